@@ -336,6 +336,18 @@ bool isSubsampled(grk_image *image) {
 	return false;
 }
 
+void log_memory_stats(void) {
+	grk_memory_stats stats;
+	if (!grk_get_memory_stats(&stats))
+		return;
+	spdlog::info("memory (KB): current / peak");
+	for (uint32_t i = 0; i < GRK_MEM_NUM_TAGS; ++i) {
+		spdlog::info("  {:<16} {:>10} / {:>10}",
+				grk_get_memory_tag_name((GRK_MEM_TAG) i),
+				stats.current[i] / 1024, stats.peak[i] / 1024);
+	}
+}
+
 int population_count(uint32_t val)
 {
 #ifdef _MSC_VER
@@ -25,6 +25,8 @@ public:
 	virtual ~IImageFormat() {}
 	virtual bool encodeHeader(grk_image *image, const std::string &filename , uint32_t compressionParam)=0;
 	virtual bool encodeStrip(uint32_t rows) = 0;
+	// encode rows held by strip, for an image passed to encodeHeader without data
+	virtual bool encodeStrip(grk_image *strip) = 0;
 	virtual bool encodeFinish(void) = 0;
 	virtual grk_image*  decode(const std::string &filename ,  grk_cparameters  *parameters)=0;
 
@@ -23,6 +23,12 @@ ImageFormat::ImageFormat() : m_image(nullptr),
 							m_row_count(0)
 {}
 
+bool ImageFormat::encodeStrip(grk_image *strip){
+	(void) strip;
+
+	return false;
+}
+
 uint32_t ImageFormat::maxY(uint32_t rows){
 	return std::min<uint32_t>(m_row_count + rows, m_image->comps[0].h);
 }
@@ -23,6 +23,8 @@ class ImageFormat : public IImageFormat {
 public:
 	ImageFormat();
 	virtual ~ImageFormat() {}
+	// by default, a format can only be encoded from a full image
+	bool encodeStrip(grk_image *strip) override;
 protected:
 	grk_image *m_image;
 	std::string m_fileName;
@@ -407,7 +407,8 @@ int PNGFormat::do_encode(const char *write_idf,
 			break;
 		if (m_image->comps[0].sgnd != m_image->comps[i].sgnd)
 			break;
-		if (!m_image->comps[i].data) {
+		// an image without data is written strip by strip
+		if (m_image->comps[0].data && !m_image->comps[i].data) {
 			spdlog::error("imagetopng: component {} is null.", i);
 			return 1;
 		}
@@ -567,8 +568,10 @@ int PNGFormat::do_encode(const char *write_idf,
 		goto beach;
 	}
 
-	for (i = 0; i < nr_comp; ++i)
-		scale_component(&(m_image->comps[i]), prec);
+	for (i = 0; i < nr_comp; ++i) {
+		if (m_image->comps[i].data)
+			scale_component(&(m_image->comps[i]), prec);
+	}
 
 	png_write_info(png, m_info);
 
@@ -627,6 +630,20 @@ bool PNGFormat::encodeHeader(grk_image *img, const std::string &filename,
 	return do_encode(filename.c_str(), compressionParam) ? false : true;
 }
 bool PNGFormat::encodeStrip(uint32_t rows){
+	return encodeRows(rows, m_image->comps[0].stride);
+}
+bool PNGFormat::encodeStrip(grk_image *strip){
+	if (strip->numcomps < nr_comp)
+		return false;
+	for (uint32_t i = 0; i < nr_comp; ++i) {
+		if (!strip->comps[i].data)
+			return false;
+		scale_component(strip->comps + i, prec);
+		m_planes[i] = strip->comps[i].data;
+	}
+	return encodeRows(strip->comps[0].h, strip->comps[0].stride);
+}
+bool PNGFormat::encodeRows(uint32_t rows, uint32_t stride){
 	cvtPlanarToInterleaved cvtPxToCx = cvtPlanarToInterleaved_LUT[nr_comp];
 	cvtFrom32 cvt32sToPack = nullptr;
 	png_bytep row_buf_cpy = row_buf;
@@ -650,7 +667,6 @@ bool PNGFormat::encodeStrip(uint32_t rows){
 
 	int32_t adjust = m_image->comps[0].sgnd ? 1 << (prec - 1) : 0;
 	size_t width = m_image->comps[0].w;
-	uint32_t stride = m_image->comps[0].stride;
 	uint32_t max = maxY(rows);
 	for (uint32_t y = m_row_count; y < max; ++y) {
 		cvtPxToCx(m_planes, buffer32s_cpy, width, adjust);
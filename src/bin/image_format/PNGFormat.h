@@ -28,12 +28,14 @@ public:
 	PNGFormat();
 	bool encodeHeader(grk_image *  m_image, const std::string &filename, uint32_t compressionParam) override;
 	bool encodeStrip(uint32_t rows) override;
+	bool encodeStrip(grk_image *strip) override;
 	bool encodeFinish(void) override;
 	grk_image *  decode(const std::string &filename,  grk_cparameters  *parameters) override;
 
 private:
 	int do_encode(const char *write_idf,	uint32_t compressionLevel);
 	grk_image* do_decode(const char *read_idf, grk_cparameters *params);
+	bool encodeRows(uint32_t rows, uint32_t stride);
 
 	png_infop m_info;
 	png_structp png;
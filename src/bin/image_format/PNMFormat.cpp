@@ -711,10 +711,9 @@ static int imagetopnm(grk_image *image, const char *outfile, bool force_split) {
 				}
 			}
 		}
-		if (writeToStdout) {
-			rc = 0;
-			goto cleanup;
-		}
+		// all components were written to a single file
+		rc = 0;
+		goto cleanup;
 	}
 
 	if (writeToStdout)
@@ -842,19 +841,174 @@ cleanup:
 	return rc;
 }/* imagetopnm() */
 
+/*
+ Write rows of image components, interleaved, with a big endian sample
+ of type T for each component
+ */
+template<typename T> static bool write_rows(FILE *fdest, grk_image *image,
+		const uint32_t *comps, uint32_t numcomps, const int32_t *adjust,
+		uint32_t rows) {
+	const size_t bufSize = 4096;
+	T buf[bufSize];
+	T *outPtr = buf;
+	size_t outCount = 0;
+	uint32_t width = image->comps[comps[0]].w;
+	for (uint32_t j = 0; j < rows; ++j) {
+		for (uint32_t i = 0; i < width; ++i) {
+			for (uint32_t k = 0; k < numcomps; ++k) {
+				auto comp = image->comps + comps[k];
+				int32_t v = comp->data[(size_t) j * comp->stride + i] + adjust[k];
+				if (!grk::writeBytes<T>((T) v, buf, &outPtr, &outCount, bufSize,
+						true, fdest))
+					return false;
+			}
+		}
+	}
+	if (outCount) {
+		size_t res = fwrite(buf, sizeof(T), outCount, fdest);
+		if (res != outCount)
+			return false;
+	}
+
+	return true;
+}
+
+PNMFormat::PNMFormat(bool split) : forceSplit(split),
+									m_numcomps(0),
+									m_two(false),
+									m_writeToStdout(false)
+{}
+
 bool PNMFormat::encodeHeader(grk_image *image, const std::string &filename,
 		uint32_t compressionParam) {
 	(void) compressionParam;
+	m_image = image;
+	m_fileName = filename;
+	m_row_count = 0;
+	// without data, the image is written in strips
+	if (image->numcomps && !image->comps[0].data)
+		return encodeStripHeader();
+
 	return imagetopnm(image, filename.c_str(), forceSplit) ? false : true;
 }
+
+/*
+ Open output and write header for an image that is written in strips.
+ Samples are laid out as imagetopnm lays them out; only images
+ written to a single file are supported.
+ */
+bool PNMFormat::encodeStripHeader(void) {
+	auto image = m_image;
+	auto outfile = m_fileName.c_str();
+	uint32_t prec = image->comps[0].prec;
+	uint32_t ncomp = image->numcomps;
+	if (prec > 16) {
+		spdlog::error("PNMFormat: precision {} is larger than 16", prec);
+		return false;
+	}
+	if (ncomp > 4) {
+		spdlog::error("PNMFormat: {} components cannot be written in strips",
+				ncomp);
+		return false;
+	}
+	size_t len = strlen(outfile);
+	bool want_gray = len >= 2
+			&& (outfile[len - 2] == 'g' || outfile[len - 2] == 'G');
+	if (want_gray)
+		ncomp = 1;
+	bool interleaved = !forceSplit && ncomp > 1;
+	if (ncomp > 1 && !interleaved) {
+		spdlog::error("PNMFormat: split components cannot be written in strips");
+		return false;
+	}
+	for (uint32_t k = 1; k < ncomp; ++k) {
+		if (image->comps[k].dx != image->comps[0].dx
+				|| image->comps[k].dy != image->comps[0].dy
+				|| image->comps[k].w != image->comps[0].w
+				|| image->comps[k].h != image->comps[0].h) {
+			spdlog::error("PNMFormat: components of different dimensions cannot"
+					" be written in strips");
+			return false;
+		}
+	}
+	m_writeToStdout = grk::useStdio(outfile);
+	if (!grk::grk_open_for_output(&m_file, outfile, m_writeToStdout))
+		return false;
+	m_two = prec > 8;
+	uint32_t width = image->comps[0].w;
+	uint32_t height = image->comps[0].h;
+	uint32_t max = (1 << prec) - 1;
+	m_numcomps = 0;
+	if (interleaved) {
+		bool triple = ncomp > 2;
+		bool has_alpha = ncomp == 4 || ncomp == 2;
+		m_comps[m_numcomps++] = 0;
+		if (triple) {
+			m_comps[m_numcomps++] = 1;
+			m_comps[m_numcomps++] = 2;
+		}
+		if (has_alpha) {
+			m_comps[m_numcomps++] = ncomp - 1;
+			fprintf(m_file, "P7\n# Grok-%s\nWIDTH %u\nHEIGHT %u\nDEPTH %u\n"
+					"MAXVAL %u\nTUPLTYPE %s\nENDHDR\n", grk_version(), width,
+					height, ncomp, max,
+					triple ? "RGB_ALPHA" : "GRAYSCALE_ALPHA");
+		} else {
+			fprintf(m_file, "P6\n# Grok-%s\n%u %u\n%u\n", grk_version(), width,
+					height, max);
+		}
+		// as in imagetopnm, 8 bit samples are not adjusted
+		for (uint32_t k = 0; k < m_numcomps; ++k) {
+			auto comp = image->comps + m_comps[k];
+			m_adjust[k] = m_two && comp->sgnd ? 1 << (comp->prec - 1) : 0;
+		}
+	} else {
+		if (image->numcomps > ncomp)
+			spdlog::warn("[PGM file] Only the first component is written out");
+		m_comps[m_numcomps++] = 0;
+		fprintf(m_file, "P5\n#Grok-%s\n%u %u\n%u\n", grk_version(), width,
+				height, max);
+		m_adjust[0] = image->comps[0].sgnd ? 1 << (prec - 1) : 0;
+	}
+
+	return !ferror(m_file);
+}
 bool PNMFormat::encodeStrip(uint32_t rows){
 
 
 	return true;
 }
+bool PNMFormat::encodeStrip(grk_image *strip){
+	if (!m_file || strip->numcomps < m_image->numcomps)
+		return false;
+	for (uint32_t k = 0; k < m_numcomps; ++k) {
+		if (!strip->comps[m_comps[k]].data)
+			return false;
+	}
+	uint32_t max = maxY(strip->comps[0].h);
+	uint32_t rows = max - m_row_count;
+	bool rc = m_two ?
+			write_rows<uint16_t>(m_file, strip, m_comps, m_numcomps, m_adjust,
+					rows) :
+			write_rows<uint8_t>(m_file, strip, m_comps, m_numcomps, m_adjust,
+					rows);
+	m_row_count = max;
+
+	return rc;
+}
 bool PNMFormat::encodeFinish(void){
+	if (!m_file)
+		return true;
+	bool rc = m_row_count == m_image->comps[0].h;
+	if (m_writeToStdout) {
+		if (fflush(m_file))
+			rc = false;
+	} else if (!grk::safe_fclose(m_file)) {
+		rc = false;
+	}
+	m_file = nullptr;
 
-	return true;
+	return rc;
 }
 grk_image* PNMFormat::decode(const std::string &filename,
 		grk_cparameters *parameters) {
@@ -20,13 +20,22 @@
 
 class PNMFormat : public ImageFormat {
 public:
-	explicit PNMFormat(bool split) : forceSplit(split) {}
+	explicit PNMFormat(bool split);
 	bool encodeHeader(grk_image *  image, const std::string &filename, uint32_t compressionParam) override;
 	bool encodeStrip(uint32_t rows) override;
+	bool encodeStrip(grk_image *strip) override;
 	bool encodeFinish(void) override;
 	grk_image *  decode(const std::string &filename,  grk_cparameters  *parameters) override;
 private:
+	bool encodeStripHeader(void);
+
 	bool forceSplit;
+	// components written to each pixel of strips, in order
+	uint32_t m_comps[4];
+	uint32_t m_numcomps;
+	int32_t m_adjust[4];
+	bool m_two;
+	bool m_writeToStdout;
 
 };
 
@@ -27,20 +27,68 @@
 #include "convert.h"
 #include "common.h"
 
+static bool components_check(grk_image *image);
+static bool write_rows(FILE *rawFile, bool big_endian, grk_image_comp *comp,
+		uint32_t rows);
+
 bool RAWFormat::encodeHeader(grk_image *image, const std::string &filename,
 		uint32_t compressionParam) {
 	(void) compressionParam;
-	return imagetoraw(image, filename.c_str(), bigEndian) ? true : false;
+	m_image = image;
+	m_fileName = filename;
+	m_row_count = 0;
+	// without data, the image is written in strips
+	if (image->numcomps && !image->comps[0].data) {
+		if (!components_check(image))
+			return false;
+		// components are stored one after the other, so each strip
+		// is written at an offset into each component
+		if (grk::useStdio(filename.c_str())) {
+			spdlog::error("RAWFormat: strips cannot be written to stdout");
+			return false;
+		}
+		return grk::grk_open_for_output(&m_file, filename.c_str(), false);
+	}
+
+	return imagetoraw(image, filename.c_str(), bigEndian) ? false : true;
 }
 bool RAWFormat::encodeStrip(uint32_t rows){
 
 
 	return true;
 }
-bool RAWFormat::encodeFinish(void){
+bool RAWFormat::encodeStrip(grk_image *strip){
+	if (!m_file || strip->numcomps < m_image->numcomps)
+		return false;
+	uint32_t max = maxY(strip->comps[0].h);
+	uint32_t rows = max - m_row_count;
+	for (uint32_t compno = 0; compno < m_image->numcomps; ++compno) {
+		auto comp = m_image->comps + compno;
+		auto strip_comp = strip->comps + compno;
+		if (!strip_comp->data)
+			return false;
+		uint64_t sample_size = comp->prec <= 8 ? 1 : 2;
+		uint64_t offset = ((uint64_t) compno * comp->h + m_row_count) * comp->w
+				* sample_size;
+		if (fseek(m_file, (long) offset, SEEK_SET))
+			return false;
+		if (!write_rows(m_file, bigEndian, strip_comp, rows))
+			return false;
+	}
+	m_row_count = max;
 
 	return true;
 }
+bool RAWFormat::encodeFinish(void){
+	if (!m_file)
+		return true;
+	bool rc = m_row_count == m_image->comps[0].h;
+	if (!grk::safe_fclose(m_file))
+		rc = false;
+	m_file = nullptr;
+
+	return rc;
+}
 grk_image* RAWFormat::decode(const std::string &filename,
 		grk_cparameters *parameters) {
 	return rawtoimage(filename.c_str(), parameters, bigEndian);
@@ -241,15 +289,40 @@ template<typename T> static bool write(FILE *rawFile, bool big_endian,
 	return true;
 }
 
-int RAWFormat::imagetoraw(grk_image *image, const char *outfile,
-		bool big_endian) {
-	bool writeToStdout = grk::useStdio(outfile);
-	FILE *rawFile = nullptr;
+/*
+ Write rows of component, clamped to its precision
+ */
+static bool write_rows(FILE *rawFile, bool big_endian, grk_image_comp *comp,
+		uint32_t rows) {
+	auto w = comp->w;
+	auto stride = comp->stride;
+	bool sgnd = comp->sgnd;
+	auto prec = comp->prec;
+	int32_t lower = sgnd ? -(1 << (prec - 1)) : 0;
+	int32_t upper = sgnd ? -lower - 1 : (1 << prec) - 1;
+	int32_t *ptr = comp->data;
+	if (prec <= 8) {
+		if (sgnd)
+			return write<int8_t>(rawFile, big_endian, ptr, w, stride, rows,
+					lower, upper);
+		return write<uint8_t>(rawFile, big_endian, ptr, w, stride, rows,
+				lower, upper);
+	}
+	if (sgnd)
+		return write<int16_t>(rawFile, big_endian, ptr, w, stride, rows, lower,
+				upper);
+	return write<uint16_t>(rawFile, big_endian, ptr, w, stride, rows, lower,
+			upper);
+}
+
+/*
+ Check that components can be stored in a raw file
+ */
+static bool components_check(grk_image *image) {
 	unsigned int compno, numcomps;
-	int fails = 1;
 	if ((image->numcomps * image->x1 * image->y1) == 0) {
 		spdlog::error("imagetoraw: invalid raw image parameters");
-		goto beach;
+		return false;
 	}
 
 	numcomps = image->numcomps;
@@ -272,8 +345,24 @@ int RAWFormat::imagetoraw(grk_image *image, const char *outfile,
 	if (compno != numcomps) {
 		spdlog::error(
 				"imagetoraw: All components shall have the same subsampling, same bit depth, same sign.");
-		goto beach;
+		return false;
+	}
+	if (image->comps[0].prec > 16) {
+		spdlog::error("imagetoraw: more than 16 bits per component no handled yet");
+		return false;
 	}
+
+	return true;
+}
+
+int RAWFormat::imagetoraw(grk_image *image, const char *outfile,
+		bool big_endian) {
+	bool writeToStdout = grk::useStdio(outfile);
+	FILE *rawFile = nullptr;
+	unsigned int compno;
+	int fails = 1;
+	if (!components_check(image))
+		goto beach;
 	if (!grk::grk_open_for_output(&rawFile, outfile,writeToStdout))
 		goto beach;
 
@@ -292,45 +381,14 @@ int RAWFormat::imagetoraw(grk_image *image, const char *outfile,
 			
 			goto beach;
 		}
-		auto w = comp->w;
-		auto h = comp->h;
-		auto stride = comp->stride;
-		bool sgnd = comp->sgnd;
-		auto prec = comp->prec;
-
-		int32_t lower = sgnd ? -(1 << (prec - 1)) : 0;
-		int32_t upper =
-				sgnd ? -lower - 1 : (1 << comp->prec) - 1;
-		int32_t *ptr = comp->data;
-
-		bool rc;
-		if (prec <= 8) {
-			if (sgnd)
-				rc = write<int8_t>(rawFile, big_endian, ptr, w, stride, h, lower,
-						upper);
-			else
-				rc = write<uint8_t>(rawFile, big_endian, ptr, w, stride, h, lower,
-						upper);
-			if (!rc)
-				spdlog::error("imagetoraw: failed to write bytes for {}",
-						outfile);
-		} else if (prec <= 16) {
-			if (sgnd)
-				rc = write<int16_t>(rawFile, big_endian, ptr, w, stride, h, lower,
-						upper);
-			else
-				rc = write<uint16_t>(rawFile, big_endian, ptr, w, stride, h, lower,
-						upper);
-			if (!rc)
-				spdlog::error("fimagetoraw: ailed to write bytes for {}",
-						outfile);
-		} else if (comp->prec <= 32) {
+		if (comp->prec > 16) {
 			spdlog::error(
 					"imagetoraw: more than 16 bits per component no handled yet");
 			goto beach;
-		} else {
-			spdlog::error("imagetoraw: invalid precision: {}",
-					comp->prec);
+		}
+		if (!write_rows(rawFile, big_endian, comp, comp->h)) {
+			spdlog::error("imagetoraw: failed to write bytes for {}",
+					outfile);
 			goto beach;
 		}
 	}
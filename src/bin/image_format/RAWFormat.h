@@ -18,11 +18,12 @@
 
 #include "ImageFormat.h"
 
-class RAWFormat : ImageFormat {
+class RAWFormat : public ImageFormat {
 public:
 	explicit RAWFormat(bool isBig) : bigEndian(isBig) {}
 	bool encodeHeader(grk_image *  image, const std::string &filename, uint32_t compressionParam) override;
 	bool encodeStrip(uint32_t rows) override;
+	bool encodeStrip(grk_image *strip) override;
 	bool encodeFinish(void) override;
 	grk_image *  decode(const std::string &filename,  grk_cparameters  *parameters) override;
 private:
@@ -1815,7 +1815,7 @@ static grk_image* tiftoimage(const char *filename,
 }/* tiftoimage() */
 
 
-static int imagetotif(grk_image *image, const char *outfile,
+int TIFFFormat::do_encode(grk_image *image, const char *outfile,
 		uint32_t compression) {
 	int tiPhoto;
 	TIFF *tif = nullptr;
@@ -1897,8 +1897,14 @@ static int imagetotif(grk_image *image, const char *outfile,
 		goto cleanup;
 	}
 
-	if (!grk::all_components_sanity_check(image,true))
+	// an image without data is written strip by strip
+	if (image->comps[0].data) {
+		if (!grk::all_components_sanity_check(image,true))
+			goto cleanup;
+	} else if (subsampled) {
+		spdlog::error("imagetotif: subsampled image cannot be written strip by strip.");
 		goto cleanup;
+	}
 
 	cvtPxToCx = cvtPlanarToInterleaved_LUT[numcomps];
 	switch (bps) {
@@ -2079,6 +2085,22 @@ static int imagetotif(grk_image *image, const char *outfile,
 		TIFFSetField(tif, TIFFTAG_EXTRASAMPLES, numExtraChannels, out.get());
 	}
 
+	if (!image->comps[0].data) {
+		m_row_buf = _TIFFmalloc(TIFFScanlineSize(tif));
+		if (!m_row_buf)
+			goto cleanup;
+		m_tif = tif;
+		tif = nullptr;
+		m_buffer32s = buffer32s;
+		buffer32s = nullptr;
+		m_cvtPxToCx = cvtPxToCx;
+		m_cvt32sToTif = cvt32sToTif;
+		m_adjust = adjust;
+		m_numcomps = numcomps;
+		success = true;
+		goto cleanup;
+	}
+
 	strip_size = TIFFStripSize(tif);
 	buf = _TIFFmalloc(strip_size);
 	if (buf == nullptr)
@@ -2150,21 +2172,72 @@ static int imagetotif(grk_image *image, const char *outfile,
 		free(buffer32s);
 
 	return success ? 0 : 1;
-}/* imagetotif() */
-
+}/* do_encode() */
+
+TIFFFormat::TIFFFormat() : m_tif(nullptr),
+							m_row_buf(nullptr),
+							m_buffer32s(nullptr),
+							m_cvtPxToCx(nullptr),
+							m_cvt32sToTif(nullptr),
+							m_adjust(0),
+							m_numcomps(0)
+{}
+TIFFFormat::~TIFFFormat() {
+	close();
+}
+void TIFFFormat::close(void){
+	if (m_tif)
+		TIFFClose(m_tif);
+	m_tif = nullptr;
+	if (m_row_buf)
+		_TIFFfree(m_row_buf);
+	m_row_buf = nullptr;
+	free(m_buffer32s);
+	m_buffer32s = nullptr;
+}
 bool TIFFFormat::encodeHeader(grk_image *image, const std::string &filename,
 		uint32_t compressionParam) {
-	return imagetotif(image, filename.c_str(), compressionParam) ? false : true;
+	m_image = image;
+	m_fileName = filename;
+	m_row_count = 0;
+	return do_encode(image, filename.c_str(), compressionParam) ? false : true;
 }
 bool TIFFFormat::encodeStrip(uint32_t rows){
 
 
 	return true;
 }
-bool TIFFFormat::encodeFinish(void){
+bool TIFFFormat::encodeStrip(grk_image *strip){
+	if (!m_tif || strip->numcomps < m_numcomps)
+		return false;
+	int32_t const *planes[maxNumComponents];
+	for (uint32_t k = 0; k < m_numcomps; ++k) {
+		if (!strip->comps[k].data)
+			return false;
+		planes[k] = strip->comps[k].data;
+	}
+	size_t width = m_image->comps[0].w;
+	uint32_t max = maxY(strip->comps[0].h);
+	for (uint32_t y = m_row_count; y < max; ++y) {
+		m_cvtPxToCx(planes, m_buffer32s, width, m_adjust);
+		m_cvt32sToTif(m_buffer32s, (uint8_t*) m_row_buf, width * m_numcomps);
+		if (TIFFWriteScanline(m_tif, m_row_buf, y, 0) < 0)
+			return false;
+		for (uint32_t k = 0; k < m_numcomps; ++k)
+			planes[k] += strip->comps[k].stride;
+	}
+	m_row_count = max;
 
 	return true;
 }
+bool TIFFFormat::encodeFinish(void){
+	if (!m_tif)
+		return true;
+	bool rc = m_row_count == m_image->comps[0].h && TIFFFlush(m_tif) == 1;
+	close();
+
+	return rc;
+}
 grk_image* TIFFFormat::decode(const std::string &filename,
 		grk_cparameters *parameters) {
 	return tiftoimage(filename.c_str(), parameters);
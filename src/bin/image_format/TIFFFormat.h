@@ -16,6 +16,8 @@
 
 #pragma once
 #include "ImageFormat.h"
+#include "convert.h"
+#include <tiffio.h>
 
 
  /* TIFF conversion*/
@@ -23,8 +25,23 @@ void tiffSetErrorAndWarningHandlers(bool verbose);
 
 class TIFFFormat: public ImageFormat {
 public:
+	TIFFFormat();
+	~TIFFFormat();
 	bool encodeHeader(grk_image *  image, const std::string &filename, uint32_t compressionParam) override;
 	bool encodeStrip(uint32_t rows) override;
+	bool encodeStrip(grk_image *strip) override;
 	bool encodeFinish(void) override;
 	grk_image *  decode(const std::string &filename,  grk_cparameters  *parameters) override;
+private:
+	int do_encode(grk_image *image, const char *outfile, uint32_t compression);
+	void close(void);
+
+	// state kept open while an image without data is written strip by strip
+	TIFF *m_tif;
+	tdata_t m_row_buf;
+	int32_t *m_buffer32s;
+	cvtPlanarToInterleaved m_cvtPxToCx;
+	cvtFrom32 m_cvt32sToTif;
+	int32_t m_adjust;
+	uint32_t m_numcomps;
 };
@@ -217,10 +217,12 @@ static void encode_help_display(void) {
 	fprintf(stdout,	"    Specify PSNR for successive layers (-q 30,40,50).\n");
 	fprintf(stdout, "    Increasing PSNR values required.\n");
 	fprintf(stdout, "    Note: options -r and -q cannot be used together.\n");
-	fprintf(stdout, "[-A|-RateControlAlgorithm] <0|1>\n");
+	fprintf(stdout, "[-A|-RateControlAlgorithm] <0|1|2>\n");
 	fprintf(stdout, "    Select algorithm used for rate control\n");
 	fprintf(stdout,	"    0: Bisection search for optimal threshold using all code passes in code blocks. (default) (slightly higher PSRN than algorithm 1)\n");
 	fprintf(stdout,	"    1: Bisection search for optimal threshold using only feasible truncation points, on convex hull.\n");
+	fprintf(stdout,	"    2: Bisection search for a single optimal threshold across all tiles, using only feasible truncation points.\n");
+	fprintf(stdout,	"       Rates (-r) then apply to the whole image rather than to each tile.\n");
 	fprintf(stdout, "[-n|-Resolutions] <number of resolutions>\n");
 	fprintf(stdout, "    Number of resolutions.\n");
 	fprintf(stdout,	"    This value corresponds to the (number of DWT decompositions + 1). \n");
@@ -331,6 +333,13 @@ static void encode_help_display(void) {
 	fprintf(stdout, "    Path to T1 plugin.\n");
 	fprintf(stdout, "[-H|-num_threads] <number of threads>\n");
 	fprintf(stdout, "    Number of threads used by libgrokj2k library.\n");
+	fprintf(stdout, "[-N|-TileWindow] <number of tiles>\n");
+	fprintf(stdout, "    Maximum number of tiles held in memory while compressing.\n"
+					"    Tiles are written in order and freed as soon as they are written.\n"
+					"    Default is twice the number of threads.\n");
+	fprintf(stdout, "[-B|-MaxMemory] <megabytes>\n");
+	fprintf(stdout, "    Maximum memory used by tiles being compressed, or waiting to be written.\n"
+					"    New tiles are not started until memory is released. Default is unlimited.\n");
 	fprintf(stdout, "[-G|-DeviceId] <device ID>\n");
 	fprintf(stdout,	"    (GPU) Specify which GPU accelerator to run codec on.\n");
 	fprintf(stdout, "    A value of -1 will specify all devices.\n");
@@ -513,6 +522,11 @@ static int parse_cmdline_encoder_ex(int argc, char **argv,
 				"", "string", cmd);
 		ValueArg<uint32_t> numThreadsArg("H", "num_threads",
 				"Number of threads", false, 0, "unsigned integer", cmd);
+		ValueArg<uint32_t> tileWindowArg("N", "TileWindow",
+				"Maximum number of tiles in flight", false, 0, "unsigned integer", cmd);
+		ValueArg<uint32_t> maxMemoryArg("B", "MaxMemory",
+				"Maximum memory of tiles in flight, in megabytes", false, 0,
+				"unsigned integer", cmd);
 
 		ValueArg<int32_t> deviceIdArg("G", "DeviceId", "Device ID", false, 0,
 				"integer", cmd);
@@ -643,6 +657,13 @@ static int parse_cmdline_encoder_ex(int argc, char **argv,
 		if (numThreadsArg.isSet())
 			parameters->numThreads = numThreadsArg.getValue();
 
+		if (tileWindowArg.isSet())
+			parameters->tileWindow = tileWindowArg.getValue();
+
+		if (maxMemoryArg.isSet())
+			parameters->maxMemory = (uint64_t) maxMemoryArg.getValue() * 1024
+					* 1024;
+
 		if (deviceIdArg.isSet())
 			parameters->deviceId = deviceIdArg.getValue();
 
@@ -1738,6 +1759,8 @@ int main(int argc, char **argv) {
 			spdlog::info("compress time: {} ms/image",
 					(elapsed.count() * 1000) / (double) num_compressed_files);
 		}
+		if (initParams.parameters.verbose)
+			log_memory_stats();
 	} catch (std::bad_alloc &ba) {
 		spdlog::error(" Out of memory. Exiting.");
 		success = 1;
@@ -2175,6 +2198,8 @@ static int plugin_main(int argc, char **argv, CompressInitParams *initParams) {
 		success = 1;
 		goto cleanup;
 	}
+	if (initParams->parameters.verbose)
+		grk_set_memory_accounting(true);
 
 	img_fol_plugin = initParams->img_fol;
 	out_fol_plugin = initParams->out_fol;
@@ -65,6 +65,7 @@ using namespace grk;
 #include "grk_string.h"
 #include <climits>
 #include <string>
+#include <vector>
 #define TCLAP_NAMESTARTSTRING "-"
 #include "tclap/CmdLine.h"
 #include <chrono>
@@ -167,6 +168,9 @@ static void decode_help_display(void) {
 			"    Path to T1 plugin.\n");
 	fprintf(stdout, "  [-H | -num_threads] <number of threads>\n"
 			"    Number of threads used by libgrokj2k library.\n");
+	fprintf(stdout, "  [-B | -MaxMemory] <megabytes>\n"
+			"    Maximum memory used by tiles being decompressed. New tiles are\n"
+			"    not started until memory is released. Default is unlimited.\n");
 	fprintf(stdout,	"  [-c|-Compression] <compression method>\n"
 					"	Compress output image data. Currently, this option is only applicable when\n"
 					"	output format is set to TIF. Possible values are:\n"
@@ -212,6 +216,11 @@ static void decode_help_display(void) {
 	fprintf(stdout,
 			"  [-X | -XML] <xml file name> \n"
 			"    Store XML metadata to file. File name will be set to \"xml file name\" + \".xml\"\n");
+	fprintf(stdout,
+			"  [-x | -Index] <index file name>\n"
+			"    Load tile part index written by grk_dump, so that the tile selected\n"
+			"    with -t is located without scanning the code stream.\n"
+			"    The index is ignored if the code stream has changed since it was written.\n");
 	fprintf(stdout,
 			"  [-W | -logfile] <log file name>\n"
 			"    log to file. File name will be set to \"log file name\"\n");
@@ -456,6 +465,9 @@ int parse_cmdline_decoder(int argc, char **argv,
 				"", "string", cmd);
 		ValueArg<uint32_t> numThreadsArg("H", "num_threads",
 				"Number of threads", false, 0, "unsigned integer", cmd);
+		ValueArg<uint32_t> maxMemoryArg("B", "MaxMemory",
+				"Maximum memory of tiles in flight, in megabytes", false, 0,
+				"unsigned integer", cmd);
 		ValueArg<string> inputFileArg("i", "InputFile", "Input file", false, "",
 				"string", cmd);
 		ValueArg<string> outputFileArg("o", "OutputFile", "Output file", false,
@@ -482,6 +494,9 @@ int parse_cmdline_decoder(int argc, char **argv,
 
 		SwitchArg xmlArg("X", "XML", "XML metadata", cmd);
 
+		ValueArg<string> indexArg("x", "Index", "Index file", false, "",
+				"string", cmd);
+
 		// Kernel build flags:
 		// 1 indicates build binary, otherwise load binary
 		// 2 indicates generate binaries
@@ -671,6 +686,14 @@ int parse_cmdline_decoder(int argc, char **argv,
 			parameters->tile_index = (uint16_t) tileArg.getValue();
 			parameters->nb_tile_to_decode = 1;
 		}
+		if (indexArg.isSet()) {
+			if (grk::strcpy_s(parameters->indexfilename,
+					sizeof(parameters->indexfilename),
+					indexArg.getValue().c_str()) != 0) {
+				spdlog::error("Path is too long");
+				return 1;
+			}
+		}
 		if (precisionArg.isSet()) {
 			if (!parse_precision(precisionArg.getValue().c_str(), parameters))
 				return 1;
@@ -678,6 +701,9 @@ int parse_cmdline_decoder(int argc, char **argv,
 		if (numThreadsArg.isSet()) {
 			parameters->numThreads = numThreadsArg.getValue();
 		}
+		if (maxMemoryArg.isSet())
+			parameters->core.max_memory = (uint64_t) maxMemoryArg.getValue()
+					* 1024 * 1024;
 
 		if (decodeRegionArg.isSet()) {
 			size_t size_optarg = (size_t) strlen(
@@ -1052,6 +1078,143 @@ struct DecompressInitParams {
 
 };
 
+/*
+ Writes output strip by strip, while the image is being decompressed,
+ so that the full decompressed image is never held in memory
+ */
+struct StripWriter {
+	StripWriter(IImageFormat *format, grk_image *image, const char *fileName,
+			uint32_t compressionParam) :
+			format(format), image(image), fileName(fileName), compressionParam(
+					compressionParam), started(false) {
+	}
+	~StripWriter() {
+		delete format;
+	}
+	bool write(grk_image *strip) {
+		if (!started) {
+			started = true;
+			if (!format->encodeHeader(image, fileName, compressionParam))
+				return false;
+		}
+		return format->encodeStrip(strip);
+	}
+	bool finish(void) {
+		return started ? format->encodeFinish() : true;
+	}
+	IImageFormat *format;
+	grk_image *image;
+	std::string fileName;
+	uint32_t compressionParam;
+	bool started;
+};
+
+static bool write_strip(grk_image *strip, void *user_data) {
+	return ((StripWriter*) user_data)->write(strip);
+}
+
+/*
+ Strips can be written directly when the output image
+ needs no post-processing once fully decompressed
+ */
+static bool can_write_strips(grk_plugin_decode_callback_info *info,
+		const char *outfile, int decod_format,
+		GRK_SUPPORTED_FILE_FMT cod_format) {
+	auto parameters = info->decoder_parameters;
+	auto image = info->image;
+	if (!store_file_to_disk || info->tile || decod_format != GRK_J2K_FMT
+			|| parameters->nb_tile_to_decode || parameters->upsample
+			|| parameters->force_rgb || parameters->precision)
+		return false;
+	switch (cod_format) {
+	case GRK_PNG_FMT:
+	case GRK_TIF_FMT:
+		break;
+	case GRK_PXM_FMT:
+		// split components are written to separate files
+		if (parameters->split_pnm && image->numcomps > 1)
+			return false;
+		break;
+	case GRK_RAW_FMT:
+	case GRK_RAWL_FMT:
+		// components are stored one after the other
+		if (grk::useStdio(outfile))
+			return false;
+		break;
+	default:
+		return false;
+	}
+	if (info->header_info.t_grid_width * info->header_info.t_grid_height < 2)
+		return false;
+	if (image->numcomps > 4)
+		return false;
+	for (uint32_t i = 0; i < image->numcomps; ++i) {
+		auto comp = image->comps + i;
+		if (comp->dx != 1 || comp->dy != 1
+				|| comp->prec != image->comps[0].prec
+				|| comp->sgnd != image->comps[0].sgnd)
+			return false;
+	}
+	return true;
+}
+
+/*
+ Create strip writer for output format, or nullptr
+ if format cannot be written strip by strip
+ */
+static StripWriter* create_strip_writer(grk_decompress_parameters *parameters,
+		grk_image *image, const char *outfile,
+		GRK_SUPPORTED_FILE_FMT cod_format) {
+	switch (cod_format) {
+	case GRK_PXM_FMT:
+		return new StripWriter(new PNMFormat(parameters->split_pnm), image,
+				outfile, 0);
+	case GRK_RAW_FMT:
+		return new StripWriter(new RAWFormat(true), image, outfile, 0);
+	case GRK_RAWL_FMT:
+		return new StripWriter(new RAWFormat(false), image, outfile, 0);
+#ifdef GROK_HAVE_LIBPNG
+	case GRK_PNG_FMT:
+		return new StripWriter(new PNGFormat(), image, outfile,
+				parameters->compressionLevel);
+#endif
+#ifdef GROK_HAVE_LIBTIFF
+	case GRK_TIF_FMT:
+		return new StripWriter(new TIFFFormat(), image, outfile,
+				parameters->compression);
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+/*
+ Load tile part index written by grk_dump
+ */
+static bool load_index(grk_codec codec, const char *file_name) {
+	auto fp = fopen(file_name, "rb");
+	if (!fp) {
+		spdlog::warn("grk_decompress: unable to open index file {}", file_name);
+		return false;
+	}
+	std::vector<uint8_t> buffer;
+	bool rc = false;
+	if (fseek(fp, 0, SEEK_END) == 0) {
+		auto len = ftell(fp);
+		if (len > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+			buffer.resize((size_t) len);
+			rc = fread(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+		}
+	}
+	fclose(fp);
+	if (!rc) {
+		spdlog::warn("grk_decompress: unable to read index file {}", file_name);
+		return false;
+	}
+
+	return grk_read_index(codec, buffer.data(), buffer.size());
+}
+
 static int decode_callback(grk_plugin_decode_callback_info *info);
 static int pre_decode(grk_plugin_decode_callback_info *info);
 static int post_decode(grk_plugin_decode_callback_info *info);
@@ -1138,6 +1301,8 @@ int main(int argc, char **argv) {
 					(elapsed.count() * 1000)
 							/ (double) num_decompressed_images);
 		}
+		if (initParams.parameters.verbose)
+			log_memory_stats();
 	} catch (std::bad_alloc &ba) {
 		spdlog::error("Out of memory. Exiting.");
 		rc = 1;
@@ -1186,6 +1351,8 @@ int plugin_main(int argc, char **argv, DecompressInitParams *initParams) {
 		success = 1;
 		goto cleanup;
 	}
+	if (initParams->parameters.verbose)
+		grk_set_memory_accounting(true);
 	// create codec
 	grk_plugin_init_info initInfo;
 	initInfo.deviceId = initParams->parameters.deviceId;
@@ -1440,6 +1607,10 @@ int pre_decode(grk_plugin_decode_callback_info *info) {
 			}
 		}
 
+		// a stale or missing index only costs a scan of the code stream
+		if (parameters->indexfilename[0])
+			load_index(info->l_codec, parameters->indexfilename);
+
 		// store XML to file
 		if (info->header_info.xml_data && info->header_info.xml_data_len
 				&& parameters->serialize_xml) {
@@ -1497,6 +1668,26 @@ int pre_decode(grk_plugin_decode_callback_info *info) {
 		goto cleanup;
 	}
 
+	{
+		auto cod_format = (GRK_SUPPORTED_FILE_FMT) (
+				info->cod_format != GRK_UNK_FMT ?
+						info->cod_format : parameters->cod_format);
+		const char *outfile =
+				parameters->outfile[0] ?
+						parameters->outfile : info->output_file_name;
+		StripWriter *strip_writer = nullptr;
+		if (outfile && can_write_strips(info, outfile, decod_format, cod_format))
+			strip_writer = create_strip_writer(parameters, info->image,
+					outfile, cod_format);
+		// kept until post_decode
+		info->user_data = strip_writer;
+		if (strip_writer
+				&& !grk_set_strip_sink(info->l_codec, write_strip, strip_writer)) {
+			spdlog::error("grk_decompress: failed to set strip sink");
+			goto cleanup;
+		}
+	}
+
 	// decompress all tiles
 	if (!parameters->nb_tile_to_decode) {
 		if (!(grk_decompress(info->l_codec, info->tile, info->image)
@@ -1523,6 +1714,12 @@ int pre_decode(grk_plugin_decode_callback_info *info) {
 	if (failed) {
 		grk_image_destroy(info->image);
 		info->image = nullptr;
+		auto strip_writer = (StripWriter*) info->user_data;
+		if (strip_writer) {
+			strip_writer->finish();
+			delete strip_writer;
+			info->user_data = nullptr;
+		}
 	}
 
 	return failed ? 1 : 0;
@@ -1566,6 +1763,20 @@ int post_decode(grk_plugin_decode_callback_info *info) {
 			info->cod_format != GRK_UNK_FMT ?
 					info->cod_format : parameters->cod_format);
 
+	// image was already written, strip by strip
+	if (info->user_data) {
+		auto strip_writer = (StripWriter*) info->user_data;
+		bool started = strip_writer->started;
+		bool written = strip_writer->finish();
+		delete strip_writer;
+		info->user_data = nullptr;
+		if (started) {
+			if (!written)
+				spdlog::error("Outfile {} not generated", outfile);
+			failed = !written;
+			goto cleanup;
+		}
+	}
 	if (image->color_space != GRK_CLRSPC_SYCC && image->numcomps == 3
 			&& image->comps[0].dx == image->comps[0].dy
 			&& image->comps[1].dx != 1)
@@ -1759,7 +1970,7 @@ int post_decode(grk_plugin_decode_callback_info *info) {
 		case GRK_RAW_FMT:
 		{
 			RAWFormat raw(true);
-			if (raw.encodeHeader(image, outfileStr, 0)) {
+			if (!raw.encodeHeader(image, outfileStr, 0)) {
 				spdlog::error(
 						"Error generating raw file. Outfile {} not generated",
 						outfileStr);
@@ -1770,7 +1981,7 @@ int post_decode(grk_plugin_decode_callback_info *info) {
 		case GRK_RAWL_FMT:
 		{
 			RAWFormat raw(false);
-			if (raw.encodeHeader(image, outfileStr, 0)) {
+			if (!raw.encodeHeader(image, outfileStr, 0)) {
 				spdlog::error(
 						"Error generating rawl file. Outfile {} not generated",
 						outfileStr);
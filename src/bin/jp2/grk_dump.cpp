@@ -49,6 +49,7 @@ using namespace std;
 #include "convert.h"
 #include "grk_string.h"
 #include <string>
+#include <vector>
 
 
 typedef struct _dircnt {
@@ -69,6 +70,8 @@ typedef struct _img_folder {
 	bool set_out_format;
 
 	uint32_t flag;
+	/** Tile part index file */
+	char index_file[GRK_PATH_LEN];
 } img_fol;
 
 
@@ -101,6 +104,10 @@ static void decode_help_display(void) {
 	fprintf(stdout, "    OPTIONAL\n");
 	fprintf(stdout, "    Output file where file info will be dump.\n");
 	fprintf(stdout, "    By default it will be in the stdout.\n");
+	fprintf(stdout, "  -x <index file>\n");
+	fprintf(stdout, "    OPTIONAL\n");
+	fprintf(stdout, "    Write tile part index to a sidecar file, which can be\n");
+	fprintf(stdout, "    loaded by grk_decompress to locate tiles without scanning.\n");
 	fprintf(stdout, "  -v ");
 	fprintf(stdout, "    OPTIONAL\n");
 	fprintf(stdout, "    Enable informative messages\n");
@@ -227,6 +234,9 @@ static int parse_cmdline_decoder(int argc, char **argv,
 		ValueArg<string> imgDirArg("y", "ImgDir", "image directory", false, "", "string",
 				cmd);
 
+		ValueArg<string> indexArg("x", "index", "index file", false, "", "string",
+				cmd);
+
 		SwitchArg verboseArg("v", "verbose", "verbose", cmd);
 		ValueArg<uint32_t> flagArg("f", "flag",	"flag", false, 0, "unsigned integer", cmd);
 
@@ -256,6 +266,14 @@ static int parse_cmdline_decoder(int argc, char **argv,
 			}
 		}
 
+		if (indexArg.isSet()){
+			if (grk::strcpy_s(img_fol->index_file, sizeof(img_fol->index_file),
+					indexArg.getValue().c_str()) != 0) {
+				spdlog::error("Path is too long");
+				return 1;
+			}
+		}
+
 		if (imgDirArg.isSet()){
 			img_fol->imgdirpath = (char*) malloc(imgDirArg.getValue().length() + 1);
 			if (!img_fol->imgdirpath)
@@ -311,6 +329,30 @@ static int parse_cmdline_decoder(int argc, char **argv,
 
 /* -------------------------------------------------------------------------- */
 
+/**
+ * Write tile part index of code stream to sidecar file
+ */
+static bool write_index(grk_codec codec, const char *file_name) {
+	size_t len = 0;
+	if (!grk_write_index(codec, nullptr, &len))
+		return false;
+	std::vector<uint8_t> buffer(len);
+	if (!grk_write_index(codec, buffer.data(), &len))
+		return false;
+	auto fp = fopen(file_name, "wb");
+	if (!fp) {
+		spdlog::error("failed to open {} for writing", file_name);
+		return false;
+	}
+	bool rc = fwrite(buffer.data(), 1, len, fp) == len;
+	if (!grk::safe_fclose(fp))
+		rc = false;
+	if (!rc)
+		spdlog::error("failed to write index to {}", file_name);
+
+	return rc;
+}
+
 /**
  sample error debug callback expecting no client object
  */
@@ -476,6 +518,11 @@ int main(int argc, char *argv[]) {
 
 		grk_dump_codec(l_codec, img_fol.flag, fout);
 
+		if (img_fol.index_file[0] && !write_index(l_codec, img_fol.index_file)) {
+			rc = EXIT_FAILURE;
+			goto cleanup;
+		}
+
 		cstr_info = grk_get_cstr_info(l_codec);
 
 		cstr_index = grk_get_cstr_index(l_codec);
@@ -23,6 +23,10 @@
 
 namespace grk {
 
+// bounds of sparse array block dimensions, for windowed decompression
+const uint32_t sparse_min_block_dim = 16;
+const uint32_t sparse_max_block_dim = 64;
+
 TileComponent::TileComponent() :numresolutions(0),
 								numAllocatedResolutions(0),
 								resolutions_to_decompress(0),
@@ -32,6 +36,7 @@ TileComponent::TileComponent() :numresolutions(0),
 						#endif
 							   numpix(0),
 							   buf(nullptr),
+							   buf16(nullptr),
 							   whole_tile_decoding(true),
 							   m_is_encoder(false),
 							   m_sa(nullptr),
@@ -42,7 +47,7 @@ TileComponent::~TileComponent(){
 	release_mem();
 	delete buf;
 }
-void TileComponent::release_mem(){
+void TileComponent::release_mem(bool recycle){
 	if (resolutions) {
 		auto nb_resolutions = numAllocatedResolutions;
 		for (uint32_t resno = 0; resno < nb_resolutions; ++resno) {
@@ -54,20 +59,49 @@ void TileComponent::release_mem(){
 					auto precinct = band->precincts + precno;
 					precinct->deleteTagTrees();
 					if (m_is_encoder)
-						delete[] precinct->enc;
+						ArenaAllocator::destroy_array(precinct->enc,
+								precinct->numAllocatedCodeBlocks);
 					else
-						delete[] precinct->dec;
+						ArenaAllocator::destroy_array(precinct->dec,
+								precinct->numAllocatedCodeBlocks);
 				}
-				delete[] band->precincts;
+				ArenaAllocator::destroy_array(band->precincts,
+						band->numAllocatedPrecincts);
 				band->precincts = nullptr;
 			} /* for (resno */
 		}
-		delete[] resolutions;
+		ArenaAllocator::destroy_array(resolutions, numAllocatedResolutions);
 		resolutions = nullptr;
 	}
-	delete m_sa;
-	m_sa = nullptr;
+	// all code block, precinct and resolution metadata goes in one shot
+	if (recycle)
+		m_arena.reset();
+	else
+		m_arena.release();
+	if (!recycle) {
+		delete m_sa;
+		m_sa = nullptr;
+	}
+	delete buf16;
+	buf16 = nullptr;
+}
+template<typename T> bool TileComponent::grow_code_blocks(T *&blocks,
+		uint64_t num_allocated, uint64_t num_blocks) {
+	auto new_blocks = m_arena.construct_array<T>(num_blocks);
+	if (!new_blocks) {
+		GRK_ERROR("Not enough memory for code blocks");
+		return false;
+	}
+	for (uint64_t i = 0; i < num_allocated; ++i) {
+		new_blocks[i] = blocks[i];
+		blocks[i].clear();
+	}
+	ArenaAllocator::destroy_array(blocks, num_allocated);
+	blocks = new_blocks;
+
+	return true;
 }
+
 bool TileComponent::init(bool isEncoder,
 						bool whole_tile,
 						grk_image *output_image,
@@ -81,6 +115,7 @@ bool TileComponent::init(bool isEncoder,
 	m_is_encoder = isEncoder;
 	whole_tile_decoding = whole_tile;
 	m_tccp = tccp;
+	m_regions.clear();
 
 	/* extent of precincts , top left, bottom right**/
 	/* number of code blocks for a precinct*/
@@ -102,15 +137,18 @@ bool TileComponent::init(bool isEncoder,
 		resolutions_to_decompress = numresolutions
 				- cp->m_coding_params.m_dec.m_reduce;
 	}
-	if (!resolutions) {
-		resolutions = new grk_resolution[numresolutions];
-		numAllocatedResolutions = numresolutions;
-	} else if (numresolutions > numAllocatedResolutions) {
+	if (!resolutions || numresolutions > numAllocatedResolutions) {
 		auto new_resolutions =
-				new grk_resolution[numresolutions];
-		for (uint32_t i = 0; i < numresolutions; ++i)
-			new_resolutions[i] = resolutions[i];
-		delete[] resolutions;
+				m_arena.construct_array<grk_resolution>(numresolutions);
+		if (!new_resolutions) {
+			GRK_ERROR("Not enough memory for tile resolutions");
+			return false;
+		}
+		if (resolutions) {
+			for (uint32_t i = 0; i < numAllocatedResolutions; ++i)
+				new_resolutions[i] = resolutions[i];
+			ArenaAllocator::destroy_array(resolutions, numAllocatedResolutions);
+		}
 		resolutions = new_resolutions;
 		numAllocatedResolutions = numresolutions;
 	}
@@ -233,14 +271,17 @@ bool TileComponent::init(bool isEncoder,
 												image_comp->prec,
 												m_is_encoder);
 
-			if (!band->precincts && (nb_precincts > 0U)) {
-				band->precincts = new grk_precinct[nb_precincts];
-				band->numAllocatedPrecincts = nb_precincts;
-			} else if (band->numAllocatedPrecincts < nb_precincts) {
-				auto new_precincts = new grk_precinct[nb_precincts];
+			if (band->numAllocatedPrecincts < nb_precincts) {
+				auto new_precincts =
+						m_arena.construct_array<grk_precinct>(nb_precincts);
+				if (!new_precincts) {
+					GRK_ERROR("Not enough memory for precincts");
+					return false;
+				}
 				for (size_t i = 0; i < band->numAllocatedPrecincts; ++i)
 					new_precincts[i] = band->precincts[i];
-				delete[] band->precincts;
+				ArenaAllocator::destroy_array(band->precincts,
+						band->numAllocatedPrecincts);
 				band->precincts = new_precincts;
 				band->numAllocatedPrecincts = nb_precincts;
 			}
@@ -291,30 +332,18 @@ bool TileComponent::init(bool isEncoder,
 						* current_precinct->ch;
 				/*fprintf(stderr, "\t\t\t\t precinct_cw = %u x recinct_ch = %u\n",current_precinct->cw, current_precinct->ch);      */
 				if (nb_code_blocks > 0) {
-					if (isEncoder){
-						if (!current_precinct->enc){
-							current_precinct->enc = new grk_cblk_enc[nb_code_blocks];
-						} else if (nb_code_blocks > current_precinct->num_code_blocks){
-							auto new_blocks = new grk_cblk_enc[nb_code_blocks];
-							for (uint64_t i = 0; i < current_precinct->num_code_blocks; ++i){
-								new_blocks[i] = current_precinct->enc[i];
-								current_precinct->enc[i].clear();
-							}
-							delete[] current_precinct->enc;
-							current_precinct->enc = new_blocks;
-						}
-					} else {
-						if (!current_precinct->dec){
-							current_precinct->dec = new grk_cblk_dec[nb_code_blocks];
-						} else if (nb_code_blocks > current_precinct->num_code_blocks){
-							auto new_blocks = new grk_cblk_dec[nb_code_blocks];
-							for (uint64_t i = 0; i < current_precinct->num_code_blocks; ++i){
-								new_blocks[i] = current_precinct->dec[i];
-								current_precinct->dec[i].clear();
-							}
-							delete[] current_precinct->dec;
-							current_precinct->dec = new_blocks;
-						}
+					if (nb_code_blocks > current_precinct->numAllocatedCodeBlocks) {
+						if (isEncoder
+								&& !grow_code_blocks(current_precinct->enc,
+										current_precinct->numAllocatedCodeBlocks,
+										nb_code_blocks))
+							return false;
+						if (!isEncoder
+								&& !grow_code_blocks(current_precinct->dec,
+										current_precinct->numAllocatedCodeBlocks,
+										nb_code_blocks))
+							return false;
+						current_precinct->numAllocatedCodeBlocks = nb_code_blocks;
 					}
 				    current_precinct->num_code_blocks = nb_code_blocks;
 				}
@@ -333,8 +362,11 @@ bool TileComponent::init(bool isEncoder,
 					if (m_is_encoder) {
 						auto code_block = current_precinct->enc + cblkno;
 
-						if (!code_block->alloc())
+						if (!code_block->alloc(&m_arena, tcp->numlayers,
+								band->numbps)) {
+							GRK_ERROR("Not enough memory for code block");
 							return false;
+						}
 						/* code-block size (global) */
 						code_block->x0 = std::max<uint32_t>(cblkxstart,
 								current_precinct->x0);
@@ -347,9 +379,11 @@ bool TileComponent::init(bool isEncoder,
 
 						if (!current_plugin_tile
 								|| (state & GRK_PLUGIN_STATE_DEBUG)) {
-							if (!code_block->alloc_data(
-									nominalBlockSize))
+							if (!code_block->alloc_data(&m_arena,
+									nominalBlockSize)) {
+								GRK_ERROR("Not enough memory for code block data");
 								return false;
+							}
 						}
 					} else {
 						auto code_block =
@@ -391,7 +425,26 @@ bool TileComponent::is_subband_area_of_interest(uint32_t resno,
 {
 	if (whole_tile_decoding)
 		return true;
+	if (m_regions.empty())
+		return is_subband_area_of_interest(buf->unreduced_bounds(), resno,
+				bandno, aoi_x0, aoi_y0, aoi_x1, aoi_y1);
+	for (auto &region : m_regions) {
+		if (is_subband_area_of_interest(region, resno, bandno, aoi_x0,
+				aoi_y0, aoi_x1, aoi_y1))
+			return true;
+	}
+
+	return false;
+}
 
+bool TileComponent::is_subband_area_of_interest(const grk_rect &region,
+								uint32_t resno,
+								uint32_t bandno,
+								uint32_t aoi_x0,
+								uint32_t aoi_y0,
+								uint32_t aoi_x1,
+								uint32_t aoi_y1) const
+{
     /* Note: those values for filter_margin are in part the result of */
     /* experimentation. The value 2 for QMFBID=1 (5x3 filter) can be linked */
     /* to the maximum left/right extension given in tables F.2 and F.3 of the */
@@ -404,11 +457,10 @@ bool TileComponent::is_subband_area_of_interest(uint32_t resno,
 
     /* Compute the intersection of the area of interest, expressed in tile component coordinates */
     /* with the tile coordinates */
-	auto dims = buf->unreduced_bounds();
-	uint32_t tcx0 = (uint32_t)dims.x0;
-	uint32_t tcy0 = (uint32_t)dims.y0;
-	uint32_t tcx1 = (uint32_t)dims.x1;
-	uint32_t tcy1 = (uint32_t)dims.y1;
+	uint32_t tcx0 = (uint32_t)region.x0;
+	uint32_t tcy0 = (uint32_t)region.y0;
+	uint32_t tcx1 = (uint32_t)region.x1;
+	uint32_t tcy1 = (uint32_t)region.y1;
 
     /* Compute number of decomposition for this band. See table F-1 */
     uint32_t nb = (resno == 0) ?
@@ -455,12 +507,83 @@ bool TileComponent::is_subband_area_of_interest(uint32_t resno,
     return intersects;
 }
 
+void TileComponent::set_regions(const std::vector<grk_image*> &images,
+								uint32_t dx, uint32_t dy){
+	auto maxRes = resolutions + numresolutions - 1;
+	auto unreduced_dim = grk_rect(maxRes->x0, maxRes->y0, maxRes->x1, maxRes->y1);
+	m_regions.clear();
+	for (auto image : images) {
+		auto region = grk_rect(ceildiv<uint32_t>(image->x0, dx),
+								ceildiv<uint32_t>(image->y0, dy),
+								ceildiv<uint32_t>(image->x1, dx),
+								ceildiv<uint32_t>(image->y1, dy));
+		region.intersection(unreduced_dim);
+		if (region.is_non_degenerate())
+			m_regions.push_back(region);
+	}
+}
+
+bool TileComponent::update_window_bounds(void){
+	/* Compute the intersection of the area of interest, expressed in tile coordinates */
+	/* with the tile coordinates */
+	auto dims = buf->bounds();
+	uint32_t win_x0 = max<uint32_t>(x0, (uint32_t) dims.x0);
+	uint32_t win_y0 = max<uint32_t>(y0, (uint32_t) dims.y0);
+	uint32_t win_x1 = min<uint32_t>(x1, (uint32_t) dims.x1);
+	uint32_t win_y1 = min<uint32_t>(y1, (uint32_t) dims.y1);
+	if (win_x1 < win_x0 || win_y1 < win_y0)
+		return false;
+
+	for (uint32_t resno = 0; resno < resolutions_to_decompress; ++resno) {
+		auto res = resolutions + resno;
+		res->win_bounds =
+				grk_rect_u32(
+						ceildivpow2<uint32_t>(win_x0,
+								resolutions_to_decompress - 1 - resno),
+						ceildivpow2<uint32_t>(win_y0,
+								resolutions_to_decompress - 1 - resno),
+						ceildivpow2<uint32_t>(win_x1,
+								resolutions_to_decompress - 1 - resno),
+						ceildivpow2<uint32_t>(win_y1,
+								resolutions_to_decompress - 1 - resno));
+	}
+
+	return true;
+}
+
 
 void TileComponent::alloc_sparse_array(uint32_t numres){
-    auto tr_max = &(resolutions[numres - 1]);
-	uint32_t w = (uint32_t)(tr_max->x1 - tr_max->x0);
-	uint32_t h = (uint32_t)(tr_max->y1 - tr_max->y0);
-	auto sa = new sparse_array(w, h, min<uint32_t>(w, 64), min<uint32_t>(h, 64));
+	// each resolution has its own block grid, with blocks the size of
+	// its code blocks, so that aligned code blocks cover whole blocks
+	sparse_level levels[GRK_J2K_MAXRLVLS];
+    for (uint32_t resno = 0; resno < numres; ++resno) {
+        auto res = &resolutions[resno];
+        auto level = levels + resno;
+        level->width = res->width();
+        level->height = res->height();
+        uint32_t cblk_w = 0, cblk_h = 0;
+        for (uint32_t bandno = 0; bandno < res->numbands; ++bandno) {
+            auto band = &res->bands[bandno];
+            for (uint64_t precno = 0; precno < (uint64_t)res->pw * res->ph; ++precno) {
+                auto precinct = &band->precincts[precno];
+                for (uint64_t cblkno = 0; cblkno < (uint64_t)precinct->cw * precinct->ch; ++cblkno) {
+                    auto cblk = &precinct->dec[cblkno];
+                    cblk_w = max<uint32_t>(cblk_w, cblk->width());
+                    cblk_h = max<uint32_t>(cblk_h, cblk->height());
+                }
+            }
+        }
+        level->block_width = min<uint32_t>(std::clamp<uint32_t>(cblk_w,
+        		sparse_min_block_dim, sparse_max_block_dim), max<uint32_t>(level->width, 1));
+        level->block_height = min<uint32_t>(std::clamp<uint32_t>(cblk_h,
+        		sparse_min_block_dim, sparse_max_block_dim), max<uint32_t>(level->height, 1));
+    }
+    // the sparse array, and its blocks, are reused by the next tile
+    if (!m_sa)
+    	m_sa = new sparse_array();
+    if (!m_sa->init(levels, numres))
+    	throw runtime_error("unable to allocate sparse array");
+    auto sa = m_sa;
     for (uint32_t resno = 0; resno < numres; ++resno) {
         auto res = &resolutions[resno];
 
@@ -498,22 +621,20 @@ void TileComponent::alloc_sparse_array(uint32_t numres){
 							y += pres->y1 - pres->y0;
 						}
 
-						// allocate in relative coordinates
+						// allocate in relative coordinates: code blocks
+						// with data are fully written by T1 before they are read
 						if (!sa->alloc(x,
 									  y,
 									  x + cblk_w,
-									  y + cblk_h)) {
-							delete sa;
+									  y + cblk_h,
+									  !cblk->seg_buffers.empty()))
 							throw runtime_error("unable to allocate sparse array");
-						}
 					}
                 }
             }
         }
     }
-    if (m_sa)
-    	delete m_sa;
-    m_sa = sa;
+    sa->zero_uncovered();
 }
 
 
@@ -527,7 +648,7 @@ void TileComponent::create_buffer(grk_image *output_image,
 	grk_rect_u32::operator=(*(grk_rect_u32*)res);
 	auto maxRes = resolutions + numresolutions - 1;
 
-	delete buf;
+	auto prev_buf = buf;
 	buf = new TileComponentBuffer<int32_t>(output_image, dx,dy,
 											grk_rect(maxRes->x0, maxRes->y0, maxRes->x1, maxRes->y1),
 											grk_rect(x0, y0, x1, y1),
@@ -535,6 +656,16 @@ void TileComponent::create_buffer(grk_image *output_image,
 											numresolutions,
 											resolutions,
 											whole_tile_decoding);
+	// buffer of previous tile processed by this component
+	if (prev_buf) {
+		buf->recycle(prev_buf);
+		delete prev_buf;
+	}
+}
+
+void TileComponent::create_buffer16(void) {
+	delete buf16;
+	buf16 = new TileComponentBuffer<int16_t>(*buf);
 }
 
 }
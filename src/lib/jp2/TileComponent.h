@@ -34,6 +34,12 @@ struct TileComponent : public grk_rect_u32 {
 
 	void create_buffer(	grk_image *output_image,uint32_t dx,uint32_t dy);
 
+	/**
+	 * Create buffer of 16 bit coefficients with the geometry of the
+	 * tile buffer. The buffer is released by release_mem()
+	 */
+	void create_buffer16(void);
+
 	bool init(bool isEncoder,
 			bool whole_tile,
 			grk_image *output_image,
@@ -45,7 +51,13 @@ struct TileComponent : public grk_rect_u32 {
 			grk_plugin_tile *current_plugin_tile);
 
 	 void alloc_sparse_array(uint32_t numres);
-	 void release_mem();
+	 /**
+	  * Release tile metadata and coefficient buffers.
+	  *
+	  * @param recycle	if true, the arena keeps its capacity, for the
+	  * 				next tile processed by this component
+	  */
+	 void release_mem(bool recycle = false);
 
 	 bool is_subband_area_of_interest(uint32_t resno,
 	 								uint32_t bandno,
@@ -54,6 +66,26 @@ struct TileComponent : public grk_rect_u32 {
 	 								uint32_t aoi_x1,
 	 								uint32_t aoi_y1) const;
 
+	 /**
+	  * Decompress the code blocks of several regions of the output image,
+	  * rather than those of the region of the buffer. Regions are
+	  * cleared by init()
+	  *
+	  * @param images	output images of regions
+	  * @param dx		horizontal sub-sampling of component
+	  * @param dy		vertical sub-sampling of component
+	  */
+	 void set_regions(const std::vector<grk_image*> &images,
+			 	 	 	 uint32_t dx, uint32_t dy);
+
+	 /**
+	  * Set the window of interest of each resolution to decompress,
+	  * from the region of the buffer
+	  *
+	  * @return false if the region does not intersect the tile component
+	  */
+	 bool update_window_bounds(void);
+
 	uint32_t numresolutions; /* number of resolutions level */
 	uint32_t numAllocatedResolutions;
 	uint32_t resolutions_to_decompress; /* number of resolutions level to decompress (at max)*/
@@ -63,12 +95,31 @@ struct TileComponent : public grk_rect_u32 {
 #endif
 	uint64_t numpix;
 	TileComponentBuffer<int32_t> *buf;
+	// coefficients of reversible inverse wavelet transform, or nullptr
+	// if the transform runs on the 32 bit tile buffer
+	TileComponentBuffer<int16_t> *buf16;
     bool   whole_tile_decoding;
 	bool m_is_encoder;
 	sparse_array *m_sa;
+	// owns resolutions, precincts and code block metadata;
+	// released by release_mem()
+	ArenaAllocator m_arena;
 
 private:
+	template<typename T> bool grow_code_blocks(T *&blocks,
+			uint64_t num_allocated, uint64_t num_blocks);
+
+	 bool is_subband_area_of_interest(const grk_rect &region,
+	 								uint32_t resno,
+	 								uint32_t bandno,
+	 								uint32_t aoi_x0,
+	 								uint32_t aoi_y0,
+	 								uint32_t aoi_x1,
+	 								uint32_t aoi_y1) const;
+
 	TileComponentCodingParams *m_tccp;
+	// unreduced tile component coordinates of regions set by set_regions()
+	std::vector<grk_rect> m_regions;
 
 };
 
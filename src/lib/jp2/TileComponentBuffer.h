@@ -19,6 +19,7 @@
 #include "util.h"
 #include "grk_intmath.h"
 #include "TagTree.h"
+#include "FlatTagTree.h"
 #include "TileProcessor.h"
 #include <stdexcept>
 
@@ -46,8 +47,23 @@ template<typename T> struct res_buf {
 		return true;
 	}
 
+	// take over data of buffers of another resolution buffer
+	// with the same dimensions, clearing it if requested
+	void recycle(res_buf<T> *rhs, bool clear){
+		recycle(res, rhs->res, clear);
+		for (uint32_t i = 0; i < 3; ++i){
+			if (bands[i] && rhs->bands[i])
+				recycle(bands[i], rhs->bands[i], clear);
+		}
+	}
+
 	grk_buffer_2d<T> *res;
 	grk_buffer_2d<T> *bands[3];
+private:
+	static void recycle(grk_buffer_2d<T> *dest, grk_buffer_2d<T> *src, bool clear){
+		if (dest->recycle(src) && clear)
+			memset(dest->data, 0, (size_t)dest->stride * dest->height() * sizeof(T));
+	}
 };
 
 
@@ -104,15 +120,23 @@ template<typename T> struct TileComponentBuffer {
         for (uint32_t resno = 0; resno < reduced_num_resolutions; ++resno)
         	resolutions.push_back(tile_comp_resolutions+resno);
 
-        if ( use_band_buffers()) {
-        	// lowest resolution equals 0th band
-        	 res_buffers.push_back(new res_buf<T>(nullptr, tile_comp_resolutions->bands[0].to_u32()) );
-
-        	 for (uint32_t resno = 1; resno < reduced_num_resolutions; ++resno)
-        		 res_buffers.push_back(new res_buf<T>( tile_comp_resolutions+resno, m_bounds.to_u32()) );
-        } else {
-        	res_buffers.push_back(new res_buf<T>( nullptr, m_bounds.to_u32()) );
-        }
+        create_res_buffers();
+	}
+	/**
+	 * Create buffer with the same geometry as another tile component
+	 * buffer, whose samples may be of a different type
+	 *
+	 * @param rhs buffer to copy geometry from
+	 */
+	template<typename U> explicit TileComponentBuffer(const TileComponentBuffer<U> &rhs) :
+							m_unreduced_bounds(rhs.m_unreduced_bounds),
+							m_bounds(rhs.m_bounds),
+							resolutions(rhs.resolutions),
+							num_resolutions(rhs.num_resolutions),
+							m_encode(rhs.m_encode),
+							whole_tile_decoding(rhs.whole_tile_decoding)
+	{
+		create_res_buffers();
 	}
 	~TileComponentBuffer(){
 		for (auto& b : res_buffers)
@@ -240,6 +264,20 @@ template<typename T> struct TileComponentBuffer {
 	}
 
 
+	/**
+	 * Take over sample memory of the buffer of a previous tile, wherever
+	 * the two buffers have the same dimensions. The decoder's
+	 * buffers are cleared, as they would be on allocation
+	 *
+	 * @param rhs	buffer of previous tile
+	 */
+	void recycle(TileComponentBuffer<T> *rhs){
+		if (rhs->res_buffers.size() != res_buffers.size())
+			return;
+		for (size_t i = 0; i < res_buffers.size(); ++i)
+			res_buffers[i]->recycle(rhs->res_buffers[i], !m_encode);
+	}
+
 	bool alloc(){
 		for (auto& b : res_buffers) {
 			if (!b->alloc(!m_encode))
@@ -341,6 +379,19 @@ template<typename T> struct TileComponentBuffer {
 	}
 
 private:
+	template<typename U> friend struct TileComponentBuffer;
+
+	void create_res_buffers(void){
+        if ( use_band_buffers()) {
+        	// lowest resolution equals 0th band
+        	 res_buffers.push_back(new res_buf<T>(nullptr, resolutions[0]->bands[0].to_u32()) );
+
+        	 for (uint32_t resno = 1; resno < resolutions.size(); ++resno)
+        		 res_buffers.push_back(new res_buf<T>( resolutions[resno], m_bounds.to_u32()) );
+        } else {
+        	res_buffers.push_back(new res_buf<T>( nullptr, m_bounds.to_u32()) );
+        }
+	}
 
 	bool use_band_buffers() const{
 		//return !m_encode && whole_tile_decoding && resolutions.size() > 1;
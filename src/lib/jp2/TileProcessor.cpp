@@ -32,6 +32,9 @@ using namespace std;
 
 namespace grk {
 
+// internal buffer size of the stream that collects packets when writing PLT
+static const size_t plt_packet_buffer_size = 1024 * 1024;
+
 TileProcessor::TileProcessor(CodeStream *codeStream, BufferedStream *stream) :
 				 m_tile_index(0),
 				 m_poc_tile_part_index(0),
@@ -49,8 +52,17 @@ TileProcessor::TileProcessor(CodeStream *codeStream, BufferedStream *stream) :
 				m_stream(stream),
 				tp_pos(0),
 				m_tcp(nullptr),
-				m_corrupt_packet(false)
+				m_corrupt_packet(false),
+				m_global_rate_control(false),
+				m_checkpoints(nullptr),
+				m_input_buffer(nullptr),
+				m_pooled(false),
+				m_dc_level_shifted(false),
+				m_mct_applied(false)
 {
+	auto input = &codeStream->m_input_buffer;
+	if ((input->data || input->pull) && !current_plugin_tile)
+		m_input_buffer = input;
 	assert(stream);
 	tile = (grk_tile*) grk_calloc(1, sizeof(grk_tile));
 	if (!tile)
@@ -64,6 +76,41 @@ TileProcessor::TileProcessor(CodeStream *codeStream, BufferedStream *stream) :
 	tp_pos = m_cp->m_coding_params.m_enc.m_tp_pos;
 }
 
+void TileProcessor::reset(CodeStream *codeStream, BufferedStream *stream) {
+	m_tile_index = 0;
+	m_poc_tile_part_index = 0;
+	m_tile_part_index = 0;
+	tile_part_data_length = 0;
+	totnum_tp = 0;
+	pino = 0;
+	image = codeStream->m_input_image;
+	current_plugin_tile = codeStream->current_plugin_tile;
+	whole_tile_decoding = codeStream->whole_tile_decoding;
+	delete plt_markers;
+	plt_markers = nullptr;
+	m_stream = stream;
+	m_tile_part_lengths.clear();
+	m_tcp = nullptr;
+	m_corrupt_packet = false;
+	m_global_rate_control = false;
+	m_checkpoints = nullptr;
+	m_input_buffer = nullptr;
+	m_regions.clear();
+	auto input = &codeStream->m_input_buffer;
+	if ((input->data || input->pull) && !current_plugin_tile)
+		m_input_buffer = input;
+	m_dc_level_shifted = false;
+	m_mct_applied = false;
+	memset(m_resno_decoded_per_component,0, tile->numcomps * sizeof(uint32_t));
+
+	tile->numpix = 0;
+	tile->distotile = 0;
+	memset(tile->distolayer, 0, sizeof(tile->distolayer));
+	tile->packno = 0;
+	for (uint32_t compno = 0; compno < tile->numcomps; ++compno)
+		tile->comps[compno].release_mem(true);
+}
+
 TileProcessor::~TileProcessor() {
 	if (tile) {
 		delete[] tile->comps;
@@ -195,21 +242,15 @@ void TileProcessor::makelayer_feasible(uint32_t layno, uint16_t thresh,
 }
 
 /*
- Hybrid rate control using bisect algorithm with optimal truncation points
+ Compute feasible truncation points (convex hull) of all code blocks
+ in the tile, and accumulate slope range into rateInfo
  */
-bool TileProcessor::pcrd_bisect_feasible(uint32_t *all_packets_len) {
-
-	bool single_lossless = make_single_lossless_layer();
-	double cumdisto[100];
-	const double K = 1;
-	double maxSE = 0;
-
-	auto tcp = m_tcp;
-
+void TileProcessor::feasible_truncation_points(bool single_lossless,
+		RateInfo *rateInfo, double *maxSE) {
 	tile->numpix = 0;
+	*maxSE = 0;
 	uint32_t state = grk_plugin_get_debug_state();
 
-	RateInfo rateInfo;
 	for (uint32_t compno = 0; compno < tile->numcomps; compno++) {
 		auto tilec = &tile->comps[compno];
 		tilec->numpix = 0;
@@ -233,7 +274,7 @@ bool TileProcessor::pcrd_bisect_feasible(uint32_t *all_packets_len) {
 						if (!single_lossless) {
 							RateControl::convexHull(cblk->passes,
 									cblk->numPassesTotal);
-							rateInfo.synch(cblk);
+							rateInfo->synch(cblk);
 
 							tile->numpix += numPix;
 							tilec->numpix += numPix;
@@ -244,15 +285,31 @@ bool TileProcessor::pcrd_bisect_feasible(uint32_t *all_packets_len) {
 		} /* resno */
 
 		if (!single_lossless) {
-			maxSE += (double) (((uint64_t) 1 << image->comps[compno].prec) - 1)
+			*maxSE += (double) (((uint64_t) 1 << image->comps[compno].prec) - 1)
 					* (double) (((uint64_t) 1 << image->comps[compno].prec) - 1)
 					* (double) tilec->numpix;
 		}
 	} /* compno */
+}
+
+/*
+ Hybrid rate control using bisect algorithm with optimal truncation points
+ */
+bool TileProcessor::pcrd_bisect_feasible(uint32_t *all_packets_len) {
+
+	bool single_lossless = make_single_lossless_layer();
+	double cumdisto[100];
+	const double K = 1;
+	double maxSE = 0;
+
+	auto tcp = m_tcp;
+
+	RateInfo rateInfo;
+	feasible_truncation_points(single_lossless, &rateInfo, &maxSE);
 
 	if (single_lossless) {
 		makelayer_final(0);
-		if (plt_markers) {
+		if (plt_markers && !plt_from_final_pass()) {
 			auto t2 = new T2Encode(this);
 			uint32_t sim_all_packets_len = 0;
 			t2->encode_packets_simulate(m_tile_index,
@@ -267,6 +324,12 @@ bool TileProcessor::pcrd_bisect_feasible(uint32_t *all_packets_len) {
 	uint32_t max_slope = USHRT_MAX;
 
 	uint32_t upperBound = max_slope;
+	std::unique_ptr<RateEstimator> estimator;
+	if (!m_cp->m_coding_params.m_enc.m_fixed_quality
+			&& !m_cp->m_coding_params.m_enc.m_max_comp_size
+			&& !m_cp->m_coding_params.m_enc.m_exact_rate_control)
+		estimator = std::make_unique<RateEstimator>(this);
+	uint64_t prevLayersLen = 0;
 	for (uint32_t layno = 0; layno < tcp->numlayers; layno++) {
 		uint32_t lowerBound = min_slope;
 		uint32_t maxlen =
@@ -276,48 +339,72 @@ bool TileProcessor::pcrd_bisect_feasible(uint32_t *all_packets_len) {
 
 		if (layer_needs_rate_control(layno)) {
 			auto t2 = new T2Encode(this);
-			// thresh from previous iteration - starts off uninitialized
-			// used to bail out if difference with current thresh is small enough
-			uint32_t prevthresh = 0;
 			double distotarget = tile->distotile
 					- ((K * maxSE)
 							/ pow(10.0, tcp->distoratio[layno] / 10.0));
-
-			for (uint32_t i = 0; i < 128; ++i) {
-				uint32_t thresh = (lowerBound + upperBound) >> 1;
-				if (prevthresh != 0 && prevthresh == thresh)
-					break;
-				makelayer_feasible(layno, (uint16_t) thresh, false);
-				prevthresh = thresh;
-				if (m_cp->m_coding_params.m_enc.m_fixed_quality) {
-					double distoachieved =
-							layno == 0 ?
-									tile->distolayer[0] :
-									cumdisto[layno - 1]
-											+ tile->distolayer[layno];
-
-					if (distoachieved < distotarget) {
-						upperBound = thresh;
-						continue;
-					}
-					lowerBound = thresh;
-				} else {
-					if (!t2->encode_packets_simulate(m_tile_index,
-							layno + 1, all_packets_len, maxlen,
-							tp_pos, nullptr)) {
+			uint32_t layerUpperBound = upperBound;
+			uint32_t goodthresh = 0;
+			// set when estimated threshold fails exact confirmation
+			bool exact = false;
+			if (estimator)
+				estimator->beginLayer(layno, prevLayersLen);
+
+			while (true) {
+				// thresh from previous iteration - starts off uninitialized
+				// used to bail out if difference with current thresh is small enough
+				uint32_t prevthresh = 0;
+				lowerBound = min_slope;
+				upperBound = layerUpperBound;
+				for (uint32_t i = 0; i < 128; ++i) {
+					uint32_t thresh = (lowerBound + upperBound) >> 1;
+					if (prevthresh != 0 && prevthresh == thresh)
+						break;
+					makelayer_feasible(layno, (uint16_t) thresh, false);
+					prevthresh = thresh;
+					if (m_cp->m_coding_params.m_enc.m_fixed_quality) {
+						double distoachieved =
+								layno == 0 ?
+										tile->distolayer[0] :
+										cumdisto[layno - 1]
+												+ tile->distolayer[layno];
+
+						if (distoachieved < distotarget) {
+							upperBound = thresh;
+							continue;
+						}
 						lowerBound = thresh;
-						continue;
+					} else {
+						if (!layer_fits(t2, exact ? nullptr : estimator.get(),
+								layno, maxlen, all_packets_len)) {
+							lowerBound = thresh;
+							continue;
+						}
+						upperBound = thresh;
 					}
-					upperBound = thresh;
 				}
+				// choose conservative value for goodthresh
+				/* Threshold for Marcela Index */
+				// start by including everything in this layer
+				goodthresh = upperBound;
+				if (!estimator || exact)
+					break;
+
+				// confirm estimated threshold with an exact simulation
+				makelayer_feasible(layno, (uint16_t) goodthresh, false);
+				if (t2->encode_packets_simulate(m_tile_index, layno + 1,
+						all_packets_len, maxlen, tp_pos, nullptr)) {
+					prevLayersLen = *all_packets_len;
+					break;
+				}
+				// otherwise, repeat bisection of this layer with exact simulation
+				exact = true;
 			}
-			// choose conservative value for goodthresh
-			/* Threshold for Marcela Index */
-			// start by including everything in this layer
-			uint32_t goodthresh = upperBound;
 			delete t2;
 
 			makelayer_feasible(layno, (uint16_t) goodthresh, true);
+			if (estimator && !resync_estimator(estimator.get(), layno,
+					exact, &prevLayersLen))
+				estimator.reset();
 			cumdisto[layno] =
 					(layno == 0) ?
 							tile->distolayer[0] :
@@ -327,6 +414,12 @@ bool TileProcessor::pcrd_bisect_feasible(uint32_t *all_packets_len) {
 			;
 		} else {
 			makelayer_final(layno);
+			if (estimator) {
+				estimator->beginLayer(layno, prevLayersLen);
+				if (!resync_estimator(estimator.get(), layno, true,
+						&prevLayersLen))
+					estimator.reset();
+			}
 		}
 	}
 	return true;
@@ -411,7 +504,7 @@ bool TileProcessor::pcrd_bisect_simple(uint32_t *all_packets_len) {
 
 	} /* compno */
 	if (single_lossless){
-		if (plt_markers) {
+		if (plt_markers && !plt_from_final_pass()) {
 			auto t2 = new T2Encode(this);
 			uint32_t sim_all_packets_len = 0;
 			t2->encode_packets_simulate(m_tile_index,
@@ -425,6 +518,12 @@ bool TileProcessor::pcrd_bisect_simple(uint32_t *all_packets_len) {
 
 
 	double upperBound = max_slope;
+	std::unique_ptr<RateEstimator> estimator;
+	if (!m_cp->m_coding_params.m_enc.m_fixed_quality
+			&& !m_cp->m_coding_params.m_enc.m_max_comp_size
+			&& !m_cp->m_coding_params.m_enc.m_exact_rate_control)
+		estimator = std::make_unique<RateEstimator>(this);
+	uint64_t prevLayersLen = 0;
 	for (layno = 0; layno < m_tcp->numlayers; layno++) {
 		if (layer_needs_rate_control(layno)) {
 			double lowerBound = min_slope;
@@ -435,52 +534,75 @@ bool TileProcessor::pcrd_bisect_simple(uint32_t *all_packets_len) {
 			/* Threshold for Marcela Index */
 			// start by including everything in this layer
 			double goodthresh = 0;
-
-			// thresh from previous iteration - starts off uninitialized
-			// used to bail out if difference with current thresh is small enough
-			double prevthresh = -1;
 			double distotarget =
 					tile->distotile
 							- ((K * maxSE)
 									/ pow(10.0, m_tcp->distoratio[layno] / 10.0));
 
 			auto t2 = new T2Encode(this);
-			double thresh;
-			for (uint32_t i = 0; i < 128; ++i) {
-				thresh =
-						(upperBound == -1) ?
-								lowerBound : (lowerBound + upperBound) / 2;
-				make_layer_simple(layno, thresh, false);
-				if (prevthresh != -1 && (fabs(prevthresh - thresh)) < 0.001)
-					break;
-				prevthresh = thresh;
-				if (m_cp->m_coding_params.m_enc.m_fixed_quality) {
-					double distoachieved =
-							layno == 0 ?
-									tile->distolayer[0] :
-									cumdisto[layno - 1]
-											+ tile->distolayer[layno];
-
-					if (distoachieved < distotarget) {
-						upperBound = thresh;
-						continue;
-					}
-					lowerBound = thresh;
-				} else {
-					if (!t2->encode_packets_simulate(m_tile_index, layno + 1,
-							all_packets_len, maxlen,
-							tp_pos, nullptr)) {
+			double layerUpperBound = upperBound;
+			// set when estimated threshold fails exact confirmation
+			bool exact = false;
+			if (estimator)
+				estimator->beginLayer(layno, prevLayersLen);
+
+			while (true) {
+				// thresh from previous iteration - starts off uninitialized
+				// used to bail out if difference with current thresh is small enough
+				double prevthresh = -1;
+				double thresh = 0;
+				lowerBound = min_slope;
+				upperBound = layerUpperBound;
+				for (uint32_t i = 0; i < 128; ++i) {
+					thresh =
+							(upperBound == -1) ?
+									lowerBound : (lowerBound + upperBound) / 2;
+					make_layer_simple(layno, thresh, false);
+					if (prevthresh != -1 && (fabs(prevthresh - thresh)) < 0.001)
+						break;
+					prevthresh = thresh;
+					if (m_cp->m_coding_params.m_enc.m_fixed_quality) {
+						double distoachieved =
+								layno == 0 ?
+										tile->distolayer[0] :
+										cumdisto[layno - 1]
+												+ tile->distolayer[layno];
+
+						if (distoachieved < distotarget) {
+							upperBound = thresh;
+							continue;
+						}
 						lowerBound = thresh;
-						continue;
+					} else {
+						if (!layer_fits(t2, exact ? nullptr : estimator.get(),
+								layno, maxlen, all_packets_len)) {
+							lowerBound = thresh;
+							continue;
+						}
+						upperBound = thresh;
 					}
-					upperBound = thresh;
 				}
+				// choose conservative value for goodthresh
+				goodthresh = (upperBound == -1) ? thresh : upperBound;
+				if (!estimator || exact)
+					break;
+
+				// confirm estimated threshold with an exact simulation
+				make_layer_simple(layno, goodthresh, false);
+				if (t2->encode_packets_simulate(m_tile_index, layno + 1,
+						all_packets_len, maxlen, tp_pos, nullptr)) {
+					prevLayersLen = *all_packets_len;
+					break;
+				}
+				// otherwise, repeat bisection of this layer with exact simulation
+				exact = true;
 			}
-			// choose conservative value for goodthresh
-			goodthresh = (upperBound == -1) ? thresh : upperBound;
 			delete t2;
 
 			make_layer_simple(layno, goodthresh, true);
+			if (estimator && !resync_estimator(estimator.get(), layno,
+					exact, &prevLayersLen))
+				estimator.reset();
 			cumdisto[layno] =
 					(layno == 0) ?
 							tile->distolayer[0] :
@@ -498,6 +620,54 @@ bool TileProcessor::pcrd_bisect_simple(uint32_t *all_packets_len) {
 
 	return true;
 }
+
+/*
+ Decide whether packets of all layers up to and including layno fit in maxlen.
+ The rate estimator, if present, settles the question when its bounds
+ do not straddle maxlen; otherwise packets are simulated exactly.
+ */
+bool TileProcessor::layer_fits(T2Encode *t2, RateEstimator *estimator,
+		uint32_t layno, uint32_t maxlen, uint32_t *all_packets_len) {
+	if (estimator) {
+		estimator->evaluate();
+		if (estimator->upper() <= maxlen)
+			return true;
+		if (estimator->lower() > maxlen)
+			return false;
+	}
+	return t2->encode_packets_simulate(m_tile_index, layno + 1,
+			all_packets_len, maxlen, tp_pos, nullptr);
+}
+
+/*
+ Finalize layer layno in the rate estimator. If the estimator did not choose
+ the layer's truncation points, re-seed the length of all layers up to and
+ including layno from an exact simulation, so that the estimator can be used
+ again for the next layer.
+ */
+bool TileProcessor::resync_estimator(RateEstimator *estimator, uint32_t layno,
+		bool simulate, uint64_t *prevLayersLen) {
+	estimator->commit();
+	if (!simulate)
+		return true;
+	uint32_t len = 0;
+	if (!simulate_packets(layno, &len, nullptr))
+		return false;
+	*prevLayersLen = len;
+
+	return true;
+}
+
+bool TileProcessor::simulate_packets(uint32_t layno, uint32_t *all_packets_len,
+		PacketLengthMarkers *markers) {
+	auto t2 = new T2Encode(this);
+	bool rc = t2->encode_packets_simulate(m_tile_index, layno + 1,
+			all_packets_len, UINT_MAX, tp_pos, markers);
+	delete t2;
+
+	return rc;
+}
+
 static void prepareBlockForFirstLayer(grk_cblk_enc *cblk) {
 	cblk->numPassesInPreviousPackets = 0;
 	cblk->numPassesInPacket = 0;
@@ -771,16 +941,17 @@ bool TileProcessor::do_encode(void){
 
 	if (!current_plugin_tile || debugEncode) {
 		if (!debugEncode) {
-			if (!dc_level_shift_encode())
+			if (!m_dc_level_shifted && !dc_level_shift_encode())
 				return false;
-			if (!mct_encode())
+			if (!m_mct_applied && !mct_encode())
 				return false;
 		}
 		if (!debugEncode || debugMCT) {
 			if (!dwt_encode())
 				return false;
 		}
-		t1_encode();
+		if (!t1_encode())
+			return false;
 	}
 
 	if (!pre_compress_first_tile_part()) {
@@ -797,7 +968,8 @@ bool TileProcessor::pre_compress_first_tile_part(void) {
 		// 1. create PLT marker if required
 		delete plt_markers;
 		if (m_cp->m_coding_params.m_enc.writePLT){
-			if (!needs_rate_control())
+			// GlobalRateAllocator counts PLT markers in the image-wide budget
+			if (!needs_rate_control() || m_global_rate_control)
 				plt_markers = new PacketLengthMarkers(m_stream);
 			else
 				GRK_WARN("PLT marker generation disabled due to rate control.");
@@ -811,10 +983,26 @@ bool TileProcessor::pre_compress_first_tile_part(void) {
 	return true;
 }
 
+/*
+ With a single tile part, packet lengths for PLT are collected
+ by the final T2 pass rather than by a separate simulation
+ */
+bool TileProcessor::plt_from_final_pass(void) {
+	return totnum_tp == 1;
+}
+
+void TileProcessor::set_stream(BufferedStream *stream) {
+	m_stream = stream;
+	if (plt_markers)
+		plt_markers->set_stream(stream);
+}
+
 bool TileProcessor::compress_tile_part(	uint32_t *tile_bytes_written) {
 
 	//4 write PLT for first tile part
 	if (m_tile_part_index == 0 && plt_markers){
+		if (plt_from_final_pass())
+			return compress_tile_part_plt(tile_bytes_written);
 		uint32_t written = plt_markers->write();
 		*tile_bytes_written += written;
 	}
@@ -825,7 +1013,41 @@ bool TileProcessor::compress_tile_part(	uint32_t *tile_bytes_written) {
 
 	*tile_bytes_written += 2;
 
-	return t2_encode(tile_bytes_written);
+	return t2_encode(m_stream, tile_bytes_written, nullptr);
+}
+
+/*
+ Encode packets once into a growable buffer, collecting their lengths,
+ then write PLT and SOD followed by the buffered packets
+ */
+bool TileProcessor::compress_tile_part_plt(uint32_t *tile_bytes_written) {
+	auto stream = (BufferedStream*) create_growable_mem_stream(
+			plt_packet_buffer_size);
+	uint32_t packet_bytes_written = 0;
+	bool rc = t2_encode(stream, &packet_bytes_written, plt_markers)
+			&& stream->flush();
+	size_t len = 0;
+	auto data = get_growable_mem_stream_data((grk_stream*) stream, &len);
+	if (rc && len != packet_bytes_written) {
+		GRK_ERROR("Tile %u: buffered %llu packet bytes, expected %u",
+				m_tile_index, (unsigned long long) len, packet_bytes_written);
+		rc = false;
+	}
+	if (rc) {
+		*tile_bytes_written += plt_markers->write();
+
+		//3 write SOD
+		rc = m_stream->write_short(J2K_MS_SOD);
+		*tile_bytes_written += 2;
+	}
+	if (rc && packet_bytes_written) {
+		rc = m_stream->write_bytes(data, packet_bytes_written)
+				== packet_bytes_written;
+		*tile_bytes_written += packet_bytes_written;
+	}
+	delete stream;
+
+	return rc;
 }
 
 /** Returns whether a tile component should be fully decoded,
@@ -875,36 +1097,17 @@ bool TileProcessor::decompress_tile_t2(ChunkBuffer *src_buf) {
 		/* of the window of interest */
 		for (uint32_t compno = 0; compno < image->numcomps; compno++) {
 			auto tilec = tile->comps + compno;
-
-			/* Compute the intersection of the area of interest, expressed in tile coordinates */
-			/* with the tile coordinates */
-			auto dims = tilec->buf->bounds();
-			uint32_t win_x0 = max<uint32_t>(tilec->x0, (uint32_t) dims.x0);
-			uint32_t win_y0 = max<uint32_t>(tilec->y0, (uint32_t) dims.y0);
-			uint32_t win_x1 = min<uint32_t>(tilec->x1, (uint32_t) dims.x1);
-			uint32_t win_y1 = min<uint32_t>(tilec->y1, (uint32_t) dims.y1);
-			if (win_x1 < win_x0 || win_y1 < win_y0) {
+			if (!tilec->update_window_bounds()) {
 				/* We should not normally go there. The circumstance is when */
 				/* the tile coordinates do not intersect the area of interest */
 				/* Upper level logic should not even try to decompress that tile */
 				GRK_ERROR("Invalid tilec->win_xxx values.");
 				return false;
 			}
-
-			for (uint32_t resno = 0; resno < tilec->resolutions_to_decompress;
-					++resno) {
-				auto res = tilec->resolutions + resno;
-
-				res->win_bounds =
-						grk_rect_u32(
-								ceildivpow2<uint32_t>(win_x0,
-										tilec->resolutions_to_decompress - 1 - resno),
-								ceildivpow2<uint32_t>(win_y0,
-										tilec->resolutions_to_decompress - 1 - resno),
-								ceildivpow2<uint32_t>(win_x1,
-										tilec->resolutions_to_decompress - 1 - resno),
-								ceildivpow2<uint32_t>(win_y1,
-										tilec->resolutions_to_decompress - 1 - resno));
+			// code blocks of all regions are decompressed together
+			if (!m_regions.empty()) {
+				auto img_comp = image->comps + compno;
+				tilec->set_regions(m_regions, img_comp->dx, img_comp->dy);
 			}
 		}
 	}
@@ -925,6 +1128,68 @@ bool TileProcessor::decompress_tile_t2(ChunkBuffer *src_buf) {
 }
 
 
+/**
+ * Check if the reconstruction retained from a previous decompression of the
+ * tile can replace the lower resolutions of this decompression
+ */
+static bool can_restore_resolution(TileComponent *tilec,
+		const ResolutionReconstruction *recon, uint32_t numres,
+		uint32_t layers) {
+	if (recon->numres == 0 || recon->numres >= numres
+			|| recon->layers != layers)
+		return false;
+	auto res = tilec->resolutions + recon->numres - 1;
+
+	return res->width() == recon->width && res->height() == recon->height;
+}
+
+static void restore_resolution(TileComponent *tilec,
+		const ResolutionReconstruction *recon) {
+	auto src = recon->data.data();
+	auto dest = tilec->buf->ptr();
+	for (uint32_t j = 0; j < recon->height; ++j) {
+		memcpy(dest, src, recon->width * sizeof(int32_t));
+		src += recon->width;
+		dest += tilec->buf->stride();
+	}
+}
+
+static void save_resolution(TileComponent *tilec,
+		ResolutionReconstruction *recon, uint32_t numres, uint32_t layers) {
+	auto res = tilec->resolutions + numres - 1;
+	recon->numres = numres;
+	recon->layers = layers;
+	recon->width = res->width();
+	recon->height = res->height();
+	recon->data.resize((size_t) recon->width * recon->height);
+	auto src = tilec->buf->ptr();
+	auto dest = recon->data.data();
+	for (uint32_t j = 0; j < recon->height; ++j) {
+		memcpy(dest, src, recon->width * sizeof(int32_t));
+		src += tilec->buf->stride();
+		dest += recon->width;
+	}
+}
+
+/**
+ * Check that every coefficient that the signalled bit planes of the bands
+ * allow can be stored in 16 bits
+ */
+static bool bands_fit_16_bit(TileComponent *tilec,
+		TileComponentCodingParams *tccp) {
+	if (tccp->roishift)
+		return false;
+	for (uint32_t resno = 0; resno < tilec->numresolutions; ++resno) {
+		auto res = tilec->resolutions + resno;
+		for (uint32_t bandno = 0; bandno < res->numbands; ++bandno) {
+			if (res->bands[bandno].numbps > 15)
+				return false;
+		}
+	}
+
+	return true;
+}
+
 bool TileProcessor::decompress_tile_t1(void) {
 	bool doT1 = !current_plugin_tile
 			|| (current_plugin_tile->decode_flags & GRK_DECODE_T1);
@@ -943,26 +1208,73 @@ bool TileProcessor::decompress_tile_t1(void) {
 					return false;
 				}
 			}
+			uint32_t numres = m_resno_decoded_per_component[compno] + 1;
+			// when refining a whole tile to a higher resolution,
+			// the lower resolutions reconstructed previously are reused
+			ResolutionReconstruction *recon = nullptr;
+			uint32_t first_res = 1;
+			if (m_checkpoints && whole_tile_decoding && doPostT1) {
+				recon = m_checkpoints->get_reconstruction(compno);
+				if (can_restore_resolution(tilec, recon, numres,
+						m_tcp->num_layers_to_decode))
+					first_res = recon->numres;
+			}
+			// the reversible transform of low precision components
+			// runs on 16 bit coefficients
+			if (doPostT1 && whole_tile_decoding && first_res == 1 && numres > 1
+					&& tccp->qmfbid == 1 && m_tcp->mct != 2) {
+				uint32_t precision = image->comps[compno].prec;
+				// reversible MCT adds a bit to chroma components
+				if (m_tcp->mct == 1 && tile->numcomps >= 3
+						&& (compno == 1 || compno == 2))
+					precision++;
+				// the declared precision bounds the synthesis, and the
+				// signalled bit planes bound the decoded coefficients
+				if (Wavelet::fits_16_bit(precision, tilec->numresolutions)
+						&& bands_fit_16_bit(tilec, tccp))
+					tilec->create_buffer16();
+			}
 			std::vector<decodeBlockInfo*> blocks;
 			auto t1_wrap = std::unique_ptr<Tier1>(new Tier1());
-			if (!t1_wrap->prepareDecodeCodeblocks(tilec, tccp, &blocks))
+			if (!t1_wrap->prepareDecodeCodeblocks(compno, tilec, tccp,
+					first_res > 1 ? first_res : 0, m_checkpoints, &blocks))
 				return false;
+			if (first_res > 1)
+				restore_resolution(tilec, recon);
 			// !!! assume that code block dimensions do not change over components
 			if (!t1_wrap->decodeCodeblocks(m_tcp,
 					(uint16_t) m_tcp->tccps->cblkw,
 					(uint16_t) m_tcp->tccps->cblkh, &blocks))
 				return false;
 
-			if (doPostT1)
-				if (!Wavelet::decompress(this, tilec,
-						m_resno_decoded_per_component[compno] + 1, tccp->qmfbid))
+			// regions are transformed, one after the other, once all
+			// components are decompressed; the transform works in place,
+			// so the coefficients are saved for all but the first region
+			if (doPostT1 && !whole_tile_decoding && !m_regions.empty()) {
+				if (m_regions.size() > 1 && !tilec->m_sa->snapshot())
+					return false;
+				continue;
+			}
+			if (doPostT1) {
+				if (!Wavelet::decompress(this, tilec, first_res, numres,
+						tccp->qmfbid))
 					return false;
+				// nothing is left to refine at full resolution,
+				// so the reconstruction is released
+				if (recon && numres < tilec->numresolutions)
+					save_resolution(tilec, recon, numres,
+							m_tcp->num_layers_to_decode);
+				else if (recon)
+					*recon = ResolutionReconstruction();
+			}
 
-			tilec->release_mem();
+			tilec->release_mem(m_pooled);
 		}
 	}
 
 	if (doPostT1) {
+		if (!whole_tile_decoding && !m_regions.empty())
+			return decompress_regions();
 		if (!mct_decode())
 			return false;
 		if (!dc_level_shift_decode())
@@ -971,6 +1283,42 @@ bool TileProcessor::decompress_tile_t1(void) {
 	return true;
 }
 
+bool TileProcessor::decompress_regions(void) {
+	for (size_t i = 0; i < m_regions.size(); ++i) {
+		auto region = m_regions[i];
+		for (uint32_t compno = 0; compno < tile->numcomps; ++compno) {
+			auto tilec = tile->comps + compno;
+			auto tccp = m_tcp->tccps + compno;
+			// the tile buffer was created for the first region
+			if (i > 0) {
+				auto img_comp = image->comps + compno;
+				tilec->create_buffer(region, img_comp->dx, img_comp->dy);
+				if (!tilec->buf->alloc()) {
+					GRK_ERROR("Not enough memory for tile data");
+					return false;
+				}
+				tilec->m_sa->restore();
+			}
+			if (!tilec->update_window_bounds()) {
+				GRK_ERROR("Region %u does not intersect tile %u", (uint32_t) i,
+						m_tile_index + 1);
+				return false;
+			}
+			if (!Wavelet::decompress(this, tilec, 1,
+					m_resno_decoded_per_component[compno] + 1, tccp->qmfbid))
+				return false;
+		}
+		if (!mct_decode() || !dc_level_shift_decode())
+			return false;
+		if (!copy_decompressed_tile_to_output_image(region))
+			return false;
+	}
+	for (uint32_t compno = 0; compno < tile->numcomps; ++compno)
+		tile->comps[compno].release_mem(m_pooled);
+
+	return true;
+}
+
 
 void TileProcessor::copy_image_to_tile() {
 	for (uint32_t i = 0; i < image->numcomps; ++i) {
@@ -992,6 +1340,60 @@ void TileProcessor::copy_image_to_tile() {
 	}
 }
 
+bool TileProcessor::copy_input_buffer_to_tile() {
+	auto buffer = m_input_buffer;
+	auto numcomps = image->numcomps;
+	// all components have the same dimensions, so the tile components do too
+	auto tilec0 = tile->comps;
+	auto img_comp0 = image->comps;
+	uint32_t x_off = tilec0->x0 - ceildiv<uint32_t>(image->x0, img_comp0->dx);
+	uint32_t y_off = tilec0->y0 - ceildiv<uint32_t>(image->y0, img_comp0->dy);
+	uint32_t w = tilec0->width();
+	uint32_t h = tilec0->height();
+	size_t sample_size = grk_sample_size(buffer->type);
+	uint32_t step = buffer->interleaved ? numcomps : 1;
+
+	auto rows = buffer->data;
+	if (rows) {
+		rows += (size_t) y_off * buffer->stride;
+	} else {
+		rows = buffer->pull(y_off, h, buffer->user_data);
+		if (!rows) {
+			GRK_ERROR("Input rows callback failed for tile %u", m_tile_index + 1);
+			return false;
+		}
+	}
+	auto tcp = m_cp->tcps + m_tile_index;
+	bool mct = tcp->mct == 1 && numcomps >= 3;
+	bool reversible = tcp->tccps->qmfbid == 1;
+	for (uint32_t j = 0; j < h; ++j) {
+		auto row = rows + (size_t) j * buffer->stride
+				+ (size_t) x_off * step * sample_size;
+		for (uint32_t compno = 0; compno < numcomps; ++compno) {
+			auto tilec = tile->comps + compno;
+			auto src = row + compno * (buffer->interleaved ?
+					sample_size : buffer->plane_stride);
+			grk_unpack_row(src, w, buffer->type, step,
+					tcp->tccps[compno].m_dc_level_shift,
+					tilec->buf->ptr() + (size_t) j * tilec->buf->stride());
+		}
+		// transform row while it is still in cache
+		if (mct) {
+			auto c0 = tile->comps[0].buf->ptr() + (size_t) j * tile->comps[0].buf->stride();
+			auto c1 = tile->comps[1].buf->ptr() + (size_t) j * tile->comps[1].buf->stride();
+			auto c2 = tile->comps[2].buf->ptr() + (size_t) j * tile->comps[2].buf->stride();
+			if (reversible)
+				mct::encode_rev_row(c0, c1, c2, w);
+			else
+				mct::encode_irrev_row(c0, c1, c2, w);
+		}
+	}
+	m_dc_level_shifted = true;
+	m_mct_applied = mct;
+
+	return true;
+}
+
 bool TileProcessor::t2_decode(ChunkBuffer *src_buf,
 		uint64_t *p_data_read) {
 	auto t2 = new T2Decode(this);
@@ -1132,7 +1534,7 @@ bool TileProcessor::dwt_encode() {
 	return rc;
 }
 
-void TileProcessor::t1_encode() {
+bool TileProcessor::t1_encode() {
 	const double *mct_norms;
 	uint32_t mct_numcomps = 0U;
 	auto tcp = m_tcp;
@@ -1151,11 +1553,12 @@ void TileProcessor::t1_encode() {
 
 	auto t1_wrap = std::unique_ptr<Tier1>(new Tier1());
 
-	t1_wrap->encodeCodeblocks(tcp, tile, mct_norms, mct_numcomps,
+	return t1_wrap->encodeCodeblocks(tcp, tile, mct_norms, mct_numcomps,
 			needs_rate_control());
 }
 
-bool TileProcessor::t2_encode(uint32_t *all_packet_bytes_written) {
+bool TileProcessor::t2_encode(BufferedStream *stream,
+		uint32_t *all_packet_bytes_written, PacketLengthMarkers *markers) {
 
 	auto l_t2 = new T2Encode(this);
 #ifdef DEBUG_LOSSLESS_T2
@@ -1210,8 +1613,9 @@ bool TileProcessor::t2_encode(uint32_t *all_packet_bytes_written) {
 	}
 #endif
 
-	if (!l_t2->encode_packets(m_tile_index, m_tcp->numlayers, m_stream,
-			all_packet_bytes_written, m_poc_tile_part_index, tp_pos, pino)) {
+	if (!l_t2->encode_packets(m_tile_index, m_tcp->numlayers, stream,
+			all_packet_bytes_written, m_poc_tile_part_index, tp_pos, pino,
+			markers)) {
 		delete l_t2;
 		return false;
 	}
@@ -1243,6 +1647,9 @@ bool TileProcessor::t2_encode(uint32_t *all_packet_bytes_written) {
 }
 
 bool TileProcessor::rate_allocate() {
+	// layers are formed later for all tiles at once
+	if (m_global_rate_control)
+		return true;
 	if (m_cp->m_coding_params.m_enc.m_disto_alloc
 			|| m_cp->m_coding_params.m_enc.m_fixed_quality) {
 		uint32_t all_packets_len = 0;
@@ -1270,14 +1677,25 @@ bool TileProcessor::rate_allocate() {
 /**
  * tile_data stores only the decoded resolutions, in the actual precision
  * of the decoded image. This method copies a sub-region of this region
- * into p_output_image (which stores data in 32 bit precision)
+ * into p_output_image (which stores data in 32 bit precision), or, if
+ * buffer is not null, converts it into buffer, which has the layout
+ * of p_output_image components
  *
  * @param p_output_image:
+ * @param buffer: caller-owned output buffer, or nullptr
  *
  * @return:
  */
-bool TileProcessor::copy_decompressed_tile_to_output_image(	grk_image *p_output_image) {
+bool TileProcessor::copy_decompressed_tile_to_output_image(	grk_image *p_output_image,
+		const grk_output_buffer *buffer) {
 	auto image_src = image;
+	// interleaved components are converted together, once the rows
+	// of every component have been located
+	bool interleave = buffer && buffer->interleaved;
+	std::vector<const int32_t*> interleave_rows;
+	std::vector<size_t> interleave_strides;
+	uint8_t *interleave_dest = nullptr;
+	uint32_t interleave_w = 0, interleave_h = 0;
 	for (uint32_t i = 0; i < image_src->numcomps; i++) {
 		auto tilec = tile->comps + i;
 		auto comp_src = image_src->comps + i;
@@ -1347,16 +1765,51 @@ bool TileProcessor::copy_decompressed_tile_to_output_image(	grk_image *p_output_
 			return false;
 
 		size_t src_ind = 0;
+		auto src_ptr = tilec->buf->ptr();
+		if (buffer) {
+			size_t sample_size = grk_sample_size(buffer->type);
+			uint32_t step = buffer->interleaved ? p_output_image->numcomps : 1;
+			auto dest_ptr = buffer->data + (size_t) off_y0_dest * buffer->stride
+					+ ((size_t) off_x0_dest * step) * sample_size;
+			if (interleave) {
+				// all components have the dimensions of the first component
+				if (i == 0) {
+					interleave_dest = dest_ptr;
+					interleave_w = width_dest;
+					interleave_h = height_dest;
+				} else if (width_dest != interleave_w
+						|| height_dest != interleave_h) {
+					return false;
+				}
+				interleave_rows.push_back(src_ptr);
+				interleave_strides.push_back(width_dest + life_off_src);
+				continue;
+			}
+			dest_ptr += i * buffer->plane_stride;
+			for (uint32_t j = 0; j < height_dest; ++j) {
+				grk_convert_row(src_ptr + src_ind, width_dest, buffer->type,
+						dest_ptr, step);
+				dest_ptr += buffer->stride;
+				src_ind += width_dest + life_off_src;
+			}
+			continue;
+		}
 		auto dest_ind = (size_t) off_x0_dest
 				  	  + (size_t) off_y0_dest * comp_dest->stride;
 		size_t line_off_dest =  (size_t) comp_dest->stride - (size_t) width_dest;
-		auto src_ptr = tilec->buf->ptr();
 		for (uint32_t j = 0; j < height_dest; ++j) {
 			memcpy(comp_dest->data + dest_ind, src_ptr + src_ind,width_dest * sizeof(int32_t));
 			dest_ind += width_dest + line_off_dest;
 			src_ind  += width_dest + life_off_src;
 		}
 	}
+	for (uint32_t j = 0; j < interleave_h; ++j) {
+		grk_interleave_row(interleave_rows.data(), image_src->numcomps,
+				interleave_w, buffer->type, interleave_dest);
+		for (uint32_t i = 0; i < image_src->numcomps; i++)
+			interleave_rows[i] += interleave_strides[i];
+		interleave_dest += buffer->stride;
+	}
 
 	return true;
 }
@@ -1371,7 +1824,7 @@ bool TileProcessor::pre_write_tile() {
 	if (rc){
 		uint32_t nb_tiles = (uint32_t) m_cp->t_grid_height
 				* m_cp->t_grid_width;
-		bool transfer_image_to_tile = (nb_tiles == 1);
+		bool transfer_image_to_tile = (nb_tiles == 1) && !m_input_buffer;
 
 		/* if we only have one tile, then simply set tile component data equal to
 		 * image component data. Otherwise, allocate tile data and copy */
@@ -1387,7 +1840,9 @@ bool TileProcessor::pre_write_tile() {
 				}
 			}
 		}
-		if (!transfer_image_to_tile)
+		if (m_input_buffer)
+			rc = copy_input_buffer_to_tile();
+		else if (!transfer_image_to_tile)
 			copy_image_to_tile();
 	}
 
@@ -1523,21 +1978,27 @@ bool TileProcessor::prepare_sod_decoding(CodeStream *codeStream) {
 			tcp->m_tile_data = new ChunkBuffer();
 
 		auto len = tile_part_data_length;
-		uint8_t *buff = nullptr;
-		auto zeroCopy = m_stream->supportsZeroCopy();
-		if (!zeroCopy) {
-			try {
-				buff = new uint8_t[len];
-			} catch (std::bad_alloc &ex) {
-				GRK_ERROR("Not enough memory to allocate segment");
-				return false;
-			}
+		// tile part data that was prefetched is consumed without copying
+		auto prefetched = m_stream->read_prefetched(len);
+		if (prefetched) {
+			tcp->m_tile_data->push_back(prefetched);
+			current_read_size = len;
 		} else {
-			buff = m_stream->getCurrentPtr();
+			uint8_t *buff = nullptr;
+			auto zeroCopy = m_stream->supportsZeroCopy();
+			if (!zeroCopy) {
+				try {
+					buff = new uint8_t[len];
+				} catch (std::bad_alloc &ex) {
+					GRK_ERROR("Not enough memory to allocate segment");
+					return false;
+				}
+			} else {
+				buff = m_stream->getCurrentPtr();
+			}
+			current_read_size = m_stream->read(zeroCopy ? nullptr : buff, len);
+			tcp->m_tile_data->push_back(buff, len, !zeroCopy);
 		}
-		current_read_size = m_stream->read(zeroCopy ? nullptr : buff, len);
-		tcp->m_tile_data->push_back(buff, len, !zeroCopy);
-
 	}
 	if (current_read_size != tile_part_data_length)
 		codeStream->m_decoder.m_state = J2K_DEC_STATE_NO_EOC;
@@ -1655,6 +2116,7 @@ void grk_seg::clear() {
 	maxpasses = 0;
 	numPassesInPacket = 0;
 	numBytesInPacket = 0;
+	numPassesRead = 0;
 }
 
 grk_packet_length_info::grk_packet_length_info(uint32_t mylength, uint32_t bits) :
@@ -1678,6 +2140,7 @@ grk_precinct::grk_precinct() :
 		cw(0), ch(0),
 		enc(nullptr), dec(nullptr),
 		num_code_blocks(0),
+		numAllocatedCodeBlocks(0),
 		incltree(nullptr), imsbtree(nullptr) {
 }
 
@@ -1741,6 +2204,7 @@ grk_cblk_enc::grk_cblk_enc() :
 				paddedCompressedData(nullptr),
 				layers(	nullptr),
 				passes(nullptr),
+				numPassesAllocated(0),
 				numPassesInPreviousPackets(0),
 				numPassesTotal(0),
 				contextStream(nullptr)
@@ -1751,6 +2215,7 @@ grk_cblk_enc::grk_cblk_enc(const grk_cblk_enc &rhs) :
 						paddedCompressedData(rhs.paddedCompressedData),
 						layers(	rhs.layers),
 						passes(rhs.passes),
+						numPassesAllocated(rhs.numPassesAllocated),
 						numPassesInPreviousPackets(rhs.numPassesInPreviousPackets),
 						numPassesTotal(rhs.numPassesTotal),
 						contextStream(rhs.contextStream)
@@ -1762,6 +2227,7 @@ grk_cblk_enc& grk_cblk_enc::operator=(const grk_cblk_enc& rhs){
 		paddedCompressedData = rhs.paddedCompressedData;
 		layers = rhs.layers;
 		passes = rhs.passes;
+		numPassesAllocated = rhs.numPassesAllocated;
 		numPassesInPreviousPackets = rhs.numPassesInPreviousPackets;
 		numPassesTotal = rhs.numPassesTotal;
 		contextStream = rhs.contextStream;
@@ -1780,22 +2246,26 @@ void grk_cblk_enc::clear(){
 	grk_cblk::clear();
 	layers = nullptr;
 	passes = nullptr;
+	numPassesAllocated = 0;
 	contextStream = nullptr;
 #ifdef DEBUG_LOSSLESS_T2
 	packet_length_info.clear();
 #endif
 }
-bool grk_cblk_enc::alloc() {
+bool grk_cblk_enc::alloc(ArenaAllocator *arena, uint32_t numlayers,
+		uint32_t band_numbps) {
 	if (!layers) {
-		/* no memset since data */
-		layers = (grk_layer*) grk_calloc(100, sizeof(grk_layer));
+		layers = arena->construct_array<grk_layer>(numlayers);
 		if (!layers)
 			return false;
 	}
-	if (!passes) {
-		passes = (grk_pass*) grk_calloc(100, sizeof(grk_pass));
+	// code blocks never have more bit planes than their band
+	uint32_t numpasses = band_numbps ? 3 * band_numbps - 2 : 1;
+	if (numpasses > numPassesAllocated) {
+		passes = arena->construct_array<grk_pass>(numpasses);
 		if (!passes)
 			return false;
+		numPassesAllocated = numpasses;
 	}
 
 	return true;
@@ -1807,22 +2277,29 @@ bool grk_cblk_enc::alloc() {
  * This is done so that we can safely initialize the MQ coder pointer to data-1,
  * without risk of accessing uninitialized memory.
  */
-bool grk_cblk_enc::alloc_data(size_t nominalBlockSize) {
+bool grk_cblk_enc::alloc_data(ArenaAllocator *arena, size_t nominalBlockSize) {
 	uint32_t desired_data_size = (uint32_t) (nominalBlockSize * sizeof(uint32_t));
 	if (desired_data_size > compressedDataSize) {
 		if (owns_data)
 			delete[] compressedData;
+		owns_data = false;
 
 		// we add two fake zero bytes at beginning of buffer, so that mq coder
 		//can be initialized to data[-1] == actualData[1], and still point
 		//to a valid memory location
-		compressedData = new uint8_t[desired_data_size + grk_cblk_enc_compressed_data_pad_left];
+		compressedData = (uint8_t*) arena->alloc(desired_data_size +
+							grk_cblk_enc_compressed_data_pad_left,
+							GRK_MEM_CODE_BLOCK_DATA);
+		if (!compressedData) {
+			compressedDataSize = 0;
+			paddedCompressedData = nullptr;
+			return false;
+		}
 		compressedData[0] = 0;
 		compressedData[1] = 0;
 
 		paddedCompressedData = compressedData + grk_cblk_enc_compressed_data_pad_left;
 		compressedDataSize = desired_data_size;
-		owns_data = true;
 	}
 	return true;
 }
@@ -1834,10 +2311,9 @@ void grk_cblk_enc::cleanup() {
 		owns_data = false;
 	}
 	paddedCompressedData = nullptr;
-	grk_free(layers);
 	layers = nullptr;
-	grk_free(passes);
 	passes = nullptr;
+	numPassesAllocated = 0;
 }
 
 grk_cblk_dec::grk_cblk_dec() {
@@ -1868,27 +2344,18 @@ grk_cblk_dec& grk_cblk_dec::operator=(const grk_cblk_dec& rhs){
 }
 
 bool grk_cblk_dec::alloc() {
-	if (!segs) {
-		segs = new grk_seg[default_numbers_segments];
-		/*fprintf(stderr, "Allocate %u elements of code_block->data\n", default_numbers_segments * sizeof(grk_seg));*/
-
-		numSegmentsAllocated = default_numbers_segments;
+	/* sanitize, but keep segments for reuse.
+	 Segments are allocated on first use, see T2::init_seg */
+	auto l_segs = segs;
+	uint32_t l_current_max_segs = numSegmentsAllocated;
 
-		/*fprintf(stderr, "Allocate 8192 elements of code_block->data\n");*/
-		/*fprintf(stderr, "numSegmentsAllocated of code_block->data = %u\n", p_code_block->numSegmentsAllocated);*/
-
-	} else {
-		/* sanitize */
-		auto l_segs = segs;
-		uint32_t l_current_max_segs = numSegmentsAllocated;
+	/* Note: since seg_buffers simply holds references to another data buffer,
+	 we do not need to copy it to the sanitized block  */
+	cleanup_seg_buffers();
+	init();
+	segs = l_segs;
+	numSegmentsAllocated = l_current_max_segs;
 
-		/* Note: since seg_buffers simply holds references to another data buffer,
-		 we do not need to copy it to the sanitized block  */
-		cleanup_seg_buffers();
-		init();
-		segs = l_segs;
-		numSegmentsAllocated = l_current_max_segs;
-	}
 	return true;
 }
 
@@ -1918,16 +2385,13 @@ void grk_cblk_dec::cleanup() {
 		owns_data = false;
 	}
 	cleanup_seg_buffers();
-	delete[] segs;
 	segs = nullptr;
+	numSegmentsAllocated = 0;
 }
 
 void grk_cblk_dec::cleanup_seg_buffers(){
-
-	for (auto& b : seg_buffers)
-		delete b;
+	// buffers are owned by the tile component arena
 	seg_buffers.clear();
-
 }
 
 size_t grk_cblk_dec::getSegBuffersLen(){
@@ -1995,35 +2459,45 @@ void grk_precinct::initTagTrees() {
 	// if cw == 0 or ch == 0,
 	// then the precinct has no code blocks, therefore
 	// no need for inclusion and msb tag trees
-	if (cw > 0 && ch > 0) {
-		if (!incltree) {
-			try {
-				incltree = new TagTree(cw, ch);
-			} catch (std::exception &e) {
-				GRK_WARN("No incltree created.");
-			}
-		} else {
-			if (!incltree->init(cw, ch)) {
-				GRK_WARN("Failed to re-initialize incltree.");
-				delete incltree;
-				incltree = nullptr;
-			}
-		}
+	if (cw == 0 || ch == 0) {
+		deleteTagTrees();
+		return;
+	}
+	// existing trees are re-dimensioned, otherwise they
+	// are created on first use
+	if (incltree && !incltree->init(cw, ch)) {
+		GRK_WARN("Failed to re-initialize incltree.");
+		delete incltree;
+		incltree = nullptr;
+	}
+	if (imsbtree && !imsbtree->init(cw, ch)) {
+		GRK_WARN("Failed to re-initialize imsbtree.");
+		delete imsbtree;
+		imsbtree = nullptr;
+	}
+}
 
-		if (!imsbtree) {
-			try {
-				imsbtree = new TagTree(cw, ch);
-			} catch (std::exception &e) {
-				GRK_WARN("No imsbtree created.");
-			}
-		} else {
-			if (!imsbtree->init(cw, ch)) {
-				GRK_WARN("Failed to re-initialize imsbtree.");
-				delete imsbtree;
-				imsbtree = nullptr;
-			}
-		}
+PrecinctTagTree* grk_precinct::createTagTree(void) {
+	if (cw == 0 || ch == 0)
+		return nullptr;
+	try {
+		return new PrecinctTagTree(cw, ch);
+	} catch (std::exception &e) {
+		GRK_WARN("No tag tree created.");
 	}
+	return nullptr;
+}
+
+PrecinctTagTree* grk_precinct::getInclTree(void) {
+	if (!incltree)
+		incltree = createTagTree();
+	return incltree;
+}
+
+PrecinctTagTree* grk_precinct::getImsbTree(void) {
+	if (!imsbtree)
+		imsbtree = createTagTree();
+	return imsbtree;
 }
 
 grk_resolution::grk_resolution() :
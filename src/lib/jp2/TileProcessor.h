@@ -36,6 +36,7 @@ struct grk_seg {
 	uint32_t maxpasses;			  	// maximum number of passes in segment
 	uint32_t numPassesInPacket;	  // number of passes contributed by current packet
 	uint32_t numBytesInPacket;      // number of bytes contributed by current packet
+	uint32_t numPassesRead;		  // number of passes whose data has been read in full
 };
 
 struct grk_packet_length_info {
@@ -94,12 +95,17 @@ struct grk_cblk_enc : public grk_cblk {
 	grk_cblk_enc(const grk_cblk_enc &rhs);
 	grk_cblk_enc& operator=(const grk_cblk_enc& other);
 	void clear() override;
-	bool alloc();
-	bool alloc_data(size_t nominalBlockSize);
+	/**
+	 * Allocate layers, and passes for all bit planes of band,
+	 * from arena
+	 */
+	bool alloc(ArenaAllocator *arena, uint32_t numlayers, uint32_t band_numbps);
+	bool alloc_data(ArenaAllocator *arena, size_t nominalBlockSize);
 	void cleanup();
 	uint8_t *paddedCompressedData; /* data buffer*/
 	grk_layer *layers;
 	grk_pass *passes;
+	uint32_t numPassesAllocated;
 	uint32_t numPassesInPreviousPackets; /* number of passes in previous packetss */
 	uint32_t numPassesTotal; /* total number of passes in all layers */
 	uint32_t *contextStream;
@@ -118,6 +124,7 @@ struct grk_cblk_dec: public grk_cblk {
 	void cleanup_seg_buffers();
 	size_t getSegBuffersLen();
 	bool copy_to_contiguous_buffer(uint8_t *buffer);
+	// segment buffers and segments live in the tile component arena
 	std::vector<grk_buf*> seg_buffers;
 	grk_seg *segs; /* information on segments */
 	uint32_t numSegments; /* number of segment in block*/
@@ -126,17 +133,32 @@ struct grk_cblk_dec: public grk_cblk {
 };
 
 // precinct
+// define GRK_NODE_TAG_TREE to validate against node-based tag tree
+#ifdef GRK_NODE_TAG_TREE
+typedef TagTree PrecinctTagTree;
+#else
+typedef FlatTagTree PrecinctTagTree;
+#endif
+
 struct grk_precinct : public grk_rect_u32 {
 	grk_precinct();
 	void initTagTrees();
 	void deleteTagTrees();
 
+	// tag trees are created on first use, so precincts
+	// that never receive a packet don't pay for them
+	PrecinctTagTree* getInclTree(void);
+	PrecinctTagTree* getImsbTree(void);
+
 	uint32_t cw, ch; /* number of precinct in width and height */
 	grk_cblk_enc *enc;
 	grk_cblk_dec *dec;
 	uint64_t num_code_blocks;
-	TagTree *incltree; /* inclusion tree */
-	TagTree *imsbtree; /* IMSB tree */
+	uint64_t numAllocatedCodeBlocks;
+	PrecinctTagTree *incltree; /* inclusion tree */
+	PrecinctTagTree *imsbtree; /* IMSB tree */
+private:
+	PrecinctTagTree* createTagTree(void);
 };
 
 // band
@@ -175,6 +197,10 @@ struct grk_resolution : public grk_rect_u32 {
 };
 
 struct TileComponent;
+struct T2Encode;
+class RateEstimator;
+class RateInfo;
+class T1CheckpointStore;
 
 // tile
 struct grk_tile : public grk_rect_u32 {
@@ -222,6 +248,16 @@ struct TileProcessor {
 	 */
 	 bool init_tile(grk_image *output_image, bool isEncoder);
 
+	/**
+	 * Prepare tile processor for another tile of the same code stream.
+	 * Tile components keep their arenas and tile buffers, which the next
+	 * tile reuses if it has the same shape.
+	 *
+	 * @param	codeStream	code stream
+	 * @param	stream		stream
+	 */
+	 void reset(CodeStream *codeStream, BufferedStream *stream);
+
 	 bool pre_write_tile(void);
 
 	/**
@@ -260,12 +296,28 @@ struct TileProcessor {
 
 	bool needs_rate_control();
 
-	bool copy_decompressed_tile_to_output_image(grk_image *p_output_image);
+	bool copy_decompressed_tile_to_output_image(grk_image *p_output_image,
+			const grk_output_buffer *buffer = nullptr);
 
 	void copy_image_to_tile();
 
+	/**
+	 * Copy tile rows from caller-owned input buffer into tile buffers,
+	 * applying DC level shift and, if possible, the forward colour transform
+	 *
+	 * @return true if successful
+	 */
+	bool copy_input_buffer_to_tile();
+
 	bool prepare_sod_decoding(CodeStream *codeStream);
 
+	/**
+	 * Set stream that tile parts are written to
+	 *
+	 * @param stream	destination stream
+	 */
+	void set_stream(BufferedStream *stream);
+
 	/** index of tile being currently coded/decoded */
 	uint16_t m_tile_index;
 
@@ -311,6 +363,39 @@ struct TileProcessor {
 
 	uint32_t* m_resno_decoded_per_component;
 	BufferedStream *m_stream;
+
+	// Encoding only - length of each tile part written, in order
+	std::vector<uint32_t> m_tile_part_lengths;
+
+	bool layer_needs_rate_control(uint32_t layno);
+
+	/**
+	 * Compute feasible truncation points of all code blocks in the tile
+	 *
+	 * @param single_lossless 	true if tile has a single lossless layer
+	 * @param rateInfo 			accumulates minimum and maximum slopes
+	 * @param maxSE 			maximum squared error of tile
+	 */
+	void feasible_truncation_points(bool single_lossless, RateInfo *rateInfo,
+			double *maxSE);
+
+	void makelayer_feasible(uint32_t layno, uint16_t thresh, bool final);
+
+	void makelayer_final(uint32_t layno);
+
+	/**
+	 * Simulate packets of all layers up to and including layno
+	 *
+	 * @param layno 			layer number
+	 * @param all_packets_len 	length of simulated packets
+	 * @param markers 			collects packet lengths for PLT, or nullptr
+	 *
+	 * @return true if successful
+	 */
+	bool simulate_packets(uint32_t layno, uint32_t *all_packets_len,
+			PacketLengthMarkers *markers);
+
+	bool plt_from_final_pass(void);
 private:
 
 	/** position of the tile part flag in progression order*/
@@ -331,22 +416,27 @@ private:
 
 	 bool dc_level_shift_encode();
 
+	 /**
+	  * Inverse transform the decompressed code blocks once for each region,
+	  * and copy each region to its output image
+	  */
+	 bool decompress_regions(void);
+
 	 bool mct_encode();
 
 	 bool dwt_encode();
 
-	 void t1_encode();
+	 bool t1_encode();
 
-	 bool t2_encode(uint32_t *packet_bytes_written);
+	 bool t2_encode(BufferedStream *stream, uint32_t *packet_bytes_written,
+			 PacketLengthMarkers *markers);
 
-	 bool rate_allocate(void);
+	 bool compress_tile_part_plt(uint32_t *tile_bytes_written);
 
-	 bool layer_needs_rate_control(uint32_t layno);
+	 bool rate_allocate(void);
 
 	 bool make_single_lossless_layer();
 
-	 void makelayer_final(uint32_t layno);
-
 	 bool pcrd_bisect_simple(uint32_t *p_data_written);
 
 	 void make_layer_simple(uint32_t layno, double thresh,
@@ -354,11 +444,38 @@ private:
 
 	 bool pcrd_bisect_feasible(uint32_t *p_data_written);
 
-	 void makelayer_feasible(uint32_t layno, uint16_t thresh,
-			bool final);
+	 bool layer_fits(T2Encode *t2, RateEstimator *estimator, uint32_t layno,
+			 uint32_t maxlen, uint32_t *all_packets_len);
+
+	 bool resync_estimator(RateEstimator *estimator, uint32_t layno,
+			 bool simulate, uint64_t *prevLayersLen);
 public:
 	 bool m_corrupt_packet;
 
+	 // layers are formed by GlobalRateAllocator, across all tiles
+	 bool m_global_rate_control;
+
+	 // code block decoder state kept between decompressions of this tile,
+	 // or nullptr if not kept
+	 T1CheckpointStore *m_checkpoints;
+
+	 // caller-owned input buffer that the tile is compressed from,
+	 // or nullptr if it is compressed from image components
+	 const grk_input_buffer *m_input_buffer;
+
+	 // processor is returned to the code stream's pool after use,
+	 // so tile components keep their workspaces between tiles
+	 bool m_pooled;
+
+	 // output images of regions that share T2 and T1 of this tile,
+	 // or empty. The tile is initialized with the first region
+	 std::vector<grk_image*> m_regions;
+private:
+	 // DC level shift and colour transform were applied while
+	 // copying tile from input buffer
+	 bool m_dc_level_shifted;
+	 bool m_mct_applied;
+
 };
 
 }
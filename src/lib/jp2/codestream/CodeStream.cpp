@@ -20,6 +20,7 @@
  */
 
 #include "grk_includes.h"
+#include "Tier1.h"
 
 namespace grk {
 
@@ -106,7 +107,8 @@ static const  grk_dec_memory_marker_handler  *  j2k_get_marker_handler(
  */
 static bool j2k_decompress_tiles(CodeStream *codeStream);
 static bool j2k_decompress_tile_t2(CodeStream *codeStream, TileProcessor *tileProcessor);
-static bool j2k_decompress_tile_t2t1(CodeStream *codeStream, TileProcessor *tileProcessor,bool multi_tile);
+static bool j2k_decompress_tile_t2t1(CodeStream *codeStream, TileProcessor *tileProcessor,bool multi_tile,
+		grk_image *output_image);
 
 
 /**
@@ -356,6 +358,87 @@ static void transfer_image_data(grk_image *src, grk_image *dest) {
 	}
 }
 
+/**
+ Set component dimensions from image bounds, at given reduction
+ */
+static void set_image_comp_dims(grk_image *image, uint32_t reduce) {
+	auto img_comp = image->comps;
+	for (uint32_t compno = 0; compno < image->numcomps; ++compno) {
+		uint32_t comp_x1, comp_y1;
+
+		img_comp->x0 = ceildiv<uint32_t>(image->x0, img_comp->dx);
+		img_comp->y0 = ceildiv<uint32_t>(image->y0, img_comp->dy);
+		comp_x1 = ceildiv<uint32_t>(image->x1, img_comp->dx);
+		comp_y1 = ceildiv<uint32_t>(image->y1, img_comp->dy);
+
+		img_comp->w = (ceildivpow2<uint32_t>(comp_x1, reduce)
+				- ceildivpow2<uint32_t>(img_comp->x0, reduce));
+		img_comp->h = (ceildivpow2<uint32_t>(comp_y1, reduce)
+				- ceildivpow2<uint32_t>(img_comp->y0, reduce));
+
+		img_comp++;
+	}
+}
+
+/**
+ Copy region of decompressed tile to dest, for each component.
+ Assumption:  dest bounds lie within the tile, and src and dest
+ have the same number of components
+ */
+static bool copy_tile_region(const grk_image *tile, grk_image *dest,
+		uint32_t reduce) {
+	if (tile->numcomps != dest->numcomps)
+		return false;
+
+	for (uint32_t compno = 0; compno < dest->numcomps; compno++) {
+		auto src_comp = tile->comps + compno;
+		auto dest_comp = dest->comps + compno;
+		if (!grk_image_single_component_data_alloc(dest_comp))
+			return false;
+		uint32_t x_off = ceildivpow2<uint32_t>(dest_comp->x0, reduce)
+				- ceildivpow2<uint32_t>(src_comp->x0, reduce);
+		uint32_t y_off = ceildivpow2<uint32_t>(dest_comp->y0, reduce)
+				- ceildivpow2<uint32_t>(src_comp->y0, reduce);
+		assert(x_off + dest_comp->w <= src_comp->w);
+		assert(y_off + dest_comp->h <= src_comp->h);
+		auto src_ptr = src_comp->data + (size_t) y_off * src_comp->stride + x_off;
+		auto dest_ptr = dest_comp->data;
+		for (uint32_t j = 0; j < dest_comp->h; ++j) {
+			memcpy(dest_ptr, src_ptr, dest_comp->w * sizeof(int32_t));
+			src_ptr += src_comp->stride;
+			dest_ptr += dest_comp->stride;
+		}
+	}
+	return true;
+}
+
+/**
+ Copy decompressed region of tile into the part of dest that it covers,
+ for each component.
+ Assumption:  region bounds lie within dest bounds, dest data is allocated,
+ and region and dest have the same number of components
+ */
+static void paste_tile_region(const grk_image *region, grk_image *dest,
+		uint32_t reduce) {
+	for (uint32_t compno = 0; compno < dest->numcomps; compno++) {
+		auto src_comp = region->comps + compno;
+		auto dest_comp = dest->comps + compno;
+		uint32_t x_off = ceildivpow2<uint32_t>(src_comp->x0, reduce)
+				- ceildivpow2<uint32_t>(dest_comp->x0, reduce);
+		uint32_t y_off = ceildivpow2<uint32_t>(src_comp->y0, reduce)
+				- ceildivpow2<uint32_t>(dest_comp->y0, reduce);
+		assert(x_off + src_comp->w <= dest_comp->w);
+		assert(y_off + src_comp->h <= dest_comp->h);
+		auto src_ptr = src_comp->data;
+		auto dest_ptr = dest_comp->data + (size_t) y_off * dest_comp->stride + x_off;
+		for (uint32_t j = 0; j < src_comp->h; ++j) {
+			memcpy(dest_ptr, src_ptr, src_comp->w * sizeof(int32_t));
+			src_ptr += src_comp->stride;
+			dest_ptr += dest_comp->stride;
+		}
+	}
+}
+
 
 /**
  * Checks for invalid number of tile-parts in SOT marker (TPsot==TNsot). See issue 254.
@@ -542,8 +625,9 @@ static bool j2k_decompress_tile_t2(CodeStream *codeStream, TileProcessor *tilePr
 	return codeStream->decompress_tile_t2(tileProcessor);
 }
 
-static bool j2k_decompress_tile_t2t1(CodeStream *codeStream, TileProcessor *tileProcessor, bool multi_tile) {
-	return codeStream->decompress_tile_t2t1(tileProcessor, multi_tile);
+static bool j2k_decompress_tile_t2t1(CodeStream *codeStream, TileProcessor *tileProcessor, bool multi_tile,
+		grk_image *output_image) {
+	return codeStream->decompress_tile_t2t1(tileProcessor, multi_tile, output_image);
 }
 
 /**
@@ -553,12 +637,6 @@ static bool j2k_decompress_tiles(CodeStream *codeStream) {
 	return codeStream->decompress_tiles(codeStream->currentProcessor());
 }
 
-/*
- * Read and decompress one tile.
- */
-static bool j2k_decompress_tile(CodeStream *codeStream) {
-	return codeStream->decompress_tile(codeStream->currentProcessor());
-}
 
 bool j2k_check_poc_val(const grk_poc *p_pocs, uint32_t nb_pocs,
 		uint32_t nb_resolutions, uint32_t num_comps, uint32_t num_layers) {
@@ -1159,12 +1237,20 @@ CodeStream::CodeStream(bool decode, BufferedStream *stream) : m_input_image(null
 																m_tile_ind_to_dec(-1),
 																m_marker_scratch(nullptr),
 																m_marker_scratch_size(0),
+																m_marker_account(GRK_MEM_MARKERS),
+																m_strip_sink(nullptr),
+																m_strip_sink_user_data(nullptr),
+																m_decompress_to_buffer(false),
+																m_tile_parts_failed(false),
+																m_refine_tiles(false),
 																whole_tile_decoding(true),
 																current_plugin_tile(nullptr),
 																 m_nb_tile_parts_correction_checked(false),
 																 m_nb_tile_parts_correction(0)
 {
     memset(&m_cp, 0 , sizeof(CodingParams));
+    memset(&m_output_buffer, 0 , sizeof(m_output_buffer));
+    memset(&m_input_buffer, 0 , sizeof(m_input_buffer));
     if (decode){
 		m_decoder.m_default_tcp = new TileCodingParams();
 		m_decoder.m_last_sot_read_pos = 0;
@@ -1185,6 +1271,8 @@ CodeStream::~CodeStream(){
 	grk_image_destroy(m_output_image);
 	grk_free(m_marker_scratch);
 	delete m_tileProcessor;
+	for (auto &p : m_processor_pool)
+		delete p;
 }
 
 BufferedStream* CodeStream::getStream(){
@@ -1205,6 +1293,89 @@ TileProcessor* CodeStream::allocateProcessor(uint16_t tile_index){
 	}
 	return m_tileProcessor;
 }
+TileProcessor* CodeStream::acquire_processor(BufferedStream *stream){
+	{
+		std::unique_lock<std::mutex> lk(m_processor_pool_mutex);
+		if (!m_processor_pool.empty()) {
+			auto proc = m_processor_pool.back();
+			m_processor_pool.pop_back();
+			lk.unlock();
+			proc->reset(this, stream);
+			return proc;
+		}
+	}
+	auto proc = new TileProcessor(this,stream);
+	proc->m_pooled = true;
+
+	return proc;
+}
+
+void CodeStream::release_processor(TileProcessor *proc){
+	if (!proc)
+		return;
+	{
+		std::unique_lock<std::mutex> lk(m_processor_pool_mutex);
+		// enough processors for all threads, plus the one
+		// that is parsing the next tile. Under a memory budget, idle
+		// processors are not accounted for, so only one is kept
+		size_t max_pooled = m_memory_budget ?
+				1 : ThreadPool::get()->num_threads() + 1;
+		if (m_processor_pool.size() < max_pooled) {
+			m_processor_pool.push_back(proc);
+			return;
+		}
+	}
+	delete proc;
+}
+
+void CodeStream::trim_processor_pool(size_t max_pooled){
+	std::vector<TileProcessor*> trimmed;
+	{
+		std::unique_lock<std::mutex> lk(m_processor_pool_mutex);
+		while (m_processor_pool.size() > max_pooled) {
+			trimmed.push_back(m_processor_pool.back());
+			m_processor_pool.pop_back();
+		}
+	}
+	for (auto &p : trimmed)
+		delete p;
+}
+
+uint64_t CodeStream::tile_memory_estimate(uint16_t tile_index, bool compress){
+	auto image = m_input_image;
+	uint32_t p = tile_index % m_cp.t_grid_width;
+	uint32_t q = tile_index / m_cp.t_grid_width;
+	uint32_t tx0 = m_cp.tx0 + p * m_cp.t_width;
+	uint32_t ty0 = m_cp.ty0 + q * m_cp.t_height;
+	uint32_t x0 = std::max<uint32_t>(tx0, image->x0);
+	uint32_t y0 = std::max<uint32_t>(ty0, image->y0);
+	uint32_t x1 = std::min<uint32_t>(uint_adds(tx0, m_cp.t_width), image->x1);
+	uint32_t y1 = std::min<uint32_t>(uint_adds(ty0, m_cp.t_height), image->y1);
+	if (x1 <= x0 || y1 <= y0)
+		return 0;
+	uint32_t reduce = compress ? 0 : m_cp.m_coding_params.m_dec.m_reduce;
+	// a tile buffer sample, and, when compressing, its share
+	// of the nominal code block data
+	uint64_t sample_bytes = compress ?
+			sizeof(int32_t) + sizeof(uint32_t) : sizeof(int32_t);
+	uint64_t bytes = 0;
+	for (uint32_t compno = 0; compno < image->numcomps; ++compno) {
+		auto comp = image->comps + compno;
+		if (!comp->dx || !comp->dy)
+			continue;
+		uint32_t w = ceildivpow2<uint32_t>(ceildiv<uint32_t>(x1, comp->dx), reduce)
+				- ceildivpow2<uint32_t>(ceildiv<uint32_t>(x0, comp->dx), reduce);
+		uint32_t h = ceildivpow2<uint32_t>(ceildiv<uint32_t>(y1, comp->dy), reduce)
+				- ceildivpow2<uint32_t>(ceildiv<uint32_t>(y0, comp->dy), reduce);
+		bytes += (uint64_t) w * h * sample_bytes;
+	}
+	auto tcp = m_cp.tcps + tile_index;
+	if (!compress && tcp->m_tile_data)
+		bytes += tcp->m_tile_data->get_len();
+
+	return bytes;
+}
+
 TileProcessor* CodeStream::currentProcessor(void){
 	return m_tileProcessor;
 }
@@ -1325,7 +1496,22 @@ bool CodeStream::decompress( grk_plugin_tile *tile,	 grk_image *p_image){
 
 	current_plugin_tile = tile;
 
-	return do_decompress(p_image);
+	bool rc = do_decompress(p_image);
+	m_decompress_to_buffer = false;
+	// move back to the first SOT, so that another decompress area can be set
+	// and the image decompressed again by this codec
+	if (rc && m_decoder.m_state == J2K_DEC_STATE_EOC) {
+		if (!(m_stream->seek(cstr_index->main_head_end + 2))) {
+			GRK_ERROR("Problem with seek function");
+			return false;
+		}
+		m_decoder.m_state = J2K_DEC_STATE_TPH_SOT;
+	}
+	// one processor, with its tile buffers, is kept for the next
+	// decompression by this codec, rather than one for each thread
+	trim_processor_pool(1);
+
+	return rc;
 }
 
 /** decompress tile*/
@@ -1384,45 +1570,247 @@ bool CodeStream::decompress_tile(grk_image *p_image,	uint16_t tile_index){
 				original_image_rect.x1, original_image_rect.y1, tile_index);
 	}
 
-	auto img_comp = p_image->comps;
+	set_image_comp_dims(p_image, m_cp.m_coding_params.m_dec.m_reduce);
+
+	return decompress_tile_region(tile_index, tile_rect, p_image);
+}
+
+bool CodeStream::decompress_tile_region(uint16_t tile_index,
+		const grk_rect &tile_rect, grk_image *region) {
 	auto reduce = m_cp.m_coding_params.m_dec.m_reduce;
-	for (uint32_t compno = 0; compno < p_image->numcomps; ++compno) {
-		uint32_t comp_x1, comp_y1;
+	bool cache_tiles = m_tile_cache && m_tile_cache->caches_tiles();
+	TileCacheKey key(tile_index, reduce, m_cp.m_coding_params.m_dec.m_layer);
+	if (cache_tiles) {
+		auto cached = m_tile_cache->get(key);
+		if (cached)
+			return copy_tile_region(cached.get(), region, reduce);
+	}
 
-		img_comp->x0 = ceildiv<uint32_t>(p_image->x0, img_comp->dx);
-		img_comp->y0 = ceildiv<uint32_t>(p_image->y0, img_comp->dy);
-		comp_x1 = ceildiv<uint32_t>(p_image->x1, img_comp->dx);
-		comp_y1 = ceildiv<uint32_t>(p_image->y1, img_comp->dy);
+	auto output_image = grk_image_create0();
+	if (!output_image)
+		return false;
+	grk_copy_image_header(region, output_image);
+	// a tile destined for the cache is decompressed in full,
+	// and the requested region is then copied out of it
+	if (cache_tiles) {
+		output_image->x0 = (uint32_t) tile_rect.x0;
+		output_image->y0 = (uint32_t) tile_rect.y0;
+		output_image->x1 = (uint32_t) tile_rect.x1;
+		output_image->y1 = (uint32_t) tile_rect.y1;
+		set_image_comp_dims(output_image, reduce);
+	}
 
-		img_comp->w = (ceildivpow2<uint32_t>(comp_x1, reduce)
-				- ceildivpow2<uint32_t>(img_comp->x0, reduce));
-		img_comp->h = (ceildivpow2<uint32_t>(comp_y1, reduce)
-				- ceildivpow2<uint32_t>(img_comp->y0, reduce));
+	// The stream and decoder state are shared, so tiles are read one at a time,
+	// while tiles that have already been read are decompressed concurrently.
+	// A tile is not read again until its previous decompression has finished,
+	// since its coding parameters hold its compressed data.
+	TileProcessor *tileProcessor = nullptr;
+	T1CheckpointStore *checkpoints = nullptr;
+	{
+		std::unique_lock<std::mutex> lock(m_tile_mutex);
+		m_tile_cv.wait(lock, [this, tile_index] {
+			return m_tiles_in_flight.find(tile_index) == m_tiles_in_flight.end();
+		});
+		// the tile is initialized from the tile image; the image of a multi-tile
+		// decompression is restored once the tile has been read
+		auto multi_tile_image = m_output_image;
+		m_output_image = output_image;
+		m_tile_ind_to_dec = (int32_t) tile_index;
+
+		// reset tile part numbers, in case we are re-using the same codec object
+		// from previous decompress. Only tiles whose tile parts have been read
+		// are reset, so that decompressing every tile is not quadratic
+		for (auto i : m_tiles_parts_read)
+			m_cp.tcps[i].m_tile_part_index = -1;
+		m_tiles_parts_read.clear();
+
+		tileProcessor = read_tile(whole_tile_decoding);
+		m_output_image = multi_tile_image;
+		if (!tileProcessor) {
+			grk_image_destroy(output_image);
+			return false;
+		}
+		// the number of layers may have changed since the tile header was parsed
+		auto tcp = m_cp.tcps + tile_index;
+		if (m_cp.m_coding_params.m_dec.m_layer)
+			tcp->num_layers_to_decode = m_cp.m_coding_params.m_dec.m_layer;
+		else
+			tcp->num_layers_to_decode = tcp->numlayers;
+		if (m_refine_tiles) {
+			auto &store = m_checkpoints[tile_index];
+			if (!store)
+				store = std::make_unique<T1CheckpointStore>();
+			checkpoints = store.get();
+			tileProcessor->m_checkpoints = checkpoints;
+		}
+		m_tiles_in_flight.insert(tile_index);
+	}
 
-		img_comp++;
+	bool rc = j2k_decompress_tile_t2t1(this, tileProcessor, false, output_image);
+	bool decompressed = rc;
+	for (uint32_t compno = 0; compno < output_image->numcomps; ++compno)
+		decompressed = decompressed && output_image->comps[compno].data;
+	if (decompressed && cache_tiles) {
+		rc = copy_tile_region(output_image, region, reduce);
+		m_tile_cache->put(key, output_image);
+		output_image = nullptr;
+	} else if (rc) {
+		/* Move data and information from codec output image to user output image*/
+		transfer_image_data(output_image, region);
 	}
-	if (m_output_image)
-		grk_image_destroy(m_output_image);
-	m_output_image = grk_image_create0();
-	if (!(m_output_image))
+	delete tileProcessor;
+	grk_image_destroy(output_image);
+	uint64_t checkpoint_bytes = checkpoints ? checkpoints->size() : 0;
+	{
+		std::lock_guard<std::mutex> guard(m_tile_mutex);
+		// retain compressed tile data, which was not released after decompression,
+		// and release the data of least recently used tiles
+		auto tcp = m_cp.tcps + tile_index;
+		if (m_tile_cache && m_tile_cache->caches_coding_state()
+				&& tcp->m_tile_data) {
+			std::vector<uint16_t> evicted;
+			m_tile_cache->put_coding_state(tile_index,
+					tcp->m_tile_data->get_len(), m_tiles_in_flight, &evicted);
+			release_coding_state(evicted);
+		}
+		// release decoder state of least recently used tiles
+		if (checkpoints) {
+			std::vector<uint16_t> evicted;
+			m_tile_cache->put_refine_state(tile_index, checkpoint_bytes,
+					m_tiles_in_flight, &evicted);
+			for (auto evicted_index : evicted)
+				m_checkpoints.erase(evicted_index);
+		}
+		m_tiles_in_flight.erase(tile_index);
+	}
+	m_tile_cv.notify_all();
+
+	return rc;
+}
+
+/** decompress several regions in one pass */
+bool CodeStream::decompress_regions(const grk_region *regions,
+		uint32_t num_regions, grk_image **images){
+	if (!regions || !num_regions || !images) {
+		GRK_ERROR("No regions to decompress");
 		return false;
-	grk_copy_image_header(p_image, m_output_image);
-	m_tile_ind_to_dec = (int32_t) tile_index;
+	}
+	if (m_decoder.m_state != J2K_DEC_STATE_TPH_SOT) {
+		GRK_ERROR("Need to decompress the main header before decompressing regions");
+		return false;
+	}
+	if (current_plugin_tile) {
+		GRK_ERROR("Regions cannot be decompressed with a plugin");
+		return false;
+	}
+	auto image = m_input_image;
+	auto reduce = m_cp.m_coding_params.m_dec.m_reduce;
+	bool rc = true;
+	for (uint32_t i = 0; i < num_regions; ++i)
+		images[i] = nullptr;
+	for (uint32_t i = 0; i < num_regions && rc; ++i) {
+		auto region = regions + i;
+		if (region->x0 >= region->x1 || region->y0 >= region->y1
+				|| region->x0 < image->x0 || region->y0 < image->y0
+				|| region->x1 > image->x1 || region->y1 > image->y1) {
+			GRK_ERROR("Region %u (%u,%u,%u,%u) is empty or outside the image area",
+					i, region->x0, region->y0, region->x1, region->y1);
+			rc = false;
+			break;
+		}
+		images[i] = grk_image_create0();
+		if (!images[i]) {
+			rc = false;
+			break;
+		}
+		grk_copy_image_header(image, images[i]);
+		images[i]->x0 = region->x0;
+		images[i]->y0 = region->y0;
+		images[i]->x1 = region->x1;
+		images[i]->y1 = region->y1;
+		rc = update_image_dimensions(images[i], reduce)
+				&& alloc_multi_tile_output_data(images[i]);
+	}
 
-	// reset tile part numbers, in case we are re-using the same codec object
-	// from previous decompress
-	uint32_t nb_tiles = m_cp.t_grid_width * m_cp.t_grid_height;
-	for (uint32_t i = 0; i < nb_tiles; ++i)
-		m_cp.tcps[i].m_tile_part_index = -1;
+	// each tile is decompressed once, for all the regions that intersect it
+	uint32_t num_tiles = m_cp.t_grid_width * m_cp.t_grid_height;
+	for (uint32_t tile_index = 0; tile_index < num_tiles && rc; ++tile_index) {
+		uint32_t tile_x = tile_index % m_cp.t_grid_width;
+		uint32_t tile_y = tile_index / m_cp.t_grid_width;
+		uint32_t tx0 = std::max<uint32_t>(tile_x * m_cp.t_width + m_cp.tx0, image->x0);
+		uint32_t ty0 = std::max<uint32_t>(tile_y * m_cp.t_height + m_cp.ty0, image->y0);
+		uint32_t tx1 = std::min<uint32_t>((tile_x + 1) * m_cp.t_width + m_cp.tx0, image->x1);
+		uint32_t ty1 = std::min<uint32_t>((tile_y + 1) * m_cp.t_height + m_cp.ty0, image->y1);
+		std::vector<grk_image*> tile_regions;
+		for (uint32_t i = 0; i < num_regions; ++i) {
+			auto region = regions + i;
+			if (region->x0 < tx1 && region->x1 > tx0 && region->y0 < ty1
+					&& region->y1 > ty0)
+				tile_regions.push_back(images[i]);
+		}
+		if (tile_regions.empty())
+			continue;
 
-	/* customization of the decoding */
-	m_procedure_list.push_back((j2k_procedure) j2k_decompress_tile);
+		TileProcessor *tileProcessor = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_tile_mutex);
+			m_tile_cv.wait(lock, [this, tile_index] {
+				return m_tiles_in_flight.find((uint16_t)tile_index) == m_tiles_in_flight.end();
+			});
+			// the tile is initialized with the first region
+			m_output_image = tile_regions.front();
+			m_tile_ind_to_dec = (int32_t) tile_index;
+			// reset tile part numbers of tiles read since the last reset,
+			// including tiles read by concurrent grk_decompress_tile calls
+			for (auto i : m_tiles_parts_read)
+				m_cp.tcps[i].m_tile_part_index = -1;
+			m_tiles_parts_read.clear();
+			// regions are windows of the tile, and shared codec state
+			// is left untouched, for concurrent tile decompression
+			tileProcessor = read_tile(false);
+			m_output_image = nullptr;
+			if (!tileProcessor) {
+				rc = false;
+				break;
+			}
+			auto tcp = m_cp.tcps + tile_index;
+			if (m_cp.m_coding_params.m_dec.m_layer)
+				tcp->num_layers_to_decode = m_cp.m_coding_params.m_dec.m_layer;
+			else
+				tcp->num_layers_to_decode = tcp->numlayers;
+			m_tiles_in_flight.insert((uint16_t)tile_index);
+		}
+		tileProcessor->m_regions = tile_regions;
+		rc = j2k_decompress_tile_t2t1(this, tileProcessor, false, nullptr);
+		delete tileProcessor;
+		{
+			std::lock_guard<std::mutex> guard(m_tile_mutex);
+			auto tcp = m_cp.tcps + tile_index;
+			if (m_tile_cache && m_tile_cache->caches_coding_state()
+					&& tcp->m_tile_data) {
+				std::vector<uint16_t> evicted;
+				m_tile_cache->put_coding_state((uint16_t)tile_index,
+						tcp->m_tile_data->get_len(), m_tiles_in_flight, &evicted);
+				release_coding_state(evicted);
+			}
+			m_tiles_in_flight.erase((uint16_t)tile_index);
+		}
+		m_tile_cv.notify_all();
+	}
+	if (!rc) {
+		for (uint32_t i = 0; i < num_regions; ++i) {
+			grk_image_destroy(images[i]);
+			images[i] = nullptr;
+		}
+	}
 
-	return do_decompress(p_image);
+	return rc;
 }
 
 /** Reading function used after code stream if necessary */
 bool CodeStream::end_decompress(void){
+	trim_processor_pool(0);
+
 	return true;
 }
 
@@ -1431,9 +1819,193 @@ void CodeStream::init_decompress(grk_dparameters  *parameters){
 	if (parameters) {
 		m_cp.m_coding_params.m_dec.m_layer = parameters->cp_layer;
 		m_cp.m_coding_params.m_dec.m_reduce = parameters->cp_reduce;
+		m_refine_tiles = parameters->refine_tiles;
+		m_memory_budget = parameters->max_memory ?
+				std::make_unique<MemoryBudget>(parameters->max_memory) : nullptr;
+		if (!m_refine_tiles) {
+			m_checkpoints.clear();
+			if (m_tile_cache)
+				m_tile_cache->clear_refine_state();
+		}
+		// cached tiles are keyed by reduce and layers, so the cache is kept
+		// when only these change, for example when a viewer zooms
+		if (m_tile_cache
+				&& !m_tile_cache->has_limits(parameters->tile_cache_size,
+						parameters->tile_coding_cache_size,
+						parameters->tile_refine_cache_size)) {
+			std::vector<uint16_t> evicted;
+			m_tile_cache->clear_coding_state(&evicted);
+			release_coding_state(evicted);
+			m_checkpoints.clear();
+			m_tile_cache = nullptr;
+		}
+		// decoder state kept by refine_tiles is bounded by the cache
+		if (!m_tile_cache
+				&& (parameters->tile_cache_size
+						|| parameters->tile_coding_cache_size
+						|| m_refine_tiles))
+			m_tile_cache = std::make_unique<TileCache>(
+					parameters->tile_cache_size,
+					parameters->tile_coding_cache_size,
+					parameters->tile_refine_cache_size);
 	}
 }
 
+bool CodeStream::get_tile_cache_stats(grk_tile_cache_stats *stats){
+	if (!m_tile_cache)
+		return false;
+	m_tile_cache->get_stats(stats);
+
+	return true;
+}
+
+void CodeStream::release_coding_state(const std::vector<uint16_t> &tiles){
+	for (auto tile_index : tiles) {
+		auto tcp = m_cp.tcps + tile_index;
+		delete tcp->m_tile_data;
+		tcp->m_tile_data = nullptr;
+	}
+}
+
+void CodeStream::set_strip_sink(grk_strip_sink sink, void *user_data){
+	m_strip_sink = sink;
+	m_strip_sink_user_data = user_data;
+}
+
+bool CodeStream::set_output_buffer(const grk_output_buffer *buffer){
+	if (!buffer) {
+		memset(&m_output_buffer, 0, sizeof(m_output_buffer));
+		return true;
+	}
+	if (!buffer->data) {
+		GRK_ERROR("Output buffer has no data");
+		return false;
+	}
+	if (buffer->type > GRK_SAMPLE_FLOAT) {
+		GRK_ERROR("Unknown output buffer sample type %d", buffer->type);
+		return false;
+	}
+	m_output_buffer = *buffer;
+
+	return true;
+}
+
+bool CodeStream::build_tile_part_index(void){
+	if (m_tile_parts)
+		return true;
+	if (m_tile_parts_failed)
+		return false;
+	m_tile_parts = std::make_unique<TilePartIndex>(
+			(uint16_t) (m_cp.t_grid_width * m_cp.t_grid_height));
+	if (!m_tile_parts->build(m_stream, m_cp.tlm_markers,
+			cstr_index->main_head_end)) {
+		m_tile_parts.reset();
+		m_tile_parts_failed = true;
+		return false;
+	}
+
+	return true;
+}
+
+void CodeStream::prefetch_tile_parts(uint64_t pos){
+	if (!m_stream->supportsPrefetch())
+		return;
+	uint64_t current = m_stream->tell();
+	uint64_t stream_len = current + m_stream->get_number_byte_left();
+	if (!m_tile_parts) {
+		bool rc = build_tile_part_index();
+		if (!m_stream->seek(current) || !rc)
+			return;
+	}
+	// top up once half of the bytes read ahead have been consumed
+	uint64_t budget = m_stream->get_prefetch_budget();
+	uint64_t end = m_stream->get_prefetched_end(pos);
+	if (end - pos >= budget / 2)
+		return;
+	std::vector<std::pair<uint64_t, uint64_t>> ranges;
+	m_tile_parts->next_tile_parts(end, stream_len, budget - (end - pos),
+			&ranges);
+	// adjacent tile parts are read in blocks, so that
+	// small tile parts don't each cost a separate read
+	uint64_t max_block = std::max<uint64_t>(budget / 8, 1);
+	uint64_t block_offset = 0, block_len = 0;
+	for (auto &range : ranges) {
+		if (block_len && block_offset + block_len == range.first
+				&& block_len + range.second <= max_block) {
+			block_len += range.second;
+			continue;
+		}
+		m_stream->prefetch(block_offset, block_len);
+		block_offset = range.first;
+		block_len = range.second;
+	}
+	m_stream->prefetch(block_offset, block_len);
+}
+
+bool CodeStream::get_index_key(TilePartIndexKey *key){
+	uint64_t pos = m_stream->tell();
+	uint64_t header_len = cstr_index->main_head_end;
+	key->stream_len = pos + m_stream->get_number_byte_left();
+	auto header = std::unique_ptr<uint8_t[]>(new uint8_t[header_len]);
+	if (!m_stream->seek(0)
+			|| m_stream->read(header.get(), header_len) != header_len) {
+		GRK_ERROR("Unable to read main header");
+		return false;
+	}
+	// 64 bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (uint64_t i = 0; i < header_len; ++i) {
+		hash ^= header[i];
+		hash *= 0x100000001b3ULL;
+	}
+	key->main_header_hash = hash;
+
+	return m_stream->seek(pos);
+}
+
+bool CodeStream::write_index(uint8_t *buffer, size_t *len){
+	if (!len || !cstr_index || !cstr_index->main_head_end) {
+		GRK_ERROR("Header must be read before writing index");
+		return false;
+	}
+	TilePartIndexKey key;
+	if (!get_index_key(&key))
+		return false;
+	uint64_t pos = m_stream->tell();
+	bool rc = build_tile_part_index();
+	if (!m_stream->seek(pos))
+		return false;
+	if (!rc) {
+		GRK_ERROR("Unable to index tile parts of every tile");
+		return false;
+	}
+
+	return m_tile_parts->write(buffer, len, key);
+}
+
+bool CodeStream::read_index(const uint8_t *buffer, size_t len){
+	if (!cstr_index || !cstr_index->main_head_end) {
+		GRK_ERROR("Header must be read before reading index");
+		return false;
+	}
+	TilePartIndexKey key;
+	if (!get_index_key(&key))
+		return false;
+	uint64_t pos = m_stream->tell();
+	auto index = std::make_unique<TilePartIndex>(
+			(uint16_t) (m_cp.t_grid_width * m_cp.t_grid_height));
+	bool rc = index->read(buffer, len, key) && index->verify(m_stream);
+	if (!m_stream->seek(pos))
+		return false;
+	if (!rc) {
+		GRK_WARN("Index does not match code stream, and will be ignored");
+		return false;
+	}
+	m_tile_parts = std::move(index);
+
+	return true;
+}
+
 bool CodeStream::start_compress(void){
 	/* customization of the validation */
 	m_validation_list.push_back(
@@ -1449,6 +2021,10 @@ bool CodeStream::start_compress(void){
 	if (!init_header_writing())
 		return false;
 
+	// pre-size memory mapped output; it still grows if the estimate is exceeded
+	if (!m_stream->reserve(m_cp.m_coding_params.m_enc.m_cs_size_hint))
+		return false;
+
 	/* write header */
 	return exec(m_procedure_list);
 }
@@ -1622,8 +2198,17 @@ bool CodeStream::init_compress(grk_cparameters  *parameters,grk_image *image){
 	cp->m_coding_params.m_enc.m_fixed_quality = parameters->cp_fixed_quality;
 	cp->m_coding_params.m_enc.writePLT = parameters->writePLT;
 	cp->m_coding_params.m_enc.writeTLM = parameters->writeTLM;
+	// without a size limit, lossless output rarely exceeds the uncompressed size
+	cp->m_coding_params.m_enc.m_cs_size_hint =
+			parameters->max_cs_size ?
+					parameters->max_cs_size : (uint64_t) image_bytes;
 	cp->m_coding_params.m_enc.rateControlAlgorithm =
 			parameters->rateControlAlgorithm;
+	cp->m_coding_params.m_enc.m_exact_rate_control =
+			parameters->exactRateControl;
+	cp->m_coding_params.m_enc.tileWindow = parameters->tileWindow;
+	m_memory_budget = parameters->maxMemory ?
+			std::make_unique<MemoryBudget>(parameters->maxMemory) : nullptr;
 
 	/* tiles */
 	cp->t_width = parameters->t_width;
@@ -1927,6 +2512,22 @@ bool CodeStream::compress(grk_plugin_tile* tile){
 	std::unique_ptr<TileProcessor*[]> procs = std::make_unique<TileProcessor*[]>(nb_tiles);
 	std::atomic<bool> success(true);
 	bool rc = false;
+	auto enc = &m_cp.m_coding_params.m_enc;
+	// global rate control: layers of all tiles are formed together,
+	// once all tiles have been T1 encoded
+	bool global_rate_control = false;
+	if (enc->rateControlAlgorithm == 2 && enc->m_disto_alloc
+			&& !enc->m_fixed_quality && !enc->m_max_comp_size) {
+		for (uint32_t k = 0; k < m_cp.tcps->numlayers; ++k) {
+			if (m_encoder.m_global_rates[k] > 0)
+				global_rate_control = true;
+		}
+	}
+
+	// without global rate control, each tile can be written
+	// as soon as it is compressed
+	if (pool_size > 1 && !global_rate_control)
+		return compress_tiles_windowed(tile, (uint16_t) nb_tiles, &pool);
 
 	for (uint16_t i = 0; i < nb_tiles; ++i)
 		procs[i] = nullptr;
@@ -1939,12 +2540,14 @@ bool CodeStream::compress(grk_plugin_tile* tile){
 								  &procs,
 								  tile,
 								  tile_ind,
+								  global_rate_control,
 								  &success] {
 						if (success) {
 							auto tileProcessor = new TileProcessor(this,m_stream);
 
 							tileProcessor->m_tile_index = tile_ind;
 							tileProcessor->current_plugin_tile = tile;
+							tileProcessor->m_global_rate_control = global_rate_control;
 							if (!tileProcessor->pre_write_tile())
 								success = false;
 							else {
@@ -1959,11 +2562,14 @@ bool CodeStream::compress(grk_plugin_tile* tile){
 		}
 	} else {
 		for (uint16_t i = 0; i < nb_tiles; ++i) {
-			auto tileProcessor = new TileProcessor(this,m_stream);
+			// without global rate control, one processor serves all tiles
+			auto tileProcessor = global_rate_control ?
+					new TileProcessor(this,m_stream) : acquire_processor(m_stream);
 			m_tileProcessor = tileProcessor;
 
 			tileProcessor->m_tile_index = i;
 			tileProcessor->current_plugin_tile = tile;
+			tileProcessor->m_global_rate_control = global_rate_control;
 			if (!tileProcessor->pre_write_tile()){
 				delete tileProcessor;
 				goto cleanup;
@@ -1972,12 +2578,17 @@ bool CodeStream::compress(grk_plugin_tile* tile){
 				delete tileProcessor;
 				goto cleanup;
 			}
+			if (global_rate_control) {
+				procs[i] = tileProcessor;
+				m_tileProcessor = nullptr;
+				continue;
+			}
 			if (!post_write_tile(tileProcessor)){
 				delete tileProcessor;
 				goto cleanup;
 			}
 			m_tileProcessor = nullptr;
-			delete tileProcessor;
+			release_processor(tileProcessor);
 		}
 	}
 	if (pool_size > 1) {
@@ -1986,14 +2597,16 @@ bool CodeStream::compress(grk_plugin_tile* tile){
 		}
 		if (!success)
 			goto cleanup;
-		for (uint16_t i = 0; i < nb_tiles; ++i) {
-			setTileProcessor(procs[i], false);
-			if (!post_write_tile(procs[i]))
-				goto cleanup;
-			setTileProcessor(nullptr, true);
-			procs[i] = nullptr;
-		}
 	}
+	if (global_rate_control) {
+		GlobalRateAllocator allocator(procs.get(), (uint16_t) nb_tiles,
+				m_encoder.m_global_rates);
+		if (!allocator.allocate())
+			goto cleanup;
+	}
+	if ((pool_size > 1 || global_rate_control)
+			&& !write_tiles(procs.get(), (uint16_t) nb_tiles))
+		goto cleanup;
 	rc = true;
 cleanup:
 	for (uint16_t i = 0; i < nb_tiles; ++i)
@@ -2002,6 +2615,52 @@ cleanup:
 	return rc;
 }
 
+bool CodeStream::set_input_buffer(const grk_input_buffer *buffer){
+	if (!buffer) {
+		memset(&m_input_buffer, 0, sizeof(m_input_buffer));
+		return true;
+	}
+	if (!m_input_image) {
+		GRK_ERROR("Input buffer must be set after compression is initialized");
+		return false;
+	}
+	if (!buffer->data && !buffer->pull) {
+		GRK_ERROR("Input buffer has neither data nor rows callback");
+		return false;
+	}
+	if (buffer->type != GRK_SAMPLE_UINT8 && buffer->type != GRK_SAMPLE_UINT16
+			&& buffer->type != GRK_SAMPLE_INT16) {
+		GRK_ERROR("Unsupported input buffer sample type %d", buffer->type);
+		return false;
+	}
+	auto comp0 = m_input_image->comps;
+	for (uint32_t i = 1; i < m_input_image->numcomps; i++) {
+		auto comp = m_input_image->comps + i;
+		if (comp->w != comp0->w || comp->h != comp0->h || comp->dx != comp0->dx
+				|| comp->dy != comp0->dy) {
+			GRK_ERROR("Input buffer requires components with equal dimensions");
+			return false;
+		}
+	}
+	uint64_t row_bytes = (uint64_t) comp0->w * grk_sample_size(buffer->type);
+	if (buffer->interleaved)
+		row_bytes *= m_input_image->numcomps;
+	if (buffer->stride < row_bytes) {
+		GRK_ERROR("Input buffer stride %zu is less than row length %" PRIu64,
+				buffer->stride, row_bytes);
+		return false;
+	}
+	if (!buffer->interleaved && m_input_image->numcomps > 1
+			&& buffer->plane_stride < (uint64_t) buffer->stride * comp0->h) {
+		GRK_ERROR("Input buffer plane stride %zu is less than plane size %" PRIu64,
+				buffer->plane_stride, (uint64_t) buffer->stride * comp0->h);
+		return false;
+	}
+	m_input_buffer = *buffer;
+
+	return true;
+}
+
 bool CodeStream::compress_tile(uint16_t tile_index,	uint8_t *p_data, uint64_t uncompressed_data_size){
 
 	if (!p_data)
@@ -2010,6 +2669,8 @@ bool CodeStream::compress_tile(uint16_t tile_index,	uint8_t *p_data, uint64_t un
 
 	m_tileProcessor = new TileProcessor(this,m_stream);
 	m_tileProcessor->m_tile_index = tile_index;
+	// tile data is passed in by caller
+	m_tileProcessor->m_input_buffer = nullptr;
 
 
 	if (!currentProcessor()->pre_write_tile()) {
@@ -2042,8 +2703,10 @@ bool CodeStream::end_compress(void){
 		m_procedure_list.push_back((j2k_procedure) j2k_write_tlm_end);
 	m_procedure_list.push_back((j2k_procedure) j2k_write_epc);
 	m_procedure_list.push_back((j2k_procedure) j2k_end_encoding);
+	bool rc = exec(m_procedure_list);
+	trim_processor_pool(0);
 
-	return  exec(m_procedure_list);
+	return rc;
 }
 
 bool CodeStream::set_decompress_area(grk_image *output_image,
@@ -2178,6 +2841,7 @@ bool CodeStream::process_marker(const grk_dec_memory_marker_handler* marker_hand
 		if (!m_marker_scratch)
 			return false;
 		m_marker_scratch_size = default_header_size;
+		m_marker_account.set(m_marker_scratch_size);
 	}
 
 	// need more scratch memory
@@ -2198,6 +2862,7 @@ bool CodeStream::process_marker(const grk_dec_memory_marker_handler* marker_hand
 		}
 		m_marker_scratch = new_header_data;
 		m_marker_scratch_size = marker_size;
+		m_marker_account.set(m_marker_scratch_size);
 	}
 
 	if (m_stream->read(m_marker_scratch, marker_size)
@@ -2291,6 +2956,35 @@ bool CodeStream::alloc_multi_tile_output_data(grk_image *p_output_image){
 
 }
 
+bool CodeStream::validate_output_buffer(grk_image *p_output_image){
+	auto buffer = &m_output_buffer;
+	auto comp0 = p_output_image->comps;
+	size_t sample_size = grk_sample_size(buffer->type);
+	for (uint32_t i = 1; i < p_output_image->numcomps; i++) {
+		auto comp = p_output_image->comps + i;
+		if (comp->w != comp0->w || comp->h != comp0->h) {
+			GRK_ERROR("Output buffer requires components with equal dimensions");
+			return false;
+		}
+	}
+	uint64_t row_bytes = (uint64_t) comp0->w * sample_size;
+	if (buffer->interleaved)
+		row_bytes *= p_output_image->numcomps;
+	if (buffer->stride < row_bytes) {
+		GRK_ERROR("Output buffer stride %zu is less than row length %" PRIu64,
+				buffer->stride, row_bytes);
+		return false;
+	}
+	if (!buffer->interleaved && p_output_image->numcomps > 1
+			&& buffer->plane_stride < (uint64_t) buffer->stride * comp0->h) {
+		GRK_ERROR("Output buffer plane stride %zu is less than plane size %" PRIu64,
+				buffer->plane_stride, (uint64_t) buffer->stride * comp0->h);
+		return false;
+	}
+
+	return true;
+}
+
 bool CodeStream::read_marker_skip_unknown(uint16_t *current_marker){
 	while (true) {
 		// read next marker id
@@ -2675,7 +3369,8 @@ bool CodeStream::read_header_procedure(void) {
 }
 
 
-bool CodeStream::decompress_tile_t2t1(TileProcessor *tileProcessor, bool multi_tile) {
+bool CodeStream::decompress_tile_t2t1(TileProcessor *tileProcessor, bool multi_tile,
+		grk_image *output_image) {
 	auto decoder = &m_decoder;
 	uint16_t tile_index = tileProcessor->m_tile_index;
 	auto tcp = m_cp.tcps + tile_index;
@@ -2711,17 +3406,24 @@ bool CodeStream::decompress_tile_t2t1(TileProcessor *tileProcessor, bool multi_t
 	}
 
 	if (doPost) {
-		if (m_output_image) {
-			if (multi_tile) {
-				if (!tileProcessor->copy_decompressed_tile_to_output_image(m_output_image))
+		if (output_image) {
+			if (m_decompress_to_buffer) {
+				if (!tileProcessor->copy_decompressed_tile_to_output_image(output_image,
+						&m_output_buffer))
+					return false;
+			} else if (multi_tile) {
+				if (m_strips) {
+					if (!m_strips->ingest(tileProcessor))
+						return false;
+				} else if (!tileProcessor->copy_decompressed_tile_to_output_image(output_image))
 					return false;
 			} else {
 				/* transfer data from tile component to output image */
 				uint32_t compno = 0;
-				for (compno = 0; compno < m_output_image->numcomps;
+				for (compno = 0; compno < output_image->numcomps;
 						compno++) {
 					auto tilec = tileProcessor->tile->comps + compno;
-					auto comp = m_output_image->comps + compno;
+					auto comp = output_image->comps + compno;
 
 					//transfer memory from tile component to output image
 					tilec->buf->transfer(&comp->data, &comp->owns_data, &comp->stride);
@@ -2729,9 +3431,14 @@ bool CodeStream::decompress_tile_t2t1(TileProcessor *tileProcessor, bool multi_t
 				}
 			}
 		}
-		/* we only destroy the data, which will be re-read in read_tile_header*/
-		delete tcp->m_tile_data;
-		tcp->m_tile_data = nullptr;
+		/* we only destroy the data, which will be re-read in read_tile_header,
+		 * unless it is retained for the next decompression of this tile*/
+		bool retain = !multi_tile && m_tile_cache
+				&& m_tile_cache->caches_coding_state() && !m_cp.ppm_marker;
+		if (!retain) {
+			delete tcp->m_tile_data;
+			tcp->m_tile_data = nullptr;
+		}
 	}
 
 	return rc;
@@ -2740,99 +3447,95 @@ bool CodeStream::decompress_tile_t2t1(TileProcessor *tileProcessor, bool multi_t
 
 
 /*
- * Read and decompress one tile.
+ * Read one tile, and return its tile processor, ready for decompression.
+ *
+ * whole_tile: whether the whole tile is decompressed, or only the window
+ * of the output image
  */
-bool CodeStream::decompress_tile(TileProcessor *tileProcessor) {
-	GRK_UNUSED(tileProcessor);
+TileProcessor* CodeStream::read_tile(bool whole_tile) {
 	bool go_on = true;
 
 	/*Allocate and initialize some elements of code stream index if not already done*/
 	if (!cstr_index->tile_index) {
 		if (!j2k_allocate_tile_element_cstr_index(this))
-			return false;
+			return nullptr;
 	}
 	if (tileIndexToDecode() == -1) {
 		GRK_ERROR("j2k_decompress_tile: Unable to decompress tile "
 				"since first tile SOT has not been detected");
-		return false;
+		return nullptr;
 	}
 
 	/* Move into the code stream to the first SOT used to decompress the desired tile */
 	uint16_t tile_index_to_decode =	(uint16_t) (tileIndexToDecode());
-	if (cstr_index->tile_index) {
-		if (cstr_index->tile_index->tp_index) {
-			if (!cstr_index->tile_index[tile_index_to_decode].nb_tps) {
-				/* the index for this tile has not been built,
-				 *  so move to the last SOT read */
-				if (!(m_stream->seek(
-						m_decoder.m_last_sot_read_pos
-								+ 2))) {
-					GRK_ERROR("Problem with seek function");
-					return false;
-				}
-			} else {
-				if (!(m_stream->seek(
-						cstr_index->tile_index[tile_index_to_decode].tp_index[0].start_pos
-								+ 2))) {
-					GRK_ERROR("Problem with seek function");
-					return false;
-				}
-			}
-			/* Special case if we have previously read the EOC marker (if the previous tile decoded is the last ) */
-			if (m_decoder.m_state == J2K_DEC_STATE_EOC)
-				m_decoder.m_state =
-						J2K_DEC_STATE_TPH_SOT;
-		}
-	}
-
-	// if we have a TLM marker, then we can skip tiles until
-	// we get to desired tile
-	if (m_cp.tlm_markers){
-		m_cp.tlm_markers->getInit();
-	    auto tl = m_cp.tlm_markers->getNext();
-	    //GRK_INFO("TLM : index: %u, length : %u", tl.tile_number, tl.length);
-	    uint16_t tileNumber = 0;
-	    while (m_stream->get_number_byte_left() != 0 &&
-	    		tileNumber != tileIndexToDecode()){
-	    	if (tl.length == 0){
-	    		GRK_ERROR("j2k_decompress_tile: corrupt TLM marker");
-	    		return false;
-	    	}
-	    	m_stream->skip(tl.length);
-	    	tl = m_cp.tlm_markers->getNext();
-	    	if (tl.has_tile_number)
-	    		tileNumber = tl.tile_number;
-	    	else
-	    		tileNumber++;
-	    }
-	}
-
-	tileProcessor = new TileProcessor(this,m_stream);
-	setTileProcessor(tileProcessor,true);
-	if (!parse_markers(&go_on))
-		return false;
 
-	if (!j2k_decompress_tile_t2(this, tileProcessor))
-		return false;
+	// the tile header and compressed data may have been retained
+	// from a previous decompression, in which case nothing is read
+	auto tcp = m_cp.tcps + tile_index_to_decode;
+	if (m_tile_cache && m_tile_cache->caches_coding_state()
+			&& m_tile_cache->get_coding_state(tile_index_to_decode)
+			&& tcp->m_tile_data) {
+		// packed packet headers are consumed during decompression
+		if (tcp->ppt) {
+			tcp->ppt_data = tcp->ppt_buffer;
+			tcp->ppt_len = tcp->ppt_data_size;
+		}
+		auto tileProcessor = new TileProcessor(this,m_stream);
+		tileProcessor->whole_tile_decoding = whole_tile;
+		tileProcessor->m_tile_index = tile_index_to_decode;
+		if (!tileProcessor->init_tile(m_output_image, false)) {
+			delete tileProcessor;
+			return nullptr;
+		}
+		return tileProcessor;
+	}
 
-	if (!j2k_decompress_tile_t2t1(this, tileProcessor, false))
-		return false;
+	// index all tile parts once, so that every tile can be reached with a single seek.
+	// If the stream could not be indexed, then move to the last SOT read
+	// and search for the tile from there
+	uint64_t sot_pos = m_decoder.m_last_sot_read_pos;
+	if (build_tile_part_index()) {
+		m_tile_parts->first_tile_part(tile_index_to_decode, &sot_pos);
+		// read this tile and the tiles that follow it in the code stream ahead of need
+		prefetch_tile_parts(sot_pos);
+	}
+	if (!(m_stream->seek(sot_pos + 2))) {
+		GRK_ERROR("Problem with seek function");
+		return nullptr;
+	}
+	/* Special case if we have previously read the EOC marker (if the previous tile decoded is the last ) */
+	if (m_decoder.m_state == J2K_DEC_STATE_EOC)
+		m_decoder.m_state = J2K_DEC_STATE_TPH_SOT;
 
+	auto tileProcessor = new TileProcessor(this,m_stream);
+	tileProcessor->whole_tile_decoding = whole_tile;
+	setTileProcessor(tileProcessor,true);
+	if (!parse_markers(&go_on) || !j2k_decompress_tile_t2(this, tileProcessor)) {
+		setTileProcessor(nullptr,true);
+		return nullptr;
+	}
 
-	if (tileProcessor->m_tile_index == tile_index_to_decode) {
-		/* move into the code stream to the first SOT (FIXME or not move?)*/
-		if (!(m_stream->seek(cstr_index->main_head_end + 2))) {
-			GRK_ERROR("Problem with seek function");
-			return false;
-		}
-	} else {
+	if (tileProcessor->m_tile_index != tile_index_to_decode) {
 		GRK_ERROR(
 				"Tile read, decoded and updated is not the desired one (%u vs %u).",
 				tileProcessor->m_tile_index + 1, tile_index_to_decode + 1);
-		return false;
+		setTileProcessor(nullptr,true);
+		return nullptr;
+	}
+	/* move into the code stream to the first SOT (FIXME or not move?)*/
+	if (!(m_stream->seek(cstr_index->main_head_end + 2))) {
+		GRK_ERROR("Problem with seek function");
+		setTileProcessor(nullptr,true);
+		return nullptr;
 	}
+	// the stream is back at the first SOT, even if the last tile was read,
+	// so that another decompress area can be set
+	if (m_decoder.m_state == J2K_DEC_STATE_EOC)
+		m_decoder.m_state = J2K_DEC_STATE_TPH_SOT;
+	// caller now owns tile processor
+	setTileProcessor(nullptr,false);
 
-	return true;
+	return tileProcessor;
 }
 
 bool CodeStream::exec(std::vector<j2k_procedure> &procs) {
@@ -2882,19 +3585,49 @@ bool CodeStream::decompress_tiles(TileProcessor *tileProcessor) {
 	bool multi_tile = num_tiles_to_decode > 1;
 	std::atomic<bool> success(true);
 	std::atomic<uint32_t> num_tiles_decoded(0);
+
+	// with an output buffer, tiles are written straight into the caller's buffer
+	m_decompress_to_buffer = m_output_buffer.data && m_output_image
+			&& !current_plugin_tile;
+	if (m_tile_cache
+			&& (m_tile_cache->caches_tiles()
+					|| m_tile_cache->caches_coding_state()) && m_output_image
+			&& !m_decompress_to_buffer && !m_strip_sink && !current_plugin_tile)
+		return decompress_tiles_cached();
+	// reset tile part numbers, in case this codec has already decompressed
+	{
+		std::unique_lock<std::mutex> lock(m_tile_mutex);
+		for (auto i : m_tiles_parts_read)
+			m_cp.tcps[i].m_tile_part_index = -1;
+		m_tiles_parts_read.clear();
+	}
+	// all tiles are read from the stream, so retained coding state is released
+	if (m_tile_cache) {
+		std::vector<uint16_t> evicted;
+		m_tile_cache->clear_coding_state(&evicted);
+		release_coding_state(evicted);
+	}
+
 	ThreadPool pool(std::min<uint32_t>((uint32_t)ThreadPool::get()->num_threads(), num_tiles_to_decode));
 	std::vector< std::future<int> > results;
-
-	if (multi_tile && m_output_image) {
-		if (!alloc_multi_tile_output_data(m_output_image))
+	if (m_decompress_to_buffer) {
+		if (!validate_output_buffer(m_output_image))
+			return false;
+	} else if (multi_tile && m_output_image) {
+		// with a strip sink, the full output image is never allocated
+		if (m_strip_sink && !current_plugin_tile)
+			m_strips = std::make_unique<StripCache>(this, m_strip_sink,
+					m_strip_sink_user_data, m_memory_budget.get());
+		else if (!alloc_multi_tile_output_data(m_output_image))
 			return false;
 	}
 
 	// read header and perform T2
 	for (uint32_t tileno = 0; tileno < num_tiles_to_decode; tileno++) {
 		//1. read header
-		auto processor = new TileProcessor(this,m_stream);
+		auto processor = acquire_processor(m_stream);
 		setTileProcessor(processor,false);
+		prefetch_tile_parts(m_stream->tell());
 		if (!parse_markers(&go_on)){
 			setTileProcessor(nullptr,true);
 			return false;
@@ -2914,14 +3647,21 @@ bool CodeStream::decompress_tiles(TileProcessor *tileProcessor) {
 				return false;
 		}
 
+		// wait until tiles in flight leave room for this tile
+		uint64_t reserved = 0;
+		if (m_memory_budget) {
+			reserved = tile_memory_estimate(processor->m_tile_index, false);
+			m_memory_budget->acquire(reserved);
+		}
+
 		if (pool.num_threads() > 1) {
 			results.emplace_back(
 				pool.enqueue([this,processor,
 							  num_tiles_to_decode,
-							  multi_tile,
+							  multi_tile, reserved,
 							  &num_tiles_decoded, &success] {
 					if (success) {
-						if (!j2k_decompress_tile_t2t1(this, processor,multi_tile)){
+						if (!j2k_decompress_tile_t2t1(this, processor,multi_tile, m_output_image)){
 							GRK_ERROR("Failed to decompress tile %u/%u",
 									processor->m_tile_index + 1,num_tiles_to_decode);
 							success = false;
@@ -2929,12 +3669,17 @@ bool CodeStream::decompress_tiles(TileProcessor *tileProcessor) {
 							num_tiles_decoded++;
 						}
 					}
-					delete processor;
+					release_processor(processor);
+					if (m_memory_budget)
+						m_memory_budget->release(reserved);
 					return 0;
 				})
 			);
 		} else {
-			if (!j2k_decompress_tile_t2t1(this, processor,multi_tile)){
+			bool decoded = j2k_decompress_tile_t2t1(this, processor,multi_tile, m_output_image);
+			if (m_memory_budget)
+				m_memory_budget->release(reserved);
+			if (!decoded){
 					GRK_ERROR("Failed to decompress tile %u/%u",
 							processor->m_tile_index + 1,num_tiles_to_decode);
 					setTileProcessor(nullptr,true);
@@ -2942,7 +3687,7 @@ bool CodeStream::decompress_tiles(TileProcessor *tileProcessor) {
 			} else {
 				num_tiles_decoded++;
 			}
-			delete processor;
+			release_processor(processor);
 		}
 
 
@@ -2957,6 +3702,11 @@ bool CodeStream::decompress_tiles(TileProcessor *tileProcessor) {
 		result.get();
 	}
 	setTileProcessor(nullptr,false);
+	if (m_strips) {
+		if (!m_strips->flush())
+			success = false;
+		m_strips.reset();
+	}
 
 	// sanity checks
 	if (num_tiles_decoded == 0) {
@@ -2971,6 +3721,79 @@ bool CodeStream::decompress_tiles(TileProcessor *tileProcessor) {
 	return success;
 }
 
+bool CodeStream::decompress_tiles_cached(void) {
+	auto output_image = m_output_image;
+	auto reduce = m_cp.m_coding_params.m_dec.m_reduce;
+	if (!alloc_multi_tile_output_data(output_image))
+		return false;
+	auto area = grk_rect(output_image->x0, output_image->y0, output_image->x1,
+			output_image->y1);
+	std::vector<uint16_t> tiles;
+	for (uint32_t tile_y = m_decoder.m_start_tile_y_index;
+			tile_y < m_decoder.m_end_tile_y_index; ++tile_y) {
+		for (uint32_t tile_x = m_decoder.m_start_tile_x_index;
+				tile_x < m_decoder.m_end_tile_x_index; ++tile_x)
+			tiles.push_back((uint16_t) (tile_y * m_cp.t_grid_width + tile_x));
+	}
+	std::atomic<bool> success(true);
+	auto decompress = [this, output_image, reduce, area, &success](
+			uint16_t tile_index) {
+		uint32_t tile_x = tile_index % m_cp.t_grid_width;
+		uint32_t tile_y = tile_index / m_cp.t_grid_width;
+		auto tile_rect = grk_rect(
+				std::max<uint32_t>(tile_x * m_cp.t_width + m_cp.tx0, m_input_image->x0),
+				std::max<uint32_t>(tile_y * m_cp.t_height + m_cp.ty0, m_input_image->y0),
+				std::min<uint32_t>((tile_x + 1) * m_cp.t_width + m_cp.tx0, m_input_image->x1),
+				std::min<uint32_t>((tile_y + 1) * m_cp.t_height + m_cp.ty0, m_input_image->y1));
+		auto overlap = area;
+		overlap.intersection(tile_rect);
+		if (!overlap.is_non_degenerate())
+			return;
+		auto region = grk_image_create0();
+		if (!region) {
+			success = false;
+			return;
+		}
+		grk_copy_image_header(output_image, region);
+		region->x0 = (uint32_t) overlap.x0;
+		region->y0 = (uint32_t) overlap.y0;
+		region->x1 = (uint32_t) overlap.x1;
+		region->y1 = (uint32_t) overlap.y1;
+		set_image_comp_dims(region, reduce);
+		uint64_t reserved = 0;
+		if (m_memory_budget) {
+			reserved = tile_memory_estimate(tile_index, false);
+			m_memory_budget->acquire(reserved);
+		}
+		if (decompress_tile_region(tile_index, tile_rect, region))
+			paste_tile_region(region, output_image, reduce);
+		else
+			success = false;
+		if (m_memory_budget)
+			m_memory_budget->release(reserved);
+		grk_image_destroy(region);
+	};
+
+	size_t num_threads = std::min<size_t>(ThreadPool::get()->num_threads(),
+			tiles.size());
+	if (num_threads > 1) {
+		ThreadPool pool(num_threads);
+		std::vector<std::future<void>> results;
+		for (auto tile_index : tiles)
+			results.emplace_back(pool.enqueue(decompress, tile_index));
+		for (auto &result : results)
+			result.get();
+	} else {
+		for (auto tile_index : tiles) {
+			decompress(tile_index);
+			if (!success)
+				break;
+		}
+	}
+
+	return success;
+}
+
 bool CodeStream::decompress_validation(void) {
 	bool is_valid = true;
 
@@ -2991,7 +3814,7 @@ bool CodeStream::write_tile_part(TileProcessor *tileProcessor) {
 	//1. write SOT
 	SOTMarker sot(this);
 
-	if (!sot.write())
+	if (!sot.write(tileProcessor))
 		return false;
 	uint32_t tile_part_bytes_written = sot_marker_segment_len;
 
@@ -3002,7 +3825,7 @@ bool CodeStream::write_tile_part(TileProcessor *tileProcessor) {
 				auto tcp = m_cp.tcps + currentTileNumber;
 				auto image = m_input_image;
 				uint32_t nb_comp = image->numcomps;
-				if (!j2k_write_poc(this))
+				if (!j2k_write_poc(this, tileProcessor->m_stream))
 					return false;
 				tile_part_bytes_written += getPocSize(nb_comp,
 						1 + tcp->numpocs);
@@ -3024,15 +3847,176 @@ bool CodeStream::write_tile_part(TileProcessor *tileProcessor) {
 	if (!sot.write_psot(tile_part_bytes_written))
 		return false;
 
-	// 5. update TLM
-	if (m_cp.tlm_markers)
-		j2k_update_tlm(this, currentTileNumber, tile_part_bytes_written);
+	// 5. record length for TLM
+	tileProcessor->m_tile_part_lengths.push_back(tile_part_bytes_written);
 	++tileProcessor->m_tile_part_index;
 
 	return true;
 }
 
 bool CodeStream::post_write_tile(TileProcessor *tileProcessor) {
+	uint16_t tile_index = tileProcessor->m_tile_index;
+	if (!write_tile_parts(tileProcessor))
+		return false;
+	update_tlm(tile_index, tileProcessor->m_tile_part_lengths);
+
+	return true;
+}
+
+void CodeStream::update_tlm(uint16_t tile_index,
+		const std::vector<uint32_t> &tile_part_lengths) {
+	if (m_cp.tlm_markers) {
+		for (auto len : tile_part_lengths)
+			j2k_update_tlm(this, tile_index, len);
+	}
+}
+
+// size of internal buffer of per-tile memory streams
+static const size_t tile_stream_buffer_size = 1024 * 1024;
+
+/**
+ * Write all tiles, in index order.
+ *
+ * With more than one thread, tile parts of each tile are generated
+ * in parallel into a memory stream per tile; the calling thread
+ * then copies each tile to the code stream, in order, as soon as it is complete,
+ * and updates TLM.
+ */
+bool CodeStream::write_tiles(TileProcessor **procs, uint16_t num_tiles) {
+	if (ThreadPool::get()->num_threads() <= 1 || num_tiles == 1) {
+		for (uint16_t i = 0; i < num_tiles; ++i) {
+			setTileProcessor(procs[i], false);
+			if (!post_write_tile(procs[i]))
+				return false;
+			setTileProcessor(nullptr, true);
+			procs[i] = nullptr;
+		}
+		return true;
+	}
+
+	std::vector<grk_stream*> streams(num_tiles, nullptr);
+	std::vector<std::future<bool>> results;
+	for (uint16_t i = 0; i < num_tiles; ++i) {
+		auto stream = create_growable_mem_stream(tile_stream_buffer_size);
+		streams[i] = stream;
+		procs[i]->set_stream((BufferedStream*) stream);
+		auto proc = procs[i];
+		results.emplace_back(ThreadPool::get()->enqueue([this, proc, stream] {
+			return write_tile_parts(proc) && ((BufferedStream*) stream)->flush();
+		}));
+	}
+	bool rc = true;
+	for (uint16_t i = 0; i < num_tiles; ++i) {
+		if (!results[i].get())
+			rc = false;
+		if (rc) {
+			size_t len = 0;
+			auto data = get_growable_mem_stream_data(streams[i], &len);
+			if (len && m_stream->write_bytes(data, len) != len)
+				rc = false;
+			// tile index was incremented by write_tile_parts
+			update_tlm((uint16_t)(procs[i]->m_tile_index - 1),
+					procs[i]->m_tile_part_lengths);
+		}
+		grk_stream_destroy(streams[i]);
+		delete procs[i];
+		procs[i] = nullptr;
+	}
+
+	return rc;
+}
+
+/**
+ * Compress and write all tiles, in index order, with a bounded number
+ * of tiles in flight.
+ *
+ * Each task compresses a single tile, generates its tile parts into a memory
+ * stream and then frees the tile. The calling thread copies tiles to the
+ * code stream in index order, and only starts a new tile once the oldest tile
+ * has been written, so at most tileWindow tiles, compressed or not,
+ * are held in memory at any time. With a memory budget, a tile is also not
+ * started until its estimated memory fits in the budget.
+ */
+bool CodeStream::compress_tiles_windowed(grk_plugin_tile *tile,
+		uint16_t num_tiles, ThreadPool *pool) {
+	uint32_t window = m_cp.m_coding_params.m_enc.tileWindow;
+	if (!window)
+		window = 2 * (uint32_t) pool->num_threads();
+	window = std::min<uint32_t>(window, num_tiles);
+
+	std::vector<grk_stream*> streams(num_tiles, nullptr);
+	std::vector<std::vector<uint32_t>> tile_part_lengths(num_tiles);
+	std::vector<std::future<bool>> results(num_tiles);
+	auto compress_tile = [this, tile, &streams, &tile_part_lengths](
+			uint16_t tile_index) {
+		auto stream = create_growable_mem_stream(tile_stream_buffer_size);
+		if (!stream)
+			return false;
+		streams[tile_index] = stream;
+		auto tileProcessor = acquire_processor((BufferedStream*) stream);
+		tileProcessor->m_tile_index = tile_index;
+		tileProcessor->current_plugin_tile = tile;
+		bool rc = tileProcessor->pre_write_tile()
+				&& tileProcessor->do_encode()
+				&& write_tile_parts(tileProcessor)
+				&& ((BufferedStream*) stream)->flush();
+		if (rc)
+			tile_part_lengths[tile_index] = tileProcessor->m_tile_part_lengths;
+		release_processor(tileProcessor);
+
+		return rc;
+	};
+	std::vector<uint64_t> reserved(num_tiles, 0);
+	uint16_t next = 0;
+	// start tiles after the oldest tile in flight, while both
+	// window and memory budget allow. The budget is never waited on here,
+	// as reservations are only returned by this thread, once tiles are written
+	auto start_tiles = [this, &next, num_tiles, window, &reserved, &results,
+						&compress_tile, pool](uint16_t oldest) {
+		while (next < num_tiles && (uint32_t) (next - oldest) < window) {
+			if (m_memory_budget) {
+				uint64_t bytes = tile_memory_estimate(next, true);
+				if (!m_memory_budget->try_acquire(bytes))
+					break;
+				reserved[next] = bytes;
+			}
+			uint16_t tile_index = next;
+			results[next] = pool->enqueue([&compress_tile, tile_index] {
+				return compress_tile(tile_index);
+			});
+			++next;
+		}
+	};
+	start_tiles(0);
+	bool rc = true;
+	for (uint16_t i = 0; i < num_tiles; ++i) {
+		// tiles beyond the window are not started after a failure
+		if (!results[i].valid())
+			break;
+		if (!results[i].get())
+			rc = false;
+		if (rc) {
+			size_t len = 0;
+			auto data = get_growable_mem_stream_data(streams[i], &len);
+			if (len && m_stream->write_bytes(data, len) != len)
+				rc = false;
+			update_tlm(i, tile_part_lengths[i]);
+		}
+		if (streams[i]) {
+			grk_stream_destroy(streams[i]);
+			streams[i] = nullptr;
+		}
+		tile_part_lengths[i].clear();
+		if (m_memory_budget)
+			m_memory_budget->release(reserved[i]);
+		if (rc)
+			start_tiles((uint16_t) (i + 1));
+	}
+
+	return rc;
+}
+
+bool CodeStream::write_tile_parts(TileProcessor *tileProcessor) {
 	assert(tileProcessor->m_tile_part_index == 0);
 
 	//1. write first tile part
@@ -3203,6 +4187,26 @@ bool CodeStream::update_rates(void) {
 	size_pixel = image->numcomps * image->comps->prec;
 	auto header_size = (double) m_stream->tell();
 
+	// image-wide budgets : subtract main header, SOT and SOD markers of all
+	// tile parts, and EOC. PLT markers are counted by GlobalRateAllocator
+	{
+		uint64_t numImagePixels = (uint64_t) width * height;
+		double overhead = header_size
+				+ (double) m_encoder.m_total_tile_parts * 14 + 2;
+		double *global_rates = m_encoder.m_global_rates;
+		for (k = 0; k < tcp->numlayers; ++k) {
+			global_rates[k] = 0;
+			if (tcp->rates[k] > 0.0f) {
+				global_rates[k] = ((double) size_pixel * (double) numImagePixels)
+						/ (tcp->rates[k] * (double) bits_empty) - overhead;
+				if (global_rates[k] < 30.0)
+					global_rates[k] = 30.0;
+				if (k > 0 && global_rates[k] < global_rates[k - 1])
+					global_rates[k] = global_rates[k - 1];
+			}
+		}
+	}
+
 	for (i = 0; i < cp->t_grid_height; ++i) {
 		for (j = 0; j < cp->t_grid_width; ++j) {
 			double stride = 0;
@@ -23,6 +23,10 @@
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <set>
 #include "CodingParams.h"
 #include <map>
 
@@ -55,7 +59,6 @@ const uint32_t max_tile_part_size = UINT_MAX;
 // limits in Grok library
 const uint64_t max_tile_area = 67108864000;
 const uint32_t max_supported_precision = 16; // maximum supported precision for Grok library
-const uint32_t default_numbers_segments = 10;
 const uint32_t default_header_size = 1000;
 const uint32_t default_number_mcc_records = 10;
 const uint32_t default_number_mct_records = 10;
@@ -126,7 +129,17 @@ enum J2K_STATUS {
  */
 bool grk_image_single_component_data_alloc(	grk_image_comp *image);
 
+/**
+ * Create image with no components
+ */
+grk_image* grk_image_create0(void);
+
 struct TileProcessor;
+class StripCache;
+class TilePartIndex;
+class TileCache;
+class T1CheckpointStore;
+struct TilePartIndexKey;
 typedef bool (*j2k_procedure)(CodeStream *codeStream);
 
 
@@ -152,6 +165,10 @@ struct ICodeStream {
 	/** decompress tile*/
    virtual bool decompress_tile(grk_image *p_image,	uint16_t tile_index) = 0;
 
+	/** decompress several regions in one pass */
+   virtual bool decompress_regions(const grk_region *regions,
+		   uint32_t num_regions, grk_image **images) = 0;
+
 	/** Reading function used after code stream if necessary */
    virtual bool end_decompress(void) = 0;
 
@@ -162,12 +179,30 @@ struct ICodeStream {
    virtual bool set_decompress_area(grk_image *p_image,
 		   uint32_t start_x, uint32_t end_x, uint32_t start_y,	uint32_t end_y) = 0;
 
+	/** Set strip sink for decompressed rows */
+   virtual void set_strip_sink(grk_strip_sink sink, void *user_data) = 0;
+
+	/** Set caller-owned output buffer */
+   virtual bool set_output_buffer(const grk_output_buffer *buffer) = 0;
+
+	/** Serialize tile part index */
+   virtual bool write_index(uint8_t *buffer, size_t *len) = 0;
+
+	/** Load serialized tile part index */
+   virtual bool read_index(const uint8_t *buffer, size_t len) = 0;
+
+	/** Get tile cache statistics */
+   virtual bool get_tile_cache_stats(grk_tile_cache_stats *stats) = 0;
+
    virtual bool start_compress(void) = 0;
 
    virtual bool init_compress(grk_cparameters  *p_param,grk_image *p_image) = 0;
 
    virtual bool compress(grk_plugin_tile* tile) = 0;
 
+	/** Set caller-owned input buffer */
+   virtual bool set_input_buffer(const grk_input_buffer *buffer) = 0;
+
    virtual bool compress_tile(uint16_t tile_index,	uint8_t *p_data, uint64_t data_size) = 0;
 
    virtual bool end_compress(void) = 0;
@@ -193,6 +228,10 @@ struct CodeStream : public ICodeStream {
 	/** decompress tile*/
    bool decompress_tile(grk_image *p_image,	uint16_t tile_index);
 
+	/** decompress several regions in one pass */
+   bool decompress_regions(const grk_region *regions, uint32_t num_regions,
+		   grk_image **images);
+
 	/** Reading function used after code stream if necessary */
    bool end_decompress(void);
 
@@ -205,6 +244,8 @@ struct CodeStream : public ICodeStream {
 
    bool compress(grk_plugin_tile* tile);
 
+   bool set_input_buffer(const grk_input_buffer *buffer);
+
    bool compress_tile(uint16_t tile_index,	uint8_t *p_data, uint64_t data_size);
 
    bool end_compress(void);
@@ -245,6 +286,36 @@ struct CodeStream : public ICodeStream {
 						uint32_t end_x,
 						uint32_t end_y);
 
+	void set_strip_sink(grk_strip_sink sink, void *user_data);
+
+	bool set_output_buffer(const grk_output_buffer *buffer);
+
+	bool write_index(uint8_t *buffer, size_t *len);
+
+	bool read_index(const uint8_t *buffer, size_t len);
+
+	bool get_tile_cache_stats(grk_tile_cache_stats *stats);
+
+	/**
+	 * Build tile part index, if not already built or loaded
+	 *
+	 * @return true if index covers every tile
+	 */
+	bool build_tile_part_index(void);
+
+	/**
+	 * Queue the tile parts at or after a stream position for prefetch,
+	 * if the stream supports prefetching. Stream position is preserved.
+	 *
+	 * @param pos	stream position
+	 */
+	void prefetch_tile_parts(uint64_t pos);
+
+	/**
+	 * Compute key identifying code stream, for tile part index
+	 */
+	bool get_index_key(TilePartIndexKey *key);
+
 
 	/**
 	 * Allocate output buffer for multiple tile decode
@@ -255,6 +326,15 @@ struct CodeStream : public ICodeStream {
 	 */
 	bool alloc_multi_tile_output_data(grk_image *p_output_image);
 
+	/**
+	 * Check that output buffer can hold output image
+	 *
+	 * @param p_output_image output image
+	 *
+	 * @return true if successful
+	 */
+	bool validate_output_buffer(grk_image *p_output_image);
+
 	bool parse_markers(bool *can_decode_tile_data);
 
 	bool init_header_writing(void);
@@ -263,20 +343,55 @@ struct CodeStream : public ICodeStream {
 
 	bool do_decompress(grk_image *p_image);
 
-	bool decompress_tile_t2t1(TileProcessor *tileProcessor, bool multi_tile) ;
+	bool decompress_tile_t2t1(TileProcessor *tileProcessor, bool multi_tile,
+			grk_image *output_image) ;
+
+	TileProcessor* read_tile(bool whole_tile);
 
-	bool decompress_tile(TileProcessor *tileProcessor);
+	/**
+	 * Release retained compressed data of tiles
+	 */
+	void release_coding_state(const std::vector<uint16_t> &tiles);
 
 	bool decompress_tile_t2(TileProcessor *tileProcessor);
 
 	bool decompress_tiles(TileProcessor *tileProcessor);
 
+	/**
+	 * Decompress the tiles of the decompress area through the tile caches,
+	 * as single tile decompression does, and copy them into the output image.
+	 * Tiles are located through the tile part index, so that areas can be
+	 * decompressed repeatedly, for example by a viewer panning across the image.
+	 */
+	bool decompress_tiles_cached(void);
+
+	/**
+	 * Decompress tile, looking it up in, and adding it to, the tile caches
+	 *
+	 * @param tile_index	tile index
+	 * @param tile_rect		tile bounds, clipped to the image
+	 * @param region		image whose bounds lie within the tile, with component
+	 * 						dimensions set; receives the decompressed region
+	 */
+	bool decompress_tile_region(uint16_t tile_index, const grk_rect &tile_rect,
+			grk_image *region);
+
 	bool decompress_validation(void);
 
 	bool write_tile_part(TileProcessor *tileProcessor);
 
 	bool post_write_tile(TileProcessor *tileProcessor);
 
+	bool write_tile_parts(TileProcessor *tileProcessor);
+
+	bool write_tiles(TileProcessor **procs, uint16_t num_tiles);
+
+	bool compress_tiles_windowed(grk_plugin_tile *tile, uint16_t num_tiles,
+			ThreadPool *pool);
+
+	void update_tlm(uint16_t tile_index,
+			const std::vector<uint32_t> &tile_part_lengths);
+
 	bool get_end_header(void);
 
 	bool copy_default_tcp(void);
@@ -309,6 +424,10 @@ struct CodeStream : public ICodeStream {
 	/** Coding parameters */
 	CodingParams m_cp;
 
+	// tiles whose tile part number has advanced since tile part
+	// numbers were last reset for single tile decompression
+	std::vector<uint16_t> m_tiles_parts_read;
+
 	/** the list of procedures to exec **/
 	std::vector<j2k_procedure> m_procedure_list;
 
@@ -322,6 +441,37 @@ struct CodeStream : public ICodeStream {
 
 	TileProcessor* allocateProcessor(uint16_t tile_index);
 	TileProcessor* currentProcessor(void);
+
+	/**
+	 * Get tile processor from pool of recycled processors,
+	 * or create a new one if the pool is empty
+	 *
+	 * @param stream	stream that processor reads from or writes to
+	 */
+	TileProcessor* acquire_processor(BufferedStream *stream);
+
+	/**
+	 * Return tile processor to pool, or delete it if the pool is full
+	 */
+	void release_processor(TileProcessor *proc);
+
+	/**
+	 * Delete pooled tile processors, and their tile buffers, beyond the
+	 * given number, once no more tiles are in flight
+	 *
+	 * @param max_pooled	number of processors to keep
+	 */
+	void trim_processor_pool(size_t max_pooled);
+
+	/**
+	 * Estimate memory needed by a tile in flight, for the memory budget:
+	 * tile buffers, at the decompress reduction, plus code block data
+	 * when compressing, or compressed tile data when decompressing
+	 *
+	 * @param tile_index	tile index
+	 * @param compress		true if compressing
+	 */
+	uint64_t tile_memory_estimate(uint16_t tile_index, bool compress);
 	void setTileProcessor(TileProcessor *proc, bool deleteOld);
 
 	BufferedStream* getStream();
@@ -336,6 +486,11 @@ private:
 
 	std::map<uint32_t, TileProcessor*> m_processors;
 
+	// tile processors that have finished a tile; their tile components
+	// keep arenas and tile buffers for the next tile of the same shape
+	std::vector<TileProcessor*> m_processor_pool;
+	std::mutex m_processor_pool_mutex;
+
 
 	/** index of single tile to decompress;
 	 *  !!! initialized to -1 !!! */
@@ -344,6 +499,35 @@ private:
 
 	uint8_t *m_marker_scratch;
 	uint16_t m_marker_scratch_size;
+	MemAccount m_marker_account;
+
+	grk_strip_sink m_strip_sink;
+	void *m_strip_sink_user_data;
+	// collects decompressed tiles into strips, when strip sink is set
+	std::unique_ptr<StripCache> m_strips;
+	// caller-owned output buffer; data is null if not set
+	grk_output_buffer m_output_buffer;
+	// true while grk_decompress writes tiles into output buffer
+	bool m_decompress_to_buffer;
+	// serializes reading of tiles for concurrent single tile decompression
+	std::mutex m_tile_mutex;
+	std::condition_variable m_tile_cv;
+	// tiles currently being decompressed by single tile decompression
+	std::set<uint16_t> m_tiles_in_flight;
+	// tile part positions, built on first single tile decompress,
+	// or loaded from a serialized index
+	std::unique_ptr<TilePartIndex> m_tile_parts;
+	// set if tile parts could not be indexed, so that stream is not scanned again
+	bool m_tile_parts_failed;
+	// decompressed tiles and tile coding state kept for single tile decompression,
+	// and for area decompression through the caches
+	std::unique_ptr<TileCache> m_tile_cache;
+	// keep code block decoder state of tiles, for single tile decompression
+	bool m_refine_tiles;
+	// code block decoder state, per tile
+	std::map<uint16_t, std::unique_ptr<T1CheckpointStore>> m_checkpoints;
+	// limits memory of tiles in flight; null if unlimited
+	std::unique_ptr<MemoryBudget> m_memory_budget;
     /** Only valid for decoding. Whether the whole tile is decoded, or just the region in win_x0/win_y0/win_x1/win_y1 */
 
 public:
@@ -351,6 +535,8 @@ public:
 	grk_plugin_tile *current_plugin_tile;
 	bool m_nb_tile_parts_correction_checked;
 	uint32_t m_nb_tile_parts_correction;
+	// caller-owned input buffer; data and pull are null if not set
+	grk_input_buffer m_input_buffer;
 
 };
 
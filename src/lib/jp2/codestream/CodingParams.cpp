@@ -57,6 +57,7 @@ TileCodingParams::TileCodingParams() :
 								ppt_buffer(nullptr),
 								ppt_data_size(0),
 								ppt_len(0),
+								ppt_account(GRK_MEM_MARKERS),
 								main_qcd_qntsty(0),
 								main_qcd_numStepSizes(0),
 								tccps(nullptr),
@@ -99,6 +100,7 @@ void TileCodingParams::destroy() {
 
 	delete[] ppt_buffer;
 	ppt_buffer = nullptr;
+	ppt_account.set(0);
 	delete[] tccps;
 	tccps = nullptr;
 	grk_free(m_mct_coding_matrix);
@@ -150,6 +150,8 @@ struct TileCodingParams {
 	size_t ppt_data_size;
 	/** size of ppt_data*/
 	size_t ppt_len;
+	/** memory held by ppt markers and ppt_buffer */
+	MemAccount ppt_account;
 	/** fixed_quality */
 	double distoratio[100];
 	// quantization style as read from main QCD marker
@@ -216,6 +218,12 @@ struct EncodingParams {
 	bool writeTLM;
 	/* rate control algorithm */
 	uint32_t rateControlAlgorithm;
+	/* bisect without the rate estimator */
+	bool m_exact_rate_control;
+	/* maximum number of tiles in flight; 0 selects default */
+	uint32_t tileWindow;
+	/* expected upper bound on code stream size */
+	uint64_t m_cs_size_hint;
 };
 
 struct DecodingParams {
@@ -319,12 +327,18 @@ struct DecoderState {
 
 struct EncoderState {
 
-	EncoderState() : m_total_tile_parts(0) {}
+	EncoderState() : m_total_tile_parts(0) {
+		memset(m_global_rates, 0, sizeof(m_global_rates));
+	}
 
 	/** Total num of tile parts in whole image = num tiles* num tileparts in each tile*/
 	/** used in TLMmarker*/
 	uint16_t m_total_tile_parts; /* totnum_tp */
 
+	/** Global rate control only: cumulative packet bytes
+	 * of all tiles allowed for each layer */
+	double m_global_rates[100];
+
 };
 
 }
@@ -2634,6 +2634,10 @@ bool FileFormat::decompress( grk_plugin_tile *tile,	 grk_image *p_image){
 	if (!p_image)
 		return false;
 
+	// palette and channel definitions are applied to the full image
+	if (color.jp2_pclr || color.jp2_cdef)
+		codeStream->set_strip_sink(nullptr, nullptr);
+
 	/* J2K decoding */
 	if (!codeStream->decompress(tile, p_image)) {
 		GRK_ERROR("Failed to decompress JP2 file");
@@ -2751,6 +2755,31 @@ bool FileFormat::set_decompress_area(grk_image *p_image,
 	return codeStream->set_decompress_area(p_image, start_x, start_y, end_x, end_y);
 }
 
+void FileFormat::set_strip_sink(grk_strip_sink sink, void *user_data){
+	codeStream->set_strip_sink(sink, user_data);
+}
+
+bool FileFormat::set_output_buffer(const grk_output_buffer *buffer){
+	// palette and channel definitions are applied to the full image
+	if (buffer && (color.jp2_pclr || color.jp2_cdef)) {
+		GRK_ERROR("Output buffer not supported for JP2 file with palette or channel definitions");
+		return false;
+	}
+	return codeStream->set_output_buffer(buffer);
+}
+
+bool FileFormat::write_index(uint8_t *buffer, size_t *len){
+	return codeStream->write_index(buffer, len);
+}
+
+bool FileFormat::read_index(const uint8_t *buffer, size_t len){
+	return codeStream->read_index(buffer, len);
+}
+
+bool FileFormat::get_tile_cache_stats(grk_tile_cache_stats *stats){
+	return codeStream->get_tile_cache_stats(stats);
+}
+
 bool FileFormat::start_compress(void){
 	/* customization of the validation */
 	if (!jp2_init_compress_validation(this))
@@ -2996,6 +3025,11 @@ bool FileFormat::compress(grk_plugin_tile* tile){
 	return codeStream->compress(tile);
 }
 
+bool FileFormat::set_input_buffer(const grk_input_buffer *buffer){
+
+	return codeStream->set_input_buffer(buffer);
+}
+
 bool FileFormat::compress_tile(uint16_t tile_index,	uint8_t *p_data, uint64_t data_size){
 
 	return codeStream->compress_tile(tile_index, p_data, data_size);
@@ -3021,6 +3055,7 @@ bool FileFormat::decompress_tile(grk_image *p_image,uint16_t tile_index) {
 		return false;
 	}
 
+	std::lock_guard<std::mutex> guard(m_color_mutex);
 	if (!jp2_check_color(p_image, &(color)))
 		return false;
 
@@ -3064,6 +3099,48 @@ bool FileFormat::decompress_tile(grk_image *p_image,uint16_t tile_index) {
 }
 
 
+bool FileFormat::decompress_regions(const grk_region *regions,
+		uint32_t num_regions, grk_image **images) {
+	// palette and channel definitions are applied to the full image
+	if (color.jp2_pclr || color.jp2_cdef) {
+		GRK_ERROR("Regions cannot be decompressed from JP2 file with palette or channel definitions");
+		return false;
+	}
+	if (!codeStream->decompress_regions(regions, num_regions, images)) {
+		GRK_ERROR("Failed to decompress JP2 file");
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(m_color_mutex);
+	for (uint32_t i = 0; i < num_regions; ++i) {
+		auto image = images[i];
+		/* Set Image Color Space */
+		if (enumcs == GRK_ENUM_CLRSPC_CMYK)
+			image->color_space = GRK_CLRSPC_CMYK;
+		else if (enumcs == GRK_ENUM_CLRSPC_SRGB)
+			image->color_space = GRK_CLRSPC_SRGB;
+		else if (enumcs == GRK_ENUM_CLRSPC_GRAY)
+			image->color_space = GRK_CLRSPC_GRAY;
+		else if (enumcs == GRK_ENUM_CLRSPC_SYCC)
+			image->color_space = GRK_CLRSPC_SYCC;
+		else if (enumcs == GRK_ENUM_CLRSPC_EYCC)
+			image->color_space = GRK_CLRSPC_EYCC;
+		else
+			image->color_space = GRK_CLRSPC_UNKNOWN;
+
+		// each region gets its own copy of the profile
+		if (color.icc_profile_buf && !image->icc_profile_buf) {
+			image->icc_profile_buf = new uint8_t[color.icc_profile_len];
+			memcpy(image->icc_profile_buf, color.icc_profile_buf,
+					color.icc_profile_len);
+			image->icc_profile_len = color.icc_profile_len;
+			image->color_space = GRK_CLRSPC_ICC;
+		}
+	}
+
+	return true;
+}
+
 void FileFormat::dump(int32_t flag, FILE *out_stream){
 	j2k_dump(codeStream, flag, out_stream);
 }
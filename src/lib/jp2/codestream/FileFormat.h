@@ -159,6 +159,16 @@ struct FileFormat : public ICodeStream {
 						uint32_t end_x,
 						uint32_t end_y);
 
+	void set_strip_sink(grk_strip_sink sink, void *user_data);
+
+	bool set_output_buffer(const grk_output_buffer *buffer);
+
+	bool write_index(uint8_t *buffer, size_t *len);
+
+	bool read_index(const uint8_t *buffer, size_t len);
+
+	bool get_tile_cache_stats(grk_tile_cache_stats *stats);
+
 
 	/** Decoding function */
    bool decompress( grk_plugin_tile *tile,	grk_image *p_image);
@@ -172,12 +182,17 @@ struct FileFormat : public ICodeStream {
 
    bool compress(grk_plugin_tile* tile);
 
+   bool set_input_buffer(const grk_input_buffer *buffer);
+
    bool compress_tile(uint16_t tile_index,	uint8_t *p_data, uint64_t data_size);
 
    bool end_compress(void);
 
 	bool decompress_tile(grk_image *p_image,uint16_t tile_index);
 
+	bool decompress_regions(const grk_region *regions, uint32_t num_regions,
+			grk_image **images);
+
    void dump(int32_t flag, FILE *out_stream);
 
    grk_codestream_info_v2* get_cstr_info(void);
@@ -216,6 +231,8 @@ struct FileFormat : public ICodeStream {
 	uint32_t jp2_state;
 	uint32_t jp2_img_state;
 	grk_jp2_color color;
+	// guards color, when tiles are decompressed concurrently
+	std::mutex m_color_mutex;
 
 	bool has_capture_resolution;
 	double capture_resolution[2];
@@ -0,0 +1,186 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+#include  <stdexcept>
+
+namespace grk {
+
+FlatTagTree::FlatTagTree(uint64_t mynumleafsh, uint64_t mynumleafsv) :
+		numleafsh(0), numleafsv(0), numnodes(0), numlevels(0), buf(nullptr), capacity(
+				0), values(nullptr), lows(nullptr), known(nullptr) {
+	if (!layout(mynumleafsh, mynumleafsv)) {
+		GRK_WARN("tgt_create numnodes == 0, no tree created.");
+		throw std::runtime_error("tgt_create numnodes == 0, no tree created");
+	}
+	reset();
+}
+
+FlatTagTree::~FlatTagTree() {
+	delete[] buf;
+}
+
+/*
+ Compute level offsets and widths, and grow storage if needed
+ */
+bool FlatTagTree::layout(uint64_t num_leafs_h, uint64_t num_leafs_v) {
+	uint64_t nplh = num_leafs_h;
+	uint64_t nplv = num_leafs_v;
+	uint64_t nodeCount = 0;
+	uint32_t levels = 0;
+	uint64_t n;
+
+	do {
+		if (levels == 32)
+			return false;
+		n = nplh * nplv;
+		levelOffset[levels] = nodeCount;
+		levelWidth[levels] = nplh;
+		nodeCount += n;
+		nplh = (nplh + 1) / 2;
+		nplv = (nplv + 1) / 2;
+		++levels;
+	} while (n > 1);
+	if (nodeCount == 0)
+		return false;
+
+	if (nodeCount > capacity) {
+		// values and lows first, to keep them aligned
+		auto new_buf = new uint8_t[nodeCount
+				* (2 * sizeof(int32_t) + sizeof(uint8_t))];
+		delete[] buf;
+		buf = new_buf;
+		capacity = nodeCount;
+	}
+	values = (int32_t*) buf;
+	lows = values + capacity;
+	known = (uint8_t*) (lows + capacity);
+
+	numleafsh = num_leafs_h;
+	numleafsv = num_leafs_v;
+	numnodes = nodeCount;
+	numlevels = levels;
+
+	return true;
+}
+
+/**
+ * Reinitialise a tag tree from an existing one.
+ *
+ * @param       num_leafs_h           the width of the array of leafs of the tree
+ * @param       num_leafs_v           the height of the array of leafs of the tree
+ * @return      true if successful, false otherwise
+ */
+bool FlatTagTree::init(uint64_t num_leafs_h, uint64_t num_leafs_v) {
+	if ((numleafsh != num_leafs_h) || (numleafsv != num_leafs_v)) {
+		if (!layout(num_leafs_h, num_leafs_v))
+			return false;
+	}
+	reset();
+	return true;
+}
+
+void FlatTagTree::reset() {
+	std::fill(values, values + numnodes,
+			(int32_t) tag_tree_uninitialized_node_value);
+	memset(lows, 0, numnodes * sizeof(int32_t));
+	memset(known, 0, numnodes);
+}
+
+uint32_t FlatTagTree::path(uint64_t leafno, uint64_t *nodes) {
+	uint64_t x = leafno % numleafsh;
+	uint64_t y = leafno / numleafsh;
+	for (uint32_t level = 0; level < numlevels; ++level)
+		nodes[level] = levelOffset[level] + (y >> level) * levelWidth[level]
+				+ (x >> level);
+
+	return numlevels;
+}
+
+void FlatTagTree::setvalue(uint64_t leafno, int64_t value) {
+	uint64_t nodes[32];
+	uint32_t len = path(leafno, nodes);
+	for (uint32_t i = 0; i < len && values[nodes[i]] > value; ++i)
+		values[nodes[i]] = (int32_t) value;
+}
+
+bool FlatTagTree::compress(BitIO *bio, uint64_t leafno, int64_t threshold) {
+	uint64_t nodes[32];
+	uint32_t level = path(leafno, nodes);
+	int64_t low = 0;
+
+	// walk from root down to leaf
+	while (level--) {
+		auto node = nodes[level];
+		if (low > lows[node])
+			lows[node] = (int32_t) low;
+		else
+			low = lows[node];
+
+		while (low < threshold) {
+			if (low >= values[node]) {
+				if (!known[node]) {
+					if (!bio->write(1, 1))
+						return false;
+					known[node] = 1;
+				}
+				break;
+			}
+			if (!bio->write(0, 1))
+				return false;
+			++low;
+		}
+		lows[node] = (int32_t) low;
+	}
+	return true;
+}
+
+void FlatTagTree::decompress(BitIO *bio, uint64_t leafno, int64_t threshold,
+		uint8_t *decoded) {
+	uint64_t value;
+	decodeValue(bio, leafno, threshold, &value);
+	*decoded = (value < (uint32_t) threshold) ? 1 : 0;
+}
+
+void FlatTagTree::decodeValue(BitIO *bio, uint64_t leafno, int64_t threshold,
+		uint64_t *value) {
+	uint64_t nodes[32];
+	uint32_t level = path(leafno, nodes);
+	int64_t low = 0;
+	uint64_t node = nodes[0];
+
+	// walk from root down to leaf
+	while (level--) {
+		node = nodes[level];
+		if (low > lows[node])
+			lows[node] = (int32_t) low;
+		else
+			low = lows[node];
+		while (low < threshold && low < values[node]) {
+			uint32_t temp = 0;
+			bio->read(&temp, 1);
+			if (temp)
+				values[node] = (int32_t) low;
+			else
+				++low;
+		}
+		lows[node] = (int32_t) low;
+	}
+	*value = (uint64_t) values[node];
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+namespace grk {
+
+/**
+ Tag tree stored as flat arrays.
+
+ Nodes of each level are laid out row by row, one level after another,
+ so the parent of a node is found from its coordinates and the level offsets,
+ rather than from a parent pointer. Node values, lower bounds and known flags
+ live in separate contiguous arrays, so a reset is three linear fills.
+ Interface matches TagTree.
+ */
+class FlatTagTree {
+
+public:
+
+	/**
+	 Create a tag tree
+	 @param numleafsh Width of the array of leafs of the tree
+	 @param numleafsv Height of the array of leafs of the tree
+	 */
+	FlatTagTree(uint64_t numleafsh, uint64_t numleafsv);
+	~FlatTagTree();
+
+	/**
+	 * Reinitialises a tag tree
+	 *
+	 * @param	num_leafs_h		the width of the array of leafs of the tree
+	 * @param	num_leafs_v		the height of the array of leafs of the tree
+	 * @return	true if successful, false otherwise
+	 */
+	bool init(uint64_t num_leafs_h, uint64_t num_leafs_v);
+
+	/**
+	 Reset a tag tree (set all leaves to 0)
+	 */
+	void reset();
+	/**
+	 Set the value of a leaf of a tag tree
+	 @param leafno Number that identifies the leaf to modify
+	 @param value New value of the leaf
+	 */
+	void setvalue(uint64_t leafno, int64_t value);
+	/**
+	 Encode the value of a leaf of the tag tree up to a given threshold
+	 @param bio Pointer to a BIO handle
+	 @param leafno Number that identifies the leaf to compress
+	 @param threshold Threshold to use when encoding value of the leaf
+	 @return true if successful, otherwise false
+	 */
+	bool compress(BitIO *bio, uint64_t leafno, int64_t threshold);
+	/**
+	 Decode the value of a leaf of the tag tree up to a given threshold
+	 @param bio Pointer to a BIO handle
+	 @param leafno Number that identifies the leaf to decompress
+	 @param threshold Threshold to use when decoding value of the leaf
+	 @param decoded 1 if the node's value < threshold, 0 otherwise
+	 */
+	void decompress(BitIO *bio, uint64_t leafno, int64_t threshold,
+			uint8_t *decoded);
+
+	/**
+	 Decode the value of a leaf of the tag tree up to a given threshold
+	 @param bio Pointer to a BIO handle
+	 @param leafno Number that identifies the leaf to decompress
+	 @param threshold Threshold to use when decoding value of the leaf
+	 @param value the node's value
+	 */
+	void decodeValue(BitIO *bio, uint64_t leafno, int64_t threshold,
+			uint64_t *value);
+
+private:
+	bool layout(uint64_t num_leafs_h, uint64_t num_leafs_v);
+	// fill path with node indices from leaf up to root; returns path length
+	uint32_t path(uint64_t leafno, uint64_t *nodes);
+
+	uint64_t numleafsh;
+	uint64_t numleafsv;
+	uint64_t numnodes;
+	uint32_t numlevels;
+	uint64_t levelOffset[32];
+	uint64_t levelWidth[32];
+
+	// single allocation holding values, lows and known flags
+	uint8_t *buf;
+	uint64_t capacity; /* maximum number of nodes held by buf */
+	int32_t *values;
+	int32_t *lows;
+	uint8_t *known;
+};
+
+}
@@ -0,0 +1,188 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+namespace grk {
+
+StripCache::StripCache(CodeStream *codeStream, grk_strip_sink sink,
+		void *user_data, MemoryBudget *budget) :
+		m_codeStream(codeStream), m_sink(sink), m_user_data(user_data), m_budget(
+				budget), m_tile_row_begin(0), m_next(0), m_failed(false) {
+	auto decoder = &codeStream->m_decoder;
+	m_tile_row_begin = decoder->m_start_tile_y_index;
+	uint32_t tiles_per_strip = decoder->m_end_tile_x_index
+			- decoder->m_start_tile_x_index;
+	m_strips.resize(decoder->m_end_tile_y_index - decoder->m_start_tile_y_index);
+	for (auto &strip : m_strips)
+		strip.pending = tiles_per_strip;
+}
+
+StripCache::~StripCache() {
+	for (auto &strip : m_strips)
+		destroy_strip(&strip);
+}
+
+void StripCache::destroy_strip(Strip *strip) {
+	grk_image_destroy(strip->image);
+	strip->image = nullptr;
+	if (m_budget && strip->charged)
+		m_budget->discharge(strip->charged);
+	strip->charged = 0;
+}
+
+grk_image* StripCache::create_strip(Strip *strip_info) {
+	auto index = (uint32_t) (strip_info - &m_strips[0]);
+	uint64_t charged = 0;
+	auto cp = &m_codeStream->m_cp;
+	auto output = m_codeStream->m_output_image;
+	auto reduce = cp->m_coding_params.m_dec.m_reduce;
+	uint64_t tile_row = m_tile_row_begin + index;
+	auto y0 = (uint32_t) std::max<uint64_t>(cp->ty0 + tile_row * cp->t_height,
+			output->y0);
+	auto y1 = (uint32_t) std::min<uint64_t>(
+			cp->ty0 + (tile_row + 1) * cp->t_height, output->y1);
+
+	auto strip = grk_image_create0();
+	if (!strip)
+		return nullptr;
+	strip->x0 = output->x0;
+	strip->x1 = output->x1;
+	strip->y0 = y0;
+	strip->y1 = std::max<uint32_t>(y0, y1);
+	strip->color_space = output->color_space;
+	strip->comps = (grk_image_comp*) grk_calloc(output->numcomps,
+			sizeof(grk_image_comp));
+	if (!strip->comps) {
+		grk_image_destroy(strip);
+		return nullptr;
+	}
+	strip->numcomps = output->numcomps;
+	for (uint32_t compno = 0; compno < strip->numcomps; ++compno) {
+		auto comp = strip->comps + compno;
+		auto out_comp = output->comps + compno;
+		*comp = *out_comp;
+		comp->data = nullptr;
+		comp->owns_data = false;
+
+		// rows of strip, in reduced component coordinates
+		uint32_t out_y0 = ceildivpow2<uint32_t>(out_comp->y0, reduce);
+		uint32_t out_y1 = out_y0 + out_comp->h;
+		uint32_t strip_y0 = std::max<uint32_t>(
+				ceildivpow2<uint32_t>(ceildiv<uint32_t>(y0, out_comp->dy), reduce),
+				out_y0);
+		uint32_t strip_y1 = std::min<uint32_t>(
+				ceildivpow2<uint32_t>(ceildiv<uint32_t>(y1, out_comp->dy), reduce),
+				out_y1);
+		comp->y0 = (strip_y0 == out_y0) ? out_comp->y0 : strip_y0 << reduce;
+		comp->h = strip_y1 > strip_y0 ? strip_y1 - strip_y0 : 0;
+		comp->stride = comp->w;
+		if (!comp->h || !comp->w)
+			continue;
+		if (!grk_image_single_component_data_alloc(comp)) {
+			grk_image_destroy(strip);
+			return nullptr;
+		}
+		uint64_t bytes = (uint64_t) comp->stride * comp->h * sizeof(int32_t);
+		memset(comp->data, 0, bytes);
+		charged += bytes;
+	}
+	// strips are held until all of their tiles are decompressed,
+	// so they count against the memory available to new tiles
+	if (m_budget && charged) {
+		m_budget->charge(charged);
+		strip_info->charged = charged;
+	}
+
+	return strip;
+}
+
+bool StripCache::deliver(Strip *strip) {
+	if (!strip->image)
+		strip->image = create_strip(strip);
+	if (!strip->image) {
+		m_failed = true;
+		return false;
+	}
+	bool empty = true;
+	for (uint32_t compno = 0; compno < strip->image->numcomps; ++compno) {
+		if (strip->image->comps[compno].h)
+			empty = false;
+	}
+	if (!m_failed && !empty && !m_sink(strip->image, m_user_data)) {
+		GRK_ERROR("Strip sink failed");
+		m_failed = true;
+	}
+	destroy_strip(strip);
+
+	return !m_failed;
+}
+
+bool StripCache::deliver_complete(void) {
+	while (!m_failed && m_next < m_strips.size()
+			&& m_strips[m_next].pending == 0) {
+		if (!deliver(&m_strips[m_next]))
+			return false;
+		m_next++;
+	}
+
+	return !m_failed;
+}
+
+bool StripCache::ingest(TileProcessor *tileProcessor) {
+	auto cp = &m_codeStream->m_cp;
+	uint32_t index = tileProcessor->m_tile_index / cp->t_grid_width
+			- m_tile_row_begin;
+	if (index >= m_strips.size())
+		return true;
+	grk_image *image = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (m_failed)
+			return false;
+		auto strip = &m_strips[index];
+		if (!strip->image) {
+			strip->image = create_strip(strip);
+			if (!strip->image) {
+				m_failed = true;
+				return false;
+			}
+		}
+		image = strip->image;
+	}
+	// tiles of a strip cover disjoint columns, so they can be copied concurrently
+	bool rc = tileProcessor->copy_decompressed_tile_to_output_image(image);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto strip = &m_strips[index];
+	if (strip->pending)
+		strip->pending--;
+	if (!deliver_complete())
+		return false;
+
+	return rc;
+}
+
+bool StripCache::flush(void) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (uint32_t i = m_next; i < m_strips.size(); ++i)
+		m_strips[i].pending = 0;
+
+	return deliver_complete();
+}
+
+}
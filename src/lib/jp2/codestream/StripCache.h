@@ -0,0 +1,95 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <mutex>
+
+namespace grk {
+
+struct CodeStream;
+struct TileProcessor;
+
+/**
+ * Collects decompressed tiles into strips, one strip per row of tiles,
+ * and hands each strip to a strip sink once all of its tiles are present.
+ *
+ * Strips are delivered in top to bottom order, and freed as soon as
+ * they have been delivered, so only the rows of tiles currently being
+ * decompressed are held in memory.
+ */
+class StripCache {
+public:
+	/**
+	 * @param codeStream	code stream
+	 * @param sink			strip sink
+	 * @param user_data		user data passed to sink
+	 * @param budget		memory budget that strips are charged to,
+	 * 						or nullptr
+	 */
+	StripCache(CodeStream *codeStream, grk_strip_sink sink, void *user_data,
+			MemoryBudget *budget);
+	~StripCache();
+
+	/**
+	 * Copy decompressed tile into its strip, and deliver all strips
+	 * that are complete. May be called concurrently.
+	 *
+	 * @param tileProcessor	tile processor of decompressed tile
+	 *
+	 * @return false if the sink failed
+	 */
+	bool ingest(TileProcessor *tileProcessor);
+
+	/**
+	 * Deliver remaining strips, including strips with missing tiles
+	 *
+	 * @return false if the sink failed
+	 */
+	bool flush(void);
+
+private:
+	struct Strip {
+		Strip() :
+				image(nullptr), pending(0), charged(0) {
+		}
+		grk_image *image;
+		// number of tiles not yet copied into strip
+		uint32_t pending;
+		// bytes charged to memory budget for image
+		uint64_t charged;
+	};
+	grk_image* create_strip(Strip *strip);
+	void destroy_strip(Strip *strip);
+	bool deliver(Strip *strip);
+	// deliver complete strips in order; must be called with lock held
+	bool deliver_complete(void);
+
+	CodeStream *m_codeStream;
+	grk_strip_sink m_sink;
+	void *m_user_data;
+	MemoryBudget *m_budget;
+	uint32_t m_tile_row_begin;
+	std::vector<Strip> m_strips;
+	// index of next strip to deliver
+	uint32_t m_next;
+	bool m_failed;
+	std::mutex m_mutex;
+};
+
+}
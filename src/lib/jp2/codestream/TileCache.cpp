@@ -0,0 +1,191 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+namespace grk {
+
+static uint64_t tile_image_size(const grk_image *image) {
+	uint64_t size = 0;
+	for (uint32_t compno = 0; compno < image->numcomps; ++compno) {
+		auto comp = image->comps + compno;
+		size += (uint64_t) comp->stride * comp->h * sizeof(int32_t);
+	}
+	return size;
+}
+
+TileCache::TileCache(uint64_t max_tile_bytes, uint64_t max_coding_bytes,
+		uint64_t max_refine_bytes) :
+		m_max_tile_bytes(max_tile_bytes), m_max_coding_bytes(max_coding_bytes), m_max_refine_bytes(
+				max_refine_bytes), m_tile_bytes(0), m_coding_bytes(0), m_refine_bytes(
+				0) {
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool TileCache::has_limits(uint64_t max_tile_bytes,
+		uint64_t max_coding_bytes, uint64_t max_refine_bytes) const {
+	return m_max_tile_bytes == max_tile_bytes
+			&& m_max_coding_bytes == max_coding_bytes
+			&& m_max_refine_bytes == max_refine_bytes;
+}
+
+bool TileCache::caches_tiles(void) const {
+	return m_max_tile_bytes != 0;
+}
+
+bool TileCache::caches_coding_state(void) const {
+	return m_max_coding_bytes != 0;
+}
+
+std::shared_ptr<grk_image> TileCache::get(const TileCacheKey &key) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto iter = m_tile_map.find(key);
+	if (iter == m_tile_map.end()) {
+		m_stats.tile_misses++;
+		return nullptr;
+	}
+	m_stats.tile_hits++;
+	m_tiles.splice(m_tiles.begin(), m_tiles, iter->second);
+
+	return iter->second->second;
+}
+
+void TileCache::put(const TileCacheKey &key, grk_image *image) {
+	std::shared_ptr<grk_image> entry(image, grk_image_destroy);
+	uint64_t bytes = tile_image_size(image);
+	if (bytes > m_max_tile_bytes)
+		return;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// another thread may have decompressed the same tile in the meantime
+	auto iter = m_tile_map.find(key);
+	if (iter != m_tile_map.end()) {
+		m_tile_bytes -= tile_image_size(iter->second->second.get());
+		m_tiles.erase(iter->second);
+		m_tile_map.erase(iter);
+	}
+	while (!m_tiles.empty() && m_tile_bytes + bytes > m_max_tile_bytes) {
+		auto &lru = m_tiles.back();
+		m_tile_bytes -= tile_image_size(lru.second.get());
+		m_tile_map.erase(lru.first);
+		m_tiles.pop_back();
+		m_stats.tile_evictions++;
+	}
+	m_tiles.emplace_front(key, entry);
+	m_tile_map[key] = m_tiles.begin();
+	m_tile_bytes += bytes;
+}
+
+bool TileCache::get_coding_state(uint16_t tile_index) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto iter = m_coding_map.find(tile_index);
+	if (iter == m_coding_map.end()) {
+		m_stats.coding_state_misses++;
+		return false;
+	}
+	m_stats.coding_state_hits++;
+	m_coding.splice(m_coding.begin(), m_coding, iter->second);
+
+	return true;
+}
+
+void TileCache::put_coding_state(uint16_t tile_index, uint64_t bytes,
+		const std::set<uint16_t> &in_flight, std::vector<uint16_t> *evicted) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (bytes > m_max_coding_bytes) {
+		evicted->push_back(tile_index);
+		return;
+	}
+	auto iter = m_coding_map.find(tile_index);
+	if (iter != m_coding_map.end()) {
+		m_coding_bytes -= iter->second->second;
+		m_coding.erase(iter->second);
+		m_coding_map.erase(iter);
+	}
+	auto lru = m_coding.end();
+	while (lru != m_coding.begin()
+			&& m_coding_bytes + bytes > m_max_coding_bytes) {
+		--lru;
+		if (in_flight.find(lru->first) != in_flight.end())
+			continue;
+		m_coding_bytes -= lru->second;
+		m_coding_map.erase(lru->first);
+		evicted->push_back(lru->first);
+		lru = m_coding.erase(lru);
+		m_stats.coding_state_evictions++;
+	}
+	// only tiles in flight remain, so this tile can't be retained
+	if (m_coding_bytes + bytes > m_max_coding_bytes) {
+		evicted->push_back(tile_index);
+		return;
+	}
+	m_coding.emplace_front(tile_index, bytes);
+	m_coding_map[tile_index] = m_coding.begin();
+	m_coding_bytes += bytes;
+}
+
+void TileCache::clear_coding_state(std::vector<uint16_t> *evicted) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (auto &entry : m_coding)
+		evicted->push_back(entry.first);
+	m_coding.clear();
+	m_coding_map.clear();
+	m_coding_bytes = 0;
+}
+
+void TileCache::put_refine_state(uint16_t tile_index, uint64_t bytes,
+		const std::set<uint16_t> &in_flight, std::vector<uint16_t> *evicted) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto iter = m_refine_map.find(tile_index);
+	if (iter != m_refine_map.end()) {
+		m_refine_bytes -= iter->second->second;
+		m_refine.erase(iter->second);
+		m_refine_map.erase(iter);
+	}
+	auto lru = m_refine.end();
+	while (lru != m_refine.begin()
+			&& m_refine_bytes + bytes > m_max_refine_bytes) {
+		--lru;
+		if (in_flight.find(lru->first) != in_flight.end())
+			continue;
+		m_refine_bytes -= lru->second;
+		m_refine_map.erase(lru->first);
+		evicted->push_back(lru->first);
+		lru = m_refine.erase(lru);
+		m_stats.refine_state_evictions++;
+	}
+	m_refine.emplace_front(tile_index, bytes);
+	m_refine_map[tile_index] = m_refine.begin();
+	m_refine_bytes += bytes;
+}
+
+void TileCache::clear_refine_state(void) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_refine.clear();
+	m_refine_map.clear();
+	m_refine_bytes = 0;
+}
+
+void TileCache::get_stats(grk_tile_cache_stats *stats) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	*stats = m_stats;
+	stats->tile_bytes = m_tile_bytes;
+	stats->coding_state_bytes = m_coding_bytes;
+	stats->refine_state_bytes = m_refine_bytes;
+}
+
+}
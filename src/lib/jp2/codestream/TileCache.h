@@ -0,0 +1,193 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace grk {
+
+/**
+ * Identifies a decompressed tile: the same tile decompressed
+ * at a different resolution, or with a different number of layers,
+ * is a different entry
+ */
+struct TileCacheKey {
+	TileCacheKey(uint16_t tile, uint32_t red, uint32_t lyr) :
+			tile_index(tile), reduce(red), layers(lyr) {
+	}
+	bool operator<(const TileCacheKey &rhs) const {
+		if (tile_index != rhs.tile_index)
+			return tile_index < rhs.tile_index;
+		if (reduce != rhs.reduce)
+			return reduce < rhs.reduce;
+		return layers < rhs.layers;
+	}
+	uint16_t tile_index;
+	uint32_t reduce;
+	uint32_t layers;
+};
+
+/**
+ * Least recently used caches for single tile decompression, and for
+ * decompression of an area tile by tile, for viewers that revisit the same
+ * tiles while panning and zooming.
+ *
+ * 1. decompressed tiles, keyed by tile, reduce and number of layers,
+ * and bounded by the total size of their component buffers
+ *
+ * 2. tile coding state, that is the parsed tile header and the compressed
+ * tile data, keyed by tile and bounded by the total size of the compressed data.
+ * A tile whose coding state is cached is decompressed again without seeking
+ * or parsing any markers.
+ *
+ * 3. code block decoder state kept to refine tiles, keyed by tile and
+ * bounded by its total size. The state of the tile added last is always kept.
+ *
+ * The cache only does the book keeping for coding state and decoder state:
+ * the state itself is owned by the code stream, and released by the code stream
+ * when a tile is evicted. All methods may be called concurrently.
+ */
+class TileCache {
+public:
+	/**
+	 * Create cache
+	 *
+	 * @param max_tile_bytes		maximum size of decompressed tiles, or 0
+	 * 								to disable tile caching
+	 * @param max_coding_bytes		maximum size of compressed tile data, or 0
+	 * 								to disable coding state caching
+	 * @param max_refine_bytes		maximum size of decoder state
+	 */
+	TileCache(uint64_t max_tile_bytes, uint64_t max_coding_bytes,
+			uint64_t max_refine_bytes);
+
+	/**
+	 * Look up decompressed tile
+	 *
+	 * @param key	tile key
+	 *
+	 * @return tile image, or nullptr if tile is not cached.
+	 * The image remains valid while the caller holds a reference,
+	 * even if it is evicted.
+	 */
+	std::shared_ptr<grk_image> get(const TileCacheKey &key);
+
+	/**
+	 * Add decompressed tile, evicting least recently used tiles
+	 * as necessary. Tiles larger than the cache are not added.
+	 *
+	 * @param key		tile key
+	 * @param image		tile image; cache takes ownership
+	 */
+	void put(const TileCacheKey &key, grk_image *image);
+
+	/**
+	 * Check if coding state of tile is retained, and mark it as
+	 * most recently used
+	 *
+	 * @param tile_index	tile index
+	 *
+	 * @return true if coding state is retained
+	 */
+	bool get_coding_state(uint16_t tile_index);
+
+	/**
+	 * Record that coding state of tile is retained, and choose
+	 * least recently used tiles whose coding state should be released.
+	 * Tiles currently being decompressed are never chosen.
+	 *
+	 * @param tile_index		tile index
+	 * @param bytes				size of compressed tile data
+	 * @param in_flight			tiles currently being decompressed
+	 * @param evicted			tiles whose coding state must be released;
+	 * 							may include tile_index itself
+	 */
+	void put_coding_state(uint16_t tile_index, uint64_t bytes,
+			const std::set<uint16_t> &in_flight,
+			std::vector<uint16_t> *evicted);
+
+	/**
+	 * Forget all retained coding state
+	 *
+	 * @param evicted	tiles whose coding state must be released
+	 */
+	void clear_coding_state(std::vector<uint16_t> *evicted);
+
+	/**
+	 * Record size of decoder state of tile, and choose least recently
+	 * used tiles whose decoder state should be released.
+	 * Tiles currently being decompressed, and tile_index itself,
+	 * are never chosen.
+	 *
+	 * @param tile_index		tile index
+	 * @param bytes				size of decoder state
+	 * @param in_flight			tiles currently being decompressed
+	 * @param evicted			tiles whose decoder state must be released
+	 */
+	void put_refine_state(uint16_t tile_index, uint64_t bytes,
+			const std::set<uint16_t> &in_flight,
+			std::vector<uint16_t> *evicted);
+
+	/**
+	 * Forget all decoder state
+	 */
+	void clear_refine_state(void);
+
+	bool has_limits(uint64_t max_tile_bytes, uint64_t max_coding_bytes,
+			uint64_t max_refine_bytes) const;
+	bool caches_tiles(void) const;
+	bool caches_coding_state(void) const;
+
+	/**
+	 * Get hit, miss and eviction counts
+	 *
+	 * @param stats		statistics
+	 */
+	void get_stats(grk_tile_cache_stats *stats);
+
+private:
+	typedef std::pair<TileCacheKey, std::shared_ptr<grk_image>> TileEntry;
+	typedef std::pair<uint16_t, uint64_t> CodingEntry;
+
+	uint64_t m_max_tile_bytes;
+	uint64_t m_max_coding_bytes;
+	uint64_t m_max_refine_bytes;
+
+	// most recently used at front
+	std::list<TileEntry> m_tiles;
+	std::map<TileCacheKey, std::list<TileEntry>::iterator> m_tile_map;
+	uint64_t m_tile_bytes;
+
+	std::list<CodingEntry> m_coding;
+	std::map<uint16_t, std::list<CodingEntry>::iterator> m_coding_map;
+	uint64_t m_coding_bytes;
+
+	std::list<CodingEntry> m_refine;
+	std::map<uint16_t, std::list<CodingEntry>::iterator> m_refine_map;
+	uint64_t m_refine_bytes;
+
+	grk_tile_cache_stats m_stats;
+	std::mutex m_mutex;
+};
+
+}
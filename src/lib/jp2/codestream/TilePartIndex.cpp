@@ -0,0 +1,268 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+namespace grk {
+
+const uint64_t no_tile_part = (uint64_t) -1;
+
+// SOT marker (2 bytes) and SOT marker segment (10 bytes)
+const uint32_t sot_marker_bytes = 12;
+
+// serialized index: magic, version, stream length, main header hash,
+// number of tiles and number of tile parts, followed by
+// (tile index, SOT position, tile part length) for each tile part
+const uint32_t index_magic = 0x47524B49; // GRKI
+const uint32_t index_version = 1;
+const size_t index_header_bytes = 4 + 4 + 8 + 8 + 4 + 4;
+const size_t index_tile_part_bytes = 2 + 8 + 4;
+
+TilePartIndex::TilePartIndex(uint16_t numTiles) :
+		m_first_tile_part(numTiles, no_tile_part), m_num_tiles_found(0) {
+}
+
+void TilePartIndex::clear(void) {
+	m_tile_parts.clear();
+	std::fill(m_first_tile_part.begin(), m_first_tile_part.end(), no_tile_part);
+	m_num_tiles_found = 0;
+}
+
+bool TilePartIndex::add(uint16_t tile_index, uint64_t sot_pos, uint32_t length) {
+	if (tile_index >= m_first_tile_part.size())
+		return false;
+	if (m_first_tile_part[tile_index] == no_tile_part) {
+		m_first_tile_part[tile_index] = sot_pos;
+		m_num_tiles_found++;
+	}
+	m_tile_parts.push_back(TilePart(tile_index, sot_pos, length));
+
+	return true;
+}
+
+bool TilePartIndex::build(BufferedStream *stream, TileLengthMarkers *tlm,
+		uint64_t first_sot_pos) {
+	uint64_t stream_len = stream->tell() + stream->get_number_byte_left();
+	if (tlm) {
+		if (build_from_tlm(tlm, first_sot_pos, stream_len))
+			return true;
+		GRK_WARN("TLM marker is inconsistent with code stream: "
+				"scanning SOT markers instead");
+		clear();
+	}
+	bool rc = scan(stream, first_sot_pos);
+
+	return rc && m_num_tiles_found == m_first_tile_part.size();
+}
+
+bool TilePartIndex::build_from_tlm(TileLengthMarkers *tlm,
+		uint64_t first_sot_pos, uint64_t stream_len) {
+	uint64_t pos = first_sot_pos;
+	uint16_t tile_index = 0;
+	bool first = true;
+	tlm->getInit();
+	while (true) {
+		auto tl = tlm->getNext();
+		if (tl.length == 0)
+			break;
+		// without tile numbers, there is exactly one tile part per tile,
+		// in tile order
+		if (tl.has_tile_number)
+			tile_index = tl.tile_number;
+		else if (!first)
+			tile_index++;
+		first = false;
+		if (tl.length < sot_marker_bytes || pos + tl.length > stream_len)
+			return false;
+		if (!add(tile_index, pos, tl.length))
+			return false;
+		pos += tl.length;
+	}
+
+	return m_num_tiles_found == m_first_tile_part.size();
+}
+
+bool TilePartIndex::scan(BufferedStream *stream, uint64_t first_sot_pos) {
+	uint64_t pos = first_sot_pos;
+	uint8_t header[sot_marker_bytes];
+	while (true) {
+		// EOC is the only marker shorter than SOT, and may end the stream
+		if (!stream->seek(pos) || stream->read(header, 2) != 2)
+			return false;
+		uint32_t marker, marker_len, tile_index, tile_part_len;
+		grk_read<uint32_t>(header, &marker, 2);
+		if (marker == J2K_MS_EOC)
+			return true;
+		if (stream->read(header + 2, sot_marker_bytes - 2)
+				!= sot_marker_bytes - 2)
+			return false;
+		grk_read<uint32_t>(header + 2, &marker_len, 2);
+		if (marker != J2K_MS_SOT || marker_len != sot_marker_bytes - 2)
+			return false;
+		grk_read<uint32_t>(header + 4, &tile_index, 2);
+		grk_read<uint32_t>(header + 6, &tile_part_len, 4);
+		if (tile_part_len != 0 && tile_part_len < sot_marker_bytes)
+			return false;
+		if (!add((uint16_t) tile_index, pos, tile_part_len))
+			return false;
+		// last tile part extends to EOC
+		if (tile_part_len == 0)
+			return true;
+		pos += tile_part_len;
+	}
+}
+
+bool TilePartIndex::first_tile_part(uint16_t tile_index,
+		uint64_t *sot_pos) const {
+	if (tile_index >= m_first_tile_part.size()
+			|| m_first_tile_part[tile_index] == no_tile_part)
+		return false;
+	*sot_pos = m_first_tile_part[tile_index];
+
+	return true;
+}
+
+void TilePartIndex::next_tile_parts(uint64_t pos, uint64_t stream_len,
+		uint64_t max_bytes,
+		std::vector<std::pair<uint64_t, uint64_t>> *ranges) const {
+	auto iter = std::lower_bound(m_tile_parts.begin(), m_tile_parts.end(), pos,
+			[stream_len](const TilePart &tp, uint64_t p) {
+				return (tp.length ? tp.sot_pos + tp.length : stream_len) <= p;
+			});
+	uint64_t total = 0;
+	for (; iter != m_tile_parts.end(); ++iter) {
+		if (iter->sot_pos >= stream_len)
+			break;
+		uint64_t len =
+				iter->length ? iter->length : stream_len - iter->sot_pos;
+		if (total + len > max_bytes)
+			break;
+		ranges->push_back(std::make_pair(iter->sot_pos, len));
+		total += len;
+	}
+}
+
+bool TilePartIndex::write(uint8_t *buffer, size_t *len,
+		const TilePartIndexKey &key) const {
+	size_t required = index_header_bytes
+			+ m_tile_parts.size() * index_tile_part_bytes;
+	if (!buffer) {
+		*len = required;
+		return true;
+	}
+	if (*len < required) {
+		GRK_ERROR("Buffer of size %u is too small for index of size %u",
+				(uint32_t) *len, (uint32_t) required);
+		return false;
+	}
+	auto ptr = buffer;
+	grk_write<uint32_t>(ptr, index_magic);
+	ptr += 4;
+	grk_write<uint32_t>(ptr, index_version);
+	ptr += 4;
+	grk_write<uint64_t>(ptr, key.stream_len);
+	ptr += 8;
+	grk_write<uint64_t>(ptr, key.main_header_hash);
+	ptr += 8;
+	grk_write<uint32_t>(ptr, (uint32_t) m_first_tile_part.size());
+	ptr += 4;
+	grk_write<uint32_t>(ptr, (uint32_t) m_tile_parts.size());
+	ptr += 4;
+	for (auto &tp : m_tile_parts) {
+		grk_write<uint16_t>(ptr, tp.tile_index);
+		ptr += 2;
+		grk_write<uint64_t>(ptr, tp.sot_pos);
+		ptr += 8;
+		grk_write<uint32_t>(ptr, tp.length);
+		ptr += 4;
+	}
+	*len = required;
+
+	return true;
+}
+
+bool TilePartIndex::read(const uint8_t *buffer, size_t len,
+		const TilePartIndexKey &key) {
+	clear();
+	if (!buffer || len < index_header_bytes)
+		return false;
+	auto ptr = buffer;
+	uint32_t magic, version, num_tiles, num_tile_parts;
+	uint64_t stream_len, main_header_hash;
+	grk_read<uint32_t>(ptr, &magic);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &version);
+	ptr += 4;
+	if (magic != index_magic || version != index_version)
+		return false;
+	grk_read<uint64_t>(ptr, &stream_len);
+	ptr += 8;
+	grk_read<uint64_t>(ptr, &main_header_hash);
+	ptr += 8;
+	if (stream_len != key.stream_len
+			|| main_header_hash != key.main_header_hash)
+		return false;
+	grk_read<uint32_t>(ptr, &num_tiles);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &num_tile_parts);
+	ptr += 4;
+	if (num_tiles != m_first_tile_part.size()
+			|| len != index_header_bytes
+							+ (size_t) num_tile_parts * index_tile_part_bytes)
+		return false;
+	m_tile_parts.reserve(num_tile_parts);
+	for (uint32_t i = 0; i < num_tile_parts; ++i) {
+		uint16_t tile_index;
+		uint64_t sot_pos;
+		uint32_t length;
+		grk_read<uint16_t>(ptr, &tile_index);
+		ptr += 2;
+		grk_read<uint64_t>(ptr, &sot_pos);
+		ptr += 8;
+		grk_read<uint32_t>(ptr, &length);
+		ptr += 4;
+		if (sot_pos + std::max<uint32_t>(length, sot_marker_bytes) > stream_len
+				|| !add(tile_index, sot_pos, length)) {
+			clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool TilePartIndex::verify(BufferedStream *stream) const {
+	if (m_tile_parts.empty())
+		return true;
+	for (auto tp : { m_tile_parts.front(), m_tile_parts.back() }) {
+		uint8_t header[sot_marker_bytes];
+		if (!stream->seek(tp.sot_pos)
+				|| stream->read(header, sot_marker_bytes) != sot_marker_bytes)
+			return false;
+		uint32_t marker, tile_index, tile_part_len;
+		grk_read<uint32_t>(header, &marker, 2);
+		grk_read<uint32_t>(header + 4, &tile_index, 2);
+		grk_read<uint32_t>(header + 6, &tile_part_len, 4);
+		if (marker != J2K_MS_SOT || tile_index != tp.tile_index
+				|| tile_part_len != tp.length)
+			return false;
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,144 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace grk {
+
+struct TileLengthMarkers;
+
+/**
+ * Identifies the code stream that an index was built from,
+ * so that a stale serialized index can be rejected
+ */
+struct TilePartIndexKey {
+	TilePartIndexKey() :
+			stream_len(0), main_header_hash(0) {
+	}
+	// total length of stream
+	uint64_t stream_len;
+	// hash of all bytes preceding the first SOT marker
+	uint64_t main_header_hash;
+};
+
+/**
+ * Stream offsets of the tile parts of every tile in a code stream.
+ *
+ * The index is built once, from the TLM markers if present, and otherwise
+ * by hopping from SOT marker to SOT marker using Psot, without
+ * reading any packet data. A tile can then be located with a single seek.
+ *
+ * The index can also be serialized, for example to a sidecar file,
+ * and read back when the code stream is reopened.
+ */
+class TilePartIndex {
+public:
+	TilePartIndex(uint16_t numTiles);
+
+	/**
+	 * Build index
+	 *
+	 * @param stream			code stream
+	 * @param tlm				TLM markers, or nullptr if there are none
+	 * @param first_sot_pos		stream position of first SOT marker
+	 *
+	 * @return true if every tile was located
+	 */
+	bool build(BufferedStream *stream, TileLengthMarkers *tlm,
+			uint64_t first_sot_pos);
+
+	/**
+	 * Get position of SOT marker of first tile part of tile
+	 *
+	 * @param tile_index	tile index
+	 * @param sot_pos		stream position of SOT marker
+	 *
+	 * @return false if tile is not in index
+	 */
+	bool first_tile_part(uint16_t tile_index, uint64_t *sot_pos) const;
+
+	/**
+	 * Get stream ranges of the tile parts that end after a stream position,
+	 * in code stream order
+	 *
+	 * @param pos			stream position
+	 * @param stream_len	total length of stream
+	 * @param max_bytes		maximum total length of ranges
+	 * @param ranges		(offset, length) of each tile part
+	 */
+	void next_tile_parts(uint64_t pos, uint64_t stream_len, uint64_t max_bytes,
+			std::vector<std::pair<uint64_t, uint64_t>> *ranges) const;
+
+	/**
+	 * Serialize index
+	 *
+	 * @param buffer	destination buffer, or nullptr to query length
+	 * @param len		in: length of buffer; out: length of serialized index
+	 * @param key		key of code stream
+	 *
+	 * @return false if buffer is too small
+	 */
+	bool write(uint8_t *buffer, size_t *len, const TilePartIndexKey &key) const;
+
+	/**
+	 * Read serialized index
+	 *
+	 * @param buffer	serialized index
+	 * @param len		length of serialized index
+	 * @param key		key of code stream
+	 *
+	 * @return false if index is corrupt, or was built from a different code stream
+	 */
+	bool read(const uint8_t *buffer, size_t len, const TilePartIndexKey &key);
+
+	/**
+	 * Check that the SOT markers of the first and last tile parts
+	 * are where the index expects them
+	 *
+	 * @param stream	code stream
+	 *
+	 * @return true if index matches code stream
+	 */
+	bool verify(BufferedStream *stream) const;
+
+private:
+	struct TilePart {
+		TilePart(uint16_t tile, uint64_t pos, uint32_t len) :
+				tile_index(tile), sot_pos(pos), length(len) {
+		}
+		uint16_t tile_index;
+		// stream position of SOT marker
+		uint64_t sot_pos;
+		// length of tile part; zero if tile part extends to EOC
+		uint32_t length;
+	};
+	bool build_from_tlm(TileLengthMarkers *tlm, uint64_t first_sot_pos,
+			uint64_t stream_len);
+	bool scan(BufferedStream *stream, uint64_t first_sot_pos);
+	bool add(uint16_t tile_index, uint64_t sot_pos, uint32_t length);
+	void clear(void);
+
+	// tile parts, in code stream order
+	std::vector<TilePart> m_tile_parts;
+	// position of first SOT marker for each tile
+	std::vector<uint64_t> m_first_tile_part;
+	uint32_t m_num_tiles_found;
+};
+
+}
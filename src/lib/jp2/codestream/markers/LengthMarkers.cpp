@@ -276,6 +276,10 @@ PacketLengthMarkers::~PacketLengthMarkers() {
 	}
 }
 
+void PacketLengthMarkers::set_stream(BufferedStream *strm) {
+	m_stream = strm;
+}
+
 void PacketLengthMarkers::writeInit(void) {
 	readInitIndex(0);
 	m_total_bytes_written = 0;
@@ -368,6 +372,36 @@ uint32_t PacketLengthMarkers::write() {
 	return m_total_bytes_written;
 }
 
+uint32_t PacketLengthMarkers::length(void) {
+	uint32_t total_bytes = 0;
+	uint32_t marker_bytes = 0;
+	// mirrors write_marker_header
+	auto marker_header = [&total_bytes, &marker_bytes]() {
+		if (total_bytes == 0
+				|| (marker_bytes >= available_packet_len_bytes_per_plt - 5)) {
+			marker_bytes = 4;
+			total_bytes += 4;
+		}
+	};
+	marker_header();
+	for (auto map_iter = m_markers->begin(); map_iter != m_markers->end();
+			++map_iter) {
+		// index
+		marker_bytes++;
+		total_bytes++;
+		for (auto val_iter = map_iter->second->begin();
+				val_iter != map_iter->second->end(); ++val_iter) {
+			marker_header();
+			uint32_t numbits = floorlog2<uint32_t>(*val_iter) + 1;
+			uint32_t numbytes = (numbits + 6) / 7;
+			marker_bytes += numbytes;
+			total_bytes += numbytes;
+		}
+	}
+
+	return total_bytes;
+}
+
 bool PacketLengthMarkers::readPLM(uint8_t *p_header_data, uint16_t header_size){
 	if (header_size < 1) {
 		GRK_ERROR("PLM marker segment too short");
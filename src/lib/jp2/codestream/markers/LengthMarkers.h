@@ -65,7 +65,7 @@ private:
 	void push(uint8_t i_TLM, grk_tl_info curr_vec);
 	TL_MAP *m_markers;
 	uint8_t m_markerIndex;
-	uint8_t m_tilePartIndex;
+	uint32_t m_tilePartIndex;
 	TL_INFO_VEC *m_curr_vec;
 	BufferedStream *m_stream;
 	uint64_t m_tlm_start_stream_position;
@@ -103,6 +103,10 @@ struct PacketLengthMarkers {
 	void writeNext(uint32_t len);
 	// write marker to stream
 	uint32_t write();
+	// number of bytes that write() will produce
+	uint32_t length(void);
+	// set stream that markers are written to
+	void set_stream(BufferedStream *strm);
 
 private:
 	PL_MAP *m_markers;
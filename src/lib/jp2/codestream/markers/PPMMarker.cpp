@@ -26,7 +26,8 @@ namespace grk {
 
 PPMMarker::PPMMarker() : markers_count(0),
 		markers(nullptr),
-		buffer(nullptr)
+		buffer(nullptr),
+		m_account(GRK_MEM_MARKERS)
 {}
 
 PPMMarker::~PPMMarker(){
@@ -102,6 +103,7 @@ bool PPMMarker::read(uint8_t *p_header_data,
 	}
 	markers[i_ppm].m_data_size = header_size;
 	memcpy(markers[i_ppm].m_data, p_header_data, header_size);
+	m_account.add(header_size);
 
 	return true;
 }
@@ -223,6 +225,7 @@ bool PPMMarker::merge(){
 	markers_count = 0U;
 	grk_free(markers);
 	markers = nullptr;
+	m_account.set(total_data_size);
 
 	return true;
 }
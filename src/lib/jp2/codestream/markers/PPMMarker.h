@@ -62,6 +62,8 @@ private:
 
 	/** packet header storage original buffer */
 	uint8_t *buffer;
+
+	MemAccount m_account;
 };
 
 } /* namespace grk */
@@ -24,13 +24,14 @@
 namespace grk {
 
 SOTMarker::SOTMarker(CodeStream *stream) : m_codeStream(stream),
+																	m_stream(nullptr),
 																	m_psot_location(0)
 {
 }
 
 
 bool SOTMarker::write_psot(uint32_t tile_part_bytes_written) {
-	auto stream = m_codeStream->getStream();
+	auto stream = m_stream;
 	auto currentLocation = stream->tell();
 	stream->seek(m_psot_location);
 	if (!stream->write_int(tile_part_bytes_written))
@@ -40,9 +41,9 @@ bool SOTMarker::write_psot(uint32_t tile_part_bytes_written) {
 	return true;
 }
 
-bool SOTMarker::write(void){
-	auto stream = m_codeStream->getStream();
-	auto proc = m_codeStream->currentProcessor();
+bool SOTMarker::write(TileProcessor *proc){
+	auto stream = proc->m_stream;
+	m_stream = stream;
 
 	/* SOT */
 	if (!stream->write_short(J2K_MS_SOT))
@@ -137,6 +138,8 @@ bool SOTMarker::get_sot_values(uint8_t *p_header_data, uint32_t header_size,
 				tcp->m_tile_part_index + 1);
 		return false;
 	}
+	if (tcp->m_tile_part_index == -1)
+		m_codeStream->m_tiles_parts_read.push_back(tile_number);
 	++tcp->m_tile_part_index;
 	/* PSot should be equal to zero or >=14 or <= 2^32-1 */
 	if ((tot_len != 0) && (tot_len < 14)) {
@@ -33,8 +33,9 @@ public:
 	/**
 	 * Writes the SOT marker (Start of tile-part)
 	 *
+	 * @param	proc	tile processor: marker is written to its stream
 	 */
-	bool write(void);
+	bool write(TileProcessor *proc);
 
 	bool write_psot(uint32_t tile_part_bytes_written);
 
@@ -67,6 +68,7 @@ public:
 	 		uint8_t *p_num_parts);
 private:
 	 CodeStream *m_codeStream;
+	 BufferedStream *m_stream;
 	 uint64_t m_psot_location;
 
 };
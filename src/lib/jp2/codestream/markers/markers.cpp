@@ -781,7 +781,11 @@ uint16_t getPocSize(uint32_t nb_comp, uint32_t nb_poc) {
 
 bool j2k_write_poc(CodeStream *codeStream) {
 	assert(codeStream != nullptr);
-	auto stream = codeStream->getStream();
+	return j2k_write_poc(codeStream, codeStream->getStream());
+}
+
+bool j2k_write_poc(CodeStream *codeStream, BufferedStream *stream) {
+	assert(codeStream != nullptr);
 	auto tcp = &codeStream->m_cp.tcps[0];
 	auto tccp = &tcp->tccps[0];
 	auto image = codeStream->m_input_image;
@@ -1081,6 +1085,7 @@ bool j2k_read_ppt(CodeStream *codeStream, uint8_t *p_header_data,
 	}
 	tcp->ppt_markers[Z_ppt].m_data_size = header_size;
 	memcpy(tcp->ppt_markers[Z_ppt].m_data, p_header_data, header_size);
+	tcp->ppt_account.add(header_size);
 	return true;
 }
 
@@ -1127,6 +1132,7 @@ bool j2k_merge_ppt(TileCodingParams *p_tcp) {
 	grk_free(p_tcp->ppt_markers);
 	p_tcp->ppt_markers = nullptr;
 
+	p_tcp->ppt_account.set(p_tcp->ppt_len);
 	p_tcp->ppt_data = p_tcp->ppt_buffer;
 	p_tcp->ppt_data_size = p_tcp->ppt_len;
 
@@ -242,6 +242,14 @@ uint16_t getPocSize(uint32_t l_nb_comp, uint32_t l_nb_poc);
  */
 bool j2k_write_poc(CodeStream *codeStream);
 
+/**
+ * Writes the POC marker (Progression Order Change) to a given stream
+ *
+ * @param       codeStream          JPEG 2000 code stream
+ * @param       stream				destination stream
+ */
+bool j2k_write_poc(CodeStream *codeStream, BufferedStream *stream);
+
 
 /**
  * Reads a POC marker (Progression Order Change)
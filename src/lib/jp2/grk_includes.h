@@ -151,12 +151,17 @@ static inline long grk_lrintf(float f) {
 #include "mem_stream.h"
 #include "GrkMappedFile.h"
 #include "MemManager.h"
+#include "MemStats.h"
 #include "logger.h"
 #include "util.h"
 #include "grk_exceptions.h"
 #include "ChunkBuffer.h"
+#include "ArenaAllocator.h"
+#include "MemoryBudget.h"
 #include "BitIO.h"
 #include "BufferedStream.h"
+#include "FilePrefetcher.h"
+#include "SampleConvert.h"
 #include "Quantizer.h"
 #include <Profile.h>
 #include "LengthMarkers.h"
@@ -164,6 +169,9 @@ static inline long grk_lrintf(float f) {
 #include "PPMMarker.h"
 #include "SOTMarker.h"
 #include "CodeStream.h"
+#include "StripCache.h"
+#include "TilePartIndex.h"
+#include "TileCache.h"
 #include "markers.h"
 #include <Dump.h>
 #include "FileFormat.h"
@@ -171,6 +179,7 @@ static inline long grk_lrintf(float f) {
 #include "TileComponentBuffer.h"
 #include "PacketIter.h"
 #include "TagTree.h"
+#include "FlatTagTree.h"
 #include "sparse_array.h"
 #include "TileComponent.h"
 #include "TileProcessor.h"
@@ -186,3 +195,5 @@ static inline long grk_lrintf(float f) {
 #include "plugin_bridge.h"
 #include "RateControl.h"
 #include "RateInfo.h"
+#include "RateEstimator.h"
+#include "GlobalRateAllocator.h"
@@ -60,6 +60,28 @@ bool GRK_CALLCONV grk_initialize(const char *plugin_path, uint32_t numthreads) {
 GRK_API void GRK_CALLCONV grk_deinitialize() {
 	grk_plugin_cleanup();
 	ThreadPool::release();
+	grk_release_slab_pool();
+}
+
+void GRK_CALLCONV grk_set_memory_accounting(bool enable) {
+	MemStats::enable(enable);
+}
+
+bool GRK_CALLCONV grk_get_memory_stats(grk_memory_stats *stats) {
+	if (!stats || !MemStats::enabled())
+		return false;
+	MemStats::get(stats);
+
+	return true;
+}
+
+const char* GRK_CALLCONV grk_get_memory_tag_name(GRK_MEM_TAG tag) {
+	return MemStats::tag_name(tag);
+}
+
+void GRK_CALLCONV grk_set_huge_pages(bool enable, uint64_t slab_pool_size) {
+	grk_set_huge_page_policy(enable,
+			(size_t) std::min<uint64_t>(slab_pool_size, SIZE_MAX));
 }
 
 /* ---------------------------------------------------------------------- */
@@ -282,6 +304,52 @@ bool GRK_CALLCONV grk_set_decompress_area( grk_codec p_codec,
 	}
 	return false;
 }
+bool GRK_CALLCONV grk_set_strip_sink(grk_codec p_codec, grk_strip_sink sink,
+		void *user_data) {
+	if (p_codec) {
+		auto codec = (grk_codec_private*) p_codec;
+		assert(codec->is_decompressor);
+		codec->m_codeStreamBase->set_strip_sink(sink, user_data);
+		return true;
+	}
+	return false;
+}
+bool GRK_CALLCONV grk_set_output_buffer(grk_codec p_codec,
+		const grk_output_buffer *buffer) {
+	if (p_codec) {
+		auto codec = (grk_codec_private*) p_codec;
+		assert(codec->is_decompressor);
+		return codec->m_codeStreamBase->set_output_buffer(buffer);
+	}
+	return false;
+}
+bool GRK_CALLCONV grk_write_index(grk_codec p_codec, uint8_t *buffer,
+		size_t *len) {
+	if (p_codec) {
+		auto codec = (grk_codec_private*) p_codec;
+		assert(codec->is_decompressor);
+		return codec->m_codeStreamBase->write_index(buffer, len);
+	}
+	return false;
+}
+bool GRK_CALLCONV grk_read_index(grk_codec p_codec, const uint8_t *buffer,
+		size_t len) {
+	if (p_codec) {
+		auto codec = (grk_codec_private*) p_codec;
+		assert(codec->is_decompressor);
+		return codec->m_codeStreamBase->read_index(buffer, len);
+	}
+	return false;
+}
+bool GRK_CALLCONV grk_get_tile_cache_stats(grk_codec p_codec,
+		grk_tile_cache_stats *stats) {
+	if (p_codec && stats) {
+		auto codec = (grk_codec_private*) p_codec;
+		assert(codec->is_decompressor);
+		return codec->m_codeStreamBase->get_tile_cache_stats(stats);
+	}
+	return false;
+}
 bool GRK_CALLCONV grk_decompress_tile( grk_codec p_codec,
 		 grk_image *p_image, uint16_t tile_index) {
 	if (p_codec) {
@@ -292,6 +360,17 @@ bool GRK_CALLCONV grk_decompress_tile( grk_codec p_codec,
 	}
 	return false;
 }
+bool GRK_CALLCONV grk_decompress_regions(grk_codec p_codec,
+		const grk_region *regions, uint32_t num_regions, grk_image **images) {
+	if (p_codec) {
+		auto codec = (grk_codec_private*) p_codec;
+		assert(codec->is_decompressor);
+
+		return codec->m_codeStreamBase->decompress_regions(regions, num_regions,
+				images);
+	}
+	return false;
+}
 
 /* ---------------------------------------------------------------------- */
 /* COMPRESSION FUNCTIONS*/
@@ -373,6 +452,16 @@ bool GRK_CALLCONV grk_start_compress( grk_codec p_codec) {
 bool GRK_CALLCONV grk_compress( grk_codec p_codec) {
 	return grk_compress_with_plugin(p_codec, nullptr);
 }
+bool GRK_CALLCONV grk_set_input_buffer(grk_codec p_codec,
+		const grk_input_buffer *buffer) {
+	if (p_codec) {
+		auto codec = (grk_codec_private*) p_codec;
+		if (codec->is_decompressor)
+			return false;
+		return codec->m_codeStreamBase->set_input_buffer(buffer);
+	}
+	return false;
+}
 bool GRK_CALLCONV grk_compress_with_plugin( grk_codec p_info,
 		grk_plugin_tile *tile) {
 	if (p_info) {
@@ -552,6 +641,13 @@ GRK_API size_t GRK_CALLCONV grk_stream_get_write_mem_stream_length(
 		 return create_mapped_file_write_stream(fname);
 }
 /* ---------------------------------------------------------------------- */
+grk_stream* GRK_CALLCONV grk_stream_create_prefetch_file_stream(
+		const char *fname, size_t buffer_size, uint64_t prefetch_bytes) {
+	if (!buffer_size || !prefetch_bytes)
+		return nullptr;
+	return create_prefetch_file_read_stream(fname, buffer_size, prefetch_bytes);
+}
+/* ---------------------------------------------------------------------- */
 void GRK_CALLCONV grk_image_all_components_data_free(grk_image *image) {
 	uint32_t i;
 	if (!image || !image->comps)
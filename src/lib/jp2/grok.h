@@ -538,8 +538,21 @@ typedef struct _grk_cparameters {
 	double display_resolution[2];
 
 	// 0: bisect with all truncation points,  1: bisect with only feasible truncation points
+	// 2: bisect with only feasible truncation points, over all tiles of the image
 	uint32_t rateControlAlgorithm;
+	// bisect with exact packet simulation only, without the incremental
+	// rate estimator. The code stream is the same either way
+	bool exactRateControl;
 	uint32_t numThreads;
+	// maximum number of tiles being compressed, or waiting to be written,
+	// at any one time. 0: twice the number of threads
+	uint32_t tileWindow;
+	// maximum number of bytes of memory used by tiles in flight;
+	// new tiles are not started while the budget is exceeded. 0: unlimited.
+	// Not enforced with global rate control, where all tiles are kept
+	// until the last tile has been compressed. While set, large buffers
+	// are mapped directly, and returned to the system when freed
+	uint64_t maxMemory;
 	int32_t deviceId;
 	uint32_t duration; //seconds
 	uint32_t kernelBuildOptions;
@@ -705,6 +718,57 @@ typedef struct _grk_dparameters {
 	/** Number of tiles to decompress */
 	uint32_t nb_tile_to_decode;
 	uint32_t flags;
+	/**
+	 Maximum size in bytes of decompressed tiles cached by grk_decompress_tile,
+	 and by grk_decompress, so that tiles which are requested again, at the same
+	 reduce and layers, are copied from the cache instead of being decompressed.
+	 With either cache enabled, grk_decompress decompresses the tiles of the
+	 decompress area one by one, and may be called again on the same codec
+	 after setting another area with grk_set_decompress_area, for example
+	 by a viewer. This does not apply with a strip sink, an output buffer
+	 or a plugin.
+	 if == 0, tiles are not cached
+	 */
+	uint64_t tile_cache_size;
+	/**
+	 Maximum size in bytes of compressed tile data retained by grk_decompress_tile
+	 and grk_decompress, together with the parsed tile headers, so that tiles
+	 which are requested again, for example at a different reduce, are
+	 decompressed without re-reading them.
+	 if == 0, compressed tile data is not retained
+	 */
+	uint64_t tile_coding_cache_size;
+	/**
+	 Keep the code block decoder state of tiles decompressed by grk_decompress_tile,
+	 so that decompressing a tile again with more quality layers only decodes the
+	 coding passes of the additional layers, before the inverse wavelet transform
+	 and colour transform are redone. Decoding resumes at the end of the last
+	 terminated segment of each code block, so code streams compressed with
+	 termination on each coding pass benefit most.
+	 The reconstructed lower resolution of each tile is also kept, so that
+	 decompressing a tile again with a smaller cp_reduce and the same layers
+	 only decodes the code blocks of the new resolutions and applies the
+	 remaining synthesis levels of the inverse wavelet transform.
+	 */
+	bool refine_tiles;
+	/**
+	 Maximum size in bytes of the decoder state kept by refine_tiles, including
+	 the reconstructed lower resolutions. The state of least recently
+	 decompressed tiles is released first, and decompressing such a tile
+	 again starts over. The state of the tile decompressed last is always kept.
+	 if == 0, only the state of the tile decompressed last is kept
+	 */
+	uint64_t tile_refine_cache_size;
+	/**
+	 Maximum number of bytes of memory used by tiles being decompressed by
+	 grk_decompress: the next tile is not read until enough memory has been
+	 released by tiles in flight. A single tile is always decompressed,
+	 whatever its size. Strips held for a strip sink are included,
+	 but not the output image. While set, large buffers are mapped directly,
+	 and returned to the system when freed.
+	 if == 0, memory is not limited
+	 */
+	uint64_t max_memory;
 } grk_dparameters;
 
 /**
@@ -1260,6 +1324,73 @@ GRK_API bool GRK_CALLCONV grk_initialize(const char *plugin_path,
  */
 GRK_API void GRK_CALLCONV grk_deinitialize();
 
+/**
+ * Memory accounting tags: the subsystems that library memory is accounted to
+ */
+typedef enum _GRK_MEM_TAG {
+	GRK_MEM_TILE_BUFFERS, 		/**< tile component and resolution buffers */
+	GRK_MEM_TILE_METADATA,		/**< resolutions, precincts, code blocks and segments */
+	GRK_MEM_CODE_BLOCK_DATA,	/**< compressed data of code blocks being compressed */
+	GRK_MEM_PACKET_DATA,		/**< compressed tile data read, or written, in packets */
+	GRK_MEM_T1_SCRATCH,			/**< per-thread code block coder buffers */
+	GRK_MEM_DWT_SCRATCH,		/**< wavelet transform scratch buffers */
+	GRK_MEM_SPARSE_ARRAYS,		/**< sparse arrays of windowed decompression */
+	GRK_MEM_MARKERS,			/**< marker segments and packed packet headers */
+	GRK_MEM_NUM_TAGS
+} GRK_MEM_TAG;
+
+/**
+ * Memory accounting statistics, in bytes, indexed by GRK_MEM_TAG
+ */
+typedef struct _grk_memory_stats {
+	/** memory currently allocated */
+	uint64_t current[GRK_MEM_NUM_TAGS];
+	/** largest amount of memory allocated at any one time */
+	uint64_t peak[GRK_MEM_NUM_TAGS];
+} grk_memory_stats;
+
+/**
+ * Enable or disable accounting of library memory, per subsystem, for
+ * all codecs of the process. Accounting is disabled by default, and then
+ * costs a single test per allocation. Memory allocated while accounting
+ * is disabled is never accounted for, so accounting should be enabled
+ * before codecs are created. Enabling accounting resets peaks to current values.
+ *
+ * @param enable	true to enable accounting
+ */
+GRK_API void GRK_CALLCONV grk_set_memory_accounting(bool enable);
+
+/**
+ * Get memory accounting statistics
+ *
+ * @param stats		statistics
+ * @return true if accounting is enabled
+ */
+GRK_API bool GRK_CALLCONV grk_get_memory_stats(grk_memory_stats *stats);
+
+/**
+ * Get name of memory accounting tag
+ *
+ * @param tag		tag
+ * @return name of tag, or nullptr if tag is invalid
+ */
+GRK_API const char* GRK_CALLCONV grk_get_memory_tag_name(GRK_MEM_TAG tag);
+
+/**
+ * Set huge page policy for large buffers, such as tile component buffers.
+ * When enabled (disabled by default), buffers of 2 MB and more are aligned
+ * to 2 MB and backed by transparent huge pages where the system supports
+ * them. Freed huge page buffers may also be kept in a pool, and reused,
+ * already faulted in, by later tiles. Pooled buffers are not part
+ * of the memory budget of any codec.
+ *
+ * @param enable		true to back large buffers with huge pages
+ * @param slab_pool_size	maximum number of bytes of freed buffers kept
+ * 							for reuse, or 0 to disable the pool (default)
+ */
+GRK_API void GRK_CALLCONV grk_set_huge_pages(bool enable,
+		uint64_t slab_pool_size);
+
 /*
  ============================
  image function definitions
@@ -1413,6 +1544,23 @@ GRK_API size_t GRK_CALLCONV grk_stream_get_write_mem_stream_length(
 GRK_API grk_stream* GRK_CALLCONV grk_stream_create_mapped_file_stream(
 		const char *fname, bool read_stream);
 
+/**
+ * Create file read stream that reads tile parts ahead of need
+ *
+ * While a tile is decompressed, the tile parts that follow it in the
+ * code stream are read on a background I/O thread, and their data is
+ * decompressed without further copying. Tile parts are located with
+ * TLM markers if present, and otherwise with SOT markers.
+ * A small buffer_size, for example 64 KB, is sufficient, since the stream
+ * buffer is only used for markers.
+ *
+ * @param fname				file name
+ * @param buffer_size		size of stream buffer
+ * @param prefetch_bytes	maximum number of bytes read ahead
+ */
+GRK_API grk_stream* GRK_CALLCONV grk_stream_create_prefetch_file_stream(
+		const char *fname, size_t buffer_size, uint64_t prefetch_bytes);
+
 /*
  ========================================
  logger function definitions
@@ -1504,6 +1652,163 @@ GRK_API bool GRK_CALLCONV grk_set_decompress_area(grk_codec codec,
 		grk_image *image, uint32_t start_x, uint32_t start_y, uint32_t end_x,
 		uint32_t end_y);
 
+/**
+ * Strip sink: receives a band of decompressed rows of the output image.
+ *
+ * Components of the strip have the same layout as components of the output image,
+ * restricted to h rows starting at row y0 (y0 uses the same convention as
+ * the output image component). Strip data is owned by the library, and is only
+ * valid for the duration of the call. Strips are delivered from top to bottom;
+ * the sink may be called from a library thread, but never concurrently.
+ *
+ * @param	strip			strip image
+ * @param	user_data		user data passed to grk_set_strip_sink
+ *
+ * @return	false to abort decompression
+ */
+typedef bool (*grk_strip_sink)(grk_image *strip, void *user_data);
+
+/**
+ * Deliver decompressed rows to a sink, in strips, rather than storing them
+ * in the output image. One strip is delivered for each row of tiles,
+ * as soon as all of its tiles are decompressed, and is then freed,
+ * so the full output image is never allocated. After decompression,
+ * output image components have no data.
+ *
+ * Only applies to full decompression of images with more than one tile;
+ * otherwise, or if the JP2 file has a palette or channel definitions,
+ * the sink is not called and the output image is decompressed as usual.
+ * This function should be called after grk_read_header and before grk_decompress.
+ *
+ * @param	codec			decompression codec
+ * @param	sink			strip sink, or nullptr to disable
+ * @param	user_data		user data passed to sink
+ *
+ * @return	true if successful
+ */
+GRK_API bool GRK_CALLCONV grk_set_strip_sink(grk_codec codec,
+		grk_strip_sink sink, void *user_data);
+
+/**
+ * Sample type of output buffer
+ */
+typedef enum _GRK_SAMPLE_TYPE {
+	GRK_SAMPLE_UINT8,
+	GRK_SAMPLE_UINT16,
+	GRK_SAMPLE_INT16,
+	GRK_SAMPLE_FLOAT
+} GRK_SAMPLE_TYPE;
+
+/**
+ * Caller-owned output buffer
+ *
+ * With interleaved layout, sample of component c at (x,y) is stored at
+ * data + y * stride + (x * numcomps + c) * sample size.
+ * With planar layout, it is stored at
+ * data + c * plane_stride + y * stride + x * sample size.
+ * (x,y) are relative to the origin of the output image components.
+ */
+typedef struct _grk_output_buffer {
+	GRK_SAMPLE_TYPE type;
+	bool interleaved;
+	/** start of buffer */
+	uint8_t *data;
+	/** number of bytes between rows */
+	size_t stride;
+	/** number of bytes between component planes; ignored if interleaved */
+	size_t plane_stride;
+} grk_output_buffer;
+
+/**
+ * Decompress directly into a caller-owned buffer, in the given sample type and
+ * layout, rather than into the 32 bit planar components of the output image.
+ * Decompressed samples are clamped to the range of the sample type, without
+ * rescaling their precision. Regions of missing tiles are not written.
+ * After decompression, output image components have no data.
+ *
+ * Applies to grk_decompress, and takes precedence over a strip sink.
+ * All components must have the dimensions of the first component, and the
+ * buffer must hold output image components with the dimensions they have
+ * after grk_set_decompress_area. JP2 files with a palette or channel
+ * definitions are not supported.
+ * This function should be called after grk_read_header and before grk_decompress.
+ *
+ * @param	codec			decompression codec
+ * @param	buffer			output buffer, or nullptr to decompress into the output image
+ *
+ * @return	true if successful
+ */
+GRK_API bool GRK_CALLCONV grk_set_output_buffer(grk_codec codec,
+		const grk_output_buffer *buffer);
+
+/**
+ * Serialize the tile part index of a code stream, so that it can be stored,
+ * for example in a sidecar file, and loaded with grk_read_index when the
+ * code stream is reopened. The index is built if necessary, from the TLM
+ * markers, or else by scanning the SOT markers.
+ * This function should be called after grk_read_header.
+ * @param	codec			decompression codec
+ * @param	buffer			destination buffer, or nullptr to query the length
+ * 							of the serialized index
+ * @param	len				in: length of buffer; out: length of serialized index
+ * @return	true if successful
+ */
+GRK_API bool GRK_CALLCONV grk_write_index(grk_codec codec, uint8_t *buffer,
+		size_t *len);
+
+/**
+ * Load a tile part index serialized by grk_write_index, so that tiles
+ * decompressed with grk_decompress_tile are located without scanning the
+ * code stream. The index is rejected if the length of the stream, or the
+ * contents of its main header, have changed since the index was written.
+ * This function should be called after grk_read_header.
+ * @param	codec			decompression codec
+ * @param	buffer			serialized index
+ * @param	len				length of serialized index
+ * @return	true if the index was loaded
+ */
+GRK_API bool GRK_CALLCONV grk_read_index(grk_codec codec,
+		const uint8_t *buffer, size_t len);
+
+/**
+ * Tile cache statistics
+ */
+typedef struct _grk_tile_cache_stats {
+	/** number of tiles copied from the cache of decompressed tiles */
+	uint64_t tile_hits;
+	/** number of tiles that had to be decompressed */
+	uint64_t tile_misses;
+	/** number of decompressed tiles evicted from the cache */
+	uint64_t tile_evictions;
+	/** current size in bytes of cached decompressed tiles */
+	uint64_t tile_bytes;
+	/** number of tiles decompressed from retained compressed data */
+	uint64_t coding_state_hits;
+	/** number of tiles that had to be read from the stream */
+	uint64_t coding_state_misses;
+	/** number of tiles whose compressed data was released */
+	uint64_t coding_state_evictions;
+	/** current size in bytes of retained compressed data */
+	uint64_t coding_state_bytes;
+	/** number of tiles whose refine_tiles decoder state was released */
+	uint64_t refine_state_evictions;
+	/** current size in bytes of refine_tiles decoder state */
+	uint64_t refine_state_bytes;
+} grk_tile_cache_stats;
+
+/**
+ * Get statistics of the tile caches used by grk_decompress_tile and
+ * grk_decompress, which are enabled by the tile_cache_size, tile_coding_cache_size
+ * and refine_tiles decompress parameters
+ *
+ * @param	codec			decompression codec
+ * @param	stats			statistics
+ *
+ * @return	true if the tile cache is enabled
+ */
+GRK_API bool GRK_CALLCONV grk_get_tile_cache_stats(grk_codec codec,
+		grk_tile_cache_stats *stats);
+
 /**
  * Decompress image from a JPEG 2000 code stream
  *
@@ -1518,6 +1823,11 @@ GRK_API bool GRK_CALLCONV grk_decompress(grk_codec p_decompressor,
 /**
  * Decompress a specific tile
  *
+ * This function may be called concurrently from multiple threads
+ * on the same codec: the main header is parsed only once, and tiles
+ * are decompressed in parallel. Each thread must pass its own output image,
+ * with the same components as the image created by grk_read_header.
+ *
  * @param	codec			JPEG 2000 code stream
  * @param	image			output image
  * @param	tile_index		index of the tile to be decompressed
@@ -1527,6 +1837,43 @@ GRK_API bool GRK_CALLCONV grk_decompress(grk_codec p_decompressor,
 GRK_API bool GRK_CALLCONV grk_decompress_tile(grk_codec codec,
 		grk_image *image, uint16_t tile_index);
 
+/**
+ * Region of image to decompress, in image coordinates
+ */
+typedef struct _grk_region {
+	uint32_t x0;
+	uint32_t y0;
+	uint32_t x1;
+	uint32_t y1;
+} grk_region;
+
+/**
+ * Decompress several regions of the image, at the same resolution, in one pass.
+ *
+ * Each tile is read and each code block is decompressed only once, for all
+ * the regions that need it, and the inverse wavelet transform is then
+ * run for each region, into its own output image. Regions may overlap.
+ * This is cheaper than decompressing each region with grk_set_decompress_area
+ * when regions share tiles, for example neighbouring map tiles.
+ *
+ * Regions must lie within the image. The reduction and number of layers
+ * set by grk_init_decompress apply to all regions.
+ * JP2 files with a palette or channel definitions are not supported.
+ * This function should be called after grk_read_header, instead of
+ * grk_set_decompress_area and grk_decompress.
+ *
+ * @param	codec			JPEG 2000 code stream
+ * @param	regions			regions to decompress
+ * @param	num_regions		number of regions
+ * @param	images			array of num_regions images, set to the decompressed
+ * 							image of each region, to be destroyed by the caller with
+ * 							grk_image_destroy. Set to nullptr on failure
+ *
+ * @return					true if success, otherwise false
+ */
+GRK_API bool GRK_CALLCONV grk_decompress_regions(grk_codec codec,
+		const grk_region *regions, uint32_t num_regions, grk_image **images);
+
 /**
  * End decompression
  *
@@ -1597,6 +1944,71 @@ GRK_API bool GRK_CALLCONV grk_start_compress(grk_codec codec);
  */
 GRK_API bool GRK_CALLCONV grk_compress(grk_codec codec);
 
+/**
+ * Input rows callback: returns rows of the input image on demand.
+ *
+ * The callback is called once for each tile, from the thread that
+ * compresses the tile. Tiles are compressed concurrently, so the callback
+ * must be thread safe.
+ *
+ * @param	y0				first row, relative to the origin of the image components
+ * @param	num_rows		number of rows
+ * @param	user_data		user data of input buffer
+ *
+ * @return	pointer to row y0, laid out as described by the input buffer,
+ * 			or nullptr to abort compression. Rows must remain valid until
+ * 			they have been copied into the tile, which is done before the
+ * 			calling thread calls the callback again, so a buffer per thread
+ * 			may be reused for each tile.
+ */
+typedef const uint8_t* (*grk_input_rows_fn)(uint32_t y0, uint32_t num_rows,
+		void *user_data);
+
+/**
+ * Caller-owned input buffer
+ *
+ * Layout is as for grk_output_buffer: with interleaved layout, sample of
+ * component c at (x,y) is stored at data + y * stride + (x * numcomps + c) * sample size,
+ * and with planar layout at data + c * plane_stride + y * stride + x * sample size.
+ * Sample types GRK_SAMPLE_UINT8, GRK_SAMPLE_UINT16 and GRK_SAMPLE_INT16 are supported.
+ */
+typedef struct _grk_input_buffer {
+	GRK_SAMPLE_TYPE type;
+	bool interleaved;
+	/** start of buffer, or nullptr if rows are pulled from callback */
+	const uint8_t *data;
+	/** number of bytes between rows */
+	size_t stride;
+	/** number of bytes between component planes; ignored if interleaved */
+	size_t plane_stride;
+	/** rows callback, used if data is nullptr */
+	grk_input_rows_fn pull;
+	/** user data passed to rows callback */
+	void *user_data;
+} grk_input_buffer;
+
+/**
+ * Compress from a caller-owned buffer, or rows callback, rather than from
+ * the 32 bit planar components of the image passed to grk_init_compress,
+ * which then need not have component data. Each tile reads its rows from
+ * the buffer, and deinterleaves them, applies the DC level shift and,
+ * if enabled, the forward reversible or irreversible colour transform
+ * in a single pass into the tile buffers.
+ * Tiles may be compressed concurrently, in which case the rows callback
+ * is called concurrently, and must be thread safe.
+ *
+ * Applies to grk_compress. All components must have the dimensions and
+ * sub-sampling of the first component.
+ * This function should be called after grk_init_compress and before grk_compress.
+ *
+ * @param	codec			compression codec
+ * @param	buffer			input buffer, or nullptr to compress the image components
+ *
+ * @return	true if successful
+ */
+GRK_API bool GRK_CALLCONV grk_set_input_buffer(grk_codec codec,
+		const grk_input_buffer *buffer);
+
 /**
  * Compress uncompressed data stored in a buffer.
  * This method should be called right after grk_start_compress,
@@ -1849,6 +2261,8 @@ typedef struct _grk_plugin_decode_callback_info {
 	uint32_t decode_flags;
 	uint32_t full_image_x0;
 	uint32_t full_image_y0;
+	// application data, kept from pre-decode to post-decode of an image
+	void *user_data;
 } grk_plugin_decode_callback_info;
 
 typedef int32_t (*grk_plugin_decode_callback)(
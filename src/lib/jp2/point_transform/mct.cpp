@@ -501,6 +501,84 @@ void mct::encode_irrev( int* GRK_RESTRICT chan0,
 
 
 
+void mct::encode_rev_row(int32_t *GRK_RESTRICT chan0,
+		int32_t *GRK_RESTRICT chan1, int32_t *GRK_RESTRICT chan2, uint32_t n) {
+	uint32_t i = 0;
+#if (defined(__SSE2__) || defined(__AVX2__))
+	for (; i + VREG_INT_COUNT <= n; i += VREG_INT_COUNT) {
+		VREG r = LOADU(chan0 + i);
+		VREG g = LOADU(chan1 + i);
+		VREG b = LOADU(chan2 + i);
+		VREG y = SAR(ADD3(ADD(g, g), b, r), 2);
+		STOREU(chan0 + i, y);
+		STOREU(chan1 + i, SUB(b, g));
+		STOREU(chan2 + i, SUB(r, g));
+	}
+#endif
+	for (; i < n; ++i) {
+		int32_t r = chan0[i];
+		int32_t g = chan1[i];
+		int32_t b = chan2[i];
+		chan0[i] = (r + (g * 2) + b) >> 2;
+		chan1[i] = b - g;
+		chan2[i] = r - g;
+	}
+}
+
+void mct::encode_irrev_row(int32_t *GRK_RESTRICT chan0,
+		int32_t *GRK_RESTRICT chan1, int32_t *GRK_RESTRICT chan2, uint32_t n) {
+	const float a_r = 0.299f;
+	const float a_g = 0.587f;
+	const float a_b = 0.114f;
+	const float cb = 0.5f / (1.0f - a_b);
+	const float cr = 0.5f / (1.0f - a_r);
+	uint32_t i = 0;
+#if (defined(__SSE2__) || defined(__AVX2__))
+	const VREGF va_r = LOAD_CST_F(a_r);
+	const VREGF va_g = LOAD_CST_F(a_g);
+	const VREGF va_b = LOAD_CST_F(a_b);
+	const VREGF vcb = LOAD_CST_F(cb);
+	const VREGF vcr = LOAD_CST_F(cr);
+	const VREGF vscale = LOAD_CST_F((float) (1 << 11));
+	for (; i + VREG_INT_COUNT <= n; i += VREG_INT_COUNT) {
+#if defined(__AVX2__)
+		VREGF r = _mm256_cvtepi32_ps(LOADU(chan0 + i));
+		VREGF g = _mm256_cvtepi32_ps(LOADU(chan1 + i));
+		VREGF b = _mm256_cvtepi32_ps(LOADU(chan2 + i));
+#else
+		VREGF r = _mm_cvtepi32_ps(LOADU(chan0 + i));
+		VREGF g = _mm_cvtepi32_ps(LOADU(chan1 + i));
+		VREGF b = _mm_cvtepi32_ps(LOADU(chan2 + i));
+#endif
+		VREGF y = ADDF(ADDF(MULF(r, va_r), MULF(g, va_g)), MULF(b, va_b));
+		VREGF u = MULF(vcb, SUBF(b, y));
+		VREGF v = MULF(vcr, SUBF(r, y));
+#if defined(__AVX2__)
+		STOREU(chan0 + i, _mm256_cvttps_epi32(MULF(y, vscale)));
+		STOREU(chan1 + i, _mm256_cvttps_epi32(MULF(u, vscale)));
+		STOREU(chan2 + i, _mm256_cvttps_epi32(MULF(v, vscale)));
+#else
+		STOREU(chan0 + i, _mm_cvttps_epi32(MULF(y, vscale)));
+		STOREU(chan1 + i, _mm_cvttps_epi32(MULF(u, vscale)));
+		STOREU(chan2 + i, _mm_cvttps_epi32(MULF(v, vscale)));
+#endif
+	}
+#endif
+	for (; i < n; ++i) {
+		float r = (float) chan0[i];
+		float g = (float) chan1[i];
+		float b = (float) chan2[i];
+
+		float y = a_r * r + a_g * g + a_b * b;
+		float u = cb * (b - y);
+		float v = cr * (r - y);
+
+		chan0[i] = (int32_t) (y * (1 << 11));
+		chan1[i] = (int32_t) (u * (1 << 11));
+		chan2[i] = (int32_t) (v * (1 << 11));
+	}
+}
+
 void mct::calculate_norms(double *pNorms, uint32_t pNbComps, float *pMatrix) {
 	float CurrentValue;
 	double *Norms = (double*) pNorms;
@@ -35,6 +35,16 @@ public:
 	 @param n Number of samples for each component
 	 */
 	static void encode_rev(int32_t *c0, int32_t *c1, int32_t *c2, uint64_t n);
+	/**
+	 Apply a reversible multi-component transform to a row of samples,
+	 on the calling thread
+	 @param c0 Samples for red component
+	 @param c1 Samples for green component
+	 @param c2 Samples blue component
+	 @param n Number of samples for each component
+	 */
+	static void encode_rev_row(int32_t *c0, int32_t *c1, int32_t *c2,
+			uint32_t n);
 	/**
 	 Apply a reversible multi-component inverse transform to an image
 	 @param tile tile
@@ -58,6 +68,16 @@ public:
 	 @param n Number of samples for each component
 	 */
 	static void encode_irrev(int *c0, int *c1, int *c2, uint64_t n);
+	/**
+	 Apply an irreversible multi-component transform to a row of samples,
+	 on the calling thread
+	 @param c0 Samples for red component
+	 @param c1 Samples for green component
+	 @param c2 Samples blue component
+	 @param n Number of samples for each component
+	 */
+	static void encode_irrev_row(int32_t *c0, int32_t *c1, int32_t *c2,
+			uint32_t n);
 	/**
 	 Apply an irreversible multi-component inverse transform to an image
 	 @param tile tile
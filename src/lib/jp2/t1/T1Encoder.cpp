@@ -26,7 +26,8 @@ T1Encoder::T1Encoder(TileCodingParams *tcp, grk_tile *tile, uint32_t encodeMaxCb
 		tile(tile),
 		needsRateControl(needsRateControl),
 		encodeBlocks(nullptr),
-		blockCount(-1)
+		blockCount(-1),
+		success(true)
 {
 	for (auto i = 0U; i < ThreadPool::get()->num_threads(); ++i)
 		threadStructs.push_back(
@@ -36,9 +37,9 @@ T1Encoder::~T1Encoder() {
 	for (auto &t : threadStructs)
 		delete t;
 }
-void T1Encoder::compress(std::vector<encodeBlockInfo*> *blocks) {
+bool T1Encoder::compress(std::vector<encodeBlockInfo*> *blocks) {
 	if (!blocks || blocks->size() == 0)
-		return;
+		return true;
 
 	size_t num_threads = ThreadPool::get()->num_threads();
 	if (num_threads == 1){
@@ -47,7 +48,7 @@ void T1Encoder::compress(std::vector<encodeBlockInfo*> *blocks) {
 			compress(impl, *iter);
 			delete *iter;
 		}
-		return;
+		return success;
 	}
 
 
@@ -72,6 +73,8 @@ void T1Encoder::compress(std::vector<encodeBlockInfo*> *blocks) {
         result.get();
     }
 	delete[] encodeBlocks;
+
+	return success;
 }
 bool T1Encoder::compress(size_t threadId, uint64_t maxBlocks) {
 	auto impl = threadStructs[threadId];
@@ -87,7 +90,9 @@ bool T1Encoder::compress(size_t threadId, uint64_t maxBlocks) {
 void T1Encoder::compress(T1Interface *impl, encodeBlockInfo *block){
 	uint32_t max = 0;
 	impl->preEncode(block, tile, max);
-	auto dist = impl->compress(block, tile, max, needsRateControl);
+	double dist = 0;
+	if (!impl->compress(block, tile, max, needsRateControl, &dist))
+		success = false;
 	if (needsRateControl) {
 		std::unique_lock<std::mutex> lk(distortion_mutex);
 		tile->distotile += dist;
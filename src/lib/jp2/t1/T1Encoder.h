@@ -26,7 +26,7 @@ public:
 	T1Encoder(TileCodingParams *tcp, grk_tile *tile, uint32_t encodeMaxCblkW,
 			uint32_t encodeMaxCblkH, bool needsRateControl);
 	~T1Encoder();
-	void compress(std::vector<encodeBlockInfo*> *blocks);
+	bool compress(std::vector<encodeBlockInfo*> *blocks);
 
 private:
 	bool compress(size_t threadId, uint64_t maxBlocks);
@@ -39,6 +39,7 @@ private:
 	mutable std::mutex block_mutex;
 	encodeBlockInfo** encodeBlocks;
 	std::atomic<int64_t> blockCount;
+	std::atomic<bool> success;
 
 };
 
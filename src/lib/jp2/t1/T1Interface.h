@@ -22,10 +22,24 @@
 
 namespace grk {
 
+/**
+ * Decoder state of a code block, saved so that decoding can resume
+ * once more coding passes are available, rather than start over
+ */
+struct T1Checkpoint {
+	virtual ~T1Checkpoint() {
+	}
+	/**
+	 * Get number of bytes held by checkpoint
+	 */
+	virtual uint64_t size(void) const = 0;
+};
+
 struct decodeBlockInfo {
 	decodeBlockInfo() :
 			tilec(nullptr),
 			tiledp(nullptr),
+			tiledp16(nullptr),
 			stride(0),
 			cblk(nullptr),
 			resno(0),
@@ -36,10 +50,14 @@ struct decodeBlockInfo {
 			qmfbid(0),
 			x(0),
 			y(0),
-			k_msbs(0)
+			k_msbs(0),
+			checkpoint(nullptr)
 	{	}
 	TileComponent *tilec;
 	int32_t *tiledp;
+	// destination of reversible coefficients when the inverse wavelet
+	// transform runs on 16 bit coefficients, otherwise nullptr
+	int16_t *tiledp16;
 	uint32_t stride;
 	grk_cblk_dec *cblk;
 	uint32_t resno;
@@ -53,6 +71,8 @@ struct decodeBlockInfo {
 	uint32_t y;
 	// missing bit planes for all blocks in band
 	uint8_t k_msbs;
+	// saved decoder state of block, or nullptr if state is not kept
+	std::unique_ptr<T1Checkpoint> *checkpoint;
 };
 
 struct encodeBlockInfo {
@@ -107,8 +127,8 @@ public:
 
 	virtual void preEncode(encodeBlockInfo *block, grk_tile *tile,
 			uint32_t &max) = 0;
-	virtual double compress(encodeBlockInfo *block, grk_tile *tile,
-			uint32_t max, bool doRateControl)=0;
+	virtual bool compress(encodeBlockInfo *block, grk_tile *tile,
+			uint32_t max, bool doRateControl, double *disto)=0;
 
 	virtual bool decompress(decodeBlockInfo *block)=0;
 	virtual bool postDecode(decodeBlockInfo *block)=0;
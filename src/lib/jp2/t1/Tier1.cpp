@@ -21,7 +21,7 @@
 
 namespace grk {
 
-void Tier1::encodeCodeblocks(TileCodingParams *tcp,
+bool Tier1::encodeCodeblocks(TileCodingParams *tcp,
 							grk_tile *tile,
 							const double *mct_norms,
 							uint32_t mct_numcomps,
@@ -75,16 +75,43 @@ void Tier1::encodeCodeblocks(TileCodingParams *tcp,
 		}
 	}
 	T1Encoder encoder(tcp, tile, maxCblkW, maxCblkH, doRateControl);
-	encoder.compress(&blocks);
+
+	return encoder.compress(&blocks);
+}
+
+std::unique_ptr<T1Checkpoint>* T1CheckpointStore::get(uint32_t compno,
+		uint32_t resno, uint32_t bandno, uint64_t precno, uint64_t cblkno) {
+	return &m_checkpoints[BlockKey(compno, resno, bandno, precno, cblkno)];
 }
 
-bool Tier1::prepareDecodeCodeblocks(TileComponent *tilec, TileComponentCodingParams *tccp,
+ResolutionReconstruction* T1CheckpointStore::get_reconstruction(
+		uint32_t compno) {
+	return &m_reconstructions[compno];
+}
+
+uint64_t T1CheckpointStore::size(void) const {
+	uint64_t bytes = 0;
+	for (auto &entry : m_checkpoints) {
+		bytes += sizeof(entry);
+		if (entry.second)
+			bytes += entry.second->size();
+	}
+	for (auto &entry : m_reconstructions)
+		bytes += sizeof(entry)
+				+ entry.second.data.capacity() * sizeof(int32_t);
+
+	return bytes;
+}
+
+bool Tier1::prepareDecodeCodeblocks(uint32_t compno, TileComponent *tilec,
+		TileComponentCodingParams *tccp, uint32_t first_resno,
+		T1CheckpointStore *checkpoints,
 		std::vector<decodeBlockInfo*> *blocks) {
-	if (!tilec->buf->alloc()) {
+	if (!tilec->buf->alloc() || (tilec->buf16 && !tilec->buf16->alloc())) {
 		GRK_ERROR( "Not enough memory for tile data");
 		return false;
 	}
-	for (uint32_t resno = 0; resno < tilec->resolutions_to_decompress; ++resno) {
+	for (uint32_t resno = first_resno; resno < tilec->resolutions_to_decompress; ++resno) {
 		auto res = &tilec->resolutions[resno];
 		for (uint32_t bandno = 0; bandno < res->numbands; ++bandno) {
 			grk_band *GRK_RESTRICT band = res->bands + bandno;
@@ -113,9 +140,15 @@ bool Tier1::prepareDecodeCodeblocks(TileComponent *tilec, TileComponentCodingPar
 						auto block = new decodeBlockInfo();
 						block->x = cblk->x0;
 						block->y = cblk->y0;
-						block->tiledp = tilec->buf->cblk_ptr( resno, bandno,
-								block->x, block->y);
-						block->stride = tilec->buf->stride(resno,bandno);
+						if (tilec->buf16) {
+							block->tiledp16 = tilec->buf16->cblk_ptr( resno, bandno,
+									block->x, block->y);
+							block->stride = tilec->buf16->stride(resno,bandno);
+						} else {
+							block->tiledp = tilec->buf->cblk_ptr( resno, bandno,
+									block->x, block->y);
+							block->stride = tilec->buf->stride(resno,bandno);
+						}
 						block->bandno = band->bandno;
 						block->cblk = cblk;
 						block->cblk_sty = tccp->cblk_sty;
@@ -125,6 +158,9 @@ bool Tier1::prepareDecodeCodeblocks(TileComponent *tilec, TileComponentCodingPar
 						block->stepsize = band->stepsize;
 						block->tilec = tilec;
 						block->k_msbs = (uint8_t)(band->numbps - cblk->numbps);
+						if (checkpoints)
+							block->checkpoint = checkpoints->get(compno, resno,
+									bandno, precno, cblkno);
 						blocks->push_back(block);
 					}
 
@@ -19,19 +19,77 @@
 
 #include "grk_includes.h"
 #include <vector>
+#include <map>
+#include <tuple>
 #include "T1Interface.h"
 
 namespace grk {
 
+/**
+ * Reconstructed samples of one tile component at the highest resolution
+ * decompressed so far, taken after the inverse wavelet transform and before
+ * the inverse MCT and DC level shift. Samples of the irreversible transform
+ * are stored as floats.
+ */
+struct ResolutionReconstruction {
+	ResolutionReconstruction() : numres(0), layers(0), width(0), height(0) {
+	}
+	// number of resolutions reconstructed, or 0 if nothing is stored
+	uint32_t numres;
+	uint32_t layers;
+	uint32_t width;
+	uint32_t height;
+	std::vector<int32_t> data;
+};
+
+/**
+ * Decoder state of one tile, kept from one decompression of the tile to
+ * the next:
+ *
+ * 1. state of each code block, so that decoding of each block
+ * resumes after the coding passes that were already decoded
+ *
+ * 2. reconstructed lower resolution of each component, so that a tile
+ * decompressed again at a higher resolution, with the same layers,
+ * only decodes the code blocks of the new resolutions and applies the
+ * remaining synthesis levels
+ */
+class T1CheckpointStore {
+public:
+	/**
+	 * Get checkpoint slot of code block, which is empty
+	 * if block has not been decoded before
+	 */
+	std::unique_ptr<T1Checkpoint>* get(uint32_t compno, uint32_t resno,
+			uint32_t bandno, uint64_t precno, uint64_t cblkno);
+
+	/**
+	 * Get reconstructed resolution of component
+	 */
+	ResolutionReconstruction* get_reconstruction(uint32_t compno);
+
+	/**
+	 * Get number of bytes held by store, including reconstructions
+	 */
+	uint64_t size(void) const;
+
+private:
+	typedef std::tuple<uint32_t, uint32_t, uint32_t, uint64_t, uint64_t> BlockKey;
+	std::map<BlockKey, std::unique_ptr<T1Checkpoint>> m_checkpoints;
+	std::map<uint32_t, ResolutionReconstruction> m_reconstructions;
+};
+
 class Tier1 {
 public:
 
-	void encodeCodeblocks(	TileCodingParams *tcp,
+	bool encodeCodeblocks(	TileCodingParams *tcp,
 							grk_tile *tile,
 							const double *mct_norms,
 			uint32_t mct_numcomps, bool doRateControl);
 
-	bool prepareDecodeCodeblocks(TileComponent *tilec, TileComponentCodingParams *tccp,
+	bool prepareDecodeCodeblocks(uint32_t compno, TileComponent *tilec,
+			TileComponentCodingParams *tccp, uint32_t first_resno,
+			T1CheckpointStore *checkpoints,
 			std::vector<decodeBlockInfo*> *blocks);
 
 	bool decodeCodeblocks(	TileCodingParams *tcp,
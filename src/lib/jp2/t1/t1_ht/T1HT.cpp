@@ -44,9 +44,12 @@ T1HT::T1HT(bool isEncoder,
 				unencoded_data_size(maxCblkW*maxCblkH),
 				unencoded_data(new int32_t[unencoded_data_size]),
 				allocator( new mem_fixed_allocator),
-				elastic_alloc(new mem_elastic_allocator(1048576))
+				elastic_alloc(new mem_elastic_allocator(1048576)),
+				m_scratch(GRK_MEM_T1_SCRATCH)
 {
 	(void) tcp;
+	m_scratch.set((size_t) coded_data_size
+			+ (size_t) unencoded_data_size * sizeof(int32_t));
 	if (!isEncoder)
 		memset(coded_data,0,grk_cblk_dec_compressed_data_pad_left_ht);
 }
@@ -104,8 +107,8 @@ void T1HT::preEncode(encodeBlockInfo *block, grk_tile *tile,
 		}
 	}
 }
-double T1HT::compress(encodeBlockInfo *block, grk_tile *tile, uint32_t maximum,
-		bool doRateControl) {
+bool T1HT::compress(encodeBlockInfo *block, grk_tile *tile, uint32_t maximum,
+		bool doRateControl, double *disto) {
 	(void)doRateControl;
 	(void)tile;
 	(void)maximum;
@@ -134,8 +137,9 @@ double T1HT::compress(encodeBlockInfo *block, grk_tile *tile, uint32_t maximum,
 	 assert(cblk->paddedCompressedData);
 	 memcpy(cblk->paddedCompressedData, next_coded->buf, (size_t)pass_length[0]);
 	}
+	*disto = 0;
 
-  return 0;
+  return true;
 }
 bool T1HT::decompress(decodeBlockInfo *block) {
 	auto cblk = block->cblk;
@@ -147,6 +151,8 @@ bool T1HT::decompress(decodeBlockInfo *block) {
 		delete[] coded_data;
 		coded_data = new uint8_t[total_seg_len];
 		coded_data_size = (uint32_t)total_seg_len;
+		m_scratch.set((size_t) coded_data_size
+				+ (size_t) unencoded_data_size * sizeof(int32_t));
 		memset(coded_data,0,grk_cblk_dec_compressed_data_pad_left_ht);
 	}
 	uint8_t *actual_coded_data =
@@ -214,7 +220,20 @@ bool T1HT::postDecode(decodeBlockInfo *block) {
        dest = src;
 	}
 
-	if (block->qmfbid == 1) {
+	if (block->tiledp16) {
+		int32_t shift = 31 - (block->k_msbs + 1);
+		int16_t *GRK_RESTRICT tile_data = block->tiledp16;
+		for (auto j = 0U; j < cblk_h; ++j) {
+			for (auto i = 0U; i < cblk_w; ++i) {
+				int32_t temp = *src;
+				int32_t val = std::min<int32_t>((temp & 0x7FFFFFFF) >> shift,
+						INT16_MAX);
+				tile_data[i] = (int16_t)(((uint32_t)temp & 0x80000000) ? -val : val);
+				src++;
+			}
+			tile_data += dest_width;
+		}
+	} else if (block->qmfbid == 1) {
 		int32_t shift = 31 - (block->k_msbs + 1);
 		int32_t *GRK_RESTRICT tile_data = dest;
 		for (auto j = 0U; j < cblk_h; ++j) {
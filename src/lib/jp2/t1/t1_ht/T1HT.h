@@ -37,8 +37,8 @@ public:
 	virtual ~T1HT();
 
 	void preEncode(encodeBlockInfo *block, grk_tile *tile, uint32_t &max);
-	double compress(encodeBlockInfo *block, grk_tile *tile, uint32_t max,
-			bool doRateControl);
+	bool compress(encodeBlockInfo *block, grk_tile *tile, uint32_t max,
+			bool doRateControl, double *disto);
 
 	bool decompress(decodeBlockInfo *block);
 	bool postDecode(decodeBlockInfo *block);
@@ -51,6 +51,7 @@ private:
 
     mem_fixed_allocator *allocator;
     mem_elastic_allocator *elastic_alloc;
+    MemAccount m_scratch;
 };
 }
 }
@@ -24,13 +24,14 @@ namespace grk {
 namespace t1_part1{
 
 T1Part1::T1Part1(bool isEncoder, TileCodingParams *tcp, uint32_t maxCblkW,
-		uint32_t maxCblkH) : t1(nullptr){
+		uint32_t maxCblkH) : t1(nullptr), m_scratch(GRK_MEM_T1_SCRATCH){
 	(void) tcp;
 	t1 = t1_create(isEncoder);
 	if (!isEncoder) {
 	   t1->cblkdatabuffersize = maxCblkW * maxCblkH * (uint32_t)sizeof(int32_t);
 	   t1->cblkdatabuffer = (uint8_t*)grk_malloc(t1->cblkdatabuffersize);
    }
+	account_scratch();
 }
 T1Part1::~T1Part1() {
 	t1_destroy( t1);
@@ -42,6 +43,13 @@ T1Part1::~T1Part1() {
  @param  b 11-bit precision fixed point number
  @return a * b in T1_NMSEDEC_FRACBITS-bit precision fixed point
  */
+void T1Part1::account_scratch(void) {
+	if (t1)
+		m_scratch.set((size_t) t1->datasize * sizeof(int32_t)
+				+ (size_t) t1->flagssize * sizeof(grk_flag)
+				+ t1->cblkdatabuffersize);
+}
+
 static inline int32_t int_fix_mul_t1(int32_t a, int32_t b) {
 #if defined(_MSC_VER) && (_MSC_VER >= 1400) && !defined(__INTEL_COMPILER) && defined(_M_IX86)
 	int64_t temp = __emul(a, b);
@@ -63,6 +71,7 @@ void T1Part1::preEncode(encodeBlockInfo *block, grk_tile *tile,
 	auto h = cblk->height();
 	if (!t1_allocate_buffers(t1, w,h))
 		return;
+	account_scratch();
 	t1->data_stride = w;
 	auto tileLineAdvance = (tile->comps + block->compno)->buf->stride() - w;
 	auto tiledp = block->tiledp;
@@ -95,8 +104,8 @@ void T1Part1::preEncode(encodeBlockInfo *block, grk_tile *tile,
 		}
 	}
 }
-double T1Part1::compress(encodeBlockInfo *block, grk_tile *tile,
-		uint32_t max, bool doRateControl) {
+bool T1Part1::compress(encodeBlockInfo *block, grk_tile *tile,
+		uint32_t max, bool doRateControl, double *disto) {
 	auto cblk = block->cblk;
 	cblk_enc cblkexp;
 	memset(&cblkexp, 0, sizeof(cblk_enc));
@@ -111,12 +120,21 @@ double T1Part1::compress(encodeBlockInfo *block, grk_tile *tile,
 	cblkexp.data = cblk->paddedCompressedData;
 	cblkexp.data_size = cblk->compressedDataSize;
 
-	auto disto = t1_encode_cblk(t1, &cblkexp, max, block->bandno,
+	*disto = t1_encode_cblk(t1, &cblkexp, max, block->bandno,
 			block->compno,
 			(tile->comps + block->compno)->numresolutions - 1 - block->resno,
 			block->qmfbid, block->stepsize, block->cblk_sty,
 			block->mct_norms, block->mct_numcomps, doRateControl);
 
+	// passes are allocated for the bit planes of the band, which include
+	// guard bits, so a code block should never need more
+	bool rc = cblkexp.totalpasses <= cblk->numPassesAllocated;
+	if (!rc) {
+		GRK_ERROR("Code block at (%u,%u) of component %u has %u coding passes,"
+				" more than the %u passes of its band", block->x, block->y,
+				block->compno, cblkexp.totalpasses, cblk->numPassesAllocated);
+		cblkexp.totalpasses = 0;
+	}
 	cblk->numPassesTotal = cblkexp.totalpasses;
 	cblk->numbps = cblkexp.numbps;
 	for (uint32_t i = 0; i < cblk->numPassesTotal; ++i) {
@@ -131,7 +149,7 @@ double T1Part1::compress(encodeBlockInfo *block, grk_tile *tile,
 	t1_code_block_enc_deallocate(&cblkexp);
 	cblkexp.data = nullptr;
 
- 	return disto;
+ 	return rc;
 }
 
 bool T1Part1::decompress(decodeBlockInfo *block) {
@@ -149,6 +167,7 @@ bool T1Part1::decompress(decodeBlockInfo *block) {
 			return false;
 		t1->cblkdatabuffer = new_block;
 		t1->cblkdatabuffersize = (uint32_t)total_seg_len;
+		account_scratch();
 	}
 	size_t offset = 0;
 	for (auto& b : cblk->seg_buffers) {
@@ -170,6 +189,7 @@ bool T1Part1::decompress(decodeBlockInfo *block) {
 	assert(cblk->height() > 0);
 	cblkexp.real_num_segs = cblk->numSegments;
 	auto segs = new seg[cblk->numSegments];
+	bool complete = true;
 	for (uint32_t i = 0; i < cblk->numSegments; ++i){
 		auto segp = segs + i;
 		memset(segp, 0, sizeof(seg));
@@ -177,17 +197,32 @@ bool T1Part1::decompress(decodeBlockInfo *block) {
 		segp->len = sgrk->len;
 		assert(segp->len <= total_seg_len);
 		segp->real_num_passes = sgrk->numpasses;
+		// state can only be saved at the end of a terminated segment
+		// whose passes have all been read
+		complete = complete && sgrk->numpasses == sgrk->maxpasses
+				&& sgrk->numPassesRead == sgrk->numpasses;
+		if (complete)
+			cblkexp.num_checkpoint_segs = i + 1;
 	}
 	cblkexp.segs = segs;
 	// subtract roishift as it was added when packet was parsed
 	// and exp uses subtracted value
 	cblkexp.numbps = cblk->numbps - block->roishift;
 
+	t1_dec_checkpoint *checkpoint = nullptr;
+	if (block->checkpoint) {
+		if (!*block->checkpoint)
+			block->checkpoint->reset(new T1Part1Checkpoint());
+		checkpoint = &((T1Part1Checkpoint*) block->checkpoint->get())->state;
+	}
+
     ret =t1_decode_cblk(t1,
     				&cblkexp,
     				block->bandno,
 					block->roishift,
-					block->cblk_sty);
+					block->cblk_sty,
+					checkpoint);
+	account_scratch();
 
 	delete[] segs;
 	return ret;
@@ -263,6 +298,16 @@ bool T1Part1::postDecode(decodeBlockInfo *block) {
 					  true)) {
 			  return false;
 		  }
+	} else if (block->tiledp16) {
+		int16_t *GRK_RESTRICT tiledp = block->tiledp16;
+		// saturate, rather than wrap, coefficients out of the 16 bit range
+		for (uint32_t j = 0; j < cblk_h; ++j) {
+			for (uint32_t i = 0; i < cblk_w; ++i)
+				tiledp[i] = (int16_t) std::clamp<int32_t>(src[i] / 2,
+						INT16_MIN, INT16_MAX);
+			src += (size_t) cblk_w;
+			tiledp += stride;
+		}
 	} else {
 		auto dest = tilec_data;
 		if (qmfbid == 1) {
@@ -30,20 +30,33 @@ namespace grk {
 
 namespace t1_part1 {
 
+struct T1Part1Checkpoint : public T1Checkpoint {
+	uint64_t size(void) const {
+		return sizeof(*this) + state.segs.capacity() * sizeof(seg)
+				+ state.data.capacity() * sizeof(int32_t)
+				+ state.flags.capacity() * sizeof(grk_flag);
+	}
+	t1_dec_checkpoint state;
+};
+
 class T1Part1: public T1Interface {
 public:
 	T1Part1(bool isEncoder, TileCodingParams *tcp, uint32_t maxCblkW, uint32_t maxCblkH);
 	virtual ~T1Part1();
 
 	void preEncode(encodeBlockInfo *block, grk_tile *tile, uint32_t &max);
-	double compress(encodeBlockInfo *block, grk_tile *tile, uint32_t max,
-			bool doRateControl);
+	bool compress(encodeBlockInfo *block, grk_tile *tile, uint32_t max,
+			bool doRateControl, double *disto);
 
 	bool decompress(decodeBlockInfo *block);
 	bool postDecode(decodeBlockInfo *block);
 
 private:
+	// account for buffers, which grow to fit the largest code block
+	void account_scratch(void);
+
 	t1_info *t1;
+	MemAccount m_scratch;
 };
 }
 }
@@ -1189,8 +1189,39 @@ static void t1_dec_refpass_mqc(t1_info *t1, int32_t bpno) {
 	}
 }
 
+static bool t1_dec_can_resume(const t1_info *t1,
+		const t1_dec_checkpoint *checkpoint, const cblk_dec *cblk) {
+	uint32_t datasize = (cblk->x1 - cblk->x0) * (cblk->y1 - cblk->y0);
+	if (checkpoint->segs.empty() || checkpoint->numbps != cblk->numbps
+			|| checkpoint->segs.size() > cblk->real_num_segs
+			|| checkpoint->data.size() != datasize
+			|| checkpoint->flags.size() != t1->flagssize)
+		return false;
+	for (uint32_t segno = 0; segno < checkpoint->segs.size(); ++segno) {
+		auto saved = &checkpoint->segs[segno];
+		auto current = cblk->segs + segno;
+		if (saved->len != current->len
+				|| saved->real_num_passes != current->real_num_passes)
+			return false;
+	}
+	return true;
+}
+
+static void t1_dec_save(t1_info *t1, const cblk_dec *cblk, uint32_t numsegs,
+		uint32_t passtype, int32_t bpno_plus_one,
+		t1_dec_checkpoint *checkpoint) {
+	checkpoint->segs.assign(cblk->segs, cblk->segs + numsegs);
+	checkpoint->numbps = cblk->numbps;
+	checkpoint->passtype = passtype;
+	checkpoint->bpno_plus_one = bpno_plus_one;
+	memcpy(checkpoint->ctxs, t1->mqc.ctxs, sizeof(checkpoint->ctxs));
+	uint32_t datasize = (cblk->x1 - cblk->x0) * (cblk->y1 - cblk->y0);
+	checkpoint->data.assign(t1->data, t1->data + datasize);
+	checkpoint->flags.assign(t1->flags, t1->flags + t1->flagssize);
+}
+
 bool t1_decode_cblk(t1_info *t1, cblk_dec *cblk, uint32_t orient,
-		uint32_t roishift, uint32_t cblksty) {
+		uint32_t roishift, uint32_t cblksty, t1_dec_checkpoint *checkpoint) {
 	auto mqc = &(t1->mqc);
 	uint32_t cblkdataindex = 0;
 	bool check_pterm = cblksty & GRK_CBLKSTY_PTERM;
@@ -1209,11 +1240,27 @@ bool t1_decode_cblk(t1_info *t1, cblk_dec *cblk, uint32_t orient,
 		return false;
 	}
 	uint32_t passtype = 2;
-
-	mqc_resetstates(mqc);
+	uint32_t first_seg = 0;
+
+	if (checkpoint && t1_dec_can_resume(t1, checkpoint, cblk)) {
+		// restore state at end of last saved segment, and skip
+		// straight to the first new segment
+		first_seg = (uint32_t) checkpoint->segs.size();
+		for (uint32_t segno = 0; segno < first_seg; ++segno)
+			cblkdataindex += cblk->segs[segno].len;
+		passtype = checkpoint->passtype;
+		bpno_plus_one = checkpoint->bpno_plus_one;
+		memcpy(mqc->ctxs, checkpoint->ctxs, sizeof(mqc->ctxs));
+		memcpy(t1->data, checkpoint->data.data(),
+				checkpoint->data.size() * sizeof(int32_t));
+		memcpy(t1->flags, checkpoint->flags.data(),
+				checkpoint->flags.size() * sizeof(grk_flag));
+	} else {
+		mqc_resetstates(mqc);
+	}
 	auto cblkdata = cblk->chunks[0].data;
 
-	for (uint32_t segno = 0; segno < cblk->real_num_segs; ++segno) {
+	for (uint32_t segno = first_seg; segno < cblk->real_num_segs; ++segno) {
 		auto seg = cblk->segs + segno;
 
 		/* BYPASS mode */
@@ -1257,6 +1304,9 @@ bool t1_decode_cblk(t1_info *t1, cblk_dec *cblk, uint32_t orient,
 			}
 		}
 		mqc_finish_dec(mqc);
+		if (checkpoint && segno + 1 == cblk->num_checkpoint_segs)
+			t1_dec_save(t1, cblk, segno + 1, passtype, bpno_plus_one,
+					checkpoint);
 	}
 
 	if (check_pterm) {
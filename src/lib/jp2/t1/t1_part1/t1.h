@@ -22,6 +22,7 @@
 #pragma once
 
 #include "t1_flags.h"
+#include <vector>
 
 namespace grk {
 
@@ -156,8 +157,40 @@ struct t1_info {
 	uint32_t cblkdatabuffersize;
 };
 
+/**
+ Decoder state at the end of a code block segment. Segments are terminated,
+ so decoding can resume from here once more segments are available,
+ provided that the segments decoded so far are unchanged.
+ */
+struct t1_dec_checkpoint {
+	t1_dec_checkpoint() : numbps(0), passtype(0), bpno_plus_one(0) {
+		memset(ctxs, 0, sizeof(ctxs));
+	}
+	/* decoded segments */
+	std::vector<seg> segs;
+	uint32_t numbps;
+	uint32_t passtype;
+	int32_t bpno_plus_one;
+	const mqc_state *ctxs[MQC_NUMCTXS];
+	std::vector<int32_t> data;
+	std::vector<grk_flag> flags;
+};
+
+/**
+ Decode code block
+
+ @param t1			T1 handle
+ @param cblk		code block
+ @param orient		band orientation
+ @param roishift	region of interest shift
+ @param cblksty		code block style
+ @param checkpoint	if not null, decoding resumes from checkpoint, if possible,
+ 	 	 	 	 	and the state at the end of segment cblk->num_checkpoint_segs - 1
+ 	 	 	 	 	is saved to it
+ */
 bool t1_decode_cblk(t1_info *t1, cblk_dec *cblk,
-		uint32_t orient, uint32_t roishift, uint32_t cblksty);
+		uint32_t orient, uint32_t roishift, uint32_t cblksty,
+		t1_dec_checkpoint *checkpoint);
 
 void t1_code_block_enc_deallocate(cblk_enc *
         p_code_block);
@@ -89,6 +89,8 @@ struct cblk_dec {
     uint32_t x0, y0, x1, y1;
     uint32_t numbps;
     uint32_t real_num_segs;
+    /* number of leading segments that are complete, and can be checkpointed */
+    uint32_t num_checkpoint_segs;
 };
 
 /* Macros to deal with signed integer with just MSB bit set for
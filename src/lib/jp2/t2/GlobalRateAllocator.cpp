@@ -0,0 +1,242 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+namespace grk {
+
+GlobalRateAllocator::GlobalRateAllocator(TileProcessor **procs,
+		uint16_t numTiles, const double *budgets) :
+		m_procs(procs), m_numTiles(numTiles), m_budgets(budgets), m_useEstimate(
+				true), m_prevLayersLen(numTiles, 0), m_packetsLen(numTiles, 0), m_pltLen(numTiles, 0), m_pltLenBound(
+				0) {
+}
+
+GlobalRateAllocator::~GlobalRateAllocator() {
+	for (auto &estimator : m_estimators)
+		delete estimator;
+}
+
+void GlobalRateAllocator::for_each_tile(std::function<void(uint16_t)> func) {
+	if (ThreadPool::get()->num_threads() > 1 && m_numTiles > 1) {
+		std::vector<std::future<int>> results;
+		for (uint16_t i = 0; i < m_numTiles; ++i) {
+			results.emplace_back(ThreadPool::get()->enqueue([func, i] {
+				func(i);
+				return 0;
+			}));
+		}
+		for (auto &result : results)
+			result.get();
+	} else {
+		for (uint16_t i = 0; i < m_numTiles; ++i)
+			func(i);
+	}
+}
+
+void GlobalRateAllocator::make_layer(uint32_t layno, uint16_t thresh,
+		bool final) {
+	for_each_tile([this, layno, thresh, final](uint16_t i) {
+		m_procs[i]->makelayer_feasible(layno, thresh, final);
+	});
+}
+
+bool GlobalRateAllocator::simulate(uint32_t layno, uint64_t *len) {
+	std::atomic<bool> success(true);
+	for_each_tile([this, layno, &success](uint16_t i) {
+		uint32_t tileLen = 0;
+		m_pltLen[i] = 0;
+		if (m_procs[i]->plt_markers) {
+			PacketLengthMarkers markers;
+			markers.writeInit();
+			if (!m_procs[i]->simulate_packets(layno, &tileLen, &markers))
+				success = false;
+			m_pltLen[i] = markers.length();
+		} else if (!m_procs[i]->simulate_packets(layno, &tileLen, nullptr)) {
+			success = false;
+		}
+		m_packetsLen[i] = tileLen;
+	});
+	*len = 0;
+	for (uint16_t i = 0; i < m_numTiles; ++i)
+		*len += m_packetsLen[i] + m_pltLen[i];
+
+	return success;
+}
+
+/*
+ Upper bound on length of PLT markers of a tile: at most five bytes
+ per packet length, plus marker, length and index of each marker segment
+ */
+uint64_t GlobalRateAllocator::plt_len_bound(uint16_t tileno) {
+	auto proc = m_procs[tileno];
+	if (!proc->plt_markers)
+		return 0;
+	uint64_t numPackets = 0;
+	for (uint32_t compno = 0; compno < proc->tile->numcomps; compno++) {
+		auto tilec = proc->tile->comps + compno;
+		for (uint32_t resno = 0; resno < tilec->numresolutions; resno++) {
+			auto res = tilec->resolutions + resno;
+			numPackets += (uint64_t) res->pw * res->ph;
+		}
+	}
+	numPackets *= proc->m_cp->tcps[proc->m_tile_index].numlayers;
+
+	return numPackets * 5 + (numPackets / min_packets_per_full_plt + 1) * 5;
+}
+
+/*
+ Decide whether packets of all tiles, for all layers up to and including layno,
+ fit in budget. Estimator bounds are used when they settle the question;
+ otherwise packets of all tiles are simulated exactly.
+ */
+bool GlobalRateAllocator::fits(uint32_t layno, uint64_t budget) {
+	if (m_useEstimate) {
+		for_each_tile([this](uint16_t i) {
+			m_estimators[i]->evaluate();
+		});
+		uint64_t lower = 0, upper = m_pltLenBound;
+		for (auto &estimator : m_estimators) {
+			lower += estimator->lower();
+			upper += estimator->upper();
+		}
+		if (upper <= budget)
+			return true;
+		if (lower > budget)
+			return false;
+	}
+	uint64_t len = 0;
+	if (!simulate(layno, &len))
+		return false;
+
+	return len <= budget;
+}
+
+bool GlobalRateAllocator::allocate(void) {
+	std::vector<RateInfo> rateInfo(m_numTiles);
+	bool exact = m_procs[0]->m_cp->m_coding_params.m_enc.m_exact_rate_control;
+	if (!exact)
+		m_estimators.resize(m_numTiles, nullptr);
+	for_each_tile([this, &rateInfo, exact](uint16_t i) {
+		double maxSE = 0;
+		m_procs[i]->feasible_truncation_points(false, &rateInfo[i], &maxSE);
+		if (!exact)
+			m_estimators[i] = new RateEstimator(m_procs[i]);
+	});
+	for (uint16_t i = 0; i < m_numTiles; ++i)
+		m_pltLenBound += plt_len_bound(i);
+
+	uint32_t min_slope = USHRT_MAX;
+	for (auto &info : rateInfo)
+		min_slope = std::min<uint32_t>(min_slope, info.getMinimumThresh());
+	uint32_t upperBound = USHRT_MAX;
+
+	auto numlayers = m_procs[0]->m_cp->tcps[m_procs[0]->m_tile_index].numlayers;
+	for (uint32_t layno = 0; layno < numlayers; layno++) {
+		uint32_t lowerBound = min_slope;
+		if (m_procs[0]->layer_needs_rate_control(layno)) {
+			auto budget = (uint64_t) m_budgets[layno];
+			uint32_t layerUpperBound = upperBound;
+			uint32_t goodthresh = 0;
+			for (uint16_t i = 0; i < m_estimators.size(); ++i)
+				m_estimators[i]->beginLayer(layno, m_prevLayersLen[i]);
+			m_useEstimate = !exact;
+
+			while (true) {
+				uint32_t prevthresh = 0;
+				lowerBound = min_slope;
+				upperBound = layerUpperBound;
+				for (uint32_t i = 0; i < 128; ++i) {
+					uint32_t thresh = (lowerBound + upperBound) >> 1;
+					if (prevthresh != 0 && prevthresh == thresh)
+						break;
+					make_layer(layno, (uint16_t) thresh, false);
+					prevthresh = thresh;
+					if (!fits(layno, budget)) {
+						lowerBound = thresh;
+						continue;
+					}
+					upperBound = thresh;
+				}
+				goodthresh = upperBound;
+
+				// confirm threshold with an exact simulation; this also
+				// records exact packet lengths of each tile
+				make_layer(layno, (uint16_t) goodthresh, false);
+				uint64_t len = 0;
+				if (!simulate(layno, &len)) {
+					GRK_ERROR("Global rate allocation: failed to simulate packets");
+					return false;
+				}
+				if (len <= budget)
+					break;
+				if (!m_useEstimate) {
+					// even the smallest layer found by exact bisection
+					// is too large
+					GRK_WARN("Global rate allocation: layer %u needs %llu bytes,"
+							" exceeding its budget of %llu bytes", layno,
+							(unsigned long long) len,
+							(unsigned long long) budget);
+					break;
+				}
+				// otherwise, repeat bisection of this layer with exact simulation
+				m_useEstimate = false;
+			}
+			make_layer(layno, (uint16_t) goodthresh, true);
+			for (auto &estimator : m_estimators)
+				estimator->commit();
+			m_prevLayersLen = m_packetsLen;
+			// upper bound for next layer is initialized to lowerBound for current layer, minus one
+			upperBound = lowerBound - 1;
+		} else {
+			for_each_tile([this, layno](uint16_t i) {
+				m_procs[i]->makelayer_final(layno);
+			});
+			// resync estimators with exact packet lengths of final layer
+			uint64_t len = 0;
+			if (!simulate(layno, &len)) {
+				GRK_ERROR("Global rate allocation: failed to simulate packets");
+				return false;
+			}
+			for (uint16_t i = 0; i < m_estimators.size(); ++i) {
+				m_estimators[i]->beginLayer(layno, m_prevLayersLen[i]);
+				m_estimators[i]->commit();
+			}
+			m_prevLayersLen = m_packetsLen;
+		}
+	}
+	// with several tile parts, PLT markers are written before the packets,
+	// so collect packet lengths now
+	for (uint16_t i = 0; i < m_numTiles; ++i) {
+		auto proc = m_procs[i];
+		if (proc->plt_markers && !proc->plt_from_final_pass()) {
+			uint32_t len = 0;
+			if (!proc->simulate_packets(numlayers - 1, &len,
+					proc->plt_markers)) {
+				GRK_ERROR("Global rate allocation: failed to simulate packets");
+				return false;
+			}
+		}
+	}
+	// simulation marks packets as encoded
+	for (uint16_t i = 0; i < m_numTiles; ++i)
+		m_procs[i]->m_packetTracker.clear();
+
+	return true;
+}
+
+}
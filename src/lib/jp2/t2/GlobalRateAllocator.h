@@ -0,0 +1,80 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <functional>
+
+namespace grk {
+
+struct TileProcessor;
+class RateEstimator;
+
+/**
+ * Rate allocation across all tiles of an image.
+ *
+ * Once T1 has run for every tile, a single slope threshold per layer
+ * is found by bisection over feasible truncation points of the whole image,
+ * so that bytes go where they buy the largest distortion reduction,
+ * and the summed packet length of all tiles, together with their PLT
+ * markers if any, meets the image-wide budget.
+ */
+class GlobalRateAllocator {
+public:
+	/**
+	 * Create allocator
+	 *
+	 * @param procs		tile processors, T1 complete
+	 * @param numTiles	number of tiles
+	 * @param budgets	image-wide packet and PLT byte budget for each layer
+	 */
+	GlobalRateAllocator(TileProcessor **procs, uint16_t numTiles,
+			const double *budgets);
+	~GlobalRateAllocator();
+
+	/**
+	 * Form layers for all tiles
+	 *
+	 * @return true if successful
+	 */
+	bool allocate(void);
+
+private:
+	void for_each_tile(std::function<void(uint16_t)> func);
+	void make_layer(uint32_t layno, uint16_t thresh, bool final);
+	bool fits(uint32_t layno, uint64_t budget);
+	bool simulate(uint32_t layno, uint64_t *len);
+	uint64_t plt_len_bound(uint16_t tileno);
+
+	TileProcessor **m_procs;
+	uint16_t m_numTiles;
+	const double *m_budgets;
+	// false while the current layer is bisected with exact simulation
+	bool m_useEstimate;
+	std::vector<RateEstimator*> m_estimators;
+	// exact packet length of finalized layers, per tile
+	std::vector<uint64_t> m_prevLayersLen;
+	// packet length of last simulation, per tile
+	std::vector<uint64_t> m_packetsLen;
+	// PLT marker length of last simulation, per tile
+	std::vector<uint64_t> m_pltLen;
+	// upper bound on PLT length of all tiles, added to estimator bounds
+	uint64_t m_pltLenBound;
+};
+
+}
@@ -0,0 +1,264 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+namespace grk {
+
+RateEstimatorBlock::RateEstimatorBlock() :
+		cblk(nullptr), packet(0), zeroBitPlanes(0), numTreeLevels(0), numPassesIncluded(
+				0), numlenbits(0), numpasses(0), bitsLo(0), bitsHi(0), len(0) {
+}
+
+RateEstimatorPacket::RateEstimatorPacket() :
+		bitsLo(0), bitsHi(0), treeBitsHi(0) {
+}
+
+/*
+ Number of levels and number of non-leaf nodes of a tag tree,
+ following the construction in TagTree
+ */
+static void tag_tree_dimensions(uint64_t numleafsh, uint64_t numleafsv,
+		uint32_t *numlevels, uint64_t *numInternalNodes) {
+	uint64_t nplh = numleafsh;
+	uint64_t nplv = numleafsv;
+	uint64_t n;
+	*numlevels = 0;
+	*numInternalNodes = 0;
+	do {
+		n = nplh * nplv;
+		if (*numlevels)
+			*numInternalNodes += n;
+		nplh = (nplh + 1) / 2;
+		nplv = (nplv + 1) / 2;
+		++*numlevels;
+	} while (n > 1);
+}
+
+// number of bits used by BitIO::putnumpasses
+static uint32_t num_passes_bits(uint32_t n) {
+	if (n == 1)
+		return 1;
+	else if (n == 2)
+		return 2;
+	else if (n <= 5)
+		return 4;
+	else if (n <= 36)
+		return 9;
+	return 16;
+}
+
+// header bytes: BitIO packs at least 7 bits per byte, plus a possible
+// trailing byte after 0xFF
+static uint64_t header_bytes_lo(uint64_t bits) {
+	return (bits + 7) / 8;
+}
+static uint64_t header_bytes_hi(uint64_t bits) {
+	return (bits + 6) / 7 + 1;
+}
+
+RateEstimator::RateEstimator(TileProcessor *tileProc) :
+		m_layno(0), m_markerBytes(0), m_prevLayersLen(0), m_bodyLen(0), m_headerLo(
+				0), m_headerHi(0) {
+	auto tile = tileProc->tile;
+	auto tcp = tileProc->m_cp->tcps + tileProc->m_tile_index;
+	if (tcp->csty & J2K_CP_CSTY_SOP)
+		m_markerBytes += 6;
+	if (tcp->csty & J2K_CP_CSTY_EPH)
+		m_markerBytes += 2;
+
+	for (uint32_t compno = 0; compno < tile->numcomps; compno++) {
+		auto tilec = tile->comps + compno;
+		for (uint32_t resno = 0; resno < tilec->numresolutions; resno++) {
+			auto res = tilec->resolutions + resno;
+			for (uint64_t precno = 0; precno < (uint64_t) res->pw * res->ph;
+					precno++) {
+				RateEstimatorPacket packet;
+				auto packetIndex = (uint32_t) m_packets.size();
+				for (uint32_t bandno = 0; bandno < res->numbands; bandno++) {
+					auto band = res->bands + bandno;
+					auto prc = band->precincts + precno;
+					uint64_t nb_blocks = (uint64_t) prc->cw * prc->ch;
+					if (!nb_blocks)
+						continue;
+					uint32_t numlevels;
+					uint64_t numInternalNodes;
+					tag_tree_dimensions(prc->cw, prc->ch, &numlevels,
+							&numInternalNodes);
+					packet.treeBitsHi += numInternalNodes;
+					for (uint64_t cblkno = 0; cblkno < nb_blocks; ++cblkno) {
+						RateEstimatorBlock block;
+						block.cblk = prc->enc + cblkno;
+						block.packet = packetIndex;
+						if (band->numbps > block.cblk->numbps)
+							block.zeroBitPlanes = band->numbps
+									- block.cblk->numbps;
+						block.numTreeLevels = numlevels;
+						m_blocks.push_back(block);
+					}
+				}
+				m_packets.push_back(packet);
+			}
+		}
+	}
+}
+
+void RateEstimator::beginLayer(uint32_t layno, uint64_t prevLayersLen) {
+	m_layno = layno;
+	m_prevLayersLen = prevLayersLen;
+	m_bodyLen = 0;
+	m_headerLo = 0;
+	m_headerHi = 0;
+
+	// every packet carries the empty header bit
+	for (auto &packet : m_packets) {
+		packet.bitsLo = 1;
+		packet.bitsHi = 1 + packet.treeBitsHi;
+	}
+	// start with no passes included in this layer
+	for (auto &block : m_blocks) {
+		block.numpasses = 0;
+		block.len = 0;
+		// a previously included block signals exclusion with a single bit,
+		// otherwise the inclusion tag tree leaf costs at most one bit
+		block.bitsLo = block.numPassesIncluded ? 1 : 0;
+		block.bitsHi = 1;
+		auto packet = &m_packets[block.packet];
+		packet->bitsLo += block.bitsLo;
+		packet->bitsHi += block.bitsHi;
+	}
+	for (auto &packet : m_packets)
+		addPacketBytes(&packet);
+}
+
+void RateEstimator::removePacketBytes(RateEstimatorPacket *packet) {
+	m_headerLo -= header_bytes_lo(packet->bitsLo);
+	m_headerHi -= header_bytes_hi(packet->bitsHi);
+}
+
+void RateEstimator::addPacketBytes(RateEstimatorPacket *packet) {
+	m_headerLo += header_bytes_lo(packet->bitsLo);
+	m_headerHi += header_bytes_hi(packet->bitsHi);
+}
+
+/*
+ Bits used by the length increment comma code and the code word segment lengths,
+ mirroring T2Encode::encode_packet
+ */
+uint32_t RateEstimator::lengthBits(RateEstimatorBlock *block,
+		uint32_t numpasses, uint32_t *increment) {
+	auto cblk = block->cblk;
+	uint32_t numlenbits = block->numPassesIncluded ? block->numlenbits : 3;
+	uint32_t first = block->numPassesIncluded;
+	uint32_t last = first + numpasses;
+	uint32_t len = 0;
+	uint32_t nump = 0;
+
+	*increment = 0;
+	for (uint32_t passno = first; passno < last; ++passno) {
+		auto pass = cblk->passes + passno;
+		++nump;
+		len += pass->len;
+		if (pass->term || passno == last - 1) {
+			*increment = (uint32_t) std::max<int32_t>((int32_t) *increment,
+					floorlog2<int32_t>(len) + 1
+							- ((int32_t) numlenbits + floorlog2<int32_t>(nump)));
+			len = 0;
+			nump = 0;
+		}
+	}
+	numlenbits += *increment;
+	uint32_t bits = *increment + 1;
+	for (uint32_t passno = first; passno < last; ++passno) {
+		auto pass = cblk->passes + passno;
+		++nump;
+		if (pass->term || passno == last - 1) {
+			bits += numlenbits + (uint32_t) floorlog2<int32_t>(nump);
+			nump = 0;
+		}
+	}
+
+	return bits;
+}
+
+void RateEstimator::update(RateEstimatorBlock *block, uint32_t numpasses) {
+	auto packet = &m_packets[block->packet];
+	removePacketBytes(packet);
+	packet->bitsLo -= block->bitsLo;
+	packet->bitsHi -= block->bitsHi;
+	m_bodyLen -= block->len;
+
+	block->numpasses = numpasses;
+	if (!numpasses) {
+		block->bitsLo = block->numPassesIncluded ? 1 : 0;
+		block->bitsHi = 1;
+		block->len = 0;
+	} else {
+		uint32_t increment;
+		// inclusion bit, number of passes and segment lengths are exact
+		uint32_t bits = 1 + num_passes_bits(numpasses)
+				+ lengthBits(block, numpasses, &increment);
+		block->bitsLo = bits;
+		block->bitsHi = bits;
+		// IMSB tag tree: at least one bit for the leaf, at most the
+		// leaf value plus one bit per level of the tree
+		if (!block->numPassesIncluded) {
+			block->bitsLo += 1;
+			block->bitsHi += block->zeroBitPlanes + block->numTreeLevels;
+		}
+		block->len = block->cblk->layers[m_layno].len;
+	}
+
+	packet->bitsLo += block->bitsLo;
+	packet->bitsHi += block->bitsHi;
+	m_bodyLen += block->len;
+	addPacketBytes(packet);
+}
+
+void RateEstimator::evaluate(void) {
+	for (auto &block : m_blocks) {
+		uint32_t numpasses = block.cblk->layers[m_layno].numpasses;
+		if (numpasses != block.numpasses)
+			update(&block, numpasses);
+	}
+}
+
+uint64_t RateEstimator::lower(void) {
+	return m_prevLayersLen + m_bodyLen + m_headerLo
+			+ (uint64_t) m_markerBytes * m_packets.size();
+}
+
+uint64_t RateEstimator::upper(void) {
+	return m_prevLayersLen + m_bodyLen + m_headerHi
+			+ (uint64_t) m_markerBytes * m_packets.size();
+}
+
+void RateEstimator::commit(void) {
+	for (auto &block : m_blocks) {
+		uint32_t numpasses = block.cblk->layers[m_layno].numpasses;
+		if (!numpasses)
+			continue;
+		uint32_t increment;
+		lengthBits(&block, numpasses, &increment);
+		if (!block.numPassesIncluded)
+			block.numlenbits = 3;
+		block.numlenbits += increment;
+		block.numPassesIncluded += numpasses;
+	}
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace grk {
+
+struct TileProcessor;
+
+// cached rate state of a single code block
+struct RateEstimatorBlock {
+	RateEstimatorBlock();
+	grk_cblk_enc *cblk;
+	uint32_t packet;		 	 // index of packet holding this code block
+	uint32_t zeroBitPlanes;		 // value of IMSB tag tree leaf
+	uint32_t numTreeLevels;	 	 // number of levels in precinct tag trees
+	uint32_t numPassesIncluded;  // passes included in finalized layers
+	uint32_t numlenbits;		 // length indicator after finalized layers
+	uint32_t numpasses;			 // passes in current layer at last evaluation
+	uint32_t bitsLo;			 // header bits: lower bound
+	uint32_t bitsHi;			 // header bits: upper bound
+	uint32_t len;				 // body bytes
+};
+
+// cached header state of a single packet (component, resolution, precinct)
+struct RateEstimatorPacket {
+	RateEstimatorPacket();
+	uint64_t bitsLo;
+	uint64_t bitsHi;
+	// upper bound on inclusion tag tree bits from non-leaf nodes
+	uint64_t treeBitsHi;
+};
+
+/**
+ * Incremental estimate of the length of the packets of a tile, used by PCRD
+ * bisection in place of a full T2 simulation on every iteration.
+ *
+ * Code block bodies and the length-signalling part of packet headers
+ * are computed exactly; only tag tree bits and bit stuffing are unknown,
+ * and these are bracketed, so the estimate is an interval [lower, upper]
+ * that contains the exact packet length. Between evaluations,
+ * only code blocks whose layer pass count has changed are recomputed.
+ */
+class RateEstimator {
+public:
+	RateEstimator(TileProcessor *tileProc);
+
+	/**
+	 * Start estimating a new layer
+	 *
+	 * @param layno 		layer number
+	 * @param prevLayersLen exact length of all packets in previous layers
+	 */
+	void beginLayer(uint32_t layno, uint64_t prevLayersLen);
+
+	/**
+	 * Update estimate from the current layer pass counts
+	 */
+	void evaluate(void);
+
+	/**
+	 * Lower bound on the length of packets in all layers up to current layer
+	 */
+	uint64_t lower(void);
+
+	/**
+	 * Upper bound on the length of packets in all layers up to current layer
+	 */
+	uint64_t upper(void);
+
+	/**
+	 * Finalize current layer, once its truncation points are fixed
+	 */
+	void commit(void);
+
+private:
+	void update(RateEstimatorBlock *block, uint32_t numpasses);
+	void removePacketBytes(RateEstimatorPacket *packet);
+	void addPacketBytes(RateEstimatorPacket *packet);
+	uint32_t lengthBits(RateEstimatorBlock *block, uint32_t numpasses,
+			uint32_t *increment);
+
+	std::vector<RateEstimatorBlock> m_blocks;
+	std::vector<RateEstimatorPacket> m_packets;
+	uint32_t m_layno;
+	// bytes per packet for SOP and EPH markers
+	uint32_t m_markerBytes;
+	uint64_t m_prevLayersLen;
+	uint64_t m_bodyLen;
+	uint64_t m_headerLo;
+	uint64_t m_headerHi;
+};
+
+}
@@ -22,17 +22,22 @@
 namespace grk {
 
 bool T2::init_seg(grk_cblk_dec *cblk, uint32_t index, uint8_t cblk_sty,
-		bool first) {
+		bool first, ArenaAllocator *arena) {
 	uint32_t nb_segs = index + 1;
 
 	if (nb_segs > cblk->numSegmentsAllocated) {
-		auto new_segs = new grk_seg[cblk->numSegmentsAllocated
-				+ cblk->numSegmentsAllocated];
+		// a single segment unless passes are terminated, so
+		// start with what is needed and double from there
+		uint32_t num_segs = std::max<uint32_t>(nb_segs,
+				2 * cblk->numSegmentsAllocated);
+		auto new_segs = arena->construct_array<grk_seg>(num_segs);
+		if (!new_segs) {
+			GRK_ERROR("Not enough memory for code block segments");
+			return false;
+		}
 		for (uint32_t i = 0; i < cblk->numSegmentsAllocated; ++i)
 			new_segs[i] = cblk->segs[i];
-		cblk->numSegmentsAllocated += default_numbers_segments;
-		if (cblk->segs)
-			delete[] cblk->segs;
+		cblk->numSegmentsAllocated = num_segs;
 		cblk->segs = new_segs;
 	}
 
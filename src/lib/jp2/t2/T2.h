@@ -27,9 +27,10 @@ protected:
 	 @param index
 	 @param cblk_sty
 	 @param first
+	 @param arena	tile component arena that segments are allocated from
 	 */
 	bool init_seg(grk_cblk_dec *cblk, uint32_t index, uint8_t cblk_sty,
-			bool first);
+			bool first, ArenaAllocator *arena);
 };
 
 }
@@ -166,7 +166,8 @@ bool T2Decode::decode_packet(TileCodingParams *p_tcp, PacketIter *p_pi, ChunkBuf
 		return true;
 	}
 	auto p_tile = tileProcessor->tile;
-	auto res = &p_tile->comps[p_pi->compno].resolutions[p_pi->resno];
+	auto tilec = p_tile->comps + p_pi->compno;
+	auto res = &tilec->resolutions[p_pi->resno];
 	bool read_data;
 	uint64_t nb_bytes_read = 0;
 	uint64_t nb_total_bytes_read = 0;
@@ -179,7 +180,8 @@ bool T2Decode::decode_packet(TileCodingParams *p_tcp, PacketIter *p_pi, ChunkBuf
 	/* we should read data for the packet */
 	if (read_data) {
 		nb_bytes_read = 0;
-		if (!read_packet_data(res, p_pi, src_buf, &nb_bytes_read)) {
+		if (!read_packet_data(res, p_pi, src_buf, &tilec->m_arena,
+				&nb_bytes_read)) {
 			return false;
 		}
 		nb_total_bytes_read += nb_bytes_read;
@@ -191,7 +193,8 @@ bool T2Decode::decode_packet(TileCodingParams *p_tcp, PacketIter *p_pi, ChunkBuf
 bool T2Decode::read_packet_header(TileCodingParams *p_tcp, PacketIter *p_pi,
 		bool *p_is_data_present, ChunkBuffer *src_buf, uint64_t *p_data_read) {
 	auto p_tile = tileProcessor->tile;
-	auto res = &p_tile->comps[p_pi->compno].resolutions[p_pi->resno];
+	auto tilec = p_tile->comps + p_pi->compno;
+	auto res = &tilec->resolutions[p_pi->resno];
 	auto p_src_data = src_buf->get_global_ptr();
 	uint64_t max_length = src_buf->getRemainingLength();
 	uint64_t nb_code_blocks = 0;
@@ -320,7 +323,7 @@ bool T2Decode::read_packet_header(TileCodingParams *p_tcp, PacketIter *p_pi,
 			/* if cblk not yet included before --> inclusion tagtree */
 			if (!cblk->numSegments) {
 				uint64_t value;
-				prc->incltree->decodeValue(bio.get(), cblkno,
+				prc->getInclTree()->decodeValue(bio.get(), cblkno,
 						p_pi->layno + 1, &value);
 
 				if (value != tag_tree_uninitialized_node_value
@@ -370,11 +373,11 @@ bool T2Decode::read_packet_header(TileCodingParams *p_tcp, PacketIter *p_pi,
 
 				// see Taubman + Marcellin page 388
 				// loop below stops at (# of missing bit planes  + 1)
-				prc->imsbtree->decompress(bio.get(), cblkno,
+				prc->getImsbTree()->decompress(bio.get(), cblkno,
 										K_msbs, &value);
 				while (!value) {
 					++K_msbs;
-					prc->imsbtree->decompress(bio.get(), cblkno,
+					prc->getImsbTree()->decompress(bio.get(), cblkno,
 											K_msbs, &value);
 				}
 				assert(K_msbs >= 1);
@@ -408,7 +411,8 @@ bool T2Decode::read_packet_header(TileCodingParams *p_tcp, PacketIter *p_pi,
 
 			if (!cblk->numSegments) {
 				if (!T2Decode::init_seg(cblk, segno,
-						p_tcp->tccps[p_pi->compno].cblk_sty, true)) {
+						p_tcp->tccps[p_pi->compno].cblk_sty, true,
+						&tilec->m_arena)) {
 					return false;
 				}
 			} else {
@@ -417,7 +421,8 @@ bool T2Decode::read_packet_header(TileCodingParams *p_tcp, PacketIter *p_pi,
 						== cblk->segs[segno].maxpasses) {
 					++segno;
 					if (!T2Decode::init_seg(cblk, segno,
-							p_tcp->tccps[p_pi->compno].cblk_sty, false)) {
+							p_tcp->tccps[p_pi->compno].cblk_sty, false,
+							&tilec->m_arena)) {
 						return false;
 					}
 				}
@@ -468,7 +473,8 @@ bool T2Decode::read_packet_header(TileCodingParams *p_tcp, PacketIter *p_pi,
 				if (blockPassesInPacket > 0) {
 					++segno;
 					if (!T2Decode::init_seg(cblk, segno,
-							p_tcp->tccps[p_pi->compno].cblk_sty, false)) {
+							p_tcp->tccps[p_pi->compno].cblk_sty, false,
+							&tilec->m_arena)) {
 						return false;
 					}
 				}
@@ -505,7 +511,7 @@ bool T2Decode::read_packet_header(TileCodingParams *p_tcp, PacketIter *p_pi,
 }
 
 bool T2Decode::read_packet_data(grk_resolution *res, PacketIter *p_pi,
-		ChunkBuffer *src_buf, uint64_t *p_data_read) {
+		ChunkBuffer *src_buf, ArenaAllocator *arena, uint64_t *p_data_read) {
 	for (uint32_t bandno = 0; bandno < res->numbands; ++bandno) {
 		auto band = res->bands + bandno;
 		auto prc = &band->precincts[p_pi->precno];
@@ -532,8 +538,9 @@ bool T2Decode::read_packet_data(grk_resolution *res, PacketIter *p_pi,
 			uint32_t numPassesInPacket = cblk->numPassesInPacket;
 			do {
 				size_t maxLen = src_buf->getRemainingLength();
+				bool truncated = seg->numBytesInPacket > maxLen;
 				// Check possible overflow on segment length
-				if (((seg->numBytesInPacket) > maxLen)) {
+				if (truncated) {
 					GRK_WARN("read packet data:\nSegment segment length %u\n"
 							"is greater than remaining total length of all segments (%u)\n"
 							"for codeblock %u (layer=%u, prec=%u, band=%u, res=%u, comp=%u).\n"
@@ -547,14 +554,21 @@ bool T2Decode::read_packet_data(grk_resolution *res, PacketIter *p_pi,
 
 				// only add segment to seg_buffers if length is greater than zero
 				if (seg->numBytesInPacket) {
-					cblk->seg_buffers.push_back(new grk_buf(src_buf->get_global_ptr(),
-							seg->numBytesInPacket, false));
+					auto seg_buf = (grk_buf*) arena->alloc(sizeof(grk_buf));
+					if (!seg_buf) {
+						GRK_ERROR("Not enough memory for code block segment");
+						return false;
+					}
+					cblk->seg_buffers.push_back(new (seg_buf) grk_buf(
+							src_buf->get_global_ptr(), seg->numBytesInPacket, false));
 					*(p_data_read) += seg->numBytesInPacket;
 					src_buf->incr_cur_chunk_offset(seg->numBytesInPacket);
 					cblk->compressedDataSize += seg->numBytesInPacket;
 					seg->len += seg->numBytesInPacket;
 				}
 				seg->numpasses += seg->numPassesInPacket;
+				if (!truncated)
+					seg->numPassesRead += seg->numPassesInPacket;
 				numPassesInPacket -= seg->numPassesInPacket;
 				if (numPassesInPacket > 0) {
 					++seg;
@@ -70,7 +70,7 @@ private:
 			uint64_t *p_data_read);
 
 	bool read_packet_data(grk_resolution *l_res, PacketIter *p_pi,
-			ChunkBuffer *src_buf, uint64_t *p_data_read);
+			ChunkBuffer *src_buf, ArenaAllocator *arena, uint64_t *p_data_read);
 
 	bool skip_packet_data(grk_resolution *l_res, PacketIter *p_pi,
 			uint64_t *p_data_read, uint64_t max_length);
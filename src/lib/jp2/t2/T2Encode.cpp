@@ -36,7 +36,7 @@ T2Encode::T2Encode(TileProcessor *tileProc) :
 bool T2Encode::encode_packets(uint16_t tile_no, uint32_t max_layers,
 		BufferedStream *stream, uint32_t *p_data_written,
 		uint32_t tp_num, uint32_t tp_pos,
-		uint32_t pino) {
+		uint32_t pino, PacketLengthMarkers *markers) {
 	auto cp = tileProcessor->m_cp;
 	auto image = tileProcessor->image;
 	auto p_tile = tileProcessor->tile;
@@ -63,6 +63,8 @@ bool T2Encode::encode_packets(uint16_t tile_no, uint32_t max_layers,
 				return false;
 			}
 			*p_data_written += nb_bytes;
+			if (markers && nb_bytes)
+				markers->writeNext(nb_bytes);
 			/* << INDEX */
 			++p_tile->packno;
 		}
@@ -201,7 +203,7 @@ bool T2Encode::encode_packet(TileCodingParams *tcp, PacketIter *pi,
 							"Code block %u bps greater than band bps. Skipping.",
 							cblkno);
 				} else {
-					prc->imsbtree->setvalue(cblkno,
+					prc->getImsbTree()->setvalue(cblkno,
 							(int64_t) (band->numbps - cblk->numbps));
 				}
 			}
@@ -231,7 +233,7 @@ bool T2Encode::encode_packet(TileCodingParams *tcp, PacketIter *pi,
 
 			if (!cblk->numPassesInPacket
 					&& layer->numpasses) {
-				prc->incltree->setvalue(cblkno, (int32_t) layno);
+				prc->getInclTree()->setvalue(cblkno, (int32_t) layno);
 			}
 		}
 
@@ -244,7 +246,7 @@ bool T2Encode::encode_packet(TileCodingParams *tcp, PacketIter *pi,
 
 			/* cblk inclusion bits */
 			if (!cblk->numPassesInPacket) {
-				bool rc = prc->incltree->compress(bio.get(), cblkno,
+				bool rc = prc->getInclTree()->compress(bio.get(), cblkno,
 						(int32_t) (layno + 1));
 				assert(rc);
 				if (!rc)
@@ -269,7 +271,7 @@ bool T2Encode::encode_packet(TileCodingParams *tcp, PacketIter *pi,
 			/* if first instance of cblk --> zero bit-planes information */
 			if (!cblk->numPassesInPacket) {
 				cblk->numlenbits = 3;
-				bool rc = prc->imsbtree->compress(bio.get(), cblkno,
+				bool rc = prc->getImsbTree()->compress(bio.get(), cblkno,
 						tag_tree_uninitialized_node_value);
 				assert(rc);
 				if (!rc)
@@ -598,7 +600,7 @@ bool T2Encode::encode_packet_simulate(TileCodingParams *tcp, PacketIter *pi,
 							"Code block %u bps greater than band bps. Skipping.",
 							cblkno);
 				} else {
-					prc->imsbtree->setvalue(cblkno,
+					prc->getImsbTree()->setvalue(cblkno,
 							(int64_t) (band->numbps - cblk->numbps));
 				}
 			}
@@ -622,7 +624,7 @@ bool T2Encode::encode_packet_simulate(TileCodingParams *tcp, PacketIter *pi,
 			auto layer = cblk->layers + layno;
 			if (!cblk->numPassesInPacket
 					&& layer->numpasses) {
-				prc->incltree->setvalue(cblkno, (int32_t) layno);
+				prc->getInclTree()->setvalue(cblkno, (int32_t) layno);
 			}
 		}
 		for (uint64_t cblkno = 0; cblkno < nb_blocks; cblkno++) {
@@ -635,7 +637,7 @@ bool T2Encode::encode_packet_simulate(TileCodingParams *tcp, PacketIter *pi,
 
 			/* cblk inclusion bits */
 			if (!cblk->numPassesInPacket) {
-				if (!prc->incltree->compress(bio.get(), cblkno,
+				if (!prc->getInclTree()->compress(bio.get(), cblkno,
 						(int32_t) (layno + 1)))
 					return false;
 			} else {
@@ -650,7 +652,7 @@ bool T2Encode::encode_packet_simulate(TileCodingParams *tcp, PacketIter *pi,
 			/* if first instance of cblk --> zero bit-planes information */
 			if (!cblk->numPassesInPacket) {
 				cblk->numlenbits = 3;
-				if (!prc->imsbtree->compress(bio.get(), cblkno,
+				if (!prc->getImsbTree()->compress(bio.get(), cblkno,
 						tag_tree_uninitialized_node_value))
 					return false;
 			}
@@ -662,8 +664,7 @@ bool T2Encode::encode_packet_simulate(TileCodingParams *tcp, PacketIter *pi,
 			/* computation of the increase of the length indicator and insertion in the header     */
 			for (passno = cblk->numPassesInPacket;
 					passno < nb_passes; ++passno) {
-				auto pass =
-						cblk->passes + cblk->numPassesInPacket + passno;
+				auto pass = cblk->passes + passno;
 				++nump;
 				len += pass->len;
 
@@ -687,8 +688,7 @@ bool T2Encode::encode_packet_simulate(TileCodingParams *tcp, PacketIter *pi,
 			/* insertion of the codeword segment length */
 			for (passno = cblk->numPassesInPacket;
 					passno < nb_passes; ++passno) {
-				auto pass =
-						cblk->passes + cblk->numPassesInPacket + passno;
+				auto pass = cblk->passes + passno;
 				nump++;
 				len += pass->len;
 				if (pass->term
@@ -51,11 +51,12 @@ struct T2Encode : public T2 {
 	 @param tpnum            Tile part number of the current tile
 	 @param tppos            The position of the tile part flag in the progression order
 	 @param pino             packet iterator number
+	 @param markers			 if not null, packet lengths are recorded here
 	 */
 	bool encode_packets(uint16_t tileno, uint32_t maxlayers,
 			BufferedStream *stream, uint32_t *p_data_written,
 			uint32_t tpnum, uint32_t tppos,
-			uint32_t pino);
+			uint32_t pino, PacketLengthMarkers *markers);
 
 	/**
 	 Simulate encoding packets of a tile to a destination buffer
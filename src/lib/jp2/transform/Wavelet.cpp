@@ -38,13 +38,28 @@ bool Wavelet::compress(TileComponent *tile_comp, uint8_t qmfbid){
 }
 
 bool Wavelet::decompress(TileProcessor *p_tcd,  TileComponent* tilec,
-                             uint32_t numres, uint8_t qmfbid){
+                             uint32_t first_res, uint32_t numres, uint8_t qmfbid){
 	if (qmfbid == 1)
-		return decode_53(p_tcd,tilec,numres);
+		return decode_53(p_tcd,tilec,first_res,numres);
 	else if (qmfbid == 0)
-		return decode_97(p_tcd,tilec,numres);
+		return decode_97(p_tcd,tilec,first_res,numres);
 	return false;
 }
 
+bool Wavelet::fits_16_bit(uint32_t precision, uint32_t numresolutions){
+	if (precision == 0 || precision > 16 || numresolutions < 2)
+		return false;
+	// The 5/3 analysis low pass filter has L1 norm 3/2, and the high pass
+	// filter has L1 norm 2. So, for level shifted samples of magnitude
+	// 2^(precision-1), the HH band of the coarsest level, at 4 * (9/4)^(levels-1)
+	// times the sample magnitude, bounds all other bands and all intermediate
+	// samples of the synthesis. Coefficients of truncated code blocks are
+	// reconstructed at up to 3/2 of their value: allow a factor of 2.
+	double bound = (double)(1U << (precision - 1)) * 4.0
+			* pow(2.25, (double)(numresolutions - 2));
+
+	return 2.0 * bound <= (double)INT16_MAX;
+}
+
 }
 
@@ -25,7 +25,15 @@ public:
 	virtual ~Wavelet(){}
 	static bool compress(TileComponent *tile_comp, uint8_t qmfbid);
 	static bool decompress(TileProcessor *p_tcd,  TileComponent* tilec,
-	                             uint32_t numres, uint8_t qmfbid);
+	                             uint32_t first_res, uint32_t numres, uint8_t qmfbid);
+	/**
+	 * Check whether the reversible inverse transform of a tile component
+	 * can run on 16 bit coefficients without overflow
+	 *
+	 * @param precision			precision of transformed samples
+	 * @param numresolutions	number of resolutions of tile component
+	 */
+	static bool fits_16_bit(uint32_t precision, uint32_t numresolutions);
 };
 
 }
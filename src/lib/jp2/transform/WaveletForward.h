@@ -61,6 +61,7 @@ template <typename DWT> bool WaveletForward<DWT>::run(TileComponent *tilec){
 	auto next_res = cur_res - 1;
 
 	auto bj_array = new int32_t*[ThreadPool::get()->num_threads()];
+	MemAccount scratch(GRK_MEM_DWT_SCRATCH);
 	for (uint32_t i = 0; i < ThreadPool::get()->num_threads(); ++i){
 		bj_array[i] = nullptr;
 	}
@@ -70,6 +71,7 @@ template <typename DWT> bool WaveletForward<DWT>::run(TileComponent *tilec){
 			rc = false;
 			goto cleanup;
 		}
+		scratch.add(l_data_size);
 	}
 
 	for (uint32_t decompno = 0; decompno < num_decomps; ++decompno) {
@@ -24,10 +24,11 @@
 #include "grk_includes.h"
 #include "dwt.h"
 #include <algorithm>
+#include <type_traits>
 
 namespace grk {
 
-template <typename T, typename S> struct decode_job{
+template <typename T, typename S, typename D = T> struct decode_job{
 	decode_job( S data,
 				T * GRK_RESTRICT LL,
 				uint32_t sLL,
@@ -37,7 +38,7 @@ template <typename T, typename S> struct decode_job{
 				uint32_t sLH,
 				T * GRK_RESTRICT HH,
 				uint32_t sHH,
-				T * GRK_RESTRICT destination,
+				D * GRK_RESTRICT destination,
 				uint32_t strideDestination,
 				uint32_t min_j,
 				uint32_t max_j) : data(data),
@@ -68,7 +69,7 @@ template <typename T, typename S> struct decode_job{
     uint32_t strideLH;
     T * GRK_RESTRICT bandHH;
     uint32_t strideHH;
-    T * GRK_RESTRICT dest;
+    D * GRK_RESTRICT dest;
     uint32_t strideDest;
 
     uint32_t min_j;
@@ -78,6 +79,8 @@ template <typename T, typename S> struct decode_job{
 
 /** Number of columns that we can process in parallel in the vertical pass */
 #define PLL_COLS_53     (2*VREG_INT_COUNT)
+/** Number of columns of 16 bit coefficients processed in parallel */
+#define PLL_COLS_53_16  (2*PLL_COLS_53)
 template <typename T> struct dwt_data {
 	dwt_data() : mem(nullptr),
 		         dn(0),
@@ -86,7 +89,8 @@ template <typename T> struct dwt_data {
 				 win_l_x0(0),
 				 win_l_x1(0),
 				 win_h_x0(0),
-				 win_h_x1(0)
+				 win_h_x1(0),
+				 m_account(GRK_MEM_DWT_SCRATCH)
 	{}
 
 	dwt_data(const dwt_data& rhs) : mem(nullptr),
@@ -96,7 +100,8 @@ template <typename T> struct dwt_data {
 									win_l_x0 ( rhs.win_l_x0),
 									win_l_x1 ( rhs.win_l_x1),
 									win_h_x0 ( rhs.win_h_x0),
-									win_h_x1 ( rhs.win_h_x1)
+									win_h_x1 ( rhs.win_h_x1),
+									m_account(GRK_MEM_DWT_SCRATCH)
 	{}
 
 	bool alloc(size_t len) {
@@ -116,11 +121,14 @@ template <typename T> struct dwt_data {
 	        return false;
 	    }
 		mem = (T*)grk_aligned_malloc(len * sizeof(T));
+		if (mem)
+			m_account.set(len * sizeof(T));
 		return mem != nullptr;
 	}
 	void release(){
 		grk_aligned_free(mem);
 		mem = nullptr;
+		m_account.set(0);
 	}
     T* mem;
     uint32_t dn;   /* number of elements in high pass band */
@@ -130,6 +138,7 @@ template <typename T> struct dwt_data {
     uint32_t      win_l_x1; /* end coord in low pass band */
     uint32_t      win_h_x0; /* start coord in high pass band */
     uint32_t      win_h_x1; /* end coord in high pass band */
+    MemAccount m_account;
 };
 
 struct  vec4f {
@@ -148,12 +157,12 @@ static const float dwt_delta = -0.443506852f; /*  -3633 */
 static const float K      = 1.230174105f; /*  10078 */
 static const float c13318 = 1.625732422f;
 
-static void  decode_h_cas0_53(int32_t* buf,
-                               int32_t* bandL, /* even */
+template <typename T> static void  decode_h_cas0_53(T* buf,
+                               T* bandL, /* even */
 								const uint32_t wL,
-							   int32_t* bandH,
+							   T* bandH,
 								const uint32_t wH,
-								int32_t *dest){ /* odd */
+								T *dest){ /* odd */
 	const uint32_t total_width = wL + wH;
     assert(total_width > 1);
 
@@ -174,27 +183,27 @@ static void  decode_h_cas0_53(int32_t* buf,
 			s1n = bandL[j];
 			d1n = bandH[j];
 			s0n = s1n - ((d1c + d1n + 2) >> 2);
-			buf[i  ] = s0c;
-			buf[i + 1] = d1c + ((s0c + s0n) >> 1);
+			buf[i  ] = (T)s0c;
+			buf[i + 1] = (T)(d1c + ((s0c + s0n) >> 1));
 		}
     }
 
-    buf[i] = s0n;
+    buf[i] = (T)s0n;
     if (total_width & 1) {
-        buf[total_width - 1] = bandL[(total_width - 1) >> 1] - ((d1n + 1) >> 1);
-        buf[total_width - 2] = d1n + ((s0n + buf[total_width - 1]) >> 1);
+        buf[total_width - 1] = (T)(bandL[(total_width - 1) >> 1] - ((d1n + 1) >> 1));
+        buf[total_width - 2] = (T)(d1n + ((s0n + buf[total_width - 1]) >> 1));
     } else {
-        buf[total_width - 1] = d1n + s0n;
+        buf[total_width - 1] = (T)(d1n + s0n);
     }
-    memcpy(dest, buf, total_width * sizeof(int32_t));
+    memcpy(dest, buf, total_width * sizeof(T));
 }
 
-static void  decode_h_cas1_53(int32_t* buf,
-							   int32_t* bandL, /* odd */
+template <typename T> static void  decode_h_cas1_53(T* buf,
+							   T* bandL, /* odd */
                                const uint32_t wL,
-							   int32_t* bandH,
+							   T* bandH,
                                const uint32_t wH,
-							   int32_t *dest){ /* even */
+							   T *dest){ /* even */
 	const uint32_t total_width = wL + wH;
     assert(total_width > 2);
 
@@ -203,28 +212,28 @@ static void  decode_h_cas1_53(int32_t* buf,
        accesses and explicit interleaving. */
     int32_t s1 = bandH[1];
     int32_t dc = bandL[0] - ((bandH[0] + s1 + 2) >> 2);
-    buf[0] = bandH[0] + dc;
+    buf[0] = (T)(bandH[0] + dc);
     uint32_t i, j;
     for (i = 1, j = 1; i < (total_width - 2 - !(total_width & 1)); i += 2, j++) {
     	int32_t s2 = bandH[j + 1];
     	int32_t dn = bandL[j] - ((s1 + s2 + 2) >> 2);
 
-        buf[i  ] = dc;
-        buf[i + 1] = s1 + ((dn + dc) >> 1);
+        buf[i  ] = (T)dc;
+        buf[i + 1] = (T)(s1 + ((dn + dc) >> 1));
         dc = dn;
         s1 = s2;
     }
 
-    buf[i] = dc;
+    buf[i] = (T)dc;
 
     if (!(total_width & 1)) {
     	int32_t dn = bandL[total_width / 2 - 1] - ((s1 + 1) >> 1);
-        buf[total_width - 2] = s1 + ((dn + dc) >> 1);
-        buf[total_width - 1] = dn;
+        buf[total_width - 2] = (T)(s1 + ((dn + dc) >> 1));
+        buf[total_width - 1] = (T)dn;
     } else {
-        buf[total_width - 1] = s1 + dc;
+        buf[total_width - 1] = (T)(s1 + dc);
     }
-    memcpy(dest, buf, total_width * sizeof(int32_t));
+    memcpy(dest, buf, total_width * sizeof(T));
 }
 
 
@@ -407,6 +416,206 @@ static void decode_v_cas1_mcols_SSE2_OR_AVX2_53(int32_t* buf,
     decode_v_final_memcpy_53(buf, total_height, dest, strideDest);
 }
 
+/* 16 bit lanes: a register holds PLL_COLS_53 coefficients, so that */
+/* two registers cover twice the columns of the 32 bit kernels above */
+#if __AVX2__
+#define LOAD_CST16(x) _mm256_set1_epi16(x)
+#define ADD16(x,y)    _mm256_add_epi16((x),(y))
+#define SUB16(x,y)    _mm256_sub_epi16((x),(y))
+#define SAR16(x,y)    _mm256_srai_epi16((x),(y))
+#define AND16(x,y)    _mm256_and_si256((x),(y))
+#else
+#define LOAD_CST16(x) _mm_set1_epi16(x)
+#define ADD16(x,y)    _mm_add_epi16((x),(y))
+#define SUB16(x,y)    _mm_sub_epi16((x),(y))
+#define SAR16(x,y)    _mm_srai_epi16((x),(y))
+#define AND16(x,y)    _mm_and_si128((x),(y))
+#endif
+/* (x + y) >> 1, without overflowing 16 bits */
+#define AVG16(x,y)    ADD16(ADD16(SAR16(x,1),SAR16(y,1)),AND16(AND16(x,y),one))
+/* (x + y + 2) >> 2, without overflowing 16 bits */
+#define AVG16_2(x,y)  SAR16(ADD16(AVG16(x,y),one),1)
+
+static
+void decode_v_final_memcpy_53( const int16_t* buf,
+							const uint32_t height,
+							int16_t* dest,
+							const size_t strideDest){
+	for (uint32_t i = 0; i < height; ++i) {
+        STOREU(&dest[(size_t)i * strideDest + 0],           LOAD(&buf[PLL_COLS_53_16 * i + 0]));
+        STOREU(&dest[(size_t)i * strideDest + PLL_COLS_53], LOAD(&buf[PLL_COLS_53_16 * i + PLL_COLS_53]));
+	}
+}
+
+/* widen to 32 bits when the last synthesis level is written to the tile buffer */
+static
+void decode_v_final_memcpy_53( const int16_t* buf,
+							const uint32_t height,
+							int32_t* dest,
+							const size_t strideDest){
+	for (uint32_t i = 0; i < height; ++i) {
+		for (uint32_t k = 0; k < 2; ++k) {
+			VREG v = LOAD(&buf[PLL_COLS_53_16 * i + k * PLL_COLS_53]);
+			auto d = dest + (size_t)i * strideDest + k * PLL_COLS_53;
+#if __AVX2__
+			STOREU(d, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+			STOREU(d + VREG_INT_COUNT, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v,1)));
+#else
+			STOREU(d, _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+			STOREU(d + VREG_INT_COUNT, _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+#endif
+		}
+    }
+}
+
+/** Vertical inverse 5x3 wavelet transform for 16 columns in SSE2, or
+ * 32 in AVX2, of 16 bit coefficients, when top-most pixel is on even coordinate */
+template <typename D> static void decode_v_cas0_mcols_SSE2_OR_AVX2_53(int16_t* buf,
+												int16_t* bandL, /* even */
+												const uint32_t hL,
+												const size_t strideL,
+												int16_t *bandH, /* odd */
+												const uint32_t hH,
+												const size_t strideH,
+												D *dest,
+												const uint32_t strideDest){
+    const VREG one = LOAD_CST16(1);
+    const uint32_t cols = PLL_COLS_53_16;
+
+	const uint32_t total_height = hL + hH;
+    assert(total_height > 1);
+    assert((size_t)buf % (sizeof(int32_t) * VREG_INT_COUNT) == 0);
+
+    VREG s1n_0 = LOADU(bandL);
+    VREG s1n_1 = LOADU(bandL + PLL_COLS_53);
+    VREG d1n_0 = LOADU(bandH);
+    VREG d1n_1 = LOADU(bandH + PLL_COLS_53);
+    /* s0n = s1n - ((d1n + 1) >> 1); */
+    VREG s0n_0 = SUB16(s1n_0, SAR16(ADD16(d1n_0, one), 1));
+    VREG s0n_1 = SUB16(s1n_1, SAR16(ADD16(d1n_1, one), 1));
+
+    uint32_t i = 0;
+    if (total_height > 3) {
+        uint32_t j;
+		for (i = 0, j = 1; i < (total_height - 3); i += 2, j++) {
+			VREG d1c_0 = d1n_0;
+			VREG s0c_0 = s0n_0;
+			VREG d1c_1 = d1n_1;
+			VREG s0c_1 = s0n_1;
+
+			s1n_0 = LOADU(bandL + j * strideL);
+			s1n_1 = LOADU(bandL + j * strideL + PLL_COLS_53);
+			d1n_0 = LOADU(bandH + j * strideH);
+			d1n_1 = LOADU(bandH + j * strideH + PLL_COLS_53);
+
+			/*s0n = s1n - ((d1c + d1n + 2) >> 2);*/
+			s0n_0 = SUB16(s1n_0, AVG16_2(d1c_0, d1n_0));
+			s0n_1 = SUB16(s1n_1, AVG16_2(d1c_1, d1n_1));
+
+			STORE(buf + cols * (i + 0), s0c_0);
+			STORE(buf + cols * (i + 0) + PLL_COLS_53, s0c_1);
+
+			/* d1c + ((s0c + s0n) >> 1) */
+			STORE(buf + cols * (i + 1), ADD16(d1c_0, AVG16(s0c_0, s0n_0)));
+			STORE(buf + cols * (i + 1) + PLL_COLS_53, ADD16(d1c_1, AVG16(s0c_1, s0n_1)));
+		}
+    }
+    STORE(buf + cols * i, s0n_0);
+    STORE(buf + cols * i + PLL_COLS_53, s0n_1);
+
+    if (total_height & 1) {
+        s1n_0 = LOADU(bandL + (size_t)((total_height - 1) / 2) * strideL);
+        s1n_1 = LOADU(bandL + (size_t)((total_height - 1) / 2) * strideL + PLL_COLS_53);
+        /* tmp_len_minus_1 = s1n - ((d1n + 1) >> 1); */
+        VREG tmp_len_minus_1_0 = SUB16(s1n_0, SAR16(ADD16(d1n_0, one), 1));
+        VREG tmp_len_minus_1_1 = SUB16(s1n_1, SAR16(ADD16(d1n_1, one), 1));
+        STORE(buf + cols * (total_height - 1), tmp_len_minus_1_0);
+        STORE(buf + cols * (total_height - 1) + PLL_COLS_53, tmp_len_minus_1_1);
+        /* d1n + ((s0n + tmp_len_minus_1) >> 1) */
+        STORE(buf + cols * (total_height - 2), ADD16(d1n_0, AVG16(s0n_0, tmp_len_minus_1_0)));
+        STORE(buf + cols * (total_height - 2) + PLL_COLS_53, ADD16(d1n_1, AVG16(s0n_1, tmp_len_minus_1_1)));
+    } else {
+        STORE(buf + cols * (total_height - 1), ADD16(d1n_0, s0n_0));
+        STORE(buf + cols * (total_height - 1) + PLL_COLS_53, ADD16(d1n_1, s0n_1));
+    }
+    decode_v_final_memcpy_53(buf,total_height, dest, strideDest);
+}
+
+/** Vertical inverse 5x3 wavelet transform for 16 columns in SSE2, or
+ * 32 in AVX2, of 16 bit coefficients, when top-most pixel is on odd coordinate */
+template <typename D> static void decode_v_cas1_mcols_SSE2_OR_AVX2_53(int16_t* buf,
+												int16_t* bandL,
+												const uint32_t hL,
+												const uint32_t strideL,
+												int16_t *bandH,
+												const uint32_t hH,
+												const uint32_t strideH,
+												D *dest,
+												const uint32_t strideDest){
+    const VREG one = LOAD_CST16(1);
+    const uint32_t cols = PLL_COLS_53_16;
+
+    const uint32_t total_height = hL + hH;
+    assert(total_height > 2);
+    assert((size_t)buf % (sizeof(int32_t) * VREG_INT_COUNT) == 0);
+
+    const int16_t* in_even = bandH;
+    const int16_t* in_odd = bandL;
+    VREG s1_0 = LOADU(in_even + strideH);
+    VREG s1_1 = LOADU(in_even + strideH + PLL_COLS_53);
+    /* in_odd[0] - ((in_even[0] + s1 + 2) >> 2); */
+    VREG dc_0 = SUB16(LOADU(in_odd), AVG16_2(LOADU(in_even), s1_0));
+    VREG dc_1 = SUB16(LOADU(in_odd + PLL_COLS_53), AVG16_2(LOADU(in_even + PLL_COLS_53), s1_1));
+    STORE(buf, ADD16(LOADU(in_even), dc_0));
+    STORE(buf + PLL_COLS_53, ADD16(LOADU(in_even + PLL_COLS_53), dc_1));
+
+    uint32_t i;
+    size_t j;
+    for (i = 1, j = 1; i < (total_height - 2 - !(total_height & 1)); i += 2, j++) {
+    	VREG s2_0 = LOADU(in_even + (j + 1) * strideH);
+    	VREG s2_1 = LOADU(in_even + (j + 1) * strideH + PLL_COLS_53);
+        /* dn = in_odd[j * stride] - ((s1 + s2 + 2) >> 2); */
+    	VREG dn_0 = SUB16(LOADU(in_odd + j * strideL), AVG16_2(s1_0, s2_0));
+    	VREG dn_1 = SUB16(LOADU(in_odd + j * strideL + PLL_COLS_53), AVG16_2(s1_1, s2_1));
+
+        STORE(buf + cols * i, dc_0);
+        STORE(buf + cols * i + PLL_COLS_53, dc_1);
+        /* buf[i + 1] = s1 + ((dn + dc) >> 1); */
+        STORE(buf + cols * (i + 1), ADD16(s1_0, AVG16(dn_0, dc_0)));
+        STORE(buf + cols * (i + 1) + PLL_COLS_53, ADD16(s1_1, AVG16(dn_1, dc_1)));
+
+        dc_0 = dn_0;
+        s1_0 = s2_0;
+        dc_1 = dn_1;
+        s1_1 = s2_1;
+    }
+    STORE(buf + cols * i, dc_0);
+    STORE(buf + cols * i + PLL_COLS_53, dc_1);
+
+    if (!(total_height & 1)) {
+        /*dn = in_odd[(len / 2 - 1) * stride] - ((s1 + 1) >> 1); */
+    	VREG dn_0 = SUB16(LOADU(in_odd + (size_t)(total_height / 2 - 1) * strideL), SAR16(ADD16(s1_0, one), 1));
+    	VREG dn_1 = SUB16(LOADU(in_odd + (size_t)(total_height / 2 - 1) * strideL + PLL_COLS_53), SAR16(ADD16(s1_1, one), 1));
+        /* buf[len - 2] = s1 + ((dn + dc) >> 1); */
+        STORE(buf + cols * (total_height - 2), ADD16(s1_0, AVG16(dn_0, dc_0)));
+        STORE(buf + cols * (total_height - 2) + PLL_COLS_53, ADD16(s1_1, AVG16(dn_1, dc_1)));
+        STORE(buf + cols * (total_height - 1), dn_0);
+        STORE(buf + cols * (total_height - 1) + PLL_COLS_53, dn_1);
+    } else {
+        STORE(buf + cols * (total_height - 1), ADD16(s1_0, dc_0));
+        STORE(buf + cols * (total_height - 1) + PLL_COLS_53, ADD16(s1_1, dc_1));
+    }
+    decode_v_final_memcpy_53(buf, total_height, dest, strideDest);
+}
+
+#undef LOAD_CST16
+#undef ADD16
+#undef SUB16
+#undef SAR16
+#undef AND16
+#undef AVG16
+#undef AVG16_2
+
 #undef VREG
 #undef LOAD_CST
 #undef LOADU
@@ -422,14 +631,14 @@ static void decode_v_cas1_mcols_SSE2_OR_AVX2_53(int32_t* buf,
 
 /** Vertical inverse 5x3 wavelet transform for one column, when top-most
  * pixel is on even coordinate */
-static void decode_v_cas0_53(int32_t* buf,
-                             int32_t* bandL,
+template <typename T, typename D> static void decode_v_cas0_53(T* buf,
+                             T* bandL,
 							 const uint32_t hL,
 							 const uint32_t strideL,
-							 int32_t *bandH,
+							 T *bandH,
 							 const uint32_t hH,
                              const uint32_t strideH,
-							 int32_t *dest,
+							 D *dest,
 							 const uint32_t strideDest){
 
     const uint32_t total_height = hL + hH;
@@ -453,18 +662,18 @@ static void decode_v_cas0_53(int32_t* buf,
 			d1n = *bH;
 			bH += strideH;
 			s0n = s1n - ((d1c + d1n + 2) >> 2);
-			buf[i  ] = s0c;
-			buf[i + 1] = d1c + ((s0c + s0n) >> 1);
+			buf[i  ] = (T)s0c;
+			buf[i + 1] = (T)(d1c + ((s0c + s0n) >> 1));
 		}
     }
-    buf[i] = s0n;
+    buf[i] = (T)s0n;
     if (total_height & 1) {
-        buf[total_height - 1] =
+        buf[total_height - 1] = (T)(
             bandL[((total_height - 1) / 2) * strideL] -
-            ((d1n + 1) >> 1);
-        buf[total_height - 2] = d1n + ((s0n + buf[total_height - 1]) >> 1);
+            ((d1n + 1) >> 1));
+        buf[total_height - 2] = (T)(d1n + ((s0n + buf[total_height - 1]) >> 1));
     } else {
-        buf[total_height - 1] = d1n + s0n;
+        buf[total_height - 1] = (T)(d1n + s0n);
     }
     for (i = 0; i < total_height; ++i) {
         *dest = buf[i];
@@ -474,14 +683,14 @@ static void decode_v_cas0_53(int32_t* buf,
 
 /** Vertical inverse 5x3 wavelet transform for one column, when top-most
  * pixel is on odd coordinate */
-static void decode_v_cas1_53(int32_t* buf,
-                             int32_t *bandL,
+template <typename T, typename D> static void decode_v_cas1_53(T* buf,
+                             T *bandL,
 							 const uint32_t hL,
 							 const uint32_t strideL,
-							 int32_t *bandH,
+							 T *bandH,
 							 const uint32_t hH,
                              const uint32_t strideH,
-							int32_t *dest,
+							D *dest,
 							const uint32_t strideDest){
 
     const uint32_t total_height = hL + hH;
@@ -491,7 +700,7 @@ static void decode_v_cas1_53(int32_t* buf,
     /* accesses and explicit interleaving. */
     int32_t s1 = bandH[strideH];
     int32_t dc = bandL[0] - ((bandH[0] + s1 + 2) >> 2);
-    buf[0] = bandH[0] + dc;
+    buf[0] = (T)(bandH[0] + dc);
     auto s2_ptr = bandH + (strideH << 1);
     auto dn_ptr = bandL + strideL;
     uint32_t i, j;
@@ -502,18 +711,18 @@ static void decode_v_cas1_53(int32_t* buf,
     	int32_t dn = *dn_ptr - ((s1 + s2 + 2) >> 2);
     	dn_ptr += strideL;
 
-        buf[i  ] = dc;
-        buf[i + 1] = s1 + ((dn + dc) >> 1);
+        buf[i  ] = (T)dc;
+        buf[i + 1] = (T)(s1 + ((dn + dc) >> 1));
         dc = dn;
         s1 = s2;
     }
-    buf[i] = dc;
+    buf[i] = (T)dc;
     if (!(total_height & 1)) {
     	int32_t dn = bandL[((total_height>>1) - 1) * strideL] - ((s1 + 1) >> 1);
-        buf[total_height - 2] = s1 + ((dn + dc) >> 1);
-        buf[total_height - 1] = dn;
+        buf[total_height - 2] = (T)(s1 + ((dn + dc) >> 1));
+        buf[total_height - 1] = (T)dn;
     } else {
-        buf[total_height - 1] = s1 + dc;
+        buf[total_height - 1] = (T)(s1 + dc);
     }
     for (i = 0; i < total_height; ++i) {
         *dest = buf[i];
@@ -525,10 +734,10 @@ static void decode_v_cas1_53(int32_t* buf,
 /* Inverse 5-3 wavelet transform in 1-D for one row. */
 /* </summary>                           */
 /* Performs interleave, inverse wavelet transform and copy back to buffer */
-static void decode_h_53(const dwt_data<int32_t> *dwt,
-                         int32_t *bandL,
-						 int32_t *bandH,
-						 int32_t *dest)
+template <typename T> static void decode_h_53(const dwt_data<T> *dwt,
+                         T *bandL,
+						 T *bandH,
+						 T *dest)
 {
     const uint32_t total_width = dwt->sn + dwt->dn;
     if (dwt->cas == 0) { /* Left-most sample is on even coordinate */
@@ -541,10 +750,10 @@ static void decode_h_53(const dwt_data<int32_t> *dwt,
     } else { /* Left-most sample is on odd coordinate */
         if (total_width == 1) {
         	//FIXME - validate this calculation
-        	dest[0] = bandH[0]/2;
+        	dest[0] = (T)(bandH[0]/2);
         } else if (total_width == 2) {
-            dwt->mem[1] = bandL[0] - ((bandH[0] + 1) >> 1);
-            dest[0] = bandH[0] + dwt->mem[1];
+            dwt->mem[1] = (T)(bandL[0] - ((bandH[0] + 1) >> 1));
+            dest[0] = (T)(bandH[0] + dwt->mem[1]);
             dest[1] = dwt->mem[1];
         } else if (total_width > 2) {
             decode_h_cas1_53(dwt->mem, bandL, dwt->sn, bandH,dwt->dn, dest);
@@ -556,16 +765,18 @@ static void decode_h_53(const dwt_data<int32_t> *dwt,
 /* Inverse vertical 5-3 wavelet transform in 1-D for several columns. */
 /* </summary>                           */
 /* Performs interleave, inverse wavelet transform and copy back to buffer */
-static void decode_v_53(const dwt_data<int32_t> *dwt,
-                         int32_t *bandL,
+template <typename T, typename D> static void decode_v_53(const dwt_data<T> *dwt,
+                         T *bandL,
 						 const uint32_t strideL,
-						 int32_t *bandH,
+						 T *bandH,
 						 const uint32_t strideH,
-						 int32_t *dest,
+						 D *dest,
 						 const uint32_t strideDest,
                          uint32_t nb_cols){
     const uint32_t sn = dwt->sn;
     const uint32_t len = sn + dwt->dn;
+    const uint32_t pll_cols = sizeof(T) == sizeof(int16_t) ? PLL_COLS_53_16 : PLL_COLS_53;
+    GRK_UNUSED(pll_cols);
     if (dwt->cas == 0) {
         if (len == 1) {
             for (uint32_t c = 0; c < nb_cols; c++, bandL++,dest++)
@@ -574,7 +785,7 @@ static void decode_v_53(const dwt_data<int32_t> *dwt,
         }
     	if (CPUArch::SSE2() || CPUArch::AVX2() ) {
 #if (defined(__SSE2__) || defined(__AVX2__))
-			if (len > 1 && nb_cols == PLL_COLS_53) {
+			if (len > 1 && nb_cols == pll_cols) {
 				/* Same as below general case, except that thanks to SSE2/AVX2 */
 				/* we can efficiently process 8/16 columns in parallel */
 				decode_v_cas0_mcols_SSE2_OR_AVX2_53(dwt->mem, bandL,sn, strideL, bandH, dwt->dn, strideH, dest, strideDest);
@@ -590,21 +801,21 @@ static void decode_v_53(const dwt_data<int32_t> *dwt,
     } else {
         if (len == 1) {
             for (uint32_t c = 0; c < nb_cols; c++, bandL++,dest++)
-                dest[0] = bandL[0] >> 1;
+                dest[0] = (D)(bandL[0] >> 1);
             return;
         }
         else if (len == 2) {
             auto out = dwt->mem;
             for (uint32_t c = 0; c < nb_cols; c++, bandL++,bandH++,dest++) {
-                out[1] = bandL[0] - ((bandH[0] + 1) >> 1);
-                dest[0] = bandH[0] + out[1];
+                out[1] = (T)(bandL[0] - ((bandH[0] + 1) >> 1));
+                dest[0] = (D)(bandH[0] + out[1]);
                 dest[1] = out[1];
             }
             return;
         }
         if (CPUArch::SSE2() || CPUArch::AVX2() ) {
 #if (defined(__SSE2__) || defined(__AVX2__))
-			if (nb_cols == PLL_COLS_53) {
+			if (nb_cols == pll_cols) {
 				/* Same as below general case, except that thanks to SSE2/AVX2 */
 				/* we can efficiently process 8/16 columns in parallel */
 				decode_v_cas1_mcols_SSE2_OR_AVX2_53(dwt->mem, bandL,sn, strideL,bandH,dwt->dn, strideH, dest, strideDest);
@@ -617,14 +828,14 @@ static void decode_v_53(const dwt_data<int32_t> *dwt,
     }
 }
 
-static void decode_h_strip_53(const dwt_data<int32_t> *horiz,
+template <typename T> static void decode_h_strip_53(const dwt_data<T> *horiz,
 						 uint32_t hMin,
 						 uint32_t hMax,
-                         int32_t *bandL,
+                         T *bandL,
 						 const uint32_t strideL,
-						 int32_t *bandH,
+						 T *bandH,
 						 const uint32_t strideH,
-						 int32_t *dest,
+						 T *dest,
 						 const uint32_t strideDest) {
     for (uint32_t j = hMin; j < hMax; ++j){
         decode_h_53(horiz, bandL, bandH, dest);
@@ -634,16 +845,16 @@ static void decode_h_strip_53(const dwt_data<int32_t> *horiz,
     }
 }
 
-static bool decode_h_mt_53(uint32_t num_threads,
+template <typename T> static bool decode_h_mt_53(uint32_t num_threads,
 						size_t data_size,
-						 dwt_data<int32_t> &horiz,
-		 	 	 	 	 dwt_data<int32_t> &vert,
+						 dwt_data<T> &horiz,
+		 	 	 	 	 dwt_data<T> &vert,
 						 uint32_t rh,
-                         int32_t *bandL,
+                         T *bandL,
 						 const uint32_t strideL,
-						 int32_t *bandH,
+						 T *bandH,
 						 const uint32_t strideH,
-						 int32_t *dest,
+						 T *dest,
 						 const uint32_t strideDest) {
     if (num_threads == 1 || rh <= 1) {
     	if (!horiz.mem){
@@ -662,7 +873,7 @@ static bool decode_h_mt_53(uint32_t num_threads,
 		std::vector< std::future<int> > results;
 		for(uint32_t j = 0; j < num_jobs; ++j) {
 		   auto min_j = j * step_j;
-           auto job = new decode_job<int32_t, dwt_data<int32_t>>(horiz,
+           auto job = new decode_job<T, dwt_data<T>>(horiz,
 										bandL + min_j * strideL,
 										strideL,
 										bandH + min_j * strideH,
@@ -701,38 +912,39 @@ static bool decode_h_mt_53(uint32_t num_threads,
     return true;
 }
 
-static void decode_v_strip_53(const dwt_data<int32_t> *vert,
+template <typename T, typename D> static void decode_v_strip_53(const dwt_data<T> *vert,
 						 uint32_t wMin,
 						 uint32_t wMax,
-                         int32_t *bandL,
+                         T *bandL,
 						 const uint32_t strideL,
-						 int32_t *bandH,
+						 T *bandH,
 						 const uint32_t strideH,
-						 int32_t *dest,
+						 D *dest,
 						 const uint32_t strideDest) {
 
 
+    const uint32_t pll_cols = sizeof(T) == sizeof(int16_t) ? PLL_COLS_53_16 : PLL_COLS_53;
     uint32_t j;
-    for (j = wMin; j + PLL_COLS_53 <= wMax; j += PLL_COLS_53){
-        decode_v_53(vert, bandL, strideL, bandH, strideH,dest, strideDest, PLL_COLS_53);
-		bandL += PLL_COLS_53;
-		bandH += PLL_COLS_53;
-		dest  += PLL_COLS_53;
+    for (j = wMin; j + pll_cols <= wMax; j += pll_cols){
+        decode_v_53(vert, bandL, strideL, bandH, strideH,dest, strideDest, pll_cols);
+		bandL += pll_cols;
+		bandH += pll_cols;
+		dest  += pll_cols;
     }
     if (j < wMax)
         decode_v_53(vert, bandL, strideL, bandH, strideH, dest, strideDest, wMax - j);
 }
 
-static bool decode_v_mt_53(uint32_t num_threads,
+template <typename T, typename D> static bool decode_v_mt_53(uint32_t num_threads,
 						size_t data_size,
-						 dwt_data<int32_t> &horiz,
-		 	 	 	 	 dwt_data<int32_t> &vert,
+						 dwt_data<T> &horiz,
+		 	 	 	 	 dwt_data<T> &vert,
 						 uint32_t rw,
-                         int32_t *bandL,
+                         T *bandL,
 						 const uint32_t strideL,
-						 int32_t *bandH,
+						 T *bandH,
 						 const uint32_t strideH,
-						 int32_t *dest,
+						 D *dest,
 						 const uint32_t strideDest) {
     if (num_threads == 1 || rw <= 1) {
     	if (!horiz.mem){
@@ -751,7 +963,7 @@ static bool decode_v_mt_53(uint32_t num_threads,
 		std::vector< std::future<int> > results;
         for (uint32_t j = 0; j < num_jobs; j++) {
 			    auto min_j = j * step_j;
-            auto job = new decode_job<int32_t, dwt_data<int32_t>>(vert,
+            auto job = new decode_job<T, dwt_data<T>, D>(vert,
 										bandL + min_j,
 										strideL,
 										nullptr,
@@ -796,16 +1008,21 @@ static bool decode_v_mt_53(uint32_t num_threads,
 /* <summary>                            */
 /* Inverse wavelet transform in 2-D.    */
 /* </summary>                           */
-static bool decode_tile_53( TileComponent* tilec, uint32_t numres){
-    if (numres == 1U)
+/* Synthesis levels run on the coefficients of buf, and the last level */
+/* writes the reconstructed samples to the 32 bit tile buffer */
+template <typename T> static bool decode_tile_53( TileComponent* tilec,
+												TileComponentBuffer<T> *buf,
+												uint32_t first_res,
+												uint32_t numres){
+    if (numres <= first_res)
         return true;
 
-    auto tr = tilec->resolutions;
+    auto tr = tilec->resolutions + first_res - 1;
     uint32_t rw = tr->width();
     uint32_t rh = tr->height();
 
     uint32_t num_threads = (uint32_t)ThreadPool::get()->num_threads();
-    size_t data_size = dwt_utils::max_resolution(tr, numres);
+    size_t data_size = dwt_utils::max_resolution(tilec->resolutions, numres);
     /* overflow check */
     if (data_size > (SIZE_MAX / PLL_COLS_53 / sizeof(int32_t))) {
         GRK_ERROR("Overflow");
@@ -814,11 +1031,11 @@ static bool decode_tile_53( TileComponent* tilec, uint32_t numres){
     /* We need PLL_COLS_53 times the height of the array, */
     /* since for the vertical pass */
     /* we process PLL_COLS_53 columns at a time */
-    dwt_data<int32_t> horiz;
-    dwt_data<int32_t> vert;
+    dwt_data<T> horiz;
+    dwt_data<T> vert;
     data_size *= PLL_COLS_53 * sizeof(int32_t);
     bool rc = true;
-    for (uint32_t res = 1; res < numres; ++res){
+    for (uint32_t res = first_res; res < numres; ++res){
         horiz.sn = rw;
         vert.sn = rh;
         ++tr;
@@ -833,39 +1050,54 @@ static bool decode_tile_53( TileComponent* tilec, uint32_t numres){
 							horiz,
 							vert,
 							vert.sn,
-							tilec->buf->ptr(res-1),
-							tilec->buf->stride(res-1),
-							tilec->buf->ptr(res, 0),
-							tilec->buf->stride(res,0),
-							tilec->buf->ptr(res),
-							tilec->buf->stride(res)))
+							buf->ptr(res-1),
+							buf->stride(res-1),
+							buf->ptr(res, 0),
+							buf->stride(res,0),
+							buf->ptr(res),
+							buf->stride(res)))
     		return false;
     	if (!decode_h_mt_53(num_threads,
     						data_size,
 							horiz,
 							vert,
 							rh -  vert.sn,
-							tilec->buf->ptr(res, 1),
-							tilec->buf->stride(res,1),
-							tilec->buf->ptr(res, 2),
-							tilec->buf->stride(res,2),
-    						tilec->buf->ptr(res) + vert.sn *tilec->buf->stride(res) ,
-    						tilec->buf->stride(res) ))
+							buf->ptr(res, 1),
+							buf->stride(res,1),
+							buf->ptr(res, 2),
+							buf->stride(res,2),
+    						buf->ptr(res) + vert.sn *buf->stride(res) ,
+    						buf->stride(res) ))
     		return false;
         vert.dn = rh - vert.sn;
         vert.cas = tr->y0 & 1;
-    	if (!decode_v_mt_53(num_threads,
-    						data_size,
-							horiz,
-							vert,
-							rw,
-							tilec->buf->ptr(res),
-							tilec->buf->stride(res),
-							tilec->buf->ptr(res)+ vert.sn *tilec->buf->stride(res) ,
-							tilec->buf->stride(res),
-							tilec->buf->ptr(res),
-							tilec->buf->stride(res)))
-    		return false;
+        if (std::is_same<T, int32_t>::value || res + 1 < numres) {
+			if (!decode_v_mt_53(num_threads,
+								data_size,
+								horiz,
+								vert,
+								rw,
+								buf->ptr(res),
+								buf->stride(res),
+								buf->ptr(res)+ vert.sn *buf->stride(res) ,
+								buf->stride(res),
+								buf->ptr(res),
+								buf->stride(res)))
+				return false;
+        } else {
+			if (!decode_v_mt_53(num_threads,
+								data_size,
+								horiz,
+								vert,
+								rw,
+								buf->ptr(res),
+								buf->stride(res),
+								buf->ptr(res)+ vert.sn *buf->stride(res) ,
+								buf->stride(res),
+								tilec->buf->ptr(res),
+								tilec->buf->stride(res)))
+				return false;
+        }
     }
     horiz.release();
     return rc;
@@ -1352,15 +1584,15 @@ static bool decode_v_mt_97(uint32_t num_threads,
 /* Inverse 9-7 wavelet transform in 2-D. */
 /* </summary>                            */
 static
-bool decode_tile_97(TileComponent* GRK_RESTRICT tilec,uint32_t numres){
-    if (numres == 1U)
+bool decode_tile_97(TileComponent* GRK_RESTRICT tilec,uint32_t first_res, uint32_t numres){
+    if (numres <= first_res)
         return true;
 
-    auto tr = tilec->resolutions;
+    auto tr = tilec->resolutions + first_res - 1;
     uint32_t rw = tr->width();
     uint32_t rh = tr->height();
 
-    size_t data_size = dwt_utils::max_resolution(tr, numres);
+    size_t data_size = dwt_utils::max_resolution(tilec->resolutions, numres);
     dwt_data<vec4f> horiz;
     dwt_data<vec4f> vert;
     if (!horiz.alloc(data_size)) {
@@ -1369,7 +1601,7 @@ bool decode_tile_97(TileComponent* GRK_RESTRICT tilec,uint32_t numres){
     }
     vert.mem = horiz.mem;
     uint32_t num_threads = (uint32_t)ThreadPool::get()->num_threads();
-    for (uint32_t res = 1; res < numres; ++res) {
+    for (uint32_t res = first_res; res < numres; ++res) {
         horiz.sn = rw;
         vert.sn = rh;
         ++tr;
@@ -2151,19 +2383,20 @@ assert(ret);
 /* Inverse 5-3 wavelet transform in 2-D. */
 /* </summary>                           */
 bool decode_53(TileProcessor *p_tcd, TileComponent* tilec,
-                        uint32_t numres)
+                        uint32_t first_res, uint32_t numres)
 {
     if (p_tcd->whole_tile_decoding)
-        return decode_tile_53(tilec,numres);
+        return tilec->buf16 ? decode_tile_53(tilec, tilec->buf16, first_res, numres) :
+        		decode_tile_53(tilec, tilec->buf, first_res, numres);
     else
         return decode_partial_tile<int32_t, 1, 4,2, Partial53>(tilec, numres, tilec->m_sa);
 }
 
 bool decode_97(TileProcessor *p_tcd,
                 TileComponent* GRK_RESTRICT tilec,
-                uint32_t numres){
+                uint32_t first_res, uint32_t numres){
     if (p_tcd->whole_tile_decoding)
-        return decode_tile_97(tilec, numres);
+        return decode_tile_97(tilec, first_res, numres);
     else
         return decode_partial_tile<vec4f,4,4,4, Partial97>(tilec, numres, tilec->m_sa);
 }
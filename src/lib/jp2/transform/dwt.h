@@ -28,10 +28,13 @@ Inverse 5-3 wavelet transform in 2-D.
 Apply a reversible inverse DWT transform to a component of an image.
 @param p_tcd TCD handle
 @param tilec Tile component information (current tile)
+@param first_res First resolution level to synthesize: lower levels
+are already reconstructed in the tile buffer (whole tile decoding only)
 @param numres Number of resolution levels to decompress
 */
 bool decode_53(TileProcessor *p_tcd,
                         TileComponent* GRK_RESTRICT tilec,
+                        uint32_t first_res,
                         uint32_t numres);
 
 /**
@@ -39,10 +42,13 @@ Inverse 9-7 wavelet transform in 2-D.
 Apply an irreversible inverse DWT transform to a component of an image.
 @param p_tcd TCD handle
 @param tilec Tile component information (current tile)
+@param first_res First resolution level to synthesize: lower levels
+are already reconstructed in the tile buffer (whole tile decoding only)
 @param numres Number of resolution levels to decompress
 */
 bool decode_97(TileProcessor *p_tcd,
                              TileComponent* GRK_RESTRICT tilec,
+							 uint32_t first_res,
 							 uint32_t numres);
 
 }
@@ -58,32 +58,121 @@ using namespace std;
 
 namespace grk {
 
+// largest block, in int32_t elements
+const uint64_t sparse_max_block_size = (uint64_t)1 << 28;
+
+sparse_array::sparse_array() : width(0),
+								height(0),
+								m_num_blocks(0),
+								m_blocks_capacity(0),
+								m_block_size(0),
+								m_num_allocated(0),
+								m_num_published(0),
+								m_account(GRK_MEM_SPARSE_ARRAYS)
+{
+}
 
 sparse_array::sparse_array(uint32_t width,
 							uint32_t height,
 							uint32_t block_width,
-							uint32_t block_height) :
-									width(width),
-									height(height),
-									block_width(block_width),
-									block_height(block_height)
+							uint32_t block_height) : sparse_array()
 {
-    if (width == 0 || height == 0 || block_width == 0 || block_height == 0)
-    	throw std::runtime_error("invalid region for sparse array");
-    block_count_hor = ceildiv<uint32_t>(width, block_width);
-    block_count_ver = ceildiv<uint32_t>(height, block_height);
-    data_blocks = (int32_t**) grk_calloc((uint64_t)block_count_hor * block_count_ver,sizeof(int32_t*));
-    if (data_blocks == NULL) {
-    	GRK_ERROR("Out of memory");
-    	throw new std::exception();
-    }
+	sparse_level level = {width, height, block_width, block_height};
+	if (!init(&level, 1))
+		throw std::runtime_error("invalid region for sparse array");
 }
 
 sparse_array::~sparse_array()
 {
-	for (uint64_t i = 0; i < (uint64_t)block_count_hor * block_count_ver; i++)
-		grk_free(data_blocks[i]);
-	grk_free(data_blocks);
+	free_blocks();
+}
+
+void sparse_array::free_blocks(void){
+	for (uint64_t i = 0; i < m_num_blocks; i++) {
+		grk_free(m_blocks[i].load(std::memory_order_relaxed));
+		m_blocks[i].store(nullptr, std::memory_order_relaxed);
+	}
+	for (auto b : m_pool)
+		grk_free(b);
+	m_pool.clear();
+	m_num_allocated = 0;
+	m_num_published = 0;
+}
+
+void sparse_array::update_account(void){
+	m_account.set((size_t)((m_num_allocated + m_num_published) * m_block_size * sizeof(int32_t)
+					+ m_blocks_capacity * (sizeof(int32_t*) + sizeof(uint32_t))
+					+ m_snapshot.capacity() * sizeof(int32_t)
+					+ m_snapshot_blocks.capacity() * sizeof(uint64_t)));
+}
+
+bool sparse_array::init(const sparse_level *levels, uint32_t num_levels){
+	// lower levels may be empty, but the array may not
+	if (!levels || !num_levels || !levels[num_levels - 1].width ||
+			!levels[num_levels - 1].height)
+		return false;
+	uint64_t block_size = 0;
+	uint64_t num_blocks = 0;
+	for (uint32_t i = 0; i < num_levels; ++i) {
+		auto level = levels + i;
+		if (level->block_width == 0 || level->block_height == 0)
+			return false;
+		// levels are nested
+		if (i && (level->width < levels[i-1].width || level->height < levels[i-1].height))
+			return false;
+		uint64_t size = (uint64_t)level->block_width * level->block_height;
+		if (size > sparse_max_block_size)
+			return false;
+		block_size = max<uint64_t>(block_size, size);
+		num_blocks += (uint64_t)ceildiv<uint32_t>(level->width, level->block_width) *
+						ceildiv<uint32_t>(level->height, level->block_height);
+	}
+
+	// return blocks of previous use to the pool
+	m_num_allocated += m_num_published.exchange(0);
+	for (uint64_t i = 0; i < m_num_blocks; i++) {
+		auto block = m_blocks[i].load(std::memory_order_relaxed);
+		if (block) {
+			m_pool.push_back(block);
+			m_blocks[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+	if (block_size > m_block_size) {
+		free_blocks();
+		m_block_size = (size_t)block_size;
+	}
+	if (num_blocks > m_blocks_capacity) {
+		m_blocks.reset(new (std::nothrow) std::atomic<int32_t*>[num_blocks]);
+		if (!m_blocks) {
+			m_blocks_capacity = 0;
+			m_num_blocks = 0;
+			GRK_ERROR("Out of memory");
+			return false;
+		}
+		for (uint64_t i = 0; i < num_blocks; i++)
+			m_blocks[i].store(nullptr, std::memory_order_relaxed);
+		m_blocks_capacity = num_blocks;
+	}
+	m_num_blocks = num_blocks;
+	m_uncovered.assign(num_blocks, 0);
+	m_snapshot_blocks.clear();
+
+	m_grids.clear();
+	uint64_t first_block = 0;
+	for (uint32_t i = 0; i < num_levels; ++i) {
+		sparse_grid grid;
+		*(sparse_level*)&grid = levels[i];
+		grid.block_count_hor = ceildiv<uint32_t>(grid.width, grid.block_width);
+		grid.block_count_ver = ceildiv<uint32_t>(grid.height, grid.block_height);
+		grid.first_block = first_block;
+		first_block += (uint64_t)grid.block_count_hor * grid.block_count_ver;
+		m_grids.push_back(grid);
+	}
+	width = levels[num_levels - 1].width;
+	height = levels[num_levels - 1].height;
+	update_account();
+
+	return true;
 }
 
 bool sparse_array::is_region_valid(
@@ -95,38 +184,218 @@ bool sparse_array::is_region_valid(
     return !(x0 >= width || x1 <= x0 || x1 > width ||
              y0 >= height || y1 <= y0 || y1 > height);
 }
+
+template<typename F> bool sparse_array::for_each_part(uint32_t x0,
+														uint32_t y0,
+														uint32_t x1,
+														uint32_t y1,
+														F fn){
+	// most regions lie in a single level
+	uint32_t inner_w = 0, inner_h = 0;
+	for (auto &grid : m_grids) {
+		if (x1 <= grid.width && y1 <= grid.height) {
+			if (x0 >= inner_w || y0 >= inner_h)
+				return fn(grid, x0, y0, x1, y1);
+			break;
+		}
+		inner_w = grid.width;
+		inner_h = grid.height;
+	}
+	inner_w = 0;
+	inner_h = 0;
+	for (auto &grid : m_grids) {
+		uint32_t px1 = min<uint32_t>(x1, grid.width);
+		uint32_t py1 = min<uint32_t>(y1, grid.height);
+		if (x0 < px1 && y0 < py1) {
+			// right of previous level
+			if (px1 > inner_w) {
+				if (!fn(grid, max<uint32_t>(x0, inner_w), y0, px1, py1))
+					return false;
+			}
+			// below previous level
+			if (py1 > inner_h && x0 < inner_w) {
+				if (!fn(grid, x0, max<uint32_t>(y0, inner_h), min<uint32_t>(px1, inner_w), py1))
+					return false;
+			}
+		}
+		inner_w = grid.width;
+		inner_h = grid.height;
+	}
+
+	return true;
+}
+
+uint32_t sparse_array::block_area(uint32_t level, uint32_t block_x, uint32_t block_y) const{
+	auto &grid = m_grids[level];
+	uint32_t bx0 = block_x * grid.block_width;
+	uint32_t by0 = block_y * grid.block_height;
+	uint32_t bx1 = min<uint32_t>(bx0 + grid.block_width, grid.width);
+	uint32_t by1 = min<uint32_t>(by0 + grid.block_height, grid.height);
+	uint32_t area = (bx1 - bx0) * (by1 - by0);
+	if (level) {
+		auto &inner = m_grids[level - 1];
+		uint32_t ix1 = min<uint32_t>(bx1, inner.width);
+		uint32_t iy1 = min<uint32_t>(by1, inner.height);
+		if (bx0 < ix1 && by0 < iy1)
+			area -= (ix1 - bx0) * (iy1 - by0);
+	}
+
+	return area;
+}
+
+int32_t* sparse_array::get_block(void){
+	if (!m_pool.empty()) {
+		auto block = m_pool.back();
+		m_pool.pop_back();
+		return block;
+	}
+	auto block = (int32_t*)grk_malloc(m_block_size * sizeof(int32_t));
+	if (block)
+		m_num_allocated++;
+
+	return block;
+}
+
+int32_t* sparse_array::publish_block(uint64_t index){
+	auto block = (int32_t*)grk_calloc(m_block_size, sizeof(int32_t));
+	if (!block)
+		return nullptr;
+	int32_t *expected = nullptr;
+	if (m_blocks[index].compare_exchange_strong(expected, block,
+								std::memory_order_acq_rel, std::memory_order_acquire)) {
+		m_num_published++;
+		return block;
+	}
+	// another thread won the race
+	grk_free(block);
+
+	return expected;
+}
+
 bool sparse_array::alloc(             uint32_t x0,
                                       uint32_t y0,
                                       uint32_t x1,
-                                      uint32_t y1){
+                                      uint32_t y1,
+									  bool fully_written){
     if (!sparse_array::is_region_valid(x0, y0, x1, y1))
         return true;
 
-    uint32_t y_incr = 0;
-    uint32_t block_y = y0 / block_height;
-    for (uint32_t y = y0; y < y1; block_y ++, y += y_incr) {
-        y_incr = (y == y0) ? block_height - (y0 % block_height) :
-                 block_height;
-        y_incr = min<uint32_t>(y_incr, y1 - y);
-        uint32_t block_x = x0 / block_width;
-        uint32_t x_incr = 0;
-        for (uint32_t x = x0; x < x1; block_x ++, x += x_incr) {
-            x_incr = (x == x0) ? block_width - (x0 % block_width) : block_width;
-            x_incr = min<uint32_t>(x_incr, x1 - x);
-            auto src_block = data_blocks[(uint64_t)block_y * block_count_hor + block_x];
-			if (src_block == NULL) {
-				src_block = (int32_t*) grk_calloc((uint64_t)block_width * block_height,
-													 sizeof(int32_t));
-				if (!src_block) {
-					GRK_ERROR("Out of memory");
-					return false;
+    bool rc = for_each_part(x0, y0, x1, y1,
+    		[this, fully_written](const sparse_grid &grid, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1){
+		uint32_t level = (uint32_t)(&grid - m_grids.data());
+		size_t block_bytes = (size_t)grid.block_width * grid.block_height * sizeof(int32_t);
+		uint32_t y_incr = 0;
+		uint32_t block_y = y0 / grid.block_height;
+		for (uint32_t y = y0; y < y1; block_y ++, y += y_incr) {
+			y_incr = (y == y0) ? grid.block_height - (y0 % grid.block_height) :
+					 grid.block_height;
+			y_incr = min<uint32_t>(y_incr, y1 - y);
+			uint32_t block_x = x0 / grid.block_width;
+			uint32_t x_incr = 0;
+			for (uint32_t x = x0; x < x1; block_x ++, x += x_incr) {
+				x_incr = (x == x0) ? grid.block_width - (x0 % grid.block_width) : grid.block_width;
+				x_incr = min<uint32_t>(x_incr, x1 - x);
+				uint64_t index = grid.first_block + (uint64_t)block_y * grid.block_count_hor + block_x;
+				auto block = m_blocks[index].load(std::memory_order_relaxed);
+				auto &uncovered = m_uncovered[index];
+				if (!block) {
+					block = get_block();
+					if (!block) {
+						GRK_ERROR("Out of memory");
+						return false;
+					}
+					m_blocks[index].store(block, std::memory_order_relaxed);
+					if (fully_written) {
+						uncovered = block_area(level, block_x, block_y);
+					} else {
+						memset(block, 0, block_bytes);
+						continue;
+					}
+				}
+				if (!uncovered)
+					continue;
+				if (fully_written) {
+					uncovered -= min<uint32_t>(uncovered, x_incr * y_incr);
+				} else {
+					memset(block, 0, block_bytes);
+					uncovered = 0;
 				}
-				data_blocks[(uint64_t)block_y * block_count_hor + block_x] = src_block;
 			}
-        }
-    }
+		}
+		return true;
+    });
+    update_account();
 
-    return true;
+    return rc;
+}
+
+void sparse_array::zero_uncovered(void){
+	for (auto &grid : m_grids) {
+		size_t block_bytes = (size_t)grid.block_width * grid.block_height * sizeof(int32_t);
+		uint64_t end = grid.first_block + (uint64_t)grid.block_count_hor * grid.block_count_ver;
+		for (uint64_t i = grid.first_block; i < end; ++i) {
+			if (m_uncovered[i]) {
+				memset(m_blocks[i].load(std::memory_order_relaxed), 0, block_bytes);
+				m_uncovered[i] = 0;
+			}
+		}
+	}
+}
+
+bool sparse_array::snapshot(void){
+	m_snapshot_blocks.clear();
+	size_t len = 0;
+	for (auto &grid : m_grids) {
+		uint64_t end = grid.first_block + (uint64_t)grid.block_count_hor * grid.block_count_ver;
+		for (uint64_t i = grid.first_block; i < end; ++i) {
+			if (m_blocks[i].load(std::memory_order_relaxed)) {
+				m_snapshot_blocks.push_back(i);
+				len += (size_t)grid.block_width * grid.block_height;
+			}
+		}
+	}
+	try {
+		m_snapshot.resize(len);
+	} catch (const std::bad_alloc&) {
+		GRK_ERROR("Out of memory");
+		m_snapshot_blocks.clear();
+		return false;
+	}
+	auto dest = m_snapshot.data();
+	size_t k = 0;
+	for (auto &grid : m_grids) {
+		size_t block_len = (size_t)grid.block_width * grid.block_height;
+		uint64_t end = grid.first_block + (uint64_t)grid.block_count_hor * grid.block_count_ver;
+		for (; k < m_snapshot_blocks.size() && m_snapshot_blocks[k] < end; ++k) {
+			memcpy(dest, m_blocks[m_snapshot_blocks[k]].load(std::memory_order_relaxed),
+					block_len * sizeof(int32_t));
+			dest += block_len;
+		}
+	}
+	update_account();
+
+	return true;
+}
+
+void sparse_array::restore(void){
+	m_num_allocated += m_num_published.exchange(0);
+	auto src = m_snapshot.data();
+	size_t k = 0;
+	for (auto &grid : m_grids) {
+		size_t block_len = (size_t)grid.block_width * grid.block_height;
+		uint64_t end = grid.first_block + (uint64_t)grid.block_count_hor * grid.block_count_ver;
+		for (uint64_t i = grid.first_block; i < end; ++i) {
+			auto block = m_blocks[i].load(std::memory_order_relaxed);
+			if (k < m_snapshot_blocks.size() && m_snapshot_blocks[k] == i) {
+				memcpy(block, src, block_len * sizeof(int32_t));
+				src += block_len;
+				++k;
+			} else if (block) {
+				m_pool.push_back(block);
+				m_blocks[i].store(nullptr, std::memory_order_relaxed);
+			}
+		}
+	}
 }
 
 bool sparse_array::read_or_write(uint32_t x0,
@@ -141,8 +410,27 @@ bool sparse_array::read_or_write(uint32_t x0,
     if (!is_region_valid(x0, y0, x1, y1))
         return forgiving;
 
+    return for_each_part(x0, y0, x1, y1,
+    		[=, this](const sparse_grid &grid, uint32_t px0, uint32_t py0, uint32_t px1, uint32_t py1){
+    	return read_or_write(grid, px0, py0, px1, py1,
+    			buf + (uint64_t)(py0 - y0) * buf_line_stride + (uint64_t)(px0 - x0) * buf_col_stride,
+				buf_col_stride, buf_line_stride, is_read_op);
+    });
+}
+
+bool sparse_array::read_or_write(const sparse_grid &grid,
+										uint32_t x0,
+										uint32_t y0,
+										uint32_t x1,
+										uint32_t y1,
+										int32_t* buf,
+										const uint32_t buf_col_stride,
+										const uint32_t buf_line_stride,
+										bool is_read_op){
     const uint64_t line_stride = buf_line_stride;
     const uint64_t col_stride = buf_col_stride;
+    const uint32_t block_width = grid.block_width;
+    const uint32_t block_height = grid.block_height;
     uint32_t block_y = y0 / block_height;
     uint32_t y_incr = 0;
     for (uint32_t y = y0; y < y1; block_y ++, y += y_incr) {
@@ -156,7 +444,8 @@ bool sparse_array::read_or_write(uint32_t x0,
             x_incr = (x == x0) ? block_width - (x0 % block_width) : block_width;
             uint32_t block_x_offset = block_width - x_incr;
             x_incr = min<uint32_t>(x_incr, x1 - x);
-            auto src_block = data_blocks[(uint64_t)block_y * block_count_hor + block_x];
+            uint64_t index = grid.first_block + (uint64_t)block_y * grid.block_count_hor + block_x;
+            auto src_block = m_blocks[index].load(std::memory_order_acquire);
             if (is_read_op) {
                 if (src_block == NULL) { // if block is NULL, then zero out destination
                     if (col_stride == 1) {
@@ -244,8 +533,13 @@ bool sparse_array::read_or_write(uint32_t x0,
                     }
                 }
             } else {
-            	//all blocks should be allocated first before read/write is called
-                assert(src_block);
+                if (!src_block) {
+                	src_block = publish_block(index);
+                	if (!src_block) {
+                		GRK_ERROR("Out of memory");
+                		return false;
+                	}
+                }
                 if (col_stride == 1) {
                     int32_t* GRK_RESTRICT dest_ptr = src_block + (uint64_t)block_y_offset *
                                                        	   	   	   block_width + block_x_offset;
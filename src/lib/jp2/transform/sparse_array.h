@@ -49,6 +49,10 @@
 
 #pragma once
 
+#include <vector>
+#include <memory>
+#include <atomic>
+
 /**
 @file sparse_array.h
 @brief Sparse array management
@@ -67,10 +71,29 @@ be used. If blocks are too small, the book-keeping costs of blocks will rise.
 
 namespace grk {
 
+/**
+ * Block grid of one level of a sparse array.
+ *
+ * Level r covers the region [0,width) x [0,height), less the region covered
+ * by level r-1, so that levels match the resolutions of a tile component
+ * laid out by the wavelet transform: resolution r-1 sits in the top left
+ * corner of resolution r. Each level has its own block dimensions.
+ */
+struct sparse_level {
+	uint32_t width;
+	uint32_t height;
+	uint32_t block_width;
+	uint32_t block_height;
+};
+
 class sparse_array {
 
 public:
 
+	/** Creates an empty sparse array, to be set up by init()
+	 */
+	sparse_array();
+
 	/** Creates a new sparse array.
 	 *
 	 * @param width total width of the array.
@@ -78,7 +101,7 @@ public:
 	 * @param block_width width of a block.
 	 * @param block_height height of a block.
 	 *
-	 * @return a new sparse array instance, or NULL in case of failure.
+	 * throws std::runtime_error if dimensions are invalid
 	 */
 	sparse_array(uint32_t width,
 					uint32_t height,
@@ -90,6 +113,16 @@ public:
 	 */
 	~sparse_array();
 
+	/** (Re)initialize sparse array with one block grid per level.
+	 * Blocks of the previous use of the array are kept in a pool and
+	 * reused, and block pointer tables are only grown, never shrunk.
+	 *
+	 * @param levels levels, in increasing order of size.
+	 * @param num_levels number of levels.
+	 * @return true in case of success.
+	 */
+	bool init(const sparse_level *levels, uint32_t num_levels);
+
 	/** Read the content of a rectangular region of the sparse array into a
 	 * user buffer.
 	 *
@@ -136,7 +169,10 @@ public:
 	/** Write the content of a rectangular region into the sparse array from a
 	 * user buffer.
 	 *
-	 * Blocks intersecting the region are allocated, if not already done.
+	 * Blocks intersecting the region should be allocated with alloc(), but
+	 * missing blocks are allocated, zeroed, and published without locking.
+	 * Several threads may write concurrently to disjoint regions,
+	 * whatever their alignment with respect to blocks.
 	 *
 	 * @param x0 left x coordinate of the region to write into the sparse array.
 	 * @param y0 top x coordinate of the region to write into the sparse array.
@@ -157,24 +193,56 @@ public:
 			  const uint32_t src_line_stride,
 			  bool forgiving);
 
-	/** Allocate all blocks for a rectangular region into the sparse array from a
-	 * user buffer.
+	/** Allocate all blocks for a rectangular region of the sparse array.
+	 * Not thread safe.
 	 *
-	 * Blocks intersecting the region are allocated
+	 * Blocks intersecting the region are allocated. If the region will be
+	 * completely written before it is read, as is the case for a code block,
+	 * new blocks are not zeroed: blocks that are still not fully covered by
+	 * such regions are zeroed by zero_uncovered().
 	 *
 	 * @param x0 left x coordinate of the region to write into the sparse array.
 	 * @param y0 top x coordinate of the region to write into the sparse array.
 	 * @param x1 right x coordinate (not included) of the region to write into the sparse array. Must be greater than x0.
 	 * @param y1 bottom y coordinate (not included) of the region to write into the sparse array. Must be greater than y0.
+	 * @param fully_written true if region will be completely written before it is read
 	 * @return true in case of success.
 	 */
 	bool alloc(              uint32_t x0,
 							  uint32_t y0,
 							  uint32_t x1,
-							  uint32_t y1);
+							  uint32_t y1,
+							  bool fully_written = false);
+
+	/** Zero the blocks that are not fully covered by regions allocated
+	 * as fully written. Must be called before such regions are read or written.
+	 * Not thread safe.
+	 */
+	void zero_uncovered(void);
+
+	/** Save the content of all blocks, so that it can be restored
+	 * once the array has been transformed in place.
+	 * Not thread safe.
+	 *
+	 * @return true in case of success.
+	 */
+	bool snapshot(void);
+
+	/** Restore the content saved by snapshot(). Blocks allocated since
+	 * the snapshot are returned to the pool, so they read as 0 again.
+	 * Not thread safe.
+	 */
+	void restore(void);
 
 private:
 
+	struct sparse_grid : public sparse_level {
+		uint32_t block_count_hor;
+		uint32_t block_count_ver;
+		/** index of first block of grid in block table */
+		uint64_t first_block;
+	};
+
 	/** Returns whether region bounds are valid (non empty and within array bounds)
 	 * @param x0 left x coordinate of the region.
 	 * @param y0 top x coordinate of the region.
@@ -187,6 +255,15 @@ private:
 							uint32_t x1,
 							uint32_t y1);
 
+	/** Split region into the parts that belong to each level, and call
+	 * fn(grid, x0, y0, x1, y1) for each part, until fn returns false
+	 */
+	template<typename F> bool for_each_part(uint32_t x0,
+											uint32_t y0,
+											uint32_t x1,
+											uint32_t y1,
+											F fn);
+
 	bool read_or_write(uint32_t x0,
 						uint32_t y0,
 						uint32_t x1,
@@ -197,13 +274,56 @@ private:
 						bool forgiving,
 						bool is_read_op);
 
+	bool read_or_write(const sparse_grid &grid,
+						uint32_t x0,
+						uint32_t y0,
+						uint32_t x1,
+						uint32_t y1,
+						int32_t* buf,
+						const uint32_t buf_col_stride,
+						const uint32_t buf_line_stride,
+						bool is_read_op);
+
+	/** Area of block that belongs to its level */
+	uint32_t block_area(uint32_t level, uint32_t block_x, uint32_t block_y) const;
+
+	/** Take a block from the pool, or allocate a new one */
+	int32_t* get_block(void);
+
+	/** Allocate a zeroed block from a writer thread, and publish it */
+	int32_t* publish_block(uint64_t index);
+
+	/** Free all blocks, including pooled blocks */
+	void free_blocks(void);
+
+	void update_account(void);
+
 	uint32_t width;
     uint32_t height;
-    uint32_t block_width;
-    uint32_t block_height;
-    uint32_t block_count_hor;
-    uint32_t block_count_ver;
-    int32_t** data_blocks;
+    std::vector<sparse_grid> m_grids;
+
+    /** block table of all grids */
+    std::unique_ptr<std::atomic<int32_t*>[]> m_blocks;
+    uint64_t m_num_blocks;
+    uint64_t m_blocks_capacity;
+    /** per block: area not yet covered by fully written regions,
+     *  while block is waiting to be zeroed */
+    std::vector<uint32_t> m_uncovered;
+
+    /** number of int32_t elements of each block */
+    size_t m_block_size;
+    /** blocks of previous use of the array */
+    std::vector<int32_t*> m_pool;
+    /** indices of blocks saved by snapshot(), in increasing order */
+    std::vector<uint64_t> m_snapshot_blocks;
+    /** content of blocks saved by snapshot() */
+    std::vector<int32_t> m_snapshot;
+    /** blocks allocated by alloc() or init() */
+    uint64_t m_num_allocated;
+    /** blocks allocated by writer threads */
+    std::atomic<uint64_t> m_num_published;
+
+    MemAccount m_account;
 };
 
 }
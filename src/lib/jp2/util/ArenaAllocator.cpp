@@ -0,0 +1,124 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+#include <cstddef>
+
+namespace grk {
+
+// first block is small, so that tiles with few code blocks stay cheap
+const size_t arena_min_block_size = 16 * 1024;
+const size_t arena_max_block_size = 4 * 1024 * 1024;
+const size_t arena_align = alignof(std::max_align_t);
+
+ArenaAllocator::ArenaAllocator() :
+		m_cur(nullptr),
+		m_remaining(0),
+		m_next_block_size(arena_min_block_size),
+		m_allocated(0) {
+	for (auto &a : m_accounted)
+		a = 0;
+}
+
+ArenaAllocator::~ArenaAllocator() {
+	release();
+}
+
+bool ArenaAllocator::add_block(size_t min_bytes) {
+	size_t len = std::max<size_t>(m_next_block_size, min_bytes);
+	auto block = (uint8_t*) grk_malloc(len);
+	if (!block)
+		return false;
+	m_blocks.push_back(block);
+	m_cur = block;
+	m_remaining = len;
+	m_next_block_size = std::min<size_t>(m_next_block_size * 2,
+			arena_max_block_size);
+
+	return true;
+}
+
+void ArenaAllocator::unaccount(void) {
+	for (uint32_t i = 0; i < GRK_MEM_NUM_TAGS; ++i) {
+		if (m_accounted[i]) {
+			MemStats::sub((GRK_MEM_TAG) i, m_accounted[i]);
+			m_accounted[i] = 0;
+		}
+	}
+}
+
+void* ArenaAllocator::alloc(size_t bytes, GRK_MEM_TAG tag) {
+	if (bytes > SIZE_MAX - arena_align)
+		return nullptr;
+	bytes = (bytes + arena_align - 1) & ~(arena_align - 1);
+	if (MemStats::enabled()) {
+		MemStats::add(tag, bytes);
+		m_accounted[tag] += bytes;
+	}
+	if (bytes > m_remaining) {
+		// large requests get their own block, so that the
+		// tail of the current block is not wasted
+		if (bytes > m_next_block_size / 4) {
+			auto block = (uint8_t*) grk_malloc(bytes);
+			if (!block)
+				return nullptr;
+			m_blocks.push_back(block);
+			m_allocated += bytes;
+
+			return block;
+		}
+		if (!add_block(bytes))
+			return nullptr;
+	}
+	auto p = m_cur;
+	m_cur += bytes;
+	m_remaining -= bytes;
+	m_allocated += bytes;
+
+	return p;
+}
+
+void ArenaAllocator::release(void) {
+	unaccount();
+	for (auto &b : m_blocks)
+		grk_free(b);
+	m_blocks.clear();
+	m_cur = nullptr;
+	m_remaining = 0;
+	m_next_block_size = arena_min_block_size;
+	m_allocated = 0;
+}
+
+void ArenaAllocator::reset(void) {
+	unaccount();
+	if (m_blocks.size() == 1 && m_cur) {
+		m_remaining += (size_t) (m_cur - m_blocks[0]);
+		m_cur = m_blocks[0];
+		m_allocated = 0;
+		return;
+	}
+	size_t needed = m_allocated;
+	release();
+	if (needed)
+		add_block(needed);
+}
+
+size_t ArenaAllocator::allocated(void) const {
+	return m_allocated;
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <new>
+#include <type_traits>
+
+namespace grk {
+
+/**
+ * Bump allocator for metadata whose lifetime is that of a tile:
+ * resolutions, precincts, code blocks, layers, passes and segments.
+ *
+ * Memory is carved out of blocks that grow geometrically, and is only
+ * returned to the heap, all at once, by release(). Objects are never
+ * freed individually: arrays that are replaced by larger ones
+ * are simply abandoned until release().
+ *
+ * The allocator is not thread safe.
+ */
+class ArenaAllocator {
+public:
+	ArenaAllocator();
+	~ArenaAllocator();
+
+	/**
+	 * Allocate uninitialized memory, aligned for any fundamental type
+	 *
+	 * @param bytes	number of bytes
+	 * @param tag	memory accounting tag
+	 * @return pointer to memory, or nullptr if out of memory
+	 */
+	void* alloc(size_t bytes, GRK_MEM_TAG tag = GRK_MEM_TILE_METADATA);
+
+	/**
+	 * Allocate and default construct an array
+	 *
+	 * @param num	number of elements
+	 * @return array, or nullptr if out of memory
+	 */
+	template<typename T> T* construct_array(size_t num) {
+		if (num > SIZE_MAX / sizeof(T))
+			return nullptr;
+		auto p = (T*) alloc(num * sizeof(T));
+		if (!p)
+			return nullptr;
+		for (size_t i = 0; i < num; ++i)
+			new (p + i) T();
+		return p;
+	}
+
+	/**
+	 * Destroy elements of an array created by construct_array.
+	 * The memory itself is reclaimed by release()
+	 */
+	template<typename T> static void destroy_array(T *p, size_t num) {
+		if (!std::is_trivially_destructible<T>::value && p) {
+			for (size_t i = 0; i < num; ++i)
+				p[i].~T();
+		}
+	}
+
+	/**
+	 * Return all memory to the heap. Pointers handed out
+	 * by the arena are invalid after this call
+	 */
+	void release(void);
+
+	/**
+	 * Invalidate all pointers handed out by the arena, but keep a single
+	 * block large enough to serve the same allocations again, so that
+	 * a tile of the same shape is allocated without touching the heap
+	 */
+	void reset(void);
+
+	/**
+	 * Number of bytes handed out since last release
+	 */
+	size_t allocated(void) const;
+
+private:
+	bool add_block(size_t min_bytes);
+	void unaccount(void);
+
+	std::vector<uint8_t*> m_blocks;
+	uint8_t *m_cur;
+	size_t m_remaining;
+	size_t m_next_block_size;
+	size_t m_allocated;
+	// bytes handed out while memory accounting was enabled, per tag
+	size_t m_accounted[GRK_MEM_NUM_TAGS];
+};
+
+}
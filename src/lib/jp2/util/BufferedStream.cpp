@@ -31,10 +31,10 @@ BufferedStream::BufferedStream(uint8_t *buffer, size_t buffer_size,
 		bool is_input) :
 		m_user_data(nullptr), m_free_user_data_fn(nullptr), m_user_data_length(
 				0), m_read_fn(nullptr), m_zero_copy_read_fn(nullptr), m_write_fn(
-				nullptr), m_seek_fn(nullptr), m_status(
+				nullptr), m_seek_fn(nullptr), m_reserve_fn(nullptr), m_status(
 				is_input ?
 				GROK_STREAM_STATUS_INPUT :
-								GROK_STREAM_STATUS_OUTPUT), m_buf(nullptr), m_buffered_bytes(
+								GROK_STREAM_STATUS_OUTPUT), m_prefetcher(nullptr), m_buf(nullptr), m_buffered_bytes(
 				0), m_read_bytes_seekable(0), m_stream_offset(0) {
 
 	m_buf = new grk_buf(
@@ -306,6 +306,40 @@ bool BufferedStream::supportsZeroCopy() {
 uint8_t* BufferedStream::getCurrentPtr() {
 	return m_buf->curr_ptr();
 }
+bool BufferedStream::reserve(uint64_t len) {
+	if (!m_reserve_fn)
+		return true;
+	return m_reserve_fn(m_stream_offset + len, m_user_data);
+}
+void BufferedStream::set_mem_buffer(uint8_t *buffer, size_t len) {
+	assert(isMemStream());
+	m_buf->buf = buffer;
+	m_buf->len = len;
+}
+bool BufferedStream::supportsPrefetch() {
+	return m_prefetcher != nullptr;
+}
+uint64_t BufferedStream::get_prefetch_budget() {
+	return m_prefetcher ? m_prefetcher->get_max_bytes() : 0;
+}
+uint64_t BufferedStream::get_prefetched_end(uint64_t offset) {
+	return m_prefetcher ? m_prefetcher->get_prefetched_end(offset) : offset;
+}
+void BufferedStream::prefetch(uint64_t offset, uint64_t len) {
+	if (m_prefetcher)
+		m_prefetcher->prefetch(offset, len);
+}
+grk_buf* BufferedStream::read_prefetched(size_t p_size) {
+	if (!m_prefetcher || !p_size)
+		return nullptr;
+	auto chunk = m_prefetcher->take(m_stream_offset, p_size);
+	if (chunk && !read_seek(m_stream_offset + p_size)) {
+		delete chunk;
+		return nullptr;
+	}
+
+	return chunk;
+}
 
 bool BufferedStream::read_skip(int64_t p_size) {
 	int64_t offset = (int64_t) m_stream_offset + p_size;
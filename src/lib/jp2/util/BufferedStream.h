@@ -27,6 +27,13 @@
 
 namespace grk {
 
+class FilePrefetcher;
+
+/**
+ * Reserve space for at least len bytes in a memory backed write stream
+ */
+typedef bool (*grk_stream_reserve_fn)(uint64_t len, void *user_data);
+
 #define GROK_STREAM_STATUS_OUTPUT  0x1U
 #define GROK_STREAM_STATUS_INPUT   0x2U
 #define GROK_STREAM_STATUS_END     0x4U
@@ -79,11 +86,22 @@ struct BufferedStream: public IBufferedStream {
 	 */
 	grk_stream_seek_fn m_seek_fn;
 
+	/**
+	 * Pointer to actual reserve function (nullptr at initialization).
+	 */
+	grk_stream_reserve_fn m_reserve_fn;
+
 	/**
 	 * Stream status flags
 	 */
 	uint32_t m_status;
 
+	/**
+	 * Prefetcher of file read stream (nullptr at initialization).
+	 * Owned by the stream user data.
+	 */
+	FilePrefetcher *m_prefetcher;
+
 	/**
 	 * Reads some bytes from the stream.
 	 * @param		p_buffer	pointer to the data buffer
@@ -159,6 +177,59 @@ struct BufferedStream: public IBufferedStream {
 	bool supportsZeroCopy() ;
 	uint8_t* getCurrentPtr();
 
+	/**
+	 * Reserve space for the bytes that will be written, if the stream
+	 * supports it, for example a memory mapped file.
+	 *
+	 * @param		len		expected number of bytes written after current offset
+	 *
+	 * @return		false if space could not be reserved
+	 */
+	bool reserve(uint64_t len);
+
+	/**
+	 * Replace buffer of memory stream, keeping the current offset,
+	 * after the memory behind the stream has been reallocated
+	 *
+	 * @param		buffer	new buffer
+	 * @param		len		length of new buffer
+	 */
+	void set_mem_buffer(uint8_t *buffer, size_t len);
+
+	bool supportsPrefetch();
+
+	/**
+	 * Get maximum number of bytes that may be prefetched at once
+	 */
+	uint64_t get_prefetch_budget();
+
+	/**
+	 * Get end of the prefetched bytes that follow an offset without gaps
+	 *
+	 * @param		offset		absolute offset
+	 */
+	uint64_t get_prefetched_end(uint64_t offset);
+
+	/**
+	 * Queue byte range to be read ahead of need
+	 *
+	 * @param		offset		absolute offset
+	 * @param		len			number of bytes
+	 */
+	void prefetch(uint64_t offset, uint64_t len);
+
+	/**
+	 * Read bytes at current offset without copying,
+	 * if they have been prefetched
+	 *
+	 * @param		p_size		number of bytes to read
+	 *
+	 * @return		chunk holding the bytes, which the caller owns,
+	 * 				or nullptr if the bytes were not prefetched,
+	 * 				in which case the stream does not move
+	 */
+	grk_buf* read_prefetched(size_t p_size);
+
 private:
 
 	/**
@@ -21,7 +21,7 @@ namespace grk {
 /* #define DEBUG_CHUNK_BUF */
 
 ChunkBuffer::ChunkBuffer() :
-		data_len(0), cur_chunk_id(0) {
+		data_len(0), cur_chunk_id(0), m_account(GRK_MEM_PACKET_DATA) {
 }
 
 ChunkBuffer::~ChunkBuffer() {
@@ -123,12 +123,15 @@ void ChunkBuffer::push_back(grk_buf *chunk) {
 	chunks.push_back(chunk);
 	cur_chunk_id = (size_t) (chunks.size() - 1);
 	data_len += chunk->len;
+	if (chunk->owns_data)
+		m_account.add(chunk->len);
 }
 
 void ChunkBuffer::cleanup(void) {
 	for (size_t i = 0; i < chunks.size(); ++i)
 		delete chunks[i];
 	chunks.clear();
+	m_account.set(0);
 }
 
 void ChunkBuffer::rewind(void) {
@@ -228,4 +231,8 @@ size_t ChunkBuffer::getRemainingLength(void){
 	return data_len - get_global_offset();
 }
 
+size_t ChunkBuffer::get_len(void){
+	return data_len;
+}
+
 }
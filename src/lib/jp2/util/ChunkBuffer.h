@@ -34,6 +34,11 @@ struct ChunkBuffer {
 
 	grk_buf* push_back(uint8_t *buf, size_t len, bool ownsData);
 
+	/*
+	 Add chunk to the back of the chunk buffer, taking ownership of chunk
+	 */
+	void push_back(grk_buf *chunk);
+
 	/*
 	 Allocate array and add to the back of the chunk buffer
 	 */
@@ -66,6 +71,11 @@ struct ChunkBuffer {
 	size_t read(void *p_buffer, size_t nb_bytes);
 
 	size_t getRemainingLength(void);
+
+	/*
+	 Get total length of all chunks
+	 */
+	size_t get_len(void);
 private:
 	/*
 	 Treat segmented buffer as single contiguous buffer, and get current offset
@@ -96,11 +106,10 @@ private:
 	 */
 	size_t get_cur_chunk_offset(void);
 
-	void push_back(grk_buf *chunk);
-
 	size_t data_len; /* total length of all chunks*/
 	size_t cur_chunk_id; /* current index into chunk vector */
 	std::vector<grk_buf*> chunks;
+	MemAccount m_account; /* chunks owned by buffer */
 };
 
 }
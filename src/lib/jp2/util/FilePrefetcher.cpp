@@ -0,0 +1,273 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+namespace grk {
+
+FilePrefetcher::FilePrefetcher(grk_handle fd, uint64_t file_len,
+		uint64_t max_bytes) :
+		m_fd(fd), m_file_len(file_len), m_offset(0), m_max_bytes(max_bytes), m_bytes(
+				0), m_stop(false) {
+	m_thread = std::thread(&FilePrefetcher::run, this);
+}
+
+FilePrefetcher::~FilePrefetcher() {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stop = true;
+	}
+	m_queue_cv.notify_all();
+	m_thread.join();
+#ifdef _WIN32
+	CloseHandle(m_fd);
+#else
+	close(m_fd);
+#endif
+}
+
+bool FilePrefetcher::read_at(uint8_t *buffer, uint64_t len, uint64_t offset) {
+	while (len) {
+#ifdef _WIN32
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(overlapped));
+		overlapped.Offset = (DWORD) offset;
+		overlapped.OffsetHigh = (DWORD) (offset >> 32);
+		DWORD to_read = (DWORD) std::min<uint64_t>(len, 1U << 30);
+		DWORD num_read = 0;
+		if (!ReadFile(m_fd, buffer, to_read, &num_read, &overlapped)
+				|| num_read == 0)
+			return false;
+#else
+		auto num_read = pread(m_fd, buffer,
+				(size_t) std::min<uint64_t>(len, 1U << 30), (off_t) offset);
+		if (num_read < 0 && errno == EINTR)
+			continue;
+		if (num_read <= 0)
+			return false;
+#endif
+		buffer += num_read;
+		offset += (uint64_t) num_read;
+		len -= (uint64_t) num_read;
+	}
+
+	return true;
+}
+
+std::shared_ptr<FilePrefetcher::Range> FilePrefetcher::find(uint64_t offset,
+		uint64_t len) {
+	for (auto &r : m_ranges) {
+		if (r->offset <= offset && offset + len <= r->offset + r->len)
+			return r;
+	}
+
+	return nullptr;
+}
+
+size_t FilePrefetcher::read(uint8_t *buffer, size_t len) {
+	if (m_offset >= m_file_len)
+		return 0;
+	len = (size_t) std::min<uint64_t>(len, m_file_len - m_offset);
+	{
+		// don't read again what is being, or has been, prefetched
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto range = find(m_offset, 1);
+		if (range) {
+			m_done_cv.wait(lock, [range] {
+				return range->done;
+			});
+			if (range->ok) {
+				len = (size_t) std::min<uint64_t>(len,
+						range->offset + range->len - m_offset);
+				memcpy(buffer, range->data.get() + (m_offset - range->offset),
+						len);
+				m_offset += len;
+
+				return len;
+			}
+		}
+	}
+	if (!read_at(buffer, len, m_offset))
+		return 0;
+	m_offset += len;
+
+	return len;
+}
+
+bool FilePrefetcher::seek(uint64_t offset) {
+	if (offset > m_file_len)
+		return false;
+	m_offset = offset;
+
+	return true;
+}
+
+uint64_t FilePrefetcher::get_max_bytes(void) const {
+	return m_max_bytes;
+}
+
+void FilePrefetcher::evict(uint64_t len) {
+	// oldest prefetched ranges were most likely skipped
+	for (auto iter = m_ranges.begin();
+			iter != m_ranges.end() && m_bytes + len > m_max_bytes;) {
+		if (!(*iter)->done) {
+			++iter;
+			continue;
+		}
+		m_bytes -= (*iter)->len;
+		iter = m_ranges.erase(iter);
+	}
+}
+
+void FilePrefetcher::prefetch(uint64_t offset, uint64_t len) {
+	if (!len || offset >= m_file_len)
+		return;
+	len = std::min<uint64_t>(len, m_file_len - offset);
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (find(offset, len))
+			return;
+		evict(len);
+		if (m_bytes + len > m_max_bytes)
+			return;
+		auto range = std::make_shared<Range>(offset, len);
+		m_ranges.push_back(range);
+		m_queue.push_back(range);
+		m_bytes += len;
+	}
+	m_queue_cv.notify_one();
+}
+
+uint64_t FilePrefetcher::get_prefetched_end(uint64_t offset) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (auto range = find(offset, 1); range; range = find(offset, 1))
+		offset = range->offset + range->len;
+
+	return offset;
+}
+
+grk_buf* FilePrefetcher::take(uint64_t offset, size_t len) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto range = find(offset, len);
+	if (!range)
+		return nullptr;
+	m_done_cv.wait(lock, [range] {
+		return range->done;
+	});
+	if (!range->ok) {
+		m_ranges.remove(range);
+		m_bytes -= range->len;
+		return nullptr;
+	}
+
+	return new PrefetchedChunk(range->data, (size_t) (offset - range->offset),
+			len);
+}
+
+void FilePrefetcher::run(void) {
+	while (true) {
+		std::shared_ptr<Range> range;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queue_cv.wait(lock, [this] {
+				return m_stop || !m_queue.empty();
+			});
+			if (m_stop)
+				break;
+			range = m_queue.front();
+			m_queue.pop_front();
+		}
+		bool ok = false;
+		try {
+			range->data = std::shared_ptr<uint8_t>(
+					new uint8_t[(size_t) range->len],
+					std::default_delete<uint8_t[]>());
+			ok = read_at(range->data.get(), range->len, range->offset);
+		} catch (std::bad_alloc &ex) {
+			GRK_UNUSED(ex);
+		}
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			range->ok = ok;
+			range->done = true;
+		}
+		m_done_cv.notify_all();
+	}
+}
+
+static size_t read_from_prefetcher(void *buffer, size_t len,
+		FilePrefetcher *prefetcher) {
+	return prefetcher->read((uint8_t*) buffer, len);
+}
+
+static bool seek_in_prefetcher(uint64_t offset, FilePrefetcher *prefetcher) {
+	return prefetcher->seek(offset);
+}
+
+static void free_prefetcher(void *user_data) {
+	delete (FilePrefetcher*) user_data;
+}
+
+grk_stream* create_prefetch_file_read_stream(const char *fname,
+		size_t buffer_size, uint64_t max_bytes) {
+	if (!fname || !fname[0])
+		return nullptr;
+	uint64_t len = 0;
+#ifdef _WIN32
+	auto fd = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, nullptr);
+	if (fd == INVALID_HANDLE_VALUE) {
+		GRK_ERROR("%s: Cannot open", fname);
+		return nullptr;
+	}
+	LARGE_INTEGER filesize = { 0 };
+	if (GetFileSizeEx(fd, &filesize))
+		len = (uint64_t) filesize.QuadPart;
+#else
+	auto fd = open(fname, O_RDONLY);
+	if (fd < 0) {
+		GRK_ERROR("%s: %s", fname, strerror(errno));
+		return nullptr;
+	}
+	struct stat sb;
+	if (fstat(fd, &sb) == 0)
+		len = (uint64_t) sb.st_size;
+#endif
+	auto prefetcher = new FilePrefetcher(fd, len, max_bytes);
+	auto stream = new BufferedStream(nullptr, buffer_size, true);
+	stream->m_prefetcher = prefetcher;
+	auto l_stream = (grk_stream*) stream;
+	grk_stream_set_user_data(l_stream, prefetcher, free_prefetcher);
+	grk_stream_set_user_data_length(l_stream, len);
+	grk_stream_set_read_function(l_stream,
+			(grk_stream_read_fn) read_from_prefetcher);
+	grk_stream_set_seek_function(l_stream,
+			(grk_stream_seek_fn) seek_in_prefetcher);
+
+	return l_stream;
+}
+
+}
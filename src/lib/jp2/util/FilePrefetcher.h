@@ -0,0 +1,151 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <list>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace grk {
+
+/**
+ * Chunk of prefetched data. The chunk does not own its data,
+ * but keeps the prefetched block that holds the data alive.
+ */
+struct PrefetchedChunk: public grk_buf {
+	PrefetchedChunk(std::shared_ptr<uint8_t> block, size_t offset, size_t len) :
+			grk_buf(block.get() + offset, len, false), m_block(block) {
+	}
+	std::shared_ptr<uint8_t> m_block;
+};
+
+/**
+ * File read stream that reads byte ranges ahead of need.
+ *
+ * Ranges, typically blocks of the tile parts that follow the tile part
+ * currently being parsed, are queued with prefetch() and read with positional
+ * reads on a background I/O thread, so that decompression does not stall on
+ * a cold device while parsing tile data. Prefetched data is handed to a
+ * ChunkBuffer without copying. When the prefetch budget is exhausted,
+ * the oldest prefetched ranges are evicted.
+ *
+ * All other reads are positional reads at the current stream offset.
+ */
+class FilePrefetcher {
+public:
+	/**
+	 * Create prefetcher
+	 *
+	 * @param fd			open file handle; prefetcher takes ownership
+	 * @param file_len		length of file
+	 * @param max_bytes		maximum number of bytes that are queued or
+	 * 						have been prefetched but not yet consumed
+	 */
+	FilePrefetcher(grk_handle fd, uint64_t file_len, uint64_t max_bytes);
+	~FilePrefetcher();
+
+	/**
+	 * Read from current offset. Bytes that have been prefetched
+	 * are copied from the prefetched range.
+	 */
+	size_t read(uint8_t *buffer, size_t len);
+
+	/**
+	 * Seek to absolute offset
+	 */
+	bool seek(uint64_t offset);
+
+	uint64_t get_max_bytes(void) const;
+
+	/**
+	 * Queue byte range for prefetch. Ranges that are already queued,
+	 * or that do not fit in the prefetch budget, are ignored.
+	 *
+	 * @param offset	file offset
+	 * @param len		number of bytes
+	 */
+	void prefetch(uint64_t offset, uint64_t len);
+
+	/**
+	 * Get end of the prefetched bytes that follow an offset without gaps
+	 *
+	 * @param offset	file offset
+	 *
+	 * @return end offset, which equals offset if offset is not prefetched
+	 */
+	uint64_t get_prefetched_end(uint64_t offset);
+
+	/**
+	 * Get prefetched data, waiting for its read to complete if necessary.
+	 * The memory of the prefetched range that holds the data is released
+	 * once the range has been evicted and all chunks referencing it
+	 * have been deleted.
+	 *
+	 * @param offset	file offset
+	 * @param len		number of bytes
+	 *
+	 * @return chunk holding data, or nullptr if data was not prefetched
+	 */
+	grk_buf* take(uint64_t offset, size_t len);
+
+private:
+	struct Range {
+		Range(uint64_t off, uint64_t length) :
+				offset(off), len(length), done(false), ok(false) {
+		}
+		uint64_t offset;
+		uint64_t len;
+		std::shared_ptr<uint8_t> data;
+		bool done;
+		bool ok;
+	};
+	void run(void);
+	std::shared_ptr<Range> find(uint64_t offset, uint64_t len);
+	bool read_at(uint8_t *buffer, uint64_t len, uint64_t offset);
+	void evict(uint64_t len);
+
+	grk_handle m_fd;
+	uint64_t m_file_len;
+	uint64_t m_offset;
+	uint64_t m_max_bytes;
+
+	// queued and prefetched ranges, oldest first
+	std::list<std::shared_ptr<Range>> m_ranges;
+	std::deque<std::shared_ptr<Range>> m_queue;
+	uint64_t m_bytes;
+	bool m_stop;
+	std::mutex m_mutex;
+	std::condition_variable m_queue_cv;
+	std::condition_variable m_done_cv;
+	std::thread m_thread;
+};
+
+/**
+ * Create file read stream that prefetches tile parts
+ *
+ * @param fname			file name
+ * @param buffer_size	size of stream buffer
+ * @param max_bytes		prefetch budget in bytes
+ */
+grk_stream* create_prefetch_file_read_stream(const char *fname,
+		size_t buffer_size, uint64_t max_bytes);
+
+}
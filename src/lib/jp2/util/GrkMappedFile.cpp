@@ -118,6 +118,13 @@ static int32_t close_fd(grk_handle fd){
     return rc;
 }
 
+static bool set_file_size(grk_handle fd, uint64_t len){
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG)len;
+
+    return SetFilePointerEx(fd, size, nullptr, FILE_BEGIN) && SetEndOfFile(fd);
+}
+
 #else
 
 static uint64_t size_proc(grk_handle fd) {
@@ -140,7 +147,7 @@ static void* grk_map(grk_handle fd, size_t len, bool do_read) {
 	if (do_read)
 		ptr = (void*) mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
 	else
-		ptr = (void*) mmap(nullptr, len, PROT_WRITE, MAP_SHARED, fd, 0);
+		ptr = (void*) mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
 	return ptr == (void*) -1 ? nullptr : ptr;
 }
 
@@ -178,6 +185,10 @@ static int32_t close_fd(grk_handle fd) {
 	return close(fd);
 }
 
+static bool set_file_size(grk_handle fd, uint64_t len) {
+	return ftruncate(fd, (off_t) len) == 0;
+}
+
 #endif
 
 static void mem_map_free(void *user_data) {
@@ -222,33 +233,125 @@ grk_stream* create_mapped_file_read_stream(const char *fname) {
 	return l_stream;
 }
 
-grk_stream* create_mapped_file_write_stream(const char *fname) {
-	GRK_ERROR("Memory mapped file writing not currently supported");
-	return nullptr;
+/**
+ * Mapped output file, which grows as the code stream is written,
+ * and is truncated to the number of bytes written when the stream is destroyed
+ */
+struct mapped_write_info : public buf_info {
+	mapped_write_info() : stream(nullptr), end(0) {
+	}
+	BufferedStream *stream;
+	// number of bytes written
+	uint64_t end;
+};
+
+static bool remap(mapped_write_info *info, uint64_t len) {
+	if (len <= info->len)
+		return true;
+	// grow geometrically, so that a small initial estimate costs few remaps
+	len = std::max<uint64_t>(len, 2 * (uint64_t) info->len);
+	if (len > SIZE_MAX) {
+		GRK_ERROR("Mapped file size %llu is too large", (unsigned long long) len);
+		return false;
+	}
+	void *ptr = nullptr;
+#if defined(__linux__)
+	if (!set_file_size(info->fd, len))
+		return false;
+	ptr = mremap(info->buf, info->len, (size_t) len, MREMAP_MAYMOVE);
+	if (ptr == MAP_FAILED)
+		ptr = nullptr;
+#else
+	if (unmap(info->buf, info->len)) {
+		GRK_ERROR("Unmapping memory mapped file failed");
+		return false;
+	}
+	info->buf = nullptr;
+	if (!set_file_size(info->fd, len))
+		return false;
+	ptr = grk_map(info->fd, (size_t) len, false);
+#endif
+	if (!ptr) {
+		GRK_ERROR("Unable to grow memory mapped file to %llu bytes",
+				(unsigned long long) len);
+		return false;
+	}
+	info->buf = (uint8_t*) ptr;
+	info->len = (size_t) len;
+	info->stream->set_mem_buffer(info->buf, info->len);
+
+	return true;
+}
+
+static size_t write_to_mapped(void *src, size_t nb_bytes,
+		mapped_write_info *info) {
+	if (!remap(info, (uint64_t) info->off + nb_bytes))
+		return 0;
+	memcpy(info->buf + info->off, src, nb_bytes);
+	info->off += nb_bytes;
+	info->end = std::max<uint64_t>(info->end, info->off);
+
+	return nb_bytes;
+}
+
+static bool seek_in_mapped(uint64_t offset, mapped_write_info *info) {
+	if (!remap(info, offset))
+		return false;
+	info->off = (size_t) offset;
+	info->end = std::max<uint64_t>(info->end, info->off);
 
+	return true;
+}
+
+static bool reserve_mapped(uint64_t len, mapped_write_info *info) {
+	return remap(info, len);
+}
+
+static void mapped_write_free(void *user_data) {
+	auto info = (mapped_write_info*) user_data;
+	if (!info)
+		return;
+	if (info->buf && unmap(info->buf, info->len))
+		GRK_ERROR("Unmapping memory mapped file failed");
+	info->buf = nullptr;
+	if (!set_file_size(info->fd, info->end))
+		GRK_ERROR("Unable to truncate memory mapped file");
+	if (close_fd(info->fd))
+		GRK_ERROR("Closing memory mapped file failed");
+	delete info;
+}
+
+grk_stream* create_mapped_file_write_stream(const char *fname) {
 	grk_handle fd = open_fd(fname, "w");
 	if (fd == (grk_handle) -1){
 		GRK_ERROR("Unable to open memory mapped file %s", fname);
 		return nullptr;
 	}
 
-	auto buffer_info = new buf_info();
-	buffer_info->fd = fd;
-	auto mapped_view = grk_map(fd, buffer_info->len, false);
-	if (!mapped_view) {
+	// the mapping is sized once compression starts, from an estimate
+	// of the code stream size
+	const size_t initial_len = 1024 * 1024;
+	auto info = new mapped_write_info();
+	info->fd = fd;
+	if (set_file_size(fd, initial_len))
+		info->buf = (uint8_t*) grk_map(fd, initial_len, false);
+	if (!info->buf) {
 		GRK_ERROR("Unable to map memory mapped file %s", fname);
-		mem_map_free(buffer_info);
+		mapped_write_free(info);
 		return nullptr;
 	}
-	buffer_info->buf = (uint8_t*) mapped_view;
-	buffer_info->off = 0;
-
-	// now treat mapped file like any other memory stream
-	auto l_stream = (grk_stream*) (new BufferedStream(buffer_info->buf,
-			buffer_info->len, true));
-	grk_stream_set_user_data(l_stream, buffer_info,
-			(grk_stream_free_user_data_fn) mem_map_free);
-	set_up_mem_stream(l_stream, buffer_info->len, false);
+	info->len = initial_len;
+
+	// packet data is written directly into the mapping
+	auto stream = new BufferedStream(info->buf, info->len, false);
+	info->stream = stream;
+	auto l_stream = (grk_stream*) stream;
+	grk_stream_set_user_data(l_stream, info, mapped_write_free);
+	grk_stream_set_write_function(l_stream,
+			(grk_stream_write_fn) write_to_mapped);
+	grk_stream_set_seek_function(l_stream,
+			(grk_stream_seek_fn) seek_in_mapped);
+	stream->m_reserve_fn = (grk_stream_reserve_fn) reserve_mapped;
 
 	return l_stream;
 }
@@ -21,6 +21,11 @@
 
 #define GROK_SKIP_POISON
 #include "grk_includes.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unordered_map>
+#include <map>
+#endif
 
 
 // OSX is missing C++11 aligned_alloc (stdlib.h version)
@@ -41,6 +46,172 @@ uint32_t grk_make_aligned_width(uint32_t width){
 	return (uint32_t)((((uint64_t)width + grk_alignment - 1)/grk_alignment) * grk_alignment);
 }
 
+#ifndef _WIN32
+// While a codec has a memory budget, large blocks, such as tile buffers and
+// output strips, are mapped directly. The heap would otherwise keep them
+// once freed, in the arena of the thread that freed them, so that resident
+// memory stays at the high water mark of every thread, whatever the budget.
+// Otherwise, large blocks are only mapped if huge pages are enabled.
+const size_t grk_map_threshold = 1024 * 1024;
+const size_t grk_page_size = 4096;
+
+// Blocks of at least one huge page are mapped at a huge page boundary and
+// marked for transparent huge pages, so that column passes of the DWT and
+// T1 writeback, which touch a new 4 KB page on every row, hit the TLB.
+// Freed huge page blocks may be kept in a slab pool, already faulted in,
+// for the tile buffers of the next tile, which usually have the same size.
+#ifdef MADV_HUGEPAGE
+const size_t grk_huge_page_size = 2 * 1024 * 1024;
+#endif
+static std::atomic<bool> huge_pages_enabled(false);
+// number of codecs with a memory budget
+static std::atomic<uint32_t> map_requests(0);
+static size_t slab_pool_capacity = 0;
+static size_t slab_pool_size = 0;
+
+static std::mutex& mapped_mutex(void) {
+	static std::mutex mutex;
+	return mutex;
+}
+
+static std::unordered_map<void*, size_t>& mapped_blocks(void) {
+	static std::unordered_map<void*, size_t> blocks;
+	return blocks;
+}
+
+// freed huge page blocks, by size
+static std::multimap<size_t, void*>& slab_pool(void) {
+	static std::multimap<size_t, void*> pool;
+	return pool;
+}
+
+// trim slab pool to capacity; caller holds mapped mutex
+static void grk_trim_slab_pool(size_t capacity) {
+	auto &pool = slab_pool();
+	while (slab_pool_size > capacity) {
+		// largest slabs first
+		auto it = std::prev(pool.end());
+		munmap(it->second, it->first);
+		slab_pool_size -= it->first;
+		pool.erase(it);
+	}
+}
+
+#ifdef MADV_HUGEPAGE
+static void* grk_map_huge(size_t size) {
+	size = ((size + grk_huge_page_size - 1) / grk_huge_page_size)
+			* grk_huge_page_size;
+	{
+		std::lock_guard<std::mutex> guard(mapped_mutex());
+		// reuse a slab that wastes less than a quarter of its size
+		auto &pool = slab_pool();
+		auto it = pool.lower_bound(size);
+		if (it != pool.end() && it->first - size <= it->first / 4) {
+			auto ptr = it->second;
+			mapped_blocks()[ptr] = it->first;
+			slab_pool_size -= it->first;
+			pool.erase(it);
+
+			return ptr;
+		}
+	}
+	// over-allocate, then unmap head and tail to align to a huge page
+	size_t len = size + grk_huge_page_size;
+	auto base = (uint8_t*) mmap(nullptr, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return nullptr;
+	auto ptr = (uint8_t*) (((size_t) base + grk_huge_page_size - 1)
+			& ~(grk_huge_page_size - 1));
+	size_t head = (size_t) (ptr - base);
+	if (head)
+		munmap(base, head);
+	if (len - head > size)
+		munmap(ptr + size, len - head - size);
+	// advice only: without transparent huge page support, pages stay small
+	madvise(ptr, size, MADV_HUGEPAGE);
+	std::lock_guard<std::mutex> guard(mapped_mutex());
+	mapped_blocks()[ptr] = size;
+
+	return ptr;
+}
+#endif
+
+static void* grk_map(size_t size) {
+#ifdef MADV_HUGEPAGE
+	if (size >= grk_huge_page_size
+			&& huge_pages_enabled.load(std::memory_order_relaxed))
+		return grk_map_huge(size);
+#endif
+	auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return nullptr;
+	std::lock_guard<std::mutex> guard(mapped_mutex());
+	mapped_blocks()[ptr] = size;
+
+	return ptr;
+}
+
+static bool grk_unmap(void *ptr) {
+	// mapped blocks are page aligned, so other blocks are rarely looked up
+	if ((size_t) ptr & (grk_page_size - 1))
+		return false;
+	size_t size = 0;
+	{
+		std::lock_guard<std::mutex> guard(mapped_mutex());
+		auto it = mapped_blocks().find(ptr);
+		if (it == mapped_blocks().end())
+			return false;
+		size = it->second;
+		mapped_blocks().erase(it);
+#ifdef MADV_HUGEPAGE
+		bool huge = !((size_t) ptr & (grk_huge_page_size - 1))
+				&& !(size & (grk_huge_page_size - 1));
+		if (huge && slab_pool_size + size <= slab_pool_capacity) {
+			slab_pool().emplace(size, ptr);
+			slab_pool_size += size;
+
+			return true;
+		}
+#endif
+	}
+	munmap(ptr, size);
+
+	return true;
+}
+#endif
+
+void grk_set_huge_page_policy(bool enable, size_t pool_capacity) {
+#ifndef _WIN32
+	huge_pages_enabled = enable;
+	std::lock_guard<std::mutex> guard(mapped_mutex());
+	slab_pool_capacity = enable ? pool_capacity : 0;
+	grk_trim_slab_pool(slab_pool_capacity);
+#else
+	(void) enable;
+	(void) pool_capacity;
+#endif
+}
+
+void grk_map_large_blocks(bool enable) {
+#ifndef _WIN32
+	if (enable)
+		map_requests++;
+	else
+		map_requests--;
+#else
+	(void) enable;
+#endif
+}
+
+void grk_release_slab_pool(void) {
+#ifndef _WIN32
+	std::lock_guard<std::mutex> guard(mapped_mutex());
+	grk_trim_slab_pool(0);
+#endif
+}
+
 static inline void* grk_aligned_alloc_n(size_t alignment, size_t size) {
 	void *ptr;
 
@@ -54,6 +225,12 @@ static inline void* grk_aligned_alloc_n(size_t alignment, size_t size) {
 
 	// make new_size a multiple of alignment
 	size = ((size + alignment - 1)/alignment) * alignment;
+#ifndef _WIN32
+	if (size >= grk_map_threshold && alignment <= grk_page_size
+			&& (map_requests.load(std::memory_order_relaxed)
+					|| huge_pages_enabled.load(std::memory_order_relaxed)))
+		return grk_map(size);
+#endif
 
 #if defined(GROK_HAVE_ALIGNED_ALLOC)
 	ptr = aligned_alloc(alignment, size);
@@ -120,6 +297,10 @@ void* grk_aligned_malloc(size_t size) {
 }
 
 void grk_aligned_free(void *ptr) {
+#ifndef _WIN32
+	if (ptr && grk_unmap(ptr))
+		return;
+#endif
 #if defined(GROK_HAVE_POSIX_MEMALIGN) || defined(GROK_HAVE_ALIGNED_ALLOC) ||  defined(GROK_HAVE_MEMALIGN)
 	free(ptr);
 #elif defined(GROK_HAVE__ALIGNED_MALLOC)
@@ -52,6 +52,26 @@ void* grk_calloc(size_t numOfElements, size_t sizeOfElements);
 void* grk_aligned_malloc(size_t size);
 void grk_aligned_free(void *ptr);
 
+/**
+ Set huge page policy for large aligned blocks
+ @param enable back blocks of 2 MB and more with transparent huge pages
+ @param pool_capacity bytes of freed huge page blocks kept for reuse
+ */
+void grk_set_huge_page_policy(bool enable, size_t pool_capacity);
+
+/**
+ Map large aligned blocks directly, rather than taking them from the heap,
+ so that they are returned to the system when freed. Requests are counted:
+ blocks are mapped until each request is dropped
+ @param enable true to request mapping, false to drop a request
+ */
+void grk_map_large_blocks(bool enable);
+
+/**
+ Return freed huge page blocks kept for reuse to the system
+ */
+void grk_release_slab_pool(void);
+
 /**
  Reallocate memory blocks.
  @param m Pointer to previously allocated memory block
@@ -0,0 +1,66 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+namespace grk {
+
+std::atomic<bool> MemStats::s_enabled(false);
+std::atomic<uint64_t> MemStats::s_current[GRK_MEM_NUM_TAGS];
+std::atomic<uint64_t> MemStats::s_peak[GRK_MEM_NUM_TAGS];
+
+static const char *mem_tag_names[GRK_MEM_NUM_TAGS] = { "tile buffers",
+		"tile metadata", "code block data", "packet data", "T1 scratch",
+		"DWT scratch", "sparse arrays", "markers" };
+
+void MemStats::enable(bool enable) {
+	if (enable) {
+		for (uint32_t i = 0; i < GRK_MEM_NUM_TAGS; ++i)
+			s_peak[i] = s_current[i].load();
+	}
+	s_enabled = enable;
+}
+
+void MemStats::add(GRK_MEM_TAG tag, size_t bytes) {
+	uint64_t current = s_current[tag].fetch_add(bytes,
+			std::memory_order_relaxed) + bytes;
+	uint64_t peak = s_peak[tag].load(std::memory_order_relaxed);
+	while (current > peak
+			&& !s_peak[tag].compare_exchange_weak(peak, current,
+					std::memory_order_relaxed)) {
+	}
+}
+
+void MemStats::sub(GRK_MEM_TAG tag, size_t bytes) {
+	s_current[tag].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemStats::get(grk_memory_stats *stats) {
+	for (uint32_t i = 0; i < GRK_MEM_NUM_TAGS; ++i) {
+		stats->current[i] = s_current[i].load(std::memory_order_relaxed);
+		stats->peak[i] = s_peak[i].load(std::memory_order_relaxed);
+	}
+}
+
+const char* MemStats::tag_name(GRK_MEM_TAG tag) {
+	if ((uint32_t) tag >= GRK_MEM_NUM_TAGS)
+		return nullptr;
+
+	return mem_tag_names[tag];
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace grk {
+
+/**
+ * Process-wide memory accounting, per GRK_MEM_TAG.
+ */
+class MemStats {
+public:
+	static void enable(bool enable);
+	static bool enabled(void) {
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+	static void add(GRK_MEM_TAG tag, size_t bytes);
+	static void sub(GRK_MEM_TAG tag, size_t bytes);
+	static void get(grk_memory_stats *stats);
+	static const char* tag_name(GRK_MEM_TAG tag);
+
+private:
+	static std::atomic<bool> s_enabled;
+	static std::atomic<uint64_t> s_current[GRK_MEM_NUM_TAGS];
+	static std::atomic<uint64_t> s_peak[GRK_MEM_NUM_TAGS];
+};
+
+/**
+ * Memory held by an object, accounted to a tag.
+ *
+ * Only memory allocated while accounting is enabled is accounted for, and
+ * exactly that amount is returned once the object releases it, so counters
+ * stay consistent when accounting is toggled. Copies start with no memory.
+ */
+class MemAccount {
+public:
+	explicit MemAccount(GRK_MEM_TAG tag) :
+			m_tag(tag), m_bytes(0) {
+	}
+	MemAccount(const MemAccount &rhs) :
+			m_tag(rhs.m_tag), m_bytes(0) {
+	}
+	MemAccount& operator=(const MemAccount &rhs) {
+		if (this != &rhs) {
+			set(0);
+			m_tag = rhs.m_tag;
+		}
+		return *this;
+	}
+	~MemAccount() {
+		set(0);
+	}
+
+	/**
+	 * Set number of bytes held by object
+	 */
+	void set(size_t bytes) {
+		if (bytes == m_bytes)
+			return;
+		if (m_bytes) {
+			MemStats::sub(m_tag, m_bytes);
+			m_bytes = 0;
+		}
+		if (bytes && MemStats::enabled()) {
+			MemStats::add(m_tag, bytes);
+			m_bytes = bytes;
+		}
+	}
+
+	/**
+	 * Add to number of bytes held by object
+	 */
+	void add(size_t bytes) {
+		if (bytes && MemStats::enabled()) {
+			MemStats::add(m_tag, bytes);
+			m_bytes += bytes;
+		}
+	}
+
+	/**
+	 * Take over memory of another account with the same tag,
+	 * when ownership of the memory moves to this object
+	 */
+	void take(MemAccount *rhs) {
+		assert(rhs->m_tag == m_tag);
+		set(0);
+		m_bytes = rhs->m_bytes;
+		rhs->m_bytes = 0;
+	}
+
+private:
+	GRK_MEM_TAG m_tag;
+	size_t m_bytes;
+};
+
+}
@@ -0,0 +1,96 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+
+namespace grk {
+
+MemoryBudget::MemoryBudget(uint64_t max_bytes) :
+		m_max_bytes(max_bytes),
+		m_reserved(0),
+		m_peak(0),
+		m_num_in_flight(0) {
+	grk_map_large_blocks(true);
+}
+
+MemoryBudget::~MemoryBudget() {
+	grk_map_large_blocks(false);
+}
+
+bool MemoryBudget::admissible(uint64_t bytes) const {
+	return m_num_in_flight == 0 || (m_reserved <= m_max_bytes
+					&& bytes <= m_max_bytes - m_reserved);
+}
+
+void MemoryBudget::reserve(uint64_t bytes) {
+	m_reserved += bytes;
+	m_num_in_flight++;
+	m_peak = std::max<uint64_t>(m_peak, m_reserved);
+}
+
+void MemoryBudget::acquire(uint64_t bytes) {
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_cv.wait(lk, [this, bytes] {
+		return admissible(bytes);
+	});
+	reserve(bytes);
+}
+
+bool MemoryBudget::try_acquire(uint64_t bytes) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (!admissible(bytes))
+		return false;
+	reserve(bytes);
+
+	return true;
+}
+
+void MemoryBudget::release(uint64_t bytes) {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		assert(m_num_in_flight > 0 && m_reserved >= bytes);
+		m_reserved -= bytes;
+		m_num_in_flight--;
+	}
+	m_cv.notify_all();
+}
+
+void MemoryBudget::charge(uint64_t bytes) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_reserved += bytes;
+	m_peak = std::max<uint64_t>(m_peak, m_reserved);
+}
+
+void MemoryBudget::discharge(uint64_t bytes) {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		assert(m_reserved >= bytes);
+		m_reserved -= bytes;
+	}
+	m_cv.notify_all();
+}
+
+uint64_t MemoryBudget::peak(void) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_peak;
+}
+
+uint64_t MemoryBudget::limit(void) const {
+	return m_max_bytes;
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+
+namespace grk {
+
+/**
+ * Admission control for tiles in flight.
+ *
+ * Before a tile is started, the memory it will need is reserved
+ * against the budget; the reservation is returned once the tile's
+ * memory has been freed. A tile is admitted while the budget
+ * is exceeded only if no other tile is in flight, so that a
+ * tile larger than the budget is still processed, on its own.
+ *
+ * The budget is thread safe. While a budget exists, large blocks are
+ * mapped directly, so that the memory of finished tiles is returned
+ * to the system.
+ */
+class MemoryBudget {
+public:
+	/**
+	 * @param max_bytes	maximum number of bytes reserved at any one time
+	 */
+	explicit MemoryBudget(uint64_t max_bytes);
+	~MemoryBudget();
+
+	/**
+	 * Reserve bytes for a tile, waiting for other tiles
+	 * to return their reservations if the budget is exceeded
+	 *
+	 * @param bytes		number of bytes
+	 */
+	void acquire(uint64_t bytes);
+
+	/**
+	 * Reserve bytes for a tile, without waiting
+	 *
+	 * @param bytes		number of bytes
+	 * @return true if reserved
+	 */
+	bool try_acquire(uint64_t bytes);
+
+	/**
+	 * Return the reservation of a tile
+	 *
+	 * @param bytes		number of bytes passed to acquire
+	 */
+	void release(uint64_t bytes);
+
+	/**
+	 * Account for memory that is held outside of tiles in flight,
+	 * such as output strips waiting for the rest of their tiles.
+	 * Never waits, but delays admission of new tiles
+	 *
+	 * @param bytes		number of bytes
+	 */
+	void charge(uint64_t bytes);
+
+	/**
+	 * Return memory accounted for by charge
+	 *
+	 * @param bytes		number of bytes passed to charge
+	 */
+	void discharge(uint64_t bytes);
+
+	/**
+	 * Largest number of bytes reserved at any one time
+	 */
+	uint64_t peak(void);
+
+	uint64_t limit(void) const;
+
+private:
+	bool admissible(uint64_t bytes) const;
+	void reserve(uint64_t bytes);
+
+	uint64_t m_max_bytes;
+	uint64_t m_reserved;
+	uint64_t m_peak;
+	uint32_t m_num_in_flight;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+};
+
+}
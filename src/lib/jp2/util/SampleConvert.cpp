@@ -0,0 +1,284 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "grk_includes.h"
+#include <limits>
+
+namespace grk {
+
+size_t grk_sample_size(GRK_SAMPLE_TYPE type) {
+	switch (type) {
+	case GRK_SAMPLE_UINT8:
+		return sizeof(uint8_t);
+	case GRK_SAMPLE_UINT16:
+		return sizeof(uint16_t);
+	case GRK_SAMPLE_INT16:
+		return sizeof(int16_t);
+	case GRK_SAMPLE_FLOAT:
+		return sizeof(float);
+	}
+
+	return 0;
+}
+
+template<typename T> static void convert_scalar(const int32_t *src, uint32_t w,
+		T *dest, uint32_t step) {
+	const int32_t min = std::numeric_limits<T>::min();
+	const int32_t max = std::numeric_limits<T>::max();
+	for (uint32_t i = 0; i < w; ++i)
+		dest[(size_t) i * step] = (T) std::clamp<int32_t>(src[i], min, max);
+}
+
+static void convert_8u(const int32_t *src, uint32_t w, uint8_t *dest) {
+	uint32_t i = 0;
+#if defined(__SSE2__)
+	// saturating packs clamp to [0,255]
+	for (; i + 16 <= w; i += 16) {
+		auto s0 = _mm_loadu_si128((const __m128i*) (src + i));
+		auto s1 = _mm_loadu_si128((const __m128i*) (src + i + 4));
+		auto s2 = _mm_loadu_si128((const __m128i*) (src + i + 8));
+		auto s3 = _mm_loadu_si128((const __m128i*) (src + i + 12));
+		auto lo = _mm_packs_epi32(s0, s1);
+		auto hi = _mm_packs_epi32(s2, s3);
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	convert_scalar<uint8_t>(src + i, w - i, dest + i, 1);
+}
+
+static void convert_16u(const int32_t *src, uint32_t w, uint16_t *dest) {
+	uint32_t i = 0;
+#if defined(__SSE4_1__)
+	for (; i + 8 <= w; i += 8) {
+		auto s0 = _mm_loadu_si128((const __m128i*) (src + i));
+		auto s1 = _mm_loadu_si128((const __m128i*) (src + i + 4));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packus_epi32(s0, s1));
+	}
+#endif
+	convert_scalar<uint16_t>(src + i, w - i, dest + i, 1);
+}
+
+static void convert_16s(const int32_t *src, uint32_t w, int16_t *dest) {
+	uint32_t i = 0;
+#if defined(__SSE2__)
+	for (; i + 8 <= w; i += 8) {
+		auto s0 = _mm_loadu_si128((const __m128i*) (src + i));
+		auto s1 = _mm_loadu_si128((const __m128i*) (src + i + 4));
+		_mm_storeu_si128((__m128i*) (dest + i), _mm_packs_epi32(s0, s1));
+	}
+#endif
+	convert_scalar<int16_t>(src + i, w - i, dest + i, 1);
+}
+
+static void convert_float(const int32_t *src, uint32_t w, float *dest,
+		uint32_t step) {
+	uint32_t i = 0;
+#if defined(__SSE2__)
+	if (step == 1) {
+		for (; i + 4 <= w; i += 4)
+			_mm_storeu_ps(dest + i,
+					_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (src + i))));
+	}
+#endif
+	for (; i < w; ++i)
+		dest[(size_t) i * step] = (float) src[i];
+}
+
+#if defined(__SSSE3__)
+// store low 12 bytes of v
+static inline void store_12(uint8_t *dest, __m128i v) {
+	_mm_storel_epi64((__m128i*) dest, v);
+	int32_t hi = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+	memcpy(dest + 8, &hi, sizeof(hi));
+}
+#endif
+
+static void interleave_8u(const int32_t *const *src, uint32_t numcomps,
+		uint32_t w, uint8_t *dest) {
+	uint32_t i = 0;
+#if defined(__SSSE3__)
+	// four samples of each component are packed into one register,
+	// component after component, and then shuffled into pixel order
+	if (numcomps == 4) {
+		const __m128i order = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6,
+				10, 14, 3, 7, 11, 15);
+		for (; i + 4 <= w; i += 4) {
+			auto s0 = _mm_loadu_si128((const __m128i*) (src[0] + i));
+			auto s1 = _mm_loadu_si128((const __m128i*) (src[1] + i));
+			auto s2 = _mm_loadu_si128((const __m128i*) (src[2] + i));
+			auto s3 = _mm_loadu_si128((const __m128i*) (src[3] + i));
+			auto packed = _mm_packus_epi16(_mm_packs_epi32(s0, s1),
+					_mm_packs_epi32(s2, s3));
+			_mm_storeu_si128((__m128i*) (dest + (size_t) i * 4),
+					_mm_shuffle_epi8(packed, order));
+		}
+	} else if (numcomps == 3) {
+		const __m128i order = _mm_setr_epi8(0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7,
+				11, -1, -1, -1, -1);
+		for (; i + 4 <= w; i += 4) {
+			auto s0 = _mm_loadu_si128((const __m128i*) (src[0] + i));
+			auto s1 = _mm_loadu_si128((const __m128i*) (src[1] + i));
+			auto s2 = _mm_loadu_si128((const __m128i*) (src[2] + i));
+			auto packed = _mm_packus_epi16(_mm_packs_epi32(s0, s1),
+					_mm_packs_epi32(s2, s2));
+			store_12(dest + (size_t) i * 3, _mm_shuffle_epi8(packed, order));
+		}
+	}
+#endif
+	for (uint32_t compno = 0; compno < numcomps; ++compno)
+		convert_scalar<uint8_t>(src[compno] + i, w - i,
+				dest + (size_t) i * numcomps + compno, numcomps);
+}
+
+template<typename T> static void interleave_16(const int32_t *const *src,
+		uint32_t numcomps, uint32_t w, T *dest) {
+	uint32_t i = 0;
+#if defined(__SSE4_1__)
+	auto pack = [](__m128i a, __m128i b) {
+		return std::is_signed<T>::value ?
+				_mm_packs_epi32(a, b) : _mm_packus_epi32(a, b);
+	};
+	// components 0 and 2, and components 1 and 3, are packed together,
+	// and then unpacked twice into pixel order
+	if (numcomps == 4) {
+		for (; i + 4 <= w; i += 4) {
+			auto s0 = _mm_loadu_si128((const __m128i*) (src[0] + i));
+			auto s1 = _mm_loadu_si128((const __m128i*) (src[1] + i));
+			auto s2 = _mm_loadu_si128((const __m128i*) (src[2] + i));
+			auto s3 = _mm_loadu_si128((const __m128i*) (src[3] + i));
+			auto even = pack(s0, s2);
+			auto odd = pack(s1, s3);
+			auto lo = _mm_unpacklo_epi16(even, odd);
+			auto hi = _mm_unpackhi_epi16(even, odd);
+			auto out = (__m128i*) (dest + (size_t) i * 4);
+			_mm_storeu_si128(out, _mm_unpacklo_epi32(lo, hi));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi32(lo, hi));
+		}
+	} else if (numcomps == 3) {
+		// drop the fourth sample of each pixel
+		const __m128i order = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11,
+				12, 13, -1, -1, -1, -1);
+		for (; i + 4 <= w; i += 4) {
+			auto s0 = _mm_loadu_si128((const __m128i*) (src[0] + i));
+			auto s1 = _mm_loadu_si128((const __m128i*) (src[1] + i));
+			auto s2 = _mm_loadu_si128((const __m128i*) (src[2] + i));
+			auto even = pack(s0, s2);
+			auto odd = pack(s1, s1);
+			auto lo = _mm_unpacklo_epi16(even, odd);
+			auto hi = _mm_unpackhi_epi16(even, odd);
+			auto out = (uint8_t*) (dest + (size_t) i * 3);
+			store_12(out, _mm_shuffle_epi8(_mm_unpacklo_epi32(lo, hi), order));
+			store_12(out + 12,
+					_mm_shuffle_epi8(_mm_unpackhi_epi32(lo, hi), order));
+		}
+	}
+#endif
+	for (uint32_t compno = 0; compno < numcomps; ++compno)
+		convert_scalar<T>(src[compno] + i, w - i,
+				dest + (size_t) i * numcomps + compno, numcomps);
+}
+
+template<typename T> static void unpack(const T *src, uint32_t w,
+		uint32_t step, int32_t shift, int32_t *dest) {
+	uint32_t i = 0;
+#if defined(__SSE4_1__)
+	if (step == 1) {
+		const __m128i vshift = _mm_set1_epi32(shift);
+		for (; i + 4 <= w; i += 4) {
+			__m128i s;
+			if (sizeof(T) == 1) {
+				int32_t v;
+				memcpy(&v, src + i, sizeof(v));
+				s = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(v));
+			} else {
+				auto v = _mm_loadl_epi64((const __m128i*) (src + i));
+				s = std::is_signed<T>::value ?
+						_mm_cvtepi16_epi32(v) : _mm_cvtepu16_epi32(v);
+			}
+			_mm_storeu_si128((__m128i*) (dest + i), _mm_sub_epi32(s, vshift));
+		}
+	}
+#endif
+	for (; i < w; ++i)
+		dest[i] = (int32_t) src[(size_t) i * step] - shift;
+}
+
+void grk_unpack_row(const uint8_t *src, uint32_t w, GRK_SAMPLE_TYPE type,
+		uint32_t step, int32_t shift, int32_t *dest) {
+	switch (type) {
+	case GRK_SAMPLE_UINT8:
+		unpack<uint8_t>(src, w, step, shift, dest);
+		break;
+	case GRK_SAMPLE_UINT16:
+		unpack<uint16_t>((const uint16_t*) src, w, step, shift, dest);
+		break;
+	case GRK_SAMPLE_INT16:
+		unpack<int16_t>((const int16_t*) src, w, step, shift, dest);
+		break;
+	case GRK_SAMPLE_FLOAT:
+		assert(false);
+		break;
+	}
+}
+
+void grk_convert_row(const int32_t *src, uint32_t w, GRK_SAMPLE_TYPE type,
+		uint8_t *dest, uint32_t step) {
+	switch (type) {
+	case GRK_SAMPLE_UINT8:
+		if (step == 1)
+			convert_8u(src, w, dest);
+		else
+			convert_scalar<uint8_t>(src, w, dest, step);
+		break;
+	case GRK_SAMPLE_UINT16:
+		if (step == 1)
+			convert_16u(src, w, (uint16_t*) dest);
+		else
+			convert_scalar<uint16_t>(src, w, (uint16_t*) dest, step);
+		break;
+	case GRK_SAMPLE_INT16:
+		if (step == 1)
+			convert_16s(src, w, (int16_t*) dest);
+		else
+			convert_scalar<int16_t>(src, w, (int16_t*) dest, step);
+		break;
+	case GRK_SAMPLE_FLOAT:
+		convert_float(src, w, (float*) dest, step);
+		break;
+	}
+}
+
+void grk_interleave_row(const int32_t *const *src, uint32_t numcomps,
+		uint32_t w, GRK_SAMPLE_TYPE type, uint8_t *dest) {
+	switch (type) {
+	case GRK_SAMPLE_UINT8:
+		interleave_8u(src, numcomps, w, dest);
+		break;
+	case GRK_SAMPLE_UINT16:
+		interleave_16<uint16_t>(src, numcomps, w, (uint16_t*) dest);
+		break;
+	case GRK_SAMPLE_INT16:
+		interleave_16<int16_t>(src, numcomps, w, (int16_t*) dest);
+		break;
+	case GRK_SAMPLE_FLOAT:
+		for (uint32_t compno = 0; compno < numcomps; ++compno)
+			convert_float(src[compno], w, (float*) dest + compno, numcomps);
+		break;
+	}
+}
+
+}
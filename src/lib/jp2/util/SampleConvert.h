@@ -0,0 +1,72 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+namespace grk {
+
+/**
+ * Get size in bytes of sample type
+ */
+size_t grk_sample_size(GRK_SAMPLE_TYPE type);
+
+/**
+ * Convert a row of 32 bit samples to the given sample type, clamping
+ * to the range of the type.
+ *
+ * @param src		source samples
+ * @param w			number of samples
+ * @param type		destination sample type
+ * @param dest		destination
+ * @param step		number of destination samples between consecutive
+ * 					converted samples: 1 for planar, number of
+ * 					components for interleaved
+ */
+void grk_convert_row(const int32_t *src, uint32_t w, GRK_SAMPLE_TYPE type,
+		uint8_t *dest, uint32_t step);
+
+/**
+ * Convert one row of each component to interleaved samples of the given
+ * sample type, clamping to the range of the type. Rows of 3 and 4
+ * components are interleaved and packed together.
+ *
+ * @param src		source row of each component
+ * @param numcomps	number of components
+ * @param w			number of samples in each row
+ * @param type		destination sample type
+ * @param dest		destination
+ */
+void grk_interleave_row(const int32_t *const *src, uint32_t numcomps,
+		uint32_t w, GRK_SAMPLE_TYPE type, uint8_t *dest);
+
+/**
+ * Convert a row of samples of the given type to 32 bit samples,
+ * subtracting a DC level shift.
+ *
+ * @param src		source samples
+ * @param w			number of samples
+ * @param type		source sample type; float is not supported
+ * @param step		number of source samples between consecutive
+ * 					converted samples: 1 for planar, number of
+ * 					components for interleaved
+ * @param shift		DC level shift
+ * @param dest		destination
+ */
+void grk_unpack_row(const uint8_t *src, uint32_t w, GRK_SAMPLE_TYPE type,
+		uint32_t step, int32_t shift, int32_t *dest);
+
+}
@@ -0,0 +1,123 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ Compress a synthetic multi-tile image and report compression time
+ and peak resident set size.
+
+ Peak RSS is a per-process high water mark, so each tile window size
+ should be measured in a separate run:
+
+ bench_compress_window [window] [threads] [image size] [tile size] [output file]
+ */
+
+#include "grok.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <sys/resource.h>
+
+int main(int argc, char **argv) {
+	uint32_t window = argc > 1 ? (uint32_t) atoi(argv[1]) : 0;
+	uint32_t num_threads = argc > 2 ? (uint32_t) atoi(argv[2]) : 0;
+	uint32_t size = argc > 3 ? (uint32_t) atoi(argv[3]) : 8192;
+	uint32_t tile_size = argc > 4 ? (uint32_t) atoi(argv[4]) : 512;
+	const char *out = argc > 5 ? argv[5] : "/dev/null";
+	const uint32_t numcomps = 3;
+	int rc = EXIT_FAILURE;
+
+	if (!size || !tile_size) {
+		fprintf(stderr,
+				"usage: %s [window] [threads] [image size] [tile size] [output file]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, num_threads);
+
+	grk_image_cmptparm cmptparm[numcomps];
+	memset(cmptparm, 0, sizeof(cmptparm));
+	for (uint32_t i = 0; i < numcomps; ++i) {
+		cmptparm[i].dx = 1;
+		cmptparm[i].dy = 1;
+		cmptparm[i].w = size;
+		cmptparm[i].h = size;
+		cmptparm[i].prec = 8;
+	}
+	grk_stream *stream = nullptr;
+	grk_codec codec = nullptr;
+	auto image = grk_image_create(numcomps, cmptparm, GRK_CLRSPC_SRGB, true);
+	if (!image) {
+		fprintf(stderr, "failed to create image\n");
+		goto cleanup;
+	}
+	image->x1 = size;
+	image->y1 = size;
+	for (uint32_t i = 0; i < numcomps; ++i) {
+		auto comp = image->comps + i;
+		for (uint32_t y = 0; y < size; ++y) {
+			auto row = comp->data + (size_t) y * comp->stride;
+			for (uint32_t x = 0; x < size; ++x)
+				row[x] = (int32_t) (((x * (i + 1)) ^ (y * 3)) & 0xFF);
+		}
+	}
+
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.numThreads = num_threads;
+	parameters.tileWindow = window;
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	parameters.cod_format = GRK_J2K_FMT;
+	parameters.writeTLM = true;
+
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		stream = grk_stream_create_file_stream(out, 1024 * 1024, false);
+		if (!stream) {
+			fprintf(stderr, "failed to create output stream %s\n", out);
+			goto cleanup;
+		}
+		codec = grk_create_compress(GRK_CODEC_J2K, stream);
+		if (!codec || !grk_init_compress(codec, &parameters, image)
+				|| !grk_start_compress(codec) || !grk_compress(codec)
+				|| !grk_end_compress(codec)) {
+			fprintf(stderr, "compression failed\n");
+			goto cleanup;
+		}
+		auto finish = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed = finish - start;
+
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		printf("window %u, threads %u, image %ux%u, tiles %ux%u: "
+				"%.3f s, peak RSS %ld KB\n", window, num_threads, size, size,
+				tile_size, tile_size, elapsed.count(), usage.ru_maxrss);
+	}
+	rc = EXIT_SUCCESS;
+cleanup:
+	if (stream)
+		grk_stream_destroy(stream);
+	if (codec)
+		grk_destroy_codec(codec);
+	if (image)
+		grk_image_destroy(image);
+	grk_deinitialize();
+
+	return rc;
+}
@@ -0,0 +1,285 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ Compress and decompress a synthetic single tile image with small pages,
+ with huge pages, and with huge pages plus slab pool, and report time,
+ dTLB misses and page faults of each policy.
+
+ Counters are inherited by the threads of the thread pool, and only
+ include a thread once it exits, so each policy is measured in a child
+ process that counts from grk_initialize to grk_deinitialize.
+ dTLB misses are reported as n/a where hardware counters are not available.
+
+ bench_huge_pages [iterations] [threads] [tile size]
+ */
+
+#include "grok.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+const uint32_t numcomps = 3;
+
+enum Policy {
+	SMALL_PAGES, HUGE_PAGES, HUGE_PAGES_POOL, NUM_POLICIES
+};
+const char *policy_names[NUM_POLICIES] =
+		{ "small pages", "huge pages", "huge pages + pool" };
+
+struct Result {
+	double compress_ms;
+	double decompress_ms;
+	long long dtlb_misses;
+	long long page_faults;
+};
+
+#ifdef __linux__
+static int open_counter(uint32_t type, uint64_t config) {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.inherit = 1;
+
+	return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static long long read_counter(int fd) {
+	long long count = 0;
+	if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+		return -1;
+	close(fd);
+
+	return count;
+}
+
+static grk_image* create_image(uint32_t size) {
+	grk_image_cmptparm cmptparm[numcomps];
+	memset(cmptparm, 0, sizeof(cmptparm));
+	for (uint32_t i = 0; i < numcomps; ++i) {
+		cmptparm[i].dx = 1;
+		cmptparm[i].dy = 1;
+		cmptparm[i].w = size;
+		cmptparm[i].h = size;
+		cmptparm[i].prec = 8;
+	}
+	auto image = grk_image_create(numcomps, cmptparm, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return nullptr;
+	image->x1 = size;
+	image->y1 = size;
+	for (uint32_t i = 0; i < numcomps; ++i) {
+		auto comp = image->comps + i;
+		for (uint32_t y = 0; y < size; ++y) {
+			auto row = comp->data + (size_t) y * comp->stride;
+			for (uint32_t x = 0; x < size; ++x)
+				row[x] = (int32_t) (((x * (i + 1)) ^ (y * 3)) & 0xFF);
+		}
+	}
+
+	return image;
+}
+
+static bool compress(grk_image *image, const char *out, uint32_t num_threads,
+		uint32_t size) {
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.numThreads = num_threads;
+	parameters.tile_size_on = true;
+	parameters.t_width = size;
+	parameters.t_height = size;
+	parameters.cod_format = GRK_J2K_FMT;
+	bool rc = false;
+
+	auto stream = grk_stream_create_file_stream(out, 1024 * 1024, false);
+	if (!stream)
+		return false;
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	if (codec)
+		rc = grk_init_compress(codec, &parameters, image)
+				&& grk_start_compress(codec) && grk_compress(codec)
+				&& grk_end_compress(codec);
+	grk_stream_destroy(stream);
+	if (codec)
+		grk_destroy_codec(codec);
+
+	return rc;
+}
+
+static bool decompress(const char *in) {
+	grk_image *image = nullptr;
+	grk_header_info header_info;
+	memset(&header_info, 0, sizeof(header_info));
+	grk_dparameters parameters;
+	grk_set_default_decompress_params(&parameters);
+	bool rc = false;
+
+	auto stream = grk_stream_create_file_stream(in, 1024 * 1024, true);
+	if (!stream)
+		return false;
+	auto codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+	if (codec)
+		rc = grk_init_decompress(codec, &parameters)
+				&& grk_read_header(codec, &header_info, &image)
+				&& grk_decompress(codec, nullptr, image)
+				&& grk_end_decompress(codec);
+	if (codec)
+		grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+
+	return rc;
+}
+
+static bool measure(Policy policy, const char *file, uint32_t iterations,
+		uint32_t num_threads, uint32_t size, Result *result) {
+	auto image = create_image(size);
+	if (!image)
+		return false;
+#ifdef __linux__
+	int dtlb = open_counter(PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+					| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	int faults = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+#else
+	int dtlb = -1;
+	int faults = -1;
+#endif
+	grk_initialize(nullptr, num_threads);
+	grk_set_huge_pages(policy != SMALL_PAGES,
+			policy == HUGE_PAGES_POOL ? 4ULL * 1024 * 1024 * 1024 : 0);
+	bool rc = true;
+	std::chrono::duration<double> compress_time(0), decompress_time(0);
+	for (uint32_t i = 0; i < iterations && rc; ++i) {
+		auto start = std::chrono::high_resolution_clock::now();
+		rc = compress(image, file, num_threads, size);
+		auto finish = std::chrono::high_resolution_clock::now();
+		compress_time += finish - start;
+		if (!rc)
+			break;
+		start = std::chrono::high_resolution_clock::now();
+		rc = decompress(file);
+		finish = std::chrono::high_resolution_clock::now();
+		decompress_time += finish - start;
+	}
+	grk_deinitialize();
+	result->dtlb_misses = read_counter(dtlb);
+	result->page_faults = read_counter(faults);
+	result->compress_ms = compress_time.count() * 1000 / iterations;
+	result->decompress_ms = decompress_time.count() * 1000 / iterations;
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+/**
+ * Measure a policy in a child process
+ */
+static bool run(Policy policy, const char *file, uint32_t iterations,
+		uint32_t num_threads, uint32_t size, Result *result) {
+	int fd[2];
+	if (pipe(fd))
+		return false;
+	// buffered output would otherwise be written by both processes
+	fflush(stdout);
+	auto pid = fork();
+	if (pid < 0)
+		return false;
+	if (pid == 0) {
+		close(fd[0]);
+		Result res;
+		memset(&res, 0, sizeof(res));
+		bool rc = measure(policy, file, iterations, num_threads, size, &res)
+				&& write(fd[1], &res, sizeof(res)) == sizeof(res);
+		close(fd[1]);
+		_exit(rc ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	close(fd[1]);
+	bool rc = read(fd[0], result, sizeof(*result)) == sizeof(*result);
+	close(fd[0]);
+	int status = 0;
+	waitpid(pid, &status, 0);
+
+	return rc && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+static void print_count(long long count, long long base) {
+	if (count < 0 || base < 0) {
+		printf(" %14s %8s", "n/a", "");
+		return;
+	}
+	printf(" %14lld %7.1f%%", count,
+			base ? (double) (count - base) * 100 / (double) base : 0.0);
+}
+
+int main(int argc, char **argv) {
+	uint32_t iterations = argc > 1 ? (uint32_t) atoi(argv[1]) : 3;
+	uint32_t num_threads = argc > 2 ? (uint32_t) atoi(argv[2]) : 0;
+	uint32_t size = argc > 3 ? (uint32_t) atoi(argv[3]) : 4096;
+	int rc = EXIT_SUCCESS;
+
+	if (!iterations || !size) {
+		fprintf(stderr, "usage: %s [iterations] [threads] [tile size]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	char file[] = "/tmp/bench_huge_pages_XXXXXX";
+	int tmp = mkstemp(file);
+	if (tmp < 0) {
+		fprintf(stderr, "failed to create temporary file\n");
+		return EXIT_FAILURE;
+	}
+	close(tmp);
+
+	printf("tile %ux%u, %u components, %u iterations\n", size, size,
+			numcomps, iterations);
+	printf("%-18s %14s %14s %23s %23s\n", "policy", "compress ms",
+			"decompress ms", "dTLB misses", "page faults");
+	Result results[NUM_POLICIES];
+	for (int p = 0; p < NUM_POLICIES; ++p) {
+		auto res = results + p;
+		if (!run((Policy) p, file, iterations, num_threads, size, res)) {
+			fprintf(stderr, "%s failed\n", policy_names[p]);
+			rc = EXIT_FAILURE;
+			break;
+		}
+		auto base = results;
+		printf("%-18s %7.1f %+5.1f%% %7.1f %+5.1f%%", policy_names[p],
+				res->compress_ms,
+				(res->compress_ms - base->compress_ms) * 100
+						/ base->compress_ms, res->decompress_ms,
+				(res->decompress_ms - base->decompress_ms) * 100
+						/ base->decompress_ms);
+		print_count(res->dtlb_misses, base->dtlb_misses);
+		print_count(res->page_faults, base->page_faults);
+		printf("\n");
+	}
+	unlink(file);
+
+	return rc;
+}
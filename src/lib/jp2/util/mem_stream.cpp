@@ -122,6 +122,60 @@ size_t get_mem_stream_offset(grk_stream *stream) {
 	return buf->off;
 }
 
+struct growable_buf_info {
+	growable_buf_info() : off(0), len(0) {
+	}
+	std::vector<uint8_t> data;
+	size_t off;
+	size_t len;
+};
+
+static void free_growable_mem(void *user_data) {
+	delete (growable_buf_info*) user_data;
+}
+
+static size_t write_to_growable_mem(void *src, size_t nb_bytes,
+		growable_buf_info *dest) {
+	if (dest->off + nb_bytes > dest->data.size())
+		dest->data.resize(std::max<size_t>(dest->off + nb_bytes,
+								2 * dest->data.size()));
+	memcpy(dest->data.data() + dest->off, src, nb_bytes);
+	dest->off += nb_bytes;
+	dest->len = std::max<size_t>(dest->len, dest->off);
+
+	return nb_bytes;
+}
+
+static bool seek_from_growable_mem(uint64_t nb_bytes,
+		growable_buf_info *dest) {
+	if (nb_bytes > dest->data.size())
+		dest->data.resize((size_t) nb_bytes);
+	dest->off = (size_t) nb_bytes;
+	dest->len = std::max<size_t>(dest->len, dest->off);
+
+	return true;
+}
+
+grk_stream* create_growable_mem_stream(size_t buffer_size) {
+	auto l_stream = new BufferedStream(nullptr, buffer_size, false);
+	grk_stream_set_user_data((grk_stream*) l_stream, new growable_buf_info(),
+			free_growable_mem);
+	grk_stream_set_write_function((grk_stream*) l_stream,
+			(grk_stream_write_fn) write_to_growable_mem);
+	grk_stream_set_seek_function((grk_stream*) l_stream,
+			(grk_stream_seek_fn) seek_from_growable_mem);
+
+	return (grk_stream*) l_stream;
+}
+
+const uint8_t* get_growable_mem_stream_data(grk_stream *stream, size_t *len) {
+	auto private_stream = (BufferedStream*) stream;
+	auto info = (growable_buf_info*) private_stream->m_user_data;
+	*len = info->len;
+
+	return info->data.data();
+}
+
 grk_stream* create_mem_stream(uint8_t *buf, size_t len, bool ownsBuffer,
 		bool is_read_stream) {
 	if (!buf || !len) {
@@ -50,6 +50,22 @@ grk_stream  *  create_mem_stream(uint8_t *buf, size_t len, bool ownsBuffer,
 		bool is_read_stream);
 size_t get_mem_stream_offset( grk_stream  *stream);
 
+/**
+ * Create an output stream backed by a memory buffer that grows as needed
+ *
+ * @param buffer_size	size of internal stream buffer
+ */
+grk_stream* create_growable_mem_stream(size_t buffer_size);
+
+/**
+ * Get data written to a growable memory stream.
+ * Stream must be flushed first.
+ *
+ * @param stream	growable memory stream
+ * @param len		number of bytes written
+ */
+const uint8_t* get_growable_mem_stream_data(grk_stream *stream, size_t *len);
+
 /*
  * Callback function prototype for zero copy read function
  */
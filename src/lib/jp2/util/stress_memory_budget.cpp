@@ -0,0 +1,248 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ Compress and decompress a synthetic multi-tile image, with and without
+ a memory budget, and check that the budget bounds the growth of peak
+ resident set size.
+
+ The bound is measured rather than assumed: a budget of one byte admits
+ one tile at a time, so its run gives the growth of a single tile in flight
+ together with the scratch of every thread. With the budget under test,
+ growth may only exceed that baseline by the budget itself.
+
+ Peak RSS is a per-process high water mark, so each run takes place in
+ a child process. Growth is measured from the peak RSS once the source image
+ (compression) or the header (decompression) is in memory; decompressed
+ rows are delivered to a strip sink, so the output image is never allocated.
+
+ stress_memory_budget [budget MB] [threads] [image size] [tile size]
+ */
+
+#include "grok.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+const uint32_t numcomps = 3;
+
+// allowance, as a fraction of the baseline, for allocator and page noise
+const long noise_divisor = 8;
+
+static long peak_rss_kb(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static bool compress(const char *out, uint64_t budget, uint32_t num_threads,
+		uint32_t size, uint32_t tile_size, long *growth_kb) {
+	grk_image_cmptparm cmptparm[numcomps];
+	memset(cmptparm, 0, sizeof(cmptparm));
+	for (uint32_t i = 0; i < numcomps; ++i) {
+		cmptparm[i].dx = 1;
+		cmptparm[i].dy = 1;
+		cmptparm[i].w = size;
+		cmptparm[i].h = size;
+		cmptparm[i].prec = 8;
+	}
+	grk_stream *stream = nullptr;
+	grk_codec codec = nullptr;
+	bool rc = false;
+	long start_kb = 0;
+	auto image = grk_image_create(numcomps, cmptparm, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return false;
+	image->x1 = size;
+	image->y1 = size;
+	for (uint32_t i = 0; i < numcomps; ++i) {
+		auto comp = image->comps + i;
+		for (uint32_t y = 0; y < size; ++y) {
+			auto row = comp->data + (size_t) y * comp->stride;
+			for (uint32_t x = 0; x < size; ++x)
+				row[x] = (int32_t) (((x * (i + 1)) ^ (y * 3)) & 0xFF);
+		}
+	}
+	start_kb = peak_rss_kb();
+
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.numThreads = num_threads;
+	parameters.maxMemory = budget;
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	parameters.cod_format = GRK_J2K_FMT;
+
+	stream = grk_stream_create_file_stream(out, 1024 * 1024, false);
+	if (!stream)
+		goto cleanup;
+	codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	if (!codec || !grk_init_compress(codec, &parameters, image)
+			|| !grk_start_compress(codec) || !grk_compress(codec)
+			|| !grk_end_compress(codec))
+		goto cleanup;
+	*growth_kb = peak_rss_kb() - start_kb;
+	rc = true;
+cleanup:
+	if (stream)
+		grk_stream_destroy(stream);
+	if (codec)
+		grk_destroy_codec(codec);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+static bool discard_strip(grk_image *strip, void *user_data) {
+	(void) strip;
+	(void) user_data;
+
+	return true;
+}
+
+static bool decompress(const char *in, uint64_t budget, long *growth_kb) {
+	grk_image *image = nullptr;
+	grk_header_info header_info;
+	memset(&header_info, 0, sizeof(header_info));
+	grk_dparameters parameters;
+	grk_set_default_decompress_params(&parameters);
+	parameters.max_memory = budget;
+	bool rc = false;
+	long start_kb = 0;
+	grk_codec codec = nullptr;
+	auto stream = grk_stream_create_file_stream(in, 1024 * 1024, true);
+	if (!stream)
+		return false;
+	codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+	if (!codec || !grk_init_decompress(codec, &parameters)
+			|| !grk_read_header(codec, &header_info, &image)
+			|| !grk_set_strip_sink(codec, discard_strip, nullptr))
+		goto cleanup;
+	start_kb = peak_rss_kb();
+	if (!grk_decompress(codec, nullptr, image) || !grk_end_decompress(codec))
+		goto cleanup;
+	*growth_kb = peak_rss_kb() - start_kb;
+	rc = true;
+cleanup:
+	if (codec)
+		grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+
+	return rc;
+}
+
+/**
+ * Run compression or decompression in a child process
+ *
+ * @return growth of peak RSS in KB, or -1 on failure
+ */
+static long run(bool do_compress, const char *file, uint64_t budget,
+		uint32_t num_threads, uint32_t size, uint32_t tile_size) {
+	int fd[2];
+	if (pipe(fd))
+		return -1;
+	// buffered output would otherwise be written by both processes
+	fflush(stdout);
+	auto pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0) {
+		close(fd[0]);
+		grk_initialize(nullptr, num_threads);
+		long growth_kb = -1;
+		bool rc = do_compress ?
+				compress(file, budget, num_threads, size, tile_size,
+						&growth_kb) :
+				decompress(file, budget, &growth_kb);
+		grk_deinitialize();
+		if (!rc)
+			growth_kb = -1;
+		bool written = write(fd[1], &growth_kb, sizeof(growth_kb))
+				== sizeof(growth_kb);
+		close(fd[1]);
+		_exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	close(fd[1]);
+	long growth_kb = -1;
+	if (read(fd[0], &growth_kb, sizeof(growth_kb)) != sizeof(growth_kb))
+		growth_kb = -1;
+	close(fd[0]);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+		return -1;
+
+	return growth_kb;
+}
+
+int main(int argc, char **argv) {
+	uint32_t budget_mb = argc > 1 ? (uint32_t) atoi(argv[1]) : 4;
+	uint32_t num_threads = argc > 2 ? (uint32_t) atoi(argv[2]) : 8;
+	uint32_t size = argc > 3 ? (uint32_t) atoi(argv[3]) : 1536;
+	uint32_t tile_size = argc > 4 ? (uint32_t) atoi(argv[4]) : 384;
+	uint64_t budget = (uint64_t) budget_mb * 1024 * 1024;
+	int rc = EXIT_SUCCESS;
+
+	if (!budget_mb || !size || !tile_size) {
+		fprintf(stderr,
+				"usage: %s [budget MB] [threads] [image size] [tile size]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	char file[] = "/tmp/stress_memory_budget_XXXXXX";
+	int tmp = mkstemp(file);
+	if (tmp < 0) {
+		fprintf(stderr, "failed to create temporary file\n");
+		return EXIT_FAILURE;
+	}
+	close(tmp);
+
+	for (int do_compress = 1; do_compress >= 0; --do_compress) {
+		const char *op = do_compress ? "compress" : "decompress";
+		long unlimited_kb = run(do_compress, file, 0, num_threads, size,
+				tile_size);
+		long baseline_kb = run(do_compress, file, 1, num_threads, size,
+				tile_size);
+		long budget_kb = run(do_compress, file, budget, num_threads, size,
+				tile_size);
+		if (unlimited_kb < 0 || baseline_kb < 0 || budget_kb < 0) {
+			fprintf(stderr, "%s failed\n", op);
+			rc = EXIT_FAILURE;
+			break;
+		}
+		// the budget is a soft limit: a tile is always admitted when
+		// no other tile is in flight, which the baseline accounts for
+		long bound_kb = baseline_kb + baseline_kb / noise_divisor
+				+ (long) (budget / 1024);
+		printf("%s, threads %u, image %ux%u, tiles %ux%u: "
+				"peak RSS growth %ld KB unlimited, %ld KB one tile at a time, "
+				"%ld KB with %u MB budget (bound %ld KB)\n", op, num_threads,
+				size, size, tile_size, tile_size, unlimited_kb, baseline_kb,
+				budget_kb, budget_mb, bound_kb);
+		if (budget_kb > bound_kb) {
+			fprintf(stderr, "%s: peak RSS growth exceeds bound\n", op);
+			rc = EXIT_FAILURE;
+		}
+	}
+	unlink(file);
+
+	return rc;
+}
@@ -0,0 +1,140 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ Allocate the metadata of several tiles from one ArenaAllocator, resetting
+ it between tiles as TileComponent does. Allocations must be aligned and
+ must not overlap, and once the arena has been reset after a tile, a tile
+ of the same shape must get the same memory, carved from a single block.
+ Tiles of other shapes must still be served after a reset.
+ */
+
+#undef NDEBUG
+
+#include "grk_includes.h"
+#include <cstddef>
+#include <vector>
+
+using namespace grk;
+
+static uint32_t num_constructed = 0;
+static uint32_t num_destroyed = 0;
+
+struct Tracked {
+	Tracked() :
+			value(0x5A5A5A5A) {
+		num_constructed++;
+	}
+	~Tracked() {
+		num_destroyed++;
+	}
+	uint32_t value;
+};
+
+struct Allocation {
+	uint8_t *ptr;
+	size_t len;
+};
+
+/**
+ Allocate the metadata of a tile: many small arrays, a few large buffers,
+ and a tracked array, filling each allocation with its own pattern
+ */
+static std::vector<Allocation> allocate_tile(ArenaAllocator *arena,
+		uint32_t num_blocks) {
+	std::vector<Allocation> allocations;
+	for (uint32_t i = 0; i < num_blocks; ++i) {
+		// small arrays, such as layers and passes of a code block,
+		// and an occasional large buffer, such as code block data
+		size_t len = (i % 17 == 16) ? 64 * 1024 + i : 1 + (i * 37) % 200;
+		auto p = (uint8_t*) arena->alloc(len);
+		assert(p);
+		assert(((uintptr_t) p % alignof(std::max_align_t)) == 0);
+		memset(p, (int) (i & 0xFF), len);
+		allocations.push_back( { p, len });
+	}
+	auto tracked = arena->construct_array<Tracked>(num_blocks);
+	assert(tracked);
+	for (uint32_t i = 0; i < num_blocks; ++i)
+		assert(tracked[i].value == 0x5A5A5A5A);
+	ArenaAllocator::destroy_array(tracked, num_blocks);
+	assert(num_constructed == num_destroyed);
+
+	return allocations;
+}
+
+/**
+ Check that every allocation still holds its pattern, so that
+ no two allocations overlap
+ */
+static void check_tile(const std::vector<Allocation> &allocations) {
+	for (size_t i = 0; i < allocations.size(); ++i) {
+		auto &a = allocations[i];
+		for (size_t j = 0; j < a.len; ++j)
+			assert(a.ptr[j] == (uint8_t) (i & 0xFF));
+	}
+}
+
+int main() {
+	ArenaAllocator arena;
+	assert(arena.allocated() == 0);
+
+	// first tile grows the arena block by block
+	auto first = allocate_tile(&arena, 500);
+	check_tile(first);
+	size_t first_allocated = arena.allocated();
+	assert(first_allocated > 0);
+
+	// after a reset, a tile of the same shape is served from one block
+	arena.reset();
+	assert(arena.allocated() == 0);
+	auto second = allocate_tile(&arena, 500);
+	check_tile(second);
+	assert(arena.allocated() == first_allocated);
+	for (size_t i = 1; i < second.size(); ++i) {
+		size_t rounded = (second[i - 1].len + alignof(std::max_align_t) - 1)
+				& ~(alignof(std::max_align_t) - 1);
+		assert(second[i].ptr == second[i - 1].ptr + rounded);
+	}
+
+	// and from then on, the same memory is reused
+	for (uint32_t tile = 0; tile < 3; ++tile) {
+		arena.reset();
+		auto reused = allocate_tile(&arena, 500);
+		check_tile(reused);
+		for (size_t i = 0; i < reused.size(); ++i)
+			assert(reused[i].ptr == second[i].ptr);
+	}
+
+	// larger and smaller tiles are still served after a reset
+	const uint32_t num_blocks[] = { 2000, 10, 0, 700, 500 };
+	for (auto n : num_blocks) {
+		arena.reset();
+		auto tile = allocate_tile(&arena, n);
+		check_tile(tile);
+	}
+
+	// release returns everything; the arena can then be used again
+	arena.release();
+	assert(arena.allocated() == 0);
+	auto after_release = allocate_tile(&arena, 100);
+	check_tile(after_release);
+
+	printf("ArenaAllocator reset and reuse OK\n");
+
+	return 0;
+}
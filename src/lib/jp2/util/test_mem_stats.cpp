@@ -0,0 +1,175 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ Allocate and free memory through the tracked paths: MemAccount,
+ grk_buffer_2d and ArenaAllocator, and check current and peak counters
+ of each tag, as reported by grk_get_memory_stats. Also check that memory
+ allocated while accounting is disabled is never counted, that memory
+ allocated while enabled is returned after accounting is disabled,
+ and that counters are consistent when updated by several threads.
+ */
+
+#undef NDEBUG
+
+#include "grk_includes.h"
+#include <thread>
+#include <vector>
+
+using namespace grk;
+
+const uint32_t num_threads = 4;
+const uint32_t num_iterations = 10000;
+
+static grk_memory_stats stats(void) {
+	grk_memory_stats s;
+	bool enabled = grk_get_memory_stats(&s);
+	assert(enabled);
+
+	return s;
+}
+
+int main() {
+	grk_memory_stats s;
+	assert(!grk_get_memory_stats(&s));
+
+	// disabled: nothing is accounted
+	grk_set_memory_accounting(true);
+	auto base = stats();
+	grk_set_memory_accounting(false);
+	{
+		MemAccount account(GRK_MEM_MARKERS);
+		account.set(1000);
+		account.add(500);
+	}
+	grk_set_memory_accounting(true);
+	assert(stats().current[GRK_MEM_MARKERS] == base.current[GRK_MEM_MARKERS]);
+
+	// MemAccount: set, add, take and release on destruction
+	{
+		MemAccount account(GRK_MEM_MARKERS);
+		account.set(1000);
+		assert(stats().current[GRK_MEM_MARKERS]
+				== base.current[GRK_MEM_MARKERS] + 1000);
+		account.add(500);
+		assert(stats().current[GRK_MEM_MARKERS]
+				== base.current[GRK_MEM_MARKERS] + 1500);
+		account.set(200);
+		s = stats();
+		assert(s.current[GRK_MEM_MARKERS] == base.current[GRK_MEM_MARKERS] + 200);
+		assert(s.peak[GRK_MEM_MARKERS] == base.current[GRK_MEM_MARKERS] + 1500);
+		MemAccount other(GRK_MEM_MARKERS);
+		other.take(&account);
+		assert(stats().current[GRK_MEM_MARKERS]
+				== base.current[GRK_MEM_MARKERS] + 200);
+		// copies start with no memory
+		MemAccount copy(other);
+		assert(stats().current[GRK_MEM_MARKERS]
+				== base.current[GRK_MEM_MARKERS] + 200);
+	}
+	assert(stats().current[GRK_MEM_MARKERS] == base.current[GRK_MEM_MARKERS]);
+
+	// grk_buffer_2d: alloc, recycle, transfer and free
+	{
+		grk_buffer_2d<int32_t> buf(100, 50);
+		assert(buf.alloc(true));
+		uint64_t len = (uint64_t) buf.stride * buf.height() * sizeof(int32_t);
+		assert(stats().current[GRK_MEM_TILE_BUFFERS]
+				== base.current[GRK_MEM_TILE_BUFFERS] + len);
+		grk_buffer_2d<int32_t> recycled(100, 50);
+		assert(recycled.recycle(&buf));
+		assert(stats().current[GRK_MEM_TILE_BUFFERS]
+				== base.current[GRK_MEM_TILE_BUFFERS] + len);
+		int32_t *data = nullptr;
+		bool owns = false;
+		uint32_t stride = 0;
+		recycled.transfer(&data, &owns, &stride);
+		assert(data && owns);
+		assert(stats().current[GRK_MEM_TILE_BUFFERS]
+				== base.current[GRK_MEM_TILE_BUFFERS]);
+		grk_aligned_free(data);
+		grk_buffer_2d<int32_t> freed(100, 50);
+		assert(freed.alloc(false));
+	}
+	s = stats();
+	assert(s.current[GRK_MEM_TILE_BUFFERS] == base.current[GRK_MEM_TILE_BUFFERS]);
+	assert(s.peak[GRK_MEM_TILE_BUFFERS] > base.current[GRK_MEM_TILE_BUFFERS]);
+
+	// ArenaAllocator: per tag, until reset or release
+	{
+		ArenaAllocator arena;
+		assert(arena.alloc(100));
+		assert(arena.alloc(1000, GRK_MEM_CODE_BLOCK_DATA));
+		s = stats();
+		assert(s.current[GRK_MEM_TILE_METADATA]
+				>= base.current[GRK_MEM_TILE_METADATA] + 100);
+		assert(s.current[GRK_MEM_CODE_BLOCK_DATA]
+				>= base.current[GRK_MEM_CODE_BLOCK_DATA] + 1000);
+		arena.reset();
+		assert(stats().current[GRK_MEM_CODE_BLOCK_DATA]
+				== base.current[GRK_MEM_CODE_BLOCK_DATA]);
+		assert(arena.alloc(2000, GRK_MEM_CODE_BLOCK_DATA));
+	}
+	s = stats();
+	assert(s.current[GRK_MEM_TILE_METADATA] == base.current[GRK_MEM_TILE_METADATA]);
+	assert(s.current[GRK_MEM_CODE_BLOCK_DATA]
+			== base.current[GRK_MEM_CODE_BLOCK_DATA]);
+	assert(s.peak[GRK_MEM_CODE_BLOCK_DATA]
+			>= base.current[GRK_MEM_CODE_BLOCK_DATA] + 2000);
+
+	// memory accounted while enabled is returned after disabling
+	{
+		MemAccount account(GRK_MEM_PACKET_DATA);
+		account.set(4096);
+		grk_set_memory_accounting(false);
+	}
+	grk_set_memory_accounting(true);
+	s = stats();
+	assert(s.current[GRK_MEM_PACKET_DATA] == base.current[GRK_MEM_PACKET_DATA]);
+	// enabling resets peaks to current values
+	for (uint32_t i = 0; i < GRK_MEM_NUM_TAGS; ++i)
+		assert(s.peak[i] == s.current[i]);
+
+	// several threads: current returns to base, and peak covers
+	// at least one thread's memory
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < num_threads; ++t) {
+			threads.emplace_back([] {
+				for (uint32_t i = 0; i < num_iterations; ++i) {
+					MemAccount account(GRK_MEM_T1_SCRATCH);
+					account.set(64 + i % 64);
+					account.add(32);
+				}
+			});
+		}
+		for (auto &t : threads)
+			t.join();
+	}
+	s = stats();
+	assert(s.current[GRK_MEM_T1_SCRATCH] == base.current[GRK_MEM_T1_SCRATCH]);
+	assert(s.peak[GRK_MEM_T1_SCRATCH]
+			>= base.current[GRK_MEM_T1_SCRATCH] + 64 + 63 + 32);
+	assert(s.peak[GRK_MEM_T1_SCRATCH]
+			<= base.current[GRK_MEM_T1_SCRATCH]
+					+ (uint64_t) num_threads * (64 + 63 + 32));
+	grk_set_memory_accounting(false);
+
+	printf("MemStats counters OK\n");
+
+	return 0;
+}
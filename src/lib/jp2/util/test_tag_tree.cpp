@@ -0,0 +1,168 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ Feed identical setvalue/compress/decompress sequences through TagTree and
+ FlatTagTree, the way T2 codes inclusion and missing bit plane information,
+ and check that both produce the same bit streams and decoded values.
+ Trees are reset and re-initialized to other sizes between rounds,
+ as precinct trees are reused from one tile to the next.
+ */
+
+#undef NDEBUG
+
+#include "grk_includes.h"
+#include <vector>
+
+using namespace grk;
+
+const uint32_t num_layers = 5;
+const uint32_t max_missing_bit_planes = 20;
+const size_t packet_buffer_size = 4096;
+
+static uint32_t seed = 1;
+static uint32_t next_random(uint32_t range) {
+	seed = seed * 1103515245 + 12345;
+
+	return (seed >> 16) % range;
+}
+
+struct Leaves {
+	// first layer that includes the leaf; num_layers if never included
+	std::vector<uint32_t> layer;
+	std::vector<uint32_t> missing_bit_planes;
+};
+
+/**
+ Encode one packet per layer, returning the bytes of each packet
+ */
+template<typename T> static std::vector<std::vector<uint8_t>> encode(T *incl,
+		T *imsb, const Leaves &leaves) {
+	uint64_t num_leaves = leaves.layer.size();
+	std::vector<std::vector<uint8_t>> packets;
+	incl->reset();
+	imsb->reset();
+	for (uint64_t leafno = 0; leafno < num_leaves; ++leafno)
+		imsb->setvalue(leafno, leaves.missing_bit_planes[leafno]);
+	for (uint32_t layno = 0; layno < num_layers; ++layno) {
+		std::vector<uint8_t> buf(packet_buffer_size);
+		BitIO bio(buf.data(), buf.size(), true);
+		for (uint64_t leafno = 0; leafno < num_leaves; ++leafno) {
+			if (leaves.layer[leafno] == layno)
+				incl->setvalue(leafno, layno);
+		}
+		for (uint64_t leafno = 0; leafno < num_leaves; ++leafno) {
+			uint32_t first = leaves.layer[leafno];
+			if (first >= layno) {
+				assert(incl->compress(&bio, leafno, layno + 1));
+			} else {
+				assert(bio.write(1, 1));
+			}
+			if (first == layno)
+				assert(imsb->compress(&bio, leafno,
+								tag_tree_uninitialized_node_value));
+		}
+		assert(bio.flush());
+		buf.resize(bio.numbytes());
+		packets.push_back(buf);
+	}
+
+	return packets;
+}
+
+/**
+ Decode packets produced by encode
+ */
+template<typename T> static Leaves decode(T *incl, T *imsb,
+		uint64_t num_leaves, std::vector<std::vector<uint8_t>> &packets) {
+	Leaves leaves;
+	leaves.layer.resize(num_leaves, num_layers);
+	leaves.missing_bit_planes.resize(num_leaves, 0);
+	incl->reset();
+	imsb->reset();
+	for (uint32_t layno = 0; layno < num_layers; ++layno) {
+		auto &buf = packets[layno];
+		BitIO bio(buf.data(), buf.size(), false);
+		for (uint64_t leafno = 0; leafno < num_leaves; ++leafno) {
+			uint32_t included = 0;
+			bool first = leaves.layer[leafno] == num_layers;
+			if (first) {
+				uint64_t value;
+				incl->decodeValue(&bio, leafno, layno + 1, &value);
+				included = value <= layno;
+			} else {
+				bio.read(&included, 1);
+			}
+			if (!included || !first)
+				continue;
+			leaves.layer[leafno] = layno;
+			uint32_t K_msbs = 0;
+			uint8_t value;
+			imsb->decompress(&bio, leafno, K_msbs, &value);
+			while (!value) {
+				++K_msbs;
+				imsb->decompress(&bio, leafno, K_msbs, &value);
+			}
+			leaves.missing_bit_planes[leafno] = K_msbs - 1;
+		}
+		bio.inalign();
+	}
+
+	return leaves;
+}
+
+int main() {
+	const uint64_t sizes[][2] = { { 1, 1 }, { 7, 1 }, { 1, 9 }, { 5, 3 },
+			{ 13, 9 }, { 64, 1 }, { 2, 2 }, { 32, 32 }, { 3, 17 } };
+	TagTree tree_incl(1, 1), tree_imsb(1, 1);
+	FlatTagTree flat_incl(1, 1), flat_imsb(1, 1);
+	for (uint32_t round = 0; round < 3; ++round) {
+		for (auto &size : sizes) {
+			uint64_t w = size[0], h = size[1];
+			uint64_t num_leaves = w * h;
+			assert(tree_incl.init(w, h) && tree_imsb.init(w, h));
+			assert(flat_incl.init(w, h) && flat_imsb.init(w, h));
+			Leaves leaves;
+			for (uint64_t leafno = 0; leafno < num_leaves; ++leafno) {
+				leaves.layer.push_back(next_random(num_layers + 1));
+				leaves.missing_bit_planes.push_back(
+						next_random(max_missing_bit_planes + 1));
+			}
+			auto tree_packets = encode(&tree_incl, &tree_imsb, leaves);
+			auto flat_packets = encode(&flat_incl, &flat_imsb, leaves);
+			assert(tree_packets == flat_packets);
+
+			auto tree_leaves = decode(&tree_incl, &tree_imsb, num_leaves,
+					tree_packets);
+			auto flat_leaves = decode(&flat_incl, &flat_imsb, num_leaves,
+					flat_packets);
+			for (uint64_t leafno = 0; leafno < num_leaves; ++leafno) {
+				assert(tree_leaves.layer[leafno] == leaves.layer[leafno]);
+				assert(flat_leaves.layer[leafno] == leaves.layer[leafno]);
+				if (leaves.layer[leafno] == num_layers)
+					continue;
+				assert(tree_leaves.missing_bit_planes[leafno]
+								== leaves.missing_bit_planes[leafno]);
+				assert(flat_leaves.missing_bit_planes[leafno]
+								== leaves.missing_bit_planes[leafno]);
+			}
+		}
+	}
+	printf("TagTree and FlatTagTree match\n");
+
+	return 0;
+}
@@ -263,7 +263,8 @@ template <typename T> struct grk_buffer_2d : public grk_rect_u32 {
 	grk_buffer_2d(T *buffer,bool ownsData, uint32_t w, uint32_t strd, uint32_t h) : grk_rect_u32(0,0,w,h),
 																					data(buffer),
 																					owns_data(ownsData),
-																					stride(strd)
+																					stride(strd),
+																					m_account(GRK_MEM_TILE_BUFFERS)
 	{}
 	grk_buffer_2d(T *buffer,bool ownsData, uint32_t w, uint32_t h) : grk_buffer_2d(buffer,ownsData,w,w,h)
 	{}
@@ -292,15 +293,32 @@ template <typename T> struct grk_buffer_2d : public grk_rect_u32 {
 			if (clear)
 				memset(data, 0, data_size_needed);
 			owns_data = true;
+			m_account.set((size_t) data_size_needed);
 		}
 
 		return true;
 	}
 
+	// take over data owned by a buffer of the same dimensions,
+	// returning true if successful
+	bool recycle(grk_buffer_2d<T> *rhs){
+		if (data || !rhs->owns_data || !rhs->data ||
+				rhs->width() != width() || rhs->height() != height())
+			return false;
+		data = rhs->data;
+		owns_data = true;
+		stride = rhs->stride;
+		m_account.take(&rhs->m_account);
+		rhs->data = nullptr;
+		rhs->owns_data = false;
+
+		return true;
+	}
 	// set data to buf without owning it
 	void attach(T* buffer, uint32_t strd){
 		if (owns_data)
 			grk_aligned_free(data);
+		m_account.set(0);
 		data = buffer;
 		owns_data = false;
 		stride = strd;
@@ -309,6 +327,7 @@ template <typename T> struct grk_buffer_2d : public grk_rect_u32 {
 	void acquire(T* buffer, uint32_t strd){
 		if (owns_data)
 			grk_aligned_free(data);
+		m_account.set(0);
 		buffer = data;
 		owns_data = true;
 		stride = strd;
@@ -321,12 +340,15 @@ template <typename T> struct grk_buffer_2d : public grk_rect_u32 {
 			*owns = owns_data;
 			owns_data = false;
 			*strd = stride;
+			// memory now belongs to the output image
+			m_account.set(0);
 		}
 	}
 
 	T *data;		/* internal array*/
     bool owns_data;	/* true if buffer manages the buf array */
     uint32_t stride;
+    MemAccount m_account;
 } ;
 
 }
@@ -0,0 +1,194 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Several threads call grk_decompress_tile on one codec, each with its own
+ * output image. Every decompressed tile must match the same region of the
+ * image decompressed in one call by grk_decompress.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_threads = 4;
+const uint32_t tiles_per_thread = 6;
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters) {
+		stream = grk_stream_create_file_stream(parameters->infile,
+				1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+/**
+ * Create an output image with the same components as the header image
+ */
+static grk_image* create_tile_image(grk_image *header) {
+	std::vector<grk_image_cmptparm> params(header->numcomps);
+	for (uint32_t compno = 0; compno < header->numcomps; ++compno) {
+		auto param = &params[compno];
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = header->comps[compno].dx;
+		param->dy = header->comps[compno].dy;
+		param->w = 1;
+		param->h = 1;
+		param->prec = header->comps[compno].prec;
+		param->sgnd = header->comps[compno].sgnd;
+	}
+	auto image = grk_image_create(header->numcomps, params.data(),
+			header->color_space, false);
+	if (image) {
+		image->x0 = header->x0;
+		image->y0 = header->y0;
+		image->x1 = header->x1;
+		image->y1 = header->y1;
+	}
+
+	return image;
+}
+
+/**
+ * Compare decompressed tile with the same region of the full image
+ */
+static bool matches_full_image(grk_image *tile, grk_image *full) {
+	for (uint32_t compno = 0; compno < tile->numcomps; ++compno) {
+		auto tc = tile->comps + compno;
+		auto fc = full->comps + compno;
+		if (!tc->data || tc->x0 < fc->x0 || tc->y0 < fc->y0
+				|| tc->x0 - fc->x0 + tc->w > fc->w
+				|| tc->y0 - fc->y0 + tc->h > fc->h)
+			return false;
+		for (uint32_t j = 0; j < tc->h; ++j) {
+			auto full_row = fc->data
+					+ (size_t) (tc->y0 - fc->y0 + j) * fc->stride
+					+ (tc->x0 - fc->x0);
+			if (memcmp(tc->data + (size_t) j * tc->stride, full_row,
+					tc->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	{
+		TestCodec full, shared;
+		uint16_t num_tiles;
+		std::atomic<uint32_t> failed(0), mismatched(0);
+		std::vector<std::thread> threads;
+
+		if (!full.open(&parameters)
+				|| !grk_decompress(full.codec, nullptr, full.image)
+				|| !grk_end_decompress(full.codec)) {
+			spdlog::error("failed to decompress {}", parameters.infile);
+			goto cleanup;
+		}
+		if (!shared.open(&parameters)) {
+			spdlog::error("failed to open {}", parameters.infile);
+			goto cleanup;
+		}
+		{
+			auto cstr_info = grk_get_cstr_info(shared.codec);
+			num_tiles = (uint16_t) (cstr_info->t_grid_width
+					* cstr_info->t_grid_height);
+			grk_destroy_cstr_info(&cstr_info);
+		}
+		for (uint32_t i = 0; i < num_threads; ++i) {
+			threads.emplace_back([&, i] {
+				auto image = create_tile_image(shared.image);
+				if (!image) {
+					failed++;
+					return;
+				}
+				// threads start on different tiles, and then collide
+				for (uint32_t k = 0; k < tiles_per_thread; ++k) {
+					auto tile_index = (uint16_t) ((i + k * (i + 1)) % num_tiles);
+					if (!grk_decompress_tile(shared.codec, image, tile_index))
+						failed++;
+					else if (!matches_full_image(image, full.image))
+						mismatched++;
+				}
+				grk_image_destroy(image);
+			});
+		}
+		for (auto &t : threads)
+			t.join();
+		if (failed || mismatched) {
+			spdlog::error("{} tiles failed and {} tiles mismatched",
+					(uint32_t) failed, (uint32_t) mismatched);
+			goto cleanup;
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
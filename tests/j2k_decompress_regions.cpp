@@ -0,0 +1,313 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Multiple regions: four neighbouring regions that share tiles, a region
+ * that overlaps them, a region that lies within one tile and a region
+ * that spans the image are decompressed in one pass with
+ * grk_decompress_regions, at full resolution and at reduce 1. Each region
+ * must match the same region decompressed by a new codec with
+ * grk_set_decompress_area and grk_decompress. The regions are then
+ * decompressed again while another thread decompresses every tile of the
+ * same codec with grk_decompress_tile, and each tile must match the image
+ * decompressed by grk_decompress.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters) {
+		stream = grk_stream_create_file_stream(parameters->infile,
+				1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decompress regions in one pass, and compare each with the same region
+ * decompressed by a new codec
+ */
+static bool test_regions(grk_dparameters *parameters,
+		const std::vector<grk_region> &regions) {
+	std::vector<grk_image*> images(regions.size(), nullptr);
+	bool rc = true;
+	{
+		TestCodec batch;
+		if (!batch.open(parameters)
+				|| !grk_decompress_regions(batch.codec, regions.data(),
+						(uint32_t) regions.size(), images.data())) {
+			spdlog::error("failed to decompress {} regions", regions.size());
+			return false;
+		}
+	}
+	for (size_t k = 0; k < regions.size() && rc; ++k) {
+		auto region = regions[k];
+		TestCodec single;
+		if (!single.open(parameters)
+				|| !grk_set_decompress_area(single.codec, single.image,
+						region.x0, region.y0, region.x1, region.y1)
+				|| !grk_decompress(single.codec, nullptr, single.image)
+				|| !images[k] || !same_samples(single.image, images[k])) {
+			spdlog::error("region {} ({},{},{},{}) at reduce {} does not match",
+					k, region.x0, region.y0, region.x1, region.y1,
+					parameters->cp_reduce);
+			rc = false;
+		}
+	}
+	for (auto image : images)
+		grk_image_destroy(image);
+
+	return rc;
+}
+
+/**
+ * Create an output image with the same components as the header image
+ */
+static grk_image* create_tile_image(grk_image *header) {
+	std::vector<grk_image_cmptparm> params(header->numcomps);
+	for (uint32_t compno = 0; compno < header->numcomps; ++compno) {
+		auto param = &params[compno];
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = header->comps[compno].dx;
+		param->dy = header->comps[compno].dy;
+		param->w = 1;
+		param->h = 1;
+		param->prec = header->comps[compno].prec;
+		param->sgnd = header->comps[compno].sgnd;
+	}
+	auto image = grk_image_create(header->numcomps, params.data(),
+			header->color_space, false);
+	if (image) {
+		image->x0 = header->x0;
+		image->y0 = header->y0;
+		image->x1 = header->x1;
+		image->y1 = header->y1;
+	}
+
+	return image;
+}
+
+/**
+ * Compare decompressed tile with the same region of the full image
+ */
+static bool matches_full_image(grk_image *tile, grk_image *full) {
+	for (uint32_t compno = 0; compno < tile->numcomps; ++compno) {
+		auto tc = tile->comps + compno;
+		auto fc = full->comps + compno;
+		if (!tc->data || tc->x0 < fc->x0 || tc->y0 < fc->y0
+				|| tc->x0 - fc->x0 + tc->w > fc->w
+				|| tc->y0 - fc->y0 + tc->h > fc->h)
+			return false;
+		for (uint32_t j = 0; j < tc->h; ++j) {
+			auto full_row = fc->data
+					+ (size_t) (tc->y0 - fc->y0 + j) * fc->stride
+					+ (tc->x0 - fc->x0);
+			if (memcmp(tc->data + (size_t) j * tc->stride, full_row,
+					tc->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decompress regions on one thread while another thread decompresses
+ * every tile of the same codec
+ */
+static bool test_concurrent_tiles(grk_dparameters *parameters,
+		const std::vector<grk_region> &regions) {
+	TestCodec full, shared;
+	if (!full.open(parameters)
+			|| !grk_decompress(full.codec, nullptr, full.image)
+			|| !shared.open(parameters)) {
+		spdlog::error("failed to decompress {}", parameters->infile);
+		return false;
+	}
+	auto cstr_info = grk_get_cstr_info(shared.codec);
+	auto num_tiles = (uint16_t) (cstr_info->t_grid_width
+			* cstr_info->t_grid_height);
+	grk_destroy_cstr_info(&cstr_info);
+
+	bool tiles_ok = true;
+	std::thread tiles([&] {
+		auto image = create_tile_image(shared.image);
+		if (!image) {
+			tiles_ok = false;
+			return;
+		}
+		for (uint16_t tile_index = 0; tile_index < num_tiles; ++tile_index) {
+			if (!grk_decompress_tile(shared.codec, image, tile_index)
+					|| !matches_full_image(image, full.image)) {
+				spdlog::error("tile {} does not match", tile_index);
+				tiles_ok = false;
+			}
+		}
+		grk_image_destroy(image);
+	});
+	std::vector<grk_image*> images(regions.size(), nullptr);
+	bool regions_ok = grk_decompress_regions(shared.codec, regions.data(),
+			(uint32_t) regions.size(), images.data());
+	tiles.join();
+	for (auto image : images)
+		grk_image_destroy(image);
+	if (!regions_ok)
+		spdlog::error("failed to decompress {} regions", regions.size());
+
+	return regions_ok && tiles_ok;
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	{
+		std::vector<grk_region> regions;
+		{
+			TestCodec header;
+			if (!header.open(&parameters)) {
+				spdlog::error("failed to open {}", parameters.infile);
+				goto cleanup;
+			}
+			auto cstr_info = grk_get_cstr_info(header.codec);
+			uint32_t t_width = cstr_info->t_width;
+			uint32_t t_height = cstr_info->t_height;
+			uint32_t tx0 = cstr_info->tx0;
+			uint32_t ty0 = cstr_info->ty0;
+			grk_destroy_cstr_info(&cstr_info);
+			auto image = header.image;
+			uint32_t w = image->x1 - image->x0;
+			uint32_t h = image->y1 - image->y0;
+
+			// four neighbours on a grid, straddling tile boundaries
+			uint32_t rw = w / 5 + 3, rh = h / 5 + 1;
+			uint32_t bx = image->x0 + w / 7, by = image->y0 + h / 9;
+			for (uint32_t k = 0; k < 4; ++k) {
+				grk_region region;
+				region.x0 = bx + (k % 2) * rw;
+				region.y0 = by + (k / 2) * rh;
+				region.x1 = region.x0 + rw;
+				region.y1 = region.y0 + rh;
+				regions.push_back(region);
+			}
+			// overlaps all four neighbours
+			grk_region overlap;
+			overlap.x0 = bx + rw / 2;
+			overlap.y0 = by + rh / 2;
+			overlap.x1 = overlap.x0 + rw;
+			overlap.y1 = overlap.y0 + rh;
+			regions.push_back(overlap);
+			// within the tile at the centre of the image
+			grk_region inner;
+			inner.x0 = std::max(image->x0,
+					tx0 + ((image->x0 + w / 2 - tx0) / t_width) * t_width) + 1;
+			inner.y0 = std::max(image->y0,
+					ty0 + ((image->y0 + h / 2 - ty0) / t_height) * t_height) + 1;
+			inner.x1 = std::min(image->x1, inner.x0 + t_width / 2);
+			inner.y1 = std::min(image->y1, inner.y0 + t_height / 2);
+			regions.push_back(inner);
+			// whole image
+			grk_region whole;
+			whole.x0 = image->x0;
+			whole.y0 = image->y0;
+			whole.x1 = image->x1;
+			whole.y1 = image->y1;
+			regions.push_back(whole);
+		}
+		for (uint32_t reduce = 0; reduce < 2; ++reduce) {
+			auto reduced = parameters;
+			reduced.cp_reduce = reduce;
+			if (!test_regions(&reduced, regions))
+				goto cleanup;
+		}
+		if (!test_concurrent_tiles(&parameters, regions))
+			goto cleanup;
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
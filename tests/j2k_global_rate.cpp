@@ -0,0 +1,240 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Global rate control: a multi-tile image is compressed into three layers
+ * with rateControlAlgorithm 2, which forms layers across all tiles at once.
+ * This is done without PLT markers, with PLT markers, and with PLT markers
+ * and one tile part per resolution. Each code stream must not be larger than
+ * the target size of its final layer, must use most of it, and must
+ * decompress.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_comps = 3;
+const uint32_t image_width = 600;
+const uint32_t image_height = 500;
+const uint32_t tile_size = 128;
+const uint32_t num_layers = 3;
+const double rates[num_layers] = { 40, 20, 10 };
+// code stream must use at least this fraction of its target size
+const double min_fill = 0.9;
+
+static grk_image* create_image(void) {
+	grk_image_cmptparm params[num_comps];
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto param = params + compno;
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = image_width;
+		param->h = image_height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(num_comps, params, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = image_width;
+	image->y1 = image_height;
+	// smooth content with noise, and busier tiles towards the right,
+	// so that tiles differ in how many bytes they deserve
+	uint32_t seed = 1;
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto comp = image->comps + compno;
+		for (uint32_t j = 0; j < comp->h; ++j) {
+			for (uint32_t i = 0; i < comp->w; ++i) {
+				seed = seed * 1103515245 + 12345;
+				int32_t noise = (int32_t) ((seed >> 24) % (4 + (i * 40) / image_width));
+				double v = 128 + 60 * sin(i * 0.02 * (compno + 1)) * cos(j * 0.013)
+						+ noise;
+				comp->data[(size_t) j * comp->stride + i] = std::min<int32_t>(
+						255, std::max<int32_t>(0, (int32_t) v));
+			}
+		}
+	}
+
+	return image;
+}
+
+/**
+ * Compress image with global rate control
+ *
+ * @param plt		write PLT markers
+ * @param tile_parts	one tile part per resolution
+ * @param dest		code stream
+ */
+static bool compress(bool plt, bool tile_parts, std::vector<uint8_t> *dest) {
+	auto image = create_image();
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	parameters.tcp_numlayers = num_layers;
+	for (uint32_t k = 0; k < num_layers; ++k)
+		parameters.tcp_rates[k] = rates[k];
+	parameters.cp_disto_alloc = true;
+	parameters.rateControlAlgorithm = 2;
+	parameters.writePLT = plt;
+	if (tile_parts) {
+		parameters.tp_on = 1;
+		parameters.tp_flag = 'R';
+	}
+	dest->resize((size_t) num_comps * image_width * image_height);
+	auto stream = grk_stream_create_mem_stream(dest->data(), dest->size(),
+			false, false);
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_compress(codec, &parameters, image)
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	if (rc)
+		dest->resize(grk_stream_get_write_mem_stream_length(stream));
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+/**
+ * Decompress code stream
+ */
+static bool decompress(std::vector<uint8_t> *codestream) {
+	grk_dparameters parameters;
+	grk_set_default_decompress_params(&parameters);
+	grk_image *image = nullptr;
+	auto stream = grk_stream_create_mem_stream(codestream->data(),
+			codestream->size(), false, true);
+	auto codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_decompress(codec, &parameters)
+			&& grk_read_header(codec, nullptr, &image)
+			&& grk_decompress(codec, nullptr, image)
+			&& grk_end_decompress(codec);
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+static uint32_t read_bytes(const std::vector<uint8_t> &codestream,
+		size_t pos, uint32_t num_bytes) {
+	uint32_t val = 0;
+	for (uint32_t i = 0; i < num_bytes; ++i)
+		val = (val << 8) | codestream[pos + i];
+
+	return val;
+}
+
+/**
+ * Check whether a tile part header of the code stream contains a PLT marker
+ */
+static bool has_plt(const std::vector<uint8_t> &codestream) {
+	// skip SOC and main header
+	size_t pos = 2;
+	while (pos + 4 <= codestream.size()
+			&& read_bytes(codestream, pos, 2) != 0xFF90)
+		pos += 2 + read_bytes(codestream, pos + 2, 2);
+	while (pos + 12 <= codestream.size()
+			&& read_bytes(codestream, pos, 2) == 0xFF90) {
+		uint32_t tile_part_len = read_bytes(codestream, pos + 6, 4);
+		// tile part header markers follow SOT, up to SOD
+		size_t marker_pos = pos + 12;
+		while (marker_pos + 4 <= codestream.size()
+				&& read_bytes(codestream, marker_pos, 2) != 0xFF93) {
+			if (read_bytes(codestream, marker_pos, 2) == 0xFF58)
+				return true;
+			marker_pos += 2 + read_bytes(codestream, marker_pos + 2, 2);
+		}
+		if (!tile_part_len)
+			break;
+		pos += tile_part_len;
+	}
+
+	return false;
+}
+
+int main(int argc, char **argv) {
+	(void) argv;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 1) {
+		spdlog::error("Usage: {}", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	{
+		// 8 bit samples
+		double target = (double) num_comps * image_width * image_height
+				/ rates[num_layers - 1];
+		for (uint32_t k = 0; k < 3; ++k) {
+			bool plt = k > 0;
+			bool tile_parts = k == 2;
+			std::vector<uint8_t> codestream;
+			if (!compress(plt, tile_parts, &codestream)) {
+				spdlog::error("failed to compress with PLT {}, tile parts {}",
+						plt, tile_parts);
+				goto cleanup;
+			}
+			if (!decompress(&codestream)) {
+				spdlog::error("failed to decompress with PLT {}, tile parts {}",
+						plt, tile_parts);
+				goto cleanup;
+			}
+			if (plt != has_plt(codestream)) {
+				spdlog::error("PLT {} expected, tile parts {}", plt, tile_parts);
+				goto cleanup;
+			}
+			if (codestream.size() > target
+					|| codestream.size() < min_fill * target) {
+				spdlog::error("code stream with PLT {}, tile parts {} has {}"
+						" bytes, for target of {} bytes", plt, tile_parts,
+						codestream.size(), (uint64_t) target);
+				goto cleanup;
+			}
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
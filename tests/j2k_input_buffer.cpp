@@ -0,0 +1,316 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Input buffer: an image of random 8 bit samples, whose dimensions are not
+ * multiples of the tile size, is compressed losslessly with the colour
+ * transform from the image components, from an interleaved buffer set with
+ * grk_set_input_buffer, and from a rows callback that copies the rows of
+ * each tile into a buffer owned by the calling thread. Both code streams
+ * compressed from the buffer must match the code stream compressed from
+ * the image components.
+ *
+ * The same image is then compressed with the irreversible transforms, from
+ * the image components and from the interleaved buffer, whose rows are
+ * colour transformed one at a time. Floating point rounding may differ
+ * between the two, so the decompressed images must agree within a
+ * tolerance, and each must be close to the source samples.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_comps = 3;
+const uint32_t image_width = 1000;
+const uint32_t image_height = 700;
+const uint32_t tile_size = 256;
+// bytes of padding at end of each row
+const size_t row_padding = 5;
+// largest difference between irreversible images compressed from the
+// image components and from the buffer
+const int32_t irreversible_tolerance = 1;
+// largest difference between an irreversible image and the source samples
+const int32_t irreversible_source_tolerance = 4;
+
+struct InputRows {
+	InputRows() : data(nullptr), stride(0), calls(0) {
+	}
+	const uint8_t *data;
+	size_t stride;
+	std::atomic<uint32_t> calls;
+};
+
+/**
+ * Copy requested rows into a buffer owned by the calling thread, which is
+ * reused for the next tile compressed by that thread
+ */
+static const uint8_t* pull_rows(uint32_t y0, uint32_t num_rows,
+		void *user_data) {
+	thread_local std::vector<uint8_t> rows;
+	auto input = (InputRows*) user_data;
+	if (y0 + num_rows > image_height)
+		return nullptr;
+	rows.assign(input->data + (size_t) y0 * input->stride,
+			input->data + (size_t) (y0 + num_rows) * input->stride);
+	input->calls++;
+
+	// rows returned are relative to row y0
+	return rows.data();
+}
+
+static grk_image* create_image(const std::vector<uint8_t> &samples,
+		bool alloc_data) {
+	grk_image_cmptparm params[num_comps];
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto param = params + compno;
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = image_width;
+		param->h = image_height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(num_comps, params, GRK_CLRSPC_SRGB,
+			alloc_data);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = image_width;
+	image->y1 = image_height;
+	if (alloc_data) {
+		size_t stride = image_width * num_comps + row_padding;
+		for (uint32_t compno = 0; compno < num_comps; ++compno) {
+			auto comp = image->comps + compno;
+			for (uint32_t j = 0; j < comp->h; ++j) {
+				for (uint32_t i = 0; i < comp->w; ++i)
+					comp->data[(size_t) j * comp->stride + i] = samples[j
+							* stride + i * num_comps + compno];
+			}
+		}
+	}
+
+	return image;
+}
+
+/**
+ * Compress a new image, since the codec takes the image data
+ *
+ * @param samples		interleaved samples
+ * @param input			input buffer, or nullptr to compress the image components
+ * @param irreversible	true for the 9/7 wavelet and irreversible colour transform
+ * @param dest			code stream
+ */
+static bool compress(const std::vector<uint8_t> &samples,
+		const grk_input_buffer *input, bool irreversible,
+		std::vector<uint8_t> *dest) {
+	auto image = create_image(samples, input == nullptr);
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	parameters.tcp_mct = 1;
+	parameters.irreversible = irreversible;
+	dest->resize(2 * samples.size());
+	auto stream = grk_stream_create_mem_stream(dest->data(), dest->size(),
+			false, false);
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_compress(codec, &parameters, image)
+			&& (!input || grk_set_input_buffer(codec, input))
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	if (rc)
+		dest->resize(grk_stream_get_write_mem_stream_length(stream));
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+static grk_image* decompress(std::vector<uint8_t> *codestream) {
+	grk_dparameters parameters;
+	grk_set_default_decompress_params(&parameters);
+	grk_image *image = nullptr;
+	auto stream = grk_stream_create_mem_stream(codestream->data(),
+			codestream->size(), false, true);
+	auto codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_decompress(codec, &parameters)
+			&& grk_read_header(codec, nullptr, &image)
+			&& grk_decompress(codec, nullptr, image)
+			&& grk_end_decompress(codec);
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	if (!rc) {
+		grk_image_destroy(image);
+		image = nullptr;
+	}
+
+	return image;
+}
+
+/**
+ * Largest difference between two images, or -1 if their
+ * components do not match
+ */
+static int32_t max_difference(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return -1;
+	int32_t max_diff = 0;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return -1;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			auto row_a = ca->data + (size_t) j * ca->stride;
+			auto row_b = cb->data + (size_t) j * cb->stride;
+			for (uint32_t i = 0; i < ca->w; ++i)
+				max_diff = std::max(max_diff, abs(row_a[i] - row_b[i]));
+		}
+	}
+
+	return max_diff;
+}
+
+/**
+ * Decompress irreversible code streams compressed from the image components
+ * and from the interleaved buffer, and compare them with each other and
+ * with the source
+ */
+static bool compare_irreversible(const std::vector<uint8_t> &samples,
+		std::vector<uint8_t> *expected, std::vector<uint8_t> *buffered) {
+	auto source = create_image(samples, true);
+	auto expected_image = decompress(expected);
+	auto buffered_image = decompress(buffered);
+	bool rc = false;
+	if (source && expected_image && buffered_image) {
+		int32_t diff = max_difference(expected_image, buffered_image);
+		int32_t expected_diff = max_difference(source, expected_image);
+		int32_t buffered_diff = max_difference(source, buffered_image);
+		rc = diff >= 0 && diff <= irreversible_tolerance
+				&& expected_diff >= 0
+				&& expected_diff <= irreversible_source_tolerance
+				&& buffered_diff >= 0
+				&& buffered_diff <= irreversible_source_tolerance;
+		if (!rc)
+			spdlog::error("irreversible images differ by {} from each other, "
+					"and by {} and {} from the source", diff, expected_diff,
+					buffered_diff);
+	} else {
+		spdlog::error("failed to decompress irreversible code streams");
+	}
+	grk_image_destroy(source);
+	grk_image_destroy(expected_image);
+	grk_image_destroy(buffered_image);
+
+	return rc;
+}
+
+int main(int argc, char **argv) {
+	(void) argv;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 1) {
+		spdlog::error("Usage: {}", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	{
+		size_t stride = image_width * num_comps + row_padding;
+		std::vector<uint8_t> samples(stride * image_height);
+		std::vector<uint8_t> expected, buffered, pulled;
+		InputRows rows;
+		grk_input_buffer input;
+		uint32_t seed = 1;
+		for (auto &s : samples) {
+			seed = seed * 1103515245 + 12345;
+			s = (uint8_t) (seed >> 24);
+		}
+
+		if (!compress(samples, nullptr, false, &expected)) {
+			spdlog::error("failed to compress image components");
+			goto cleanup;
+		}
+		memset(&input, 0, sizeof(input));
+		input.type = GRK_SAMPLE_UINT8;
+		input.interleaved = true;
+		input.data = samples.data();
+		input.stride = stride;
+		if (!compress(samples, &input, false, &buffered) || buffered != expected) {
+			spdlog::error("code stream compressed from interleaved buffer has "
+					"{} bytes and differs from {} bytes compressed from image",
+					buffered.size(), expected.size());
+			goto cleanup;
+		}
+		rows.data = samples.data();
+		rows.stride = stride;
+		input.data = nullptr;
+		input.pull = pull_rows;
+		input.user_data = &rows;
+		if (!compress(samples, &input, false, &pulled) || pulled != expected) {
+			spdlog::error("code stream compressed from rows callback has "
+					"{} bytes and differs from {} bytes compressed from image",
+					pulled.size(), expected.size());
+			goto cleanup;
+		}
+		const uint32_t num_tiles = ((image_width + tile_size - 1) / tile_size)
+				* ((image_height + tile_size - 1) / tile_size);
+		if (rows.calls != num_tiles) {
+			spdlog::error("expected {} rows callbacks, got {}", num_tiles,
+					(uint32_t) rows.calls);
+			goto cleanup;
+		}
+		input.data = samples.data();
+		input.pull = nullptr;
+		input.user_data = nullptr;
+		if (!compress(samples, nullptr, true, &expected)
+				|| !compress(samples, &input, true, &buffered)) {
+			spdlog::error("failed to compress irreversible image");
+			goto cleanup;
+		}
+		if (!compare_irreversible(samples, &expected, &buffered))
+			goto cleanup;
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
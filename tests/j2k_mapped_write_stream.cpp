@@ -0,0 +1,213 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Memory mapped write stream: an image of random samples is compressed
+ * losslessly to a memory mapped file. Such an image compresses to more
+ * than its uncompressed size, which is the size the mapping is reserved
+ * for, so the mapping must grow while the code stream is written, and the
+ * file must be truncated to the code stream length when the stream is
+ * destroyed. The file must match the same image compressed to a memory
+ * stream, and must decompress to the original samples.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_comps = 3;
+const uint32_t image_width = 1024;
+const uint32_t image_height = 1024;
+const uint32_t tile_size = 512;
+
+static grk_image* create_image(void) {
+	grk_image_cmptparm params[num_comps];
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto param = params + compno;
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = image_width;
+		param->h = image_height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(num_comps, params, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = image_width;
+	image->y1 = image_height;
+	uint32_t seed = 1;
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto comp = image->comps + compno;
+		for (uint32_t j = 0; j < comp->h; ++j) {
+			for (uint32_t i = 0; i < comp->w; ++i) {
+				seed = seed * 1103515245 + 12345;
+				comp->data[(size_t) j * comp->stride + i] = (int32_t) (seed
+						>> 24);
+			}
+		}
+	}
+
+	return image;
+}
+
+/**
+ * Compress a new image, since the codec takes the image data
+ */
+static bool compress(grk_stream *stream) {
+	auto image = create_image();
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = codec && grk_init_compress(codec, &parameters, image)
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	grk_destroy_codec(codec);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+static bool read_file(const char *fname, std::vector<uint8_t> *contents) {
+	auto fp = fopen(fname, "rb");
+	if (!fp)
+		return false;
+	uint8_t buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+		contents->insert(contents->end(), buf, buf + len);
+	fclose(fp);
+
+	return true;
+}
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <output_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	{
+		const uint64_t image_bytes = (uint64_t) num_comps * image_width
+				* image_height;
+		std::vector<uint8_t> expected(2 * image_bytes), mapped;
+		size_t expected_len;
+		grk_image *image = nullptr, *decompressed = nullptr;
+		grk_stream *stream = nullptr;
+		grk_codec codec = nullptr;
+		bool decompressed_ok;
+
+		stream = grk_stream_create_mem_stream(expected.data(),
+				expected.size(), false, false);
+		if (!stream || !compress(stream)) {
+			spdlog::error("failed to compress to memory stream");
+			grk_stream_destroy(stream);
+			goto cleanup;
+		}
+		expected_len = grk_stream_get_write_mem_stream_length(stream);
+		grk_stream_destroy(stream);
+		expected.resize(expected_len);
+
+		stream = grk_stream_create_mapped_file_stream(argv[1], false);
+		if (!stream || !compress(stream)) {
+			spdlog::error("failed to compress to mapped file {}", argv[1]);
+			grk_stream_destroy(stream);
+			goto cleanup;
+		}
+		// the file is truncated when the stream is destroyed
+		grk_stream_destroy(stream);
+		if (!read_file(argv[1], &mapped) || mapped != expected) {
+			spdlog::error("mapped file has {} bytes, expected {} bytes",
+					mapped.size(), expected.size());
+			goto cleanup;
+		}
+		if (mapped.size() <= image_bytes) {
+			spdlog::error("code stream of {} bytes did not outgrow the "
+					"reserved {} bytes", mapped.size(), image_bytes);
+			goto cleanup;
+		}
+
+		grk_dparameters parameters;
+		grk_set_default_decompress_params(&parameters);
+		image = create_image();
+		stream = grk_stream_create_mapped_file_stream(argv[1], true);
+		codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+		decompressed_ok = image && codec
+				&& grk_init_decompress(codec, &parameters)
+				&& grk_read_header(codec, nullptr, &decompressed)
+				&& grk_decompress(codec, nullptr, decompressed)
+				&& grk_end_decompress(codec)
+				&& same_samples(image, decompressed);
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(decompressed);
+		grk_image_destroy(image);
+		if (!decompressed_ok) {
+			spdlog::error("mapped file does not decompress to original image");
+			goto cleanup;
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
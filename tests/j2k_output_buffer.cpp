@@ -0,0 +1,252 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Output buffer: the image, and an area whose width is not a multiple of
+ * the vector width, are decompressed with grk_set_output_buffer into 8 bit
+ * and 16 bit buffers, with planar and interleaved layout. Every sample must
+ * equal the sample decompressed into a grk_image, clamped to the range of
+ * the sample type, and the padding at the end of each row and plane must
+ * not be written.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+// bytes of padding at end of each row and each plane
+const size_t row_padding = 7;
+const size_t plane_padding = 3;
+const uint8_t sentinel = 0xcd;
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters) {
+		stream = grk_stream_create_file_stream(parameters->infile,
+				1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	bool decompress(const uint32_t *area, const grk_output_buffer *buffer) {
+		if (area
+				&& !grk_set_decompress_area(codec, image, area[0], area[1],
+						area[2], area[3]))
+			return false;
+		if (buffer && !grk_set_output_buffer(codec, buffer))
+			return false;
+
+		return grk_decompress(codec, nullptr, image)
+				&& grk_end_decompress(codec);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+static size_t sample_size(GRK_SAMPLE_TYPE type) {
+	return type == GRK_SAMPLE_UINT8 ? 1 : 2;
+}
+
+/**
+ * Read sample from buffer, clamping reference sample to range of type
+ *
+ * @param ptr		location of sample in buffer
+ * @param ref		reference sample
+ * @param type		sample type
+ */
+static bool same_sample(const uint8_t *ptr, int32_t ref,
+		GRK_SAMPLE_TYPE type) {
+	switch (type) {
+	case GRK_SAMPLE_UINT8:
+		return *ptr == std::clamp<int32_t>(ref, 0, UINT8_MAX);
+	case GRK_SAMPLE_UINT16: {
+		uint16_t val;
+		memcpy(&val, ptr, sizeof(val));
+		return val == std::clamp<int32_t>(ref, 0, UINT16_MAX);
+	}
+	case GRK_SAMPLE_INT16: {
+		int16_t val;
+		memcpy(&val, ptr, sizeof(val));
+		return val == std::clamp<int32_t>(ref, INT16_MIN, INT16_MAX);
+	}
+	default:
+		return false;
+	}
+}
+
+/**
+ * Compare buffer with reference image, and check that padding is untouched
+ */
+static bool matches_image(grk_image *ref, const grk_output_buffer *buffer,
+		size_t len) {
+	auto ss = sample_size(buffer->type);
+	auto numcomps = ref->numcomps;
+	auto w = ref->comps[0].w;
+	auto h = ref->comps[0].h;
+	std::vector<bool> written(len, false);
+	for (uint32_t compno = 0; compno < numcomps; ++compno) {
+		auto comp = ref->comps + compno;
+		if (comp->w != w || comp->h != h || !comp->data)
+			return false;
+		for (uint32_t j = 0; j < h; ++j) {
+			for (uint32_t i = 0; i < w; ++i) {
+				size_t offset =
+						buffer->interleaved ?
+								j * buffer->stride + (i * numcomps + compno) * ss :
+								compno * buffer->plane_stride + j * buffer->stride
+										+ i * ss;
+				if (offset + ss > len
+						|| !same_sample(buffer->data + offset,
+								comp->data[(size_t) j * comp->stride + i],
+								buffer->type)) {
+					spdlog::error("component {} differs at ({},{})", compno, i,
+							j);
+					return false;
+				}
+				std::fill(written.begin() + (ptrdiff_t) offset,
+						written.begin() + (ptrdiff_t) (offset + ss), true);
+			}
+		}
+	}
+	for (size_t k = 0; k < len; ++k) {
+		if (!written[k] && buffer->data[k] != sentinel) {
+			spdlog::error("padding overwritten at offset {}", k);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decompress into buffer of every sample type and layout, and compare
+ * with decompression into image
+ *
+ * @param parameters	decompress parameters
+ * @param area			area to decompress, or nullptr for the full image
+ */
+static bool test_buffers(grk_dparameters *parameters, const uint32_t *area) {
+	TestCodec reference;
+	if (!reference.open(parameters) || !reference.decompress(area, nullptr)) {
+		spdlog::error("failed to decompress {}", parameters->infile);
+		return false;
+	}
+	auto ref = reference.image;
+	const GRK_SAMPLE_TYPE types[] = { GRK_SAMPLE_UINT8, GRK_SAMPLE_UINT16,
+			GRK_SAMPLE_INT16 };
+	for (auto type : types) {
+		for (uint32_t interleaved = 0; interleaved < 2; ++interleaved) {
+			TestCodec codec;
+			grk_output_buffer buffer;
+			memset(&buffer, 0, sizeof(buffer));
+			buffer.type = type;
+			buffer.interleaved = interleaved != 0;
+			buffer.stride = (size_t) ref->comps[0].w * sample_size(type)
+					* (buffer.interleaved ? ref->numcomps : 1) + row_padding;
+			buffer.plane_stride = buffer.stride * ref->comps[0].h
+					+ plane_padding;
+			size_t len =
+					buffer.interleaved ?
+							buffer.stride * ref->comps[0].h :
+							buffer.plane_stride * ref->numcomps;
+			std::vector<uint8_t> data(len, sentinel);
+			buffer.data = data.data();
+			if (!codec.open(parameters) || !codec.decompress(area, &buffer)
+					|| !matches_image(ref, &buffer, len)) {
+				spdlog::error("{} buffer of sample type {} does not match",
+						buffer.interleaved ? "interleaved" : "planar",
+						(int) type);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	{
+		uint32_t area[4];
+		{
+			TestCodec header;
+			if (!header.open(&parameters)) {
+				spdlog::error("failed to open {}", parameters.infile);
+				goto cleanup;
+			}
+			auto image = header.image;
+			uint32_t w = image->x1 - image->x0;
+			uint32_t h = image->y1 - image->y0;
+			// odd width, so that rows end with a partial vector
+			area[0] = image->x0 + w / 8 + 1;
+			area[1] = image->y0 + h / 8;
+			area[2] = image->x0 + (5 * w) / 8 + 4;
+			area[3] = image->y0 + (5 * h) / 8 + 1;
+		}
+		if (!test_buffers(&parameters, nullptr)
+				|| !test_buffers(&parameters, area))
+			goto cleanup;
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
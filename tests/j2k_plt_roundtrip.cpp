@@ -0,0 +1,348 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * PLT round trip: a multi-tile image is compressed with PLT markers, with
+ * the default code block size and with 4x4 code blocks, which give tiles
+ * with many small code blocks. Code streams are compressed losslessly with
+ * one layer and with three layers, with and without SOP/EPH markers, and
+ * lossy with global rate control. The PLT markers of each tile must list
+ * one length per packet, and the lengths must add up to the tile's packet
+ * data. Lossless code streams must decompress to the source image, and
+ * lossy code streams must decompress to the same image as the code stream
+ * with its PLT markers removed.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_comps = 3;
+const uint32_t image_width = 400;
+const uint32_t image_height = 300;
+const uint32_t tile_size = 128;
+const uint32_t num_resolutions = 4;
+
+struct PltConfig {
+	uint32_t cblk_size;
+	uint32_t num_layers;
+	bool sop_eph;
+	bool lossy;
+};
+
+static grk_image* create_image(void) {
+	grk_image_cmptparm params[num_comps];
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto param = params + compno;
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = image_width;
+		param->h = image_height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(num_comps, params, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = image_width;
+	image->y1 = image_height;
+	// gradient with noise, so that packets are large and hard to predict
+	uint32_t seed = 1;
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto comp = image->comps + compno;
+		for (uint32_t j = 0; j < comp->h; ++j) {
+			for (uint32_t i = 0; i < comp->w; ++i) {
+				seed = seed * 1103515245 + 12345;
+				comp->data[(size_t) j * comp->stride + i] = (int32_t) ((i + j
+						+ compno * 40 + (seed >> 24) % 64) & 0xFF);
+			}
+		}
+	}
+
+	return image;
+}
+
+/**
+ * Compress image with PLT markers
+ *
+ * @param config	compression settings
+ * @param dest		code stream
+ */
+static bool compress(const PltConfig &config, std::vector<uint8_t> *dest) {
+	auto image = create_image();
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	parameters.numresolution = num_resolutions;
+	parameters.cblockw_init = config.cblk_size;
+	parameters.cblockh_init = config.cblk_size;
+	parameters.tcp_numlayers = config.num_layers;
+	// zero rates are lossless
+	parameters.cp_disto_alloc = true;
+	if (config.lossy) {
+		for (uint32_t k = 0; k < config.num_layers; ++k)
+			parameters.tcp_rates[k] = (float) (40 >> k);
+		parameters.rateControlAlgorithm = 2;
+	}
+	if (config.sop_eph)
+		parameters.csty |= 0x02 | 0x04;
+	parameters.writePLT = true;
+	// noise does not compress well
+	dest->resize((size_t) 2 * num_comps * image_width * image_height);
+	auto stream = grk_stream_create_mem_stream(dest->data(), dest->size(),
+			false, false);
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_compress(codec, &parameters, image)
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	if (rc)
+		dest->resize(grk_stream_get_write_mem_stream_length(stream));
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+/**
+ * Decompress code stream
+ */
+static grk_image* decompress(std::vector<uint8_t> *codestream) {
+	grk_dparameters parameters;
+	grk_set_default_decompress_params(&parameters);
+	grk_image *image = nullptr;
+	auto stream = grk_stream_create_mem_stream(codestream->data(),
+			codestream->size(), false, true);
+	auto codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_decompress(codec, &parameters)
+			&& grk_read_header(codec, nullptr, &image)
+			&& grk_decompress(codec, nullptr, image)
+			&& grk_end_decompress(codec);
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	if (!rc) {
+		grk_image_destroy(image);
+		image = nullptr;
+	}
+
+	return image;
+}
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static uint32_t read_bytes(const std::vector<uint8_t> &codestream,
+		size_t pos, uint32_t num_bytes) {
+	uint32_t val = 0;
+	for (uint32_t i = 0; i < num_bytes; ++i)
+		val = (val << 8) | codestream[pos + i];
+
+	return val;
+}
+
+static void write_bytes(std::vector<uint8_t> *codestream, size_t pos,
+		uint32_t val, uint32_t num_bytes) {
+	for (uint32_t i = 0; i < num_bytes; ++i)
+		(*codestream)[pos + i] = (uint8_t) (val >> (8 * (num_bytes - 1 - i)));
+}
+
+/**
+ * Copy code stream without its PLT markers, adjusting tile part lengths
+ */
+static void remove_plt(const std::vector<uint8_t> &codestream,
+		std::vector<uint8_t> *dest) {
+	size_t pos = 2;
+	while (pos + 4 <= codestream.size()
+			&& read_bytes(codestream, pos, 2) != 0xFF90)
+		pos += 2 + read_bytes(codestream, pos + 2, 2);
+	dest->assign(codestream.begin(), codestream.begin() + (ptrdiff_t) pos);
+	while (pos + 12 <= codestream.size()
+			&& read_bytes(codestream, pos, 2) == 0xFF90) {
+		uint32_t tile_part_len = read_bytes(codestream, pos + 6, 4);
+		size_t sot_pos = dest->size();
+		size_t end = pos + tile_part_len;
+		dest->insert(dest->end(), codestream.begin() + (ptrdiff_t) pos,
+				codestream.begin() + (ptrdiff_t) pos + 12);
+		pos += 12;
+		while (pos + 4 <= end && read_bytes(codestream, pos, 2) != 0xFF93) {
+			size_t next = pos + 2 + read_bytes(codestream, pos + 2, 2);
+			if (read_bytes(codestream, pos, 2) != 0xFF58)
+				dest->insert(dest->end(), codestream.begin() + (ptrdiff_t) pos,
+						codestream.begin() + (ptrdiff_t) next);
+			pos = next;
+		}
+		dest->insert(dest->end(), codestream.begin() + (ptrdiff_t) pos,
+				codestream.begin() + (ptrdiff_t) end);
+		write_bytes(dest, sot_pos + 6, (uint32_t) (dest->size() - sot_pos), 4);
+		pos = end;
+	}
+	// EOC
+	dest->insert(dest->end(), codestream.begin() + (ptrdiff_t) pos,
+			codestream.end());
+}
+
+/**
+ * Check that the PLT markers of each tile part list one length per packet,
+ * and that the lengths add up to the packet data of the tile part
+ *
+ * @param codestream	code stream with one tile part per tile
+ * @param num_packets	number of packets in each tile
+ */
+static bool check_plt(const std::vector<uint8_t> &codestream,
+		uint32_t num_packets) {
+	// skip SOC and main header
+	size_t pos = 2;
+	while (pos + 4 <= codestream.size()
+			&& read_bytes(codestream, pos, 2) != 0xFF90)
+		pos += 2 + read_bytes(codestream, pos + 2, 2);
+	uint32_t num_tiles = 0;
+	while (pos + 12 <= codestream.size()
+			&& read_bytes(codestream, pos, 2) == 0xFF90) {
+		uint32_t tile_part_len = read_bytes(codestream, pos + 6, 4);
+		if (!tile_part_len || pos + tile_part_len > codestream.size())
+			return false;
+		uint32_t packets = 0;
+		uint64_t packets_len = 0;
+		// tile part header markers follow SOT, up to SOD
+		size_t marker_pos = pos + 12;
+		while (marker_pos + 4 <= codestream.size()
+				&& read_bytes(codestream, marker_pos, 2) != 0xFF93) {
+			uint32_t marker_len = read_bytes(codestream, marker_pos + 2, 2);
+			if (read_bytes(codestream, marker_pos, 2) == 0xFF58) {
+				// skip Zplt, then read lengths, 7 bits per byte
+				uint32_t len = 0;
+				for (size_t i = marker_pos + 5; i < marker_pos + 2 + marker_len;
+						++i) {
+					len = (len << 7) | (codestream[i] & 0x7F);
+					if (!(codestream[i] & 0x80)) {
+						packets++;
+						packets_len += len;
+						len = 0;
+					}
+				}
+			}
+			marker_pos += 2 + marker_len;
+		}
+		// skip SOD
+		uint64_t data_len = pos + tile_part_len - (marker_pos + 2);
+		if (packets != num_packets || packets_len != data_len) {
+			spdlog::error("tile {}: PLT lists {} packets of {} bytes, expected"
+					" {} packets of {} bytes", num_tiles, packets, packets_len,
+					num_packets, data_len);
+			return false;
+		}
+		num_tiles++;
+		pos += tile_part_len;
+	}
+	uint32_t tiles_x = (image_width + tile_size - 1) / tile_size;
+	uint32_t tiles_y = (image_height + tile_size - 1) / tile_size;
+
+	return num_tiles == tiles_x * tiles_y;
+}
+
+int main(int argc, char **argv) {
+	(void) argv;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 1) {
+		spdlog::error("Usage: {}", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	{
+		const PltConfig configs[] = { { 64, 1, false, false },
+				{ 4, 1, false, false }, { 4, 3, true, false },
+				{ 4, 3, false, true }, { 4, 3, true, true } };
+		auto source = create_image();
+		if (!source)
+			goto cleanup;
+		for (auto &config : configs) {
+			std::vector<uint8_t> codestream;
+			grk_image *image = nullptr;
+			grk_image *reference = nullptr;
+			// default precincts: one precinct per resolution
+			uint32_t num_packets = num_comps * num_resolutions
+					* config.num_layers;
+			bool ok = compress(config, &codestream)
+					&& check_plt(codestream, num_packets)
+					&& (image = decompress(&codestream)) != nullptr;
+			if (ok && config.lossy) {
+				std::vector<uint8_t> no_plt;
+				remove_plt(codestream, &no_plt);
+				ok = no_plt.size() < codestream.size()
+						&& (reference = decompress(&no_plt)) != nullptr
+						&& same_samples(image, reference);
+			} else if (ok) {
+				ok = same_samples(image, source);
+			}
+			grk_image_destroy(image);
+			grk_image_destroy(reference);
+			if (!ok) {
+				spdlog::error("PLT round trip failed for {}x{} code blocks,"
+						" {} layers, SOP/EPH {}, lossy {}", config.cblk_size,
+						config.cblk_size, config.num_layers, config.sop_eph,
+						config.lossy);
+				grk_image_destroy(source);
+				goto cleanup;
+			}
+		}
+		grk_image_destroy(source);
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
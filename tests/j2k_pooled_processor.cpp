@@ -0,0 +1,230 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Pooled tile processors: two code streams, with different dimensions,
+ * tile sizes, components and resolutions, and with edge tiles smaller than
+ * the others, are each decompressed several times in a row by one codec:
+ * the whole image, a window across tiles, a window within one tile, then
+ * the whole image again. Tile processors and their buffers are recycled
+ * from one tile, and one decompression, to the next. Every image must
+ * match the same decompression by a new codec.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+struct ImageConfig {
+	uint32_t num_comps;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tile_width;
+	uint32_t tile_height;
+	uint32_t num_resolutions;
+	uint32_t cblk_size;
+};
+
+static grk_image* create_image(const ImageConfig &config) {
+	std::vector<grk_image_cmptparm> params(config.num_comps);
+	for (uint32_t compno = 0; compno < config.num_comps; ++compno) {
+		auto param = &params[compno];
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = config.width;
+		param->h = config.height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(config.num_comps, params.data(),
+			config.num_comps == 3 ? GRK_CLRSPC_SRGB : GRK_CLRSPC_GRAY, true);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = config.width;
+	image->y1 = config.height;
+	uint32_t seed = 1;
+	for (uint32_t compno = 0; compno < config.num_comps; ++compno) {
+		auto comp = image->comps + compno;
+		for (uint32_t j = 0; j < comp->h; ++j) {
+			for (uint32_t i = 0; i < comp->w; ++i) {
+				seed = seed * 1103515245 + 12345;
+				comp->data[(size_t) j * comp->stride + i] = (int32_t) ((i * 3
+						+ j * (compno + 1) + (seed >> 27)) & 0xFF);
+			}
+		}
+	}
+
+	return image;
+}
+
+static bool compress(const ImageConfig &config, std::vector<uint8_t> *dest) {
+	auto image = create_image(config);
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = config.tile_width;
+	parameters.t_height = config.tile_height;
+	parameters.numresolution = config.num_resolutions;
+	parameters.cblockw_init = config.cblk_size;
+	parameters.cblockh_init = config.cblk_size;
+	dest->resize((size_t) 2 * config.num_comps * config.width * config.height);
+	auto stream = grk_stream_create_mem_stream(dest->data(), dest->size(),
+			false, false);
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_compress(codec, &parameters, image)
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	if (rc)
+		dest->resize(grk_stream_get_write_mem_stream_length(stream));
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(std::vector<uint8_t> *codestream) {
+		grk_dparameters parameters;
+		grk_set_default_decompress_params(&parameters);
+		stream = grk_stream_create_mem_stream(codestream->data(),
+				codestream->size(), false, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, &parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	bool decompress(const grk_region &region) {
+		return grk_set_decompress_area(codec, image, region.x0, region.y0,
+				region.x1, region.y1) && grk_decompress(codec, nullptr, image);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->x0 != cb->x0 || ca->y0 != cb->y0 || ca->w != cb->w
+				|| ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decompress a code stream several times with one codec, and compare
+ * each image with the same decompression by a new codec
+ */
+static bool test_pooled(const ImageConfig &config) {
+	std::vector<uint8_t> codestream;
+	if (!compress(config, &codestream)) {
+		spdlog::error("failed to compress {}x{} image", config.width,
+				config.height);
+		return false;
+	}
+	// whole image, across tiles, within one tile, whole image
+	const grk_region regions[] = { { 0, 0, config.width, config.height }, {
+			config.tile_width / 2, config.tile_height / 3, config.width - 5,
+			config.tile_height * 2 + 7 }, { config.tile_width + 3,
+			config.tile_height + 1, config.tile_width * 2 - 9,
+			config.tile_height + config.tile_height / 2 }, { 0, 0, config.width,
+			config.height } };
+	TestCodec pooled;
+	if (!pooled.open(&codestream)) {
+		spdlog::error("failed to open {}x{} code stream", config.width,
+				config.height);
+		return false;
+	}
+	for (auto &region : regions) {
+		TestCodec fresh;
+		if (!pooled.decompress(region) || !fresh.open(&codestream)
+				|| !fresh.decompress(region)
+				|| !same_samples(pooled.image, fresh.image)) {
+			spdlog::error("{}x{} image: region ({},{},{},{}) does not match",
+					config.width, config.height, region.x0, region.y0,
+					region.x1, region.y1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	(void) argv;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 1) {
+		spdlog::error("Usage: {}", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	{
+		const ImageConfig configs[] = { { 3, 600, 500, 128, 128, 5, 64 }, { 1,
+				333, 257, 100, 70, 3, 16 } };
+		for (auto &config : configs) {
+			if (!test_pooled(config))
+				goto cleanup;
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
@@ -0,0 +1,191 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Prefetch file stream: the image is decompressed in one call, and tile by
+ * tile in an order that skips around the code stream, from a stream created
+ * by grk_stream_create_prefetch_file_stream with a read ahead limit of a
+ * quarter of the file. Every result must match the same decompression
+ * from a plain file stream.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const size_t prefetch_buffer_size = 64 * 1024;
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	/**
+	 * Open codec
+	 *
+	 * @param parameters		decompress parameters
+	 * @param prefetch_bytes	read ahead limit of prefetch stream,
+	 * 							or 0 for a plain file stream
+	 */
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters, uint64_t prefetch_bytes) {
+		stream = prefetch_bytes ?
+				grk_stream_create_prefetch_file_stream(parameters->infile,
+						prefetch_buffer_size, prefetch_bytes) :
+				grk_stream_create_file_stream(parameters->infile,
+						1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static uint64_t file_size(const char *fname) {
+	auto fp = fopen(fname, "rb");
+	if (!fp)
+		return 0;
+	uint64_t size = 0;
+	if (!fseek(fp, 0, SEEK_END)) {
+		auto pos = ftell(fp);
+		if (pos > 0)
+			size = (uint64_t) pos;
+	}
+	fclose(fp);
+
+	return size;
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	uint64_t prefetch_bytes;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	prefetch_bytes = file_size(parameters.infile) / 4 + 1;
+	{
+		TestCodec plain, prefetched, plain_tiles, prefetched_tiles;
+		uint16_t num_tiles;
+
+		if (!plain.open(&parameters, 0)
+				|| !grk_decompress(plain.codec, nullptr, plain.image)
+				|| !grk_end_decompress(plain.codec)) {
+			spdlog::error("failed to decompress {}", parameters.infile);
+			goto cleanup;
+		}
+		if (!prefetched.open(&parameters, prefetch_bytes)
+				|| !grk_decompress(prefetched.codec, nullptr, prefetched.image)
+				|| !grk_end_decompress(prefetched.codec)) {
+			spdlog::error("failed to decompress {} through prefetch stream",
+					parameters.infile);
+			goto cleanup;
+		}
+		if (!same_samples(plain.image, prefetched.image)) {
+			spdlog::error("image differs when read through prefetch stream");
+			goto cleanup;
+		}
+
+		if (!plain_tiles.open(&parameters, 0)
+				|| !prefetched_tiles.open(&parameters, prefetch_bytes)) {
+			spdlog::error("failed to open {}", parameters.infile);
+			goto cleanup;
+		}
+		{
+			auto cstr_info = grk_get_cstr_info(plain_tiles.codec);
+			num_tiles = (uint16_t) (cstr_info->t_grid_width
+					* cstr_info->t_grid_height);
+			grk_destroy_cstr_info(&cstr_info);
+		}
+		// tiles are visited with a stride of 7, so that tiles read ahead
+		// are skipped over; each tile is visited if the number of tiles
+		// is a power of two
+		for (uint32_t k = 0; k < num_tiles; ++k) {
+			auto tile_index = (uint16_t) ((k * 7) % num_tiles);
+			if (!grk_decompress_tile(plain_tiles.codec, plain_tiles.image,
+					tile_index)
+					|| !grk_decompress_tile(prefetched_tiles.codec,
+							prefetched_tiles.image, tile_index)) {
+				spdlog::error("failed to decompress tile {}", tile_index);
+				goto cleanup;
+			}
+			if (!same_samples(plain_tiles.image, prefetched_tiles.image)) {
+				spdlog::error("tile {} differs when read through prefetch stream",
+						tile_index);
+				goto cleanup;
+			}
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
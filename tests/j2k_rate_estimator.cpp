@@ -0,0 +1,166 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Rate estimator: a multi-tile image is compressed into four lossy layers
+ * with each rate control algorithm, once with the incremental rate
+ * estimator and once with exact packet simulation only. Both code streams
+ * must be byte-identical, with and without PLT markers.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_comps = 3;
+const uint32_t image_width = 400;
+const uint32_t image_height = 300;
+const uint32_t tile_size = 128;
+const uint32_t num_layers = 4;
+const double rates[num_layers] = { 80, 40, 20, 10 };
+const uint32_t num_algorithms = 3;
+
+static grk_image* create_image(void) {
+	grk_image_cmptparm params[num_comps];
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto param = params + compno;
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = image_width;
+		param->h = image_height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(num_comps, params, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = image_width;
+	image->y1 = image_height;
+	// smooth content with noise that increases to the right
+	uint32_t seed = 1;
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto comp = image->comps + compno;
+		for (uint32_t j = 0; j < comp->h; ++j) {
+			for (uint32_t i = 0; i < comp->w; ++i) {
+				seed = seed * 1103515245 + 12345;
+				int32_t noise = (int32_t) ((seed >> 24) % (4 + (i * 40) / image_width));
+				double v = 128 + 60 * sin(i * 0.02 * (compno + 1)) * cos(j * 0.013)
+						+ noise;
+				comp->data[(size_t) j * comp->stride + i] = std::min<int32_t>(
+						255, std::max<int32_t>(0, (int32_t) v));
+			}
+		}
+	}
+
+	return image;
+}
+
+/**
+ * Compress image into lossy layers
+ *
+ * @param algorithm	rate control algorithm
+ * @param exact		bisect with exact packet simulation only
+ * @param plt		write PLT markers
+ * @param dest		code stream
+ */
+static bool compress(uint32_t algorithm, bool exact, bool plt,
+		std::vector<uint8_t> *dest) {
+	auto image = create_image();
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	parameters.tcp_numlayers = num_layers;
+	for (uint32_t k = 0; k < num_layers; ++k)
+		parameters.tcp_rates[k] = rates[k];
+	parameters.cp_disto_alloc = true;
+	parameters.rateControlAlgorithm = algorithm;
+	parameters.exactRateControl = exact;
+	parameters.writePLT = plt;
+	dest->resize((size_t) num_comps * image_width * image_height);
+	auto stream = grk_stream_create_mem_stream(dest->data(), dest->size(),
+			false, false);
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_compress(codec, &parameters, image)
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	if (rc)
+		dest->resize(grk_stream_get_write_mem_stream_length(stream));
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+int main(int argc, char **argv) {
+	(void) argv;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 1) {
+		spdlog::error("Usage: {}", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	for (uint32_t algorithm = 0; algorithm < num_algorithms; ++algorithm) {
+		// PLT markers are only written under global rate control
+		for (uint32_t k = 0; k < (algorithm == 2 ? 2U : 1U); ++k) {
+			bool plt = k == 1;
+			std::vector<uint8_t> estimated, exact;
+			if (!compress(algorithm, false, plt, &estimated)
+					|| !compress(algorithm, true, plt, &exact)) {
+				spdlog::error("failed to compress with algorithm {}, PLT {}",
+						algorithm, plt);
+				goto cleanup;
+			}
+			if (estimated != exact) {
+				spdlog::error("algorithm {}, PLT {}: code stream of {} bytes"
+						" with rate estimator differs from code stream of {}"
+						" bytes with exact simulation", algorithm, plt,
+						estimated.size(), exact.size());
+				goto cleanup;
+			}
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
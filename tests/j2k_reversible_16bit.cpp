@@ -0,0 +1,184 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * 16 bit reversible wavelet: each tile of a low precision image compressed
+ * with the 5/3 wavelet is decompressed whole, which transforms 16 bit
+ * coefficients, and as an area one sample inside the tile, which transforms
+ * 32 bit coefficients, for each number of quality layers. The area must
+ * match the same samples of the whole tile.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters) {
+		stream = grk_stream_create_file_stream(parameters->infile,
+				1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+/**
+ * Compare area with the same samples of the tile
+ */
+static bool matches_tile(grk_image *area, grk_image *tile) {
+	for (uint32_t compno = 0; compno < area->numcomps; ++compno) {
+		auto ac = area->comps + compno;
+		auto tc = tile->comps + compno;
+		if (!ac->data || !tc->data || ac->x0 < tc->x0 || ac->y0 < tc->y0
+				|| ac->x0 - tc->x0 + ac->w > tc->w
+				|| ac->y0 - tc->y0 + ac->h > tc->h)
+			return false;
+		for (uint32_t j = 0; j < ac->h; ++j) {
+			auto tile_row = tc->data
+					+ (size_t) (ac->y0 - tc->y0 + j) * tc->stride
+					+ (ac->x0 - tc->x0);
+			if (memcmp(ac->data + (size_t) j * ac->stride, tile_row,
+					ac->w * sizeof(int32_t))) {
+				spdlog::error("component {} differs in row {}", compno,
+						ac->y0 + j);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	{
+		TestCodec header;
+		uint32_t num_layers, grid_width, grid_height;
+		uint32_t tx0, ty0, t_width, t_height;
+
+		if (!header.open(&parameters)) {
+			spdlog::error("failed to open {}", parameters.infile);
+			goto cleanup;
+		}
+		{
+			auto cstr_info = grk_get_cstr_info(header.codec);
+			bool reversible = cstr_info->m_default_tile_info.tccp_info[0].qmfbid
+					== 1;
+			num_layers = cstr_info->m_default_tile_info.numlayers;
+			grid_width = cstr_info->t_grid_width;
+			grid_height = cstr_info->t_grid_height;
+			tx0 = cstr_info->tx0;
+			ty0 = cstr_info->ty0;
+			t_width = cstr_info->t_width;
+			t_height = cstr_info->t_height;
+			grk_destroy_cstr_info(&cstr_info);
+			if (!reversible) {
+				spdlog::error("{} is not compressed with the 5/3 wavelet",
+						parameters.infile);
+				goto cleanup;
+			}
+		}
+		auto image = header.image;
+		for (uint32_t layers = 1; layers <= num_layers; ++layers) {
+			auto layered = parameters;
+			layered.cp_layer = (uint16_t) layers;
+			for (uint32_t ty = 0; ty < grid_height; ++ty) {
+				for (uint32_t tx = 0; tx < grid_width; ++tx) {
+					auto tile_index = (uint16_t) (ty * grid_width + tx);
+					uint32_t x0 = std::max(image->x0, tx0 + tx * t_width);
+					uint32_t y0 = std::max(image->y0, ty0 + ty * t_height);
+					uint32_t x1 = std::min(image->x1, tx0 + (tx + 1) * t_width);
+					uint32_t y1 = std::min(image->y1, ty0 + (ty + 1) * t_height);
+					if (x1 - x0 < 3 || y1 - y0 < 3)
+						continue;
+					TestCodec whole, area;
+					if (!whole.open(&layered)
+							|| !grk_decompress_tile(whole.codec, whole.image,
+									tile_index)) {
+						spdlog::error("failed to decompress tile {}",
+								tile_index);
+						goto cleanup;
+					}
+					if (!area.open(&layered)
+							|| !grk_set_decompress_area(area.codec, area.image,
+									x0 + 1, y0 + 1, x1 - 1, y1 - 1)
+							|| !grk_decompress(area.codec, nullptr, area.image)) {
+						spdlog::error("failed to decompress area of tile {}",
+								tile_index);
+						goto cleanup;
+					}
+					if (!matches_tile(area.image, whole.image)) {
+						spdlog::error("tile {} with {} layers does not match",
+								tile_index, layers);
+						goto cleanup;
+					}
+				}
+			}
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
@@ -0,0 +1,256 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Strip sink: an image whose height is not a multiple of the tile height
+ * is compressed losslessly, then decompressed with grk_set_strip_sink,
+ * at full resolution and at reduce 1. One strip must be delivered for each
+ * row of tiles, from top to bottom, with a shorter last strip, and the rows
+ * of all strips must match the image decompressed without a sink.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_comps = 3;
+const uint32_t image_width = 600;
+const uint32_t image_height = 500;
+const uint32_t tile_size = 128;
+
+struct Strip {
+	uint32_t y0;
+	uint32_t h;
+	// rows of each component, packed
+	std::vector<int32_t> rows[num_comps];
+};
+
+/**
+ * Copy strip, since strip data is only valid during the call
+ */
+static bool collect_strip(grk_image *strip, void *user_data) {
+	auto strips = (std::vector<Strip>*) user_data;
+	if (strip->numcomps != num_comps)
+		return false;
+	Strip copy;
+	copy.y0 = strip->comps[0].y0;
+	copy.h = strip->comps[0].h;
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto comp = strip->comps + compno;
+		if (!comp->data || comp->y0 != copy.y0 || comp->h != copy.h)
+			return false;
+		for (uint32_t j = 0; j < comp->h; ++j)
+			copy.rows[compno].insert(copy.rows[compno].end(),
+					comp->data + (size_t) j * comp->stride,
+					comp->data + (size_t) j * comp->stride + comp->w);
+	}
+	strips->push_back(copy);
+
+	return true;
+}
+
+static grk_image* create_image(void) {
+	grk_image_cmptparm params[num_comps];
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto param = params + compno;
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = image_width;
+		param->h = image_height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(num_comps, params, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = image_width;
+	image->y1 = image_height;
+	uint32_t seed = 1;
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto comp = image->comps + compno;
+		for (uint32_t j = 0; j < comp->h; ++j) {
+			for (uint32_t i = 0; i < comp->w; ++i) {
+				seed = seed * 1103515245 + 12345;
+				comp->data[(size_t) j * comp->stride + i] = (int32_t) ((i + j
+						+ (seed >> 28)) & 0xFF);
+			}
+		}
+	}
+
+	return image;
+}
+
+static bool compress(std::vector<uint8_t> *dest) {
+	auto image = create_image();
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	dest->resize((size_t) 2 * num_comps * image_width * image_height);
+	auto stream = grk_stream_create_mem_stream(dest->data(), dest->size(),
+			false, false);
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_compress(codec, &parameters, image)
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	if (rc)
+		dest->resize(grk_stream_get_write_mem_stream_length(stream));
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+/**
+ * Decompress code stream
+ *
+ * @param codestream	code stream
+ * @param reduce		number of resolutions to discard
+ * @param strips		strips delivered to sink, or nullptr to
+ * 						decompress to the output image
+ * @param image			output image
+ */
+static bool decompress(std::vector<uint8_t> *codestream, uint32_t reduce,
+		std::vector<Strip> *strips, grk_image **image) {
+	grk_dparameters parameters;
+	grk_set_default_decompress_params(&parameters);
+	parameters.cp_reduce = reduce;
+	*image = nullptr;
+	auto stream = grk_stream_create_mem_stream(codestream->data(),
+			codestream->size(), false, true);
+	auto codec = grk_create_decompress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_decompress(codec, &parameters)
+			&& grk_read_header(codec, nullptr, image)
+			&& (!strips || grk_set_strip_sink(codec, collect_strip, strips))
+			&& grk_decompress(codec, nullptr, *image)
+			&& grk_end_decompress(codec);
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+
+	return rc;
+}
+
+/**
+ * Check that strips cover the rows of the expected image, one strip
+ * for each row of tiles, and hold the same samples
+ */
+static bool check_strips(const std::vector<Strip> &strips, grk_image *expected,
+		grk_image *sunk, uint32_t reduce) {
+	uint32_t strip_height = tile_size >> reduce;
+	uint32_t num_strips = (image_height + tile_size - 1) / tile_size;
+	if (strips.size() != num_strips) {
+		spdlog::error("{} strips delivered, expected {}", strips.size(),
+				num_strips);
+		return false;
+	}
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		if (sunk->comps[compno].data) {
+			spdlog::error("output image holds data with a strip sink");
+			return false;
+		}
+	}
+	// as for the output image, component y0 is not reduced,
+	// so rows are counted at the reduced resolution
+	uint32_t y0 = 0;
+	for (size_t k = 0; k < strips.size(); ++k) {
+		auto &strip = strips[k];
+		bool last = k == strips.size() - 1;
+		uint32_t h = last ?
+				expected->comps[0].h - (uint32_t) k * strip_height : strip_height;
+		uint32_t strip_y0 = (strip.y0 >> reduce)
+				- (expected->comps[0].y0 >> reduce);
+		if (strip_y0 != y0 || strip.h != h) {
+			spdlog::error("strip {} has rows [{},{}), expected [{},{})", k,
+					strip_y0, strip_y0 + strip.h, y0, y0 + h);
+			return false;
+		}
+		for (uint32_t compno = 0; compno < num_comps; ++compno) {
+			auto comp = expected->comps + compno;
+			for (uint32_t j = 0; j < h; ++j) {
+				auto row = comp->data + (size_t) (y0 + j) * comp->stride;
+				if (memcmp(row, strip.rows[compno].data() + (size_t) j * comp->w,
+						comp->w * sizeof(int32_t))) {
+					spdlog::error("strip {} row {} of component {} differs", k,
+							j, compno);
+					return false;
+				}
+			}
+		}
+		y0 += h;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	(void) argv;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 1) {
+		spdlog::error("Usage: {}", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	{
+		std::vector<uint8_t> codestream;
+		if (!compress(&codestream)) {
+			spdlog::error("failed to compress image");
+			goto cleanup;
+		}
+		for (uint32_t reduce = 0; reduce < 2; ++reduce) {
+			grk_image *expected = nullptr;
+			grk_image *sunk = nullptr;
+			std::vector<Strip> strips;
+			bool ok = decompress(&codestream, reduce, nullptr, &expected)
+					&& decompress(&codestream, reduce, &strips, &sunk)
+					&& check_strips(strips, expected, sunk, reduce);
+			grk_image_destroy(expected);
+			grk_image_destroy(sunk);
+			if (!ok) {
+				spdlog::error("strip sink failed at reduce {}", reduce);
+				goto cleanup;
+			}
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
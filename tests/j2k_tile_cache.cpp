@@ -0,0 +1,236 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Viewer loop through the tile caches: two overlapping areas are
+ * decompressed on one codec with grk_set_decompress_area and grk_decompress,
+ * and the second area is then decompressed again at a lower resolution.
+ * Each area must match the same area decompressed by a new codec, and
+ * the tile cache statistics must show that tiles shared by the areas
+ * were copied from the cache, and that the compressed data of the tiles
+ * was not read again for the lower resolution.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <set>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters) {
+		stream = grk_stream_create_file_stream(parameters->infile,
+				1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	bool decompress(const uint32_t *area) {
+		return grk_set_decompress_area(codec, image, area[0], area[1],
+				area[2], area[3]) && grk_decompress(codec, nullptr, image);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decompress area with a new codec, and compare with image
+ */
+static bool matches_new_codec(grk_dparameters *parameters, const uint32_t *area,
+		grk_image *image) {
+	TestCodec reference;
+	if (!reference.open(parameters) || !reference.decompress(area))
+		return false;
+
+	return same_samples(reference.image, image);
+}
+
+static std::set<uint32_t> area_tiles(grk_codestream_info_v2 *info,
+		const uint32_t *area) {
+	std::set<uint32_t> tiles;
+	for (uint32_t y = (area[1] - info->ty0) / info->t_height;
+			y <= (area[3] - 1 - info->ty0) / info->t_height; ++y) {
+		for (uint32_t x = (area[0] - info->tx0) / info->t_width;
+				x <= (area[2] - 1 - info->tx0) / info->t_width; ++x)
+			tiles.insert(y * info->t_grid_width + x);
+	}
+
+	return tiles;
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	{
+		TestCodec viewer;
+		grk_tile_cache_stats stats;
+		uint32_t first[4], second[4];
+		uint64_t shared_tiles = 0, first_tiles, second_tiles;
+		uint64_t cache_bytes;
+
+		if (!viewer.open(&parameters)) {
+			spdlog::error("failed to open {}", parameters.infile);
+			goto cleanup;
+		}
+		{
+			auto image = viewer.image;
+			uint32_t w = image->x1 - image->x0;
+			uint32_t h = image->y1 - image->y0;
+			first[0] = image->x0 + w / 8;
+			first[1] = image->y0 + h / 8;
+			first[2] = image->x0 + (5 * w) / 8;
+			first[3] = image->y0 + (5 * h) / 8;
+			second[0] = image->x0 + (3 * w) / 8;
+			second[1] = image->y0 + (3 * h) / 8;
+			second[2] = image->x0 + (7 * w) / 8;
+			second[3] = image->y0 + (7 * h) / 8;
+
+			// large enough to hold every tile, so that nothing is evicted
+			uint64_t image_bytes = 0;
+			for (uint32_t compno = 0; compno < image->numcomps; ++compno)
+				image_bytes += (uint64_t) image->comps[compno].w
+						* image->comps[compno].h * sizeof(int32_t);
+			cache_bytes = 2 * image_bytes;
+			auto cached = parameters;
+			cached.tile_cache_size = cache_bytes;
+			cached.tile_coding_cache_size = cache_bytes;
+			if (!grk_init_decompress(viewer.codec, &cached)) {
+				spdlog::error("failed to enable tile cache");
+				goto cleanup;
+			}
+
+			auto info = grk_get_cstr_info(viewer.codec);
+			auto first_set = area_tiles(info, first);
+			auto second_set = area_tiles(info, second);
+			grk_destroy_cstr_info(&info);
+			first_tiles = first_set.size();
+			second_tiles = second_set.size();
+			for (auto tile : second_set)
+				shared_tiles += first_set.count(tile);
+		}
+
+		if (!viewer.decompress(first)
+				|| !matches_new_codec(&parameters, first, viewer.image)) {
+			spdlog::error("first area does not match");
+			goto cleanup;
+		}
+		if (!viewer.decompress(second)
+				|| !matches_new_codec(&parameters, second, viewer.image)) {
+			spdlog::error("second area does not match");
+			goto cleanup;
+		}
+		if (!grk_get_tile_cache_stats(viewer.codec, &stats)
+				|| stats.tile_hits != shared_tiles
+				|| stats.tile_misses != first_tiles + second_tiles - shared_tiles
+				|| stats.tile_evictions != 0) {
+			spdlog::error("expected {} tile hits and {} misses, got {} and {}",
+					shared_tiles, first_tiles + second_tiles - shared_tiles,
+					stats.tile_hits, stats.tile_misses);
+			goto cleanup;
+		}
+
+		// zoom out: the caches are kept, since only reduce changes, and tiles
+		// are decompressed again from their retained compressed data
+		parameters.cp_reduce = 1;
+		{
+			auto zoom = parameters;
+			zoom.tile_cache_size = cache_bytes;
+			zoom.tile_coding_cache_size = cache_bytes;
+			if (!grk_init_decompress(viewer.codec, &zoom)) {
+				spdlog::error("failed to change reduce");
+				goto cleanup;
+			}
+		}
+		if (!viewer.decompress(second)
+				|| !matches_new_codec(&parameters, second, viewer.image)) {
+			spdlog::error("second area does not match at reduce 1");
+			goto cleanup;
+		}
+		if (!grk_get_tile_cache_stats(viewer.codec, &stats)
+				|| stats.tile_misses
+						!= first_tiles + 2 * second_tiles - shared_tiles
+				|| stats.coding_state_hits != second_tiles) {
+			spdlog::error("expected {} coding state hits, got {}", second_tiles,
+					stats.coding_state_hits);
+			goto cleanup;
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
@@ -0,0 +1,176 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Round trip of the serialized tile part index: the index is written
+ * from one codec, loaded into a second codec opened on the same file,
+ * and the last tile decompressed through the loaded index must match
+ * the same tile decompressed by the first codec.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters) {
+		stream = grk_stream_create_file_stream(parameters->infile,
+				1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		return codec && grk_init_decompress(codec, parameters)
+				&& grk_read_header(codec, nullptr, &image);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+};
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	{
+		TestCodec writer, reader, tampered;
+		size_t len = 0;
+		std::vector<uint8_t> index;
+		uint16_t last_tile;
+
+		if (!writer.open(&parameters)) {
+			spdlog::error("failed to open {}", parameters.infile);
+			goto cleanup;
+		}
+		if (!grk_write_index(writer.codec, nullptr, &len) || !len) {
+			spdlog::error("failed to query index length");
+			goto cleanup;
+		}
+		index.resize(len);
+		if (!grk_write_index(writer.codec, index.data(), &len)) {
+			spdlog::error("failed to write index");
+			goto cleanup;
+		}
+		{
+			auto cstr_info = grk_get_cstr_info(writer.codec);
+			last_tile = (uint16_t) (cstr_info->t_grid_width
+					* cstr_info->t_grid_height - 1);
+			grk_destroy_cstr_info(&cstr_info);
+		}
+		if (!grk_decompress_tile(writer.codec, writer.image, last_tile)) {
+			spdlog::error("failed to decompress tile {}", last_tile);
+			goto cleanup;
+		}
+
+		if (!reader.open(&parameters)) {
+			spdlog::error("failed to reopen {}", parameters.infile);
+			goto cleanup;
+		}
+		if (!grk_read_index(reader.codec, index.data(), len)) {
+			spdlog::error("index written for {} was rejected",
+					parameters.infile);
+			goto cleanup;
+		}
+		if (!grk_decompress_tile(reader.codec, reader.image, last_tile)) {
+			spdlog::error("failed to decompress tile {} through index",
+					last_tile);
+			goto cleanup;
+		}
+		if (!same_samples(writer.image, reader.image)) {
+			spdlog::error("tile {} differs when located through index",
+					last_tile);
+			goto cleanup;
+		}
+
+		// an index that does not match the main header is ignored
+		if (!tampered.open(&parameters))
+			goto cleanup;
+		index[len - 1] ^= 0xFF;
+		index[16] ^= 0xFF;
+		if (grk_read_index(tampered.codec, index.data(), len)) {
+			spdlog::error("tampered index was accepted");
+			goto cleanup;
+		}
+		if (!grk_decompress_tile(tampered.codec, tampered.image, last_tile)
+				|| !same_samples(writer.image, tampered.image)) {
+			spdlog::error("failed to decompress tile {} without index",
+					last_tile);
+			goto cleanup;
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
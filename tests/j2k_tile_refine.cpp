@@ -0,0 +1,231 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Tile refinement with refine_tiles: every tile is decompressed with one
+ * quality layer, and then again with two quality layers on the same codec.
+ * Each refined tile must match the same tile decompressed with two layers
+ * by a new codec. This is done once with a decoder state cache large enough
+ * for every tile, and once with the smallest cache, which keeps the state
+ * of the last tile only. Tiles are then refined in the same way from
+ * reduce 2 to full resolution.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+struct TestCodec {
+	TestCodec() : stream(nullptr), codec(nullptr), image(nullptr), x0(0), y0(0), x1(
+			0), y1(0) {
+	}
+	~TestCodec() {
+		grk_destroy_codec(codec);
+		grk_stream_destroy(stream);
+		grk_image_destroy(image);
+	}
+	bool open(grk_dparameters *parameters) {
+		stream = grk_stream_create_file_stream(parameters->infile,
+				1024 * 1024, true);
+		if (!stream)
+			return false;
+		codec = grk_create_decompress(
+				parameters->decod_format == GRK_JP2_FMT ?
+						GRK_CODEC_JP2 : GRK_CODEC_J2K, stream);
+
+		if (!codec || !grk_init_decompress(codec, parameters)
+				|| !grk_read_header(codec, nullptr, &image))
+			return false;
+		x0 = image->x0;
+		y0 = image->y0;
+		x1 = image->x1;
+		y1 = image->y1;
+
+		return true;
+	}
+	/**
+	 * Decompress tile into image, which is first reset to the image bounds
+	 */
+	bool decompress_tile(uint16_t tile_index) {
+		image->x0 = x0;
+		image->y0 = y0;
+		image->x1 = x1;
+		image->y1 = y1;
+
+		return grk_decompress_tile(codec, image, tile_index);
+	}
+	grk_stream *stream;
+	grk_codec codec;
+	grk_image *image;
+	// image bounds read from header
+	uint32_t x0, y0, x1, y1;
+};
+
+static bool same_samples(grk_image *a, grk_image *b) {
+	if (a->numcomps != b->numcomps)
+		return false;
+	for (uint32_t compno = 0; compno < a->numcomps; ++compno) {
+		auto ca = a->comps + compno;
+		auto cb = b->comps + compno;
+		if (ca->w != cb->w || ca->h != cb->h || !ca->data || !cb->data)
+			return false;
+		for (uint32_t j = 0; j < ca->h; ++j) {
+			if (memcmp(ca->data + (size_t) j * ca->stride,
+					cb->data + (size_t) j * cb->stride,
+					ca->w * sizeof(int32_t)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Decompress every tile with coarse parameters, then refine every tile
+ * with fine parameters
+ *
+ * @param coarse			parameters of first decompression
+ * @param fine				parameters of refinement
+ * @param num_tiles			number of tiles
+ * @param cache_size		size of decoder state cache
+ * @param stats				cache statistics after refinement
+ */
+static bool refine(const grk_dparameters *coarse, const grk_dparameters *fine,
+		uint16_t num_tiles, uint64_t cache_size, grk_tile_cache_stats *stats) {
+	TestCodec viewer;
+	auto refined = *coarse;
+	refined.refine_tiles = true;
+	refined.tile_refine_cache_size = cache_size;
+	if (!viewer.open(&refined))
+		return false;
+	for (uint16_t tile_index = 0; tile_index < num_tiles; ++tile_index) {
+		if (!viewer.decompress_tile(tile_index)) {
+			spdlog::error("failed to decompress tile {}", tile_index);
+			return false;
+		}
+	}
+	refined = *fine;
+	refined.refine_tiles = true;
+	refined.tile_refine_cache_size = cache_size;
+	if (!grk_init_decompress(viewer.codec, &refined))
+		return false;
+	auto fresh = *fine;
+	for (uint16_t tile_index = 0; tile_index < num_tiles; ++tile_index) {
+		TestCodec reference;
+		if (!viewer.decompress_tile(tile_index) || !reference.open(&fresh)
+				|| !reference.decompress_tile(tile_index)
+				|| !same_samples(reference.image, viewer.image)) {
+			spdlog::error("refined tile {} does not match", tile_index);
+			return false;
+		}
+	}
+
+	return grk_get_tile_cache_stats(viewer.codec, stats);
+}
+
+int main(int argc, char **argv) {
+	grk_dparameters parameters;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 2) {
+		spdlog::error("Usage: {} <input_file>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, 0);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	grk_set_default_decompress_params(&parameters);
+	strncpy(parameters.infile, argv[1], GRK_PATH_LEN - 1);
+	if (!grk::jpeg2000_file_format(parameters.infile,
+			&parameters.decod_format)) {
+		spdlog::error("Failed to detect JPEG 2000 file format for file {}",
+				parameters.infile);
+		return EXIT_FAILURE;
+	}
+	{
+		TestCodec header;
+		grk_tile_cache_stats stats;
+		uint16_t num_tiles;
+		auto coarse = parameters, fine = parameters;
+
+		if (!header.open(&parameters)) {
+			spdlog::error("failed to open {}", parameters.infile);
+			goto cleanup;
+		}
+		{
+			auto cstr_info = grk_get_cstr_info(header.codec);
+			num_tiles = (uint16_t) (cstr_info->t_grid_width
+					* cstr_info->t_grid_height);
+			bool layered = cstr_info->m_default_tile_info.numlayers >= 2;
+			grk_destroy_cstr_info(&cstr_info);
+			if (!layered) {
+				spdlog::error("{} has fewer than two layers", parameters.infile);
+				goto cleanup;
+			}
+		}
+
+		coarse.cp_layer = 1;
+		fine.cp_layer = 2;
+		if (!refine(&coarse, &fine, num_tiles, 1ULL << 32, &stats))
+			goto cleanup;
+		if (stats.refine_state_evictions != 0 || !stats.refine_state_bytes) {
+			spdlog::error("expected no decoder state evictions, got {}",
+					stats.refine_state_evictions);
+			goto cleanup;
+		}
+
+		// the state of the last tile is kept, whatever its size, so the state
+		// of every other tile is released after each tile is decompressed
+		if (!refine(&coarse, &fine, num_tiles, 1, &stats))
+			goto cleanup;
+		if (stats.refine_state_evictions != 2 * (uint64_t) num_tiles - 1
+				|| !stats.refine_state_bytes) {
+			spdlog::error("expected {} decoder state evictions, got {}",
+					2 * (uint64_t) num_tiles - 1, stats.refine_state_evictions);
+			goto cleanup;
+		}
+
+		// zoom in: lower resolutions reconstructed at reduce 2 are reused
+		coarse = parameters;
+		coarse.cp_reduce = 2;
+		fine = parameters;
+		if (!refine(&coarse, &fine, num_tiles, 1ULL << 32, &stats))
+			goto cleanup;
+		if (stats.refine_state_evictions != 0) {
+			spdlog::error("expected no decoder state evictions, got {}",
+					stats.refine_state_evictions);
+			goto cleanup;
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
@@ -0,0 +1,157 @@
+/*
+ *    Copyright (C) 2016-2020 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Tile window: a multi-tile image is compressed by several threads with
+ * tile windows of 2, 3 and 8 tiles, and with the default window, with and
+ * without TLM and PLT markers. Each code stream must be byte-identical to
+ * the code stream compressed with a window of one tile.
+ */
+
+#include "grk_config.h"
+#include "common.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+static void error_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::error("{}", msg);
+}
+static void warning_callback(const char *msg, void *client_data) {
+	(void) client_data;
+	spdlog::warn("{}", msg);
+}
+
+const uint32_t num_threads = 4;
+const uint32_t num_comps = 3;
+const uint32_t image_width = 600;
+const uint32_t image_height = 500;
+const uint32_t tile_size = 64;
+
+static grk_image* create_image(void) {
+	grk_image_cmptparm params[num_comps];
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto param = params + compno;
+		memset(param, 0, sizeof(grk_image_cmptparm));
+		param->dx = 1;
+		param->dy = 1;
+		param->w = image_width;
+		param->h = image_height;
+		param->prec = 8;
+		param->sgnd = false;
+	}
+	auto image = grk_image_create(num_comps, params, GRK_CLRSPC_SRGB, true);
+	if (!image)
+		return nullptr;
+	image->x0 = 0;
+	image->y0 = 0;
+	image->x1 = image_width;
+	image->y1 = image_height;
+	// content varies from tile to tile, so that tiles compress
+	// to different lengths and finish in a different order
+	for (uint32_t compno = 0; compno < num_comps; ++compno) {
+		auto comp = image->comps + compno;
+		for (uint32_t j = 0; j < comp->h; ++j) {
+			for (uint32_t i = 0; i < comp->w; ++i)
+				comp->data[(size_t) j * comp->stride + i] = (int32_t) (((i
+						* (compno + 1)) ^ (j * (1 + (i / tile_size) % 5)))
+						& 0xFF);
+		}
+	}
+
+	return image;
+}
+
+/**
+ * Compress image
+ *
+ * @param window	maximum number of tiles in flight
+ * @param markers	write TLM and PLT markers
+ * @param dest		code stream
+ */
+static bool compress(uint32_t window, bool markers,
+		std::vector<uint8_t> *dest) {
+	auto image = create_image();
+	if (!image)
+		return false;
+	grk_cparameters parameters;
+	grk_set_default_compress_params(&parameters);
+	parameters.tile_size_on = true;
+	parameters.t_width = tile_size;
+	parameters.t_height = tile_size;
+	parameters.numThreads = num_threads;
+	parameters.tileWindow = window;
+	parameters.writeTLM = markers;
+	parameters.writePLT = markers;
+	dest->resize((size_t) 2 * num_comps * image_width * image_height);
+	auto stream = grk_stream_create_mem_stream(dest->data(), dest->size(),
+			false, false);
+	auto codec = grk_create_compress(GRK_CODEC_J2K, stream);
+	bool rc = stream && codec && grk_init_compress(codec, &parameters, image)
+			&& grk_start_compress(codec) && grk_compress(codec)
+			&& grk_end_compress(codec);
+	if (rc)
+		dest->resize(grk_stream_get_write_mem_stream_length(stream));
+	grk_destroy_codec(codec);
+	grk_stream_destroy(stream);
+	grk_image_destroy(image);
+
+	return rc;
+}
+
+int main(int argc, char **argv) {
+	(void) argv;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 1) {
+		spdlog::error("Usage: {}", argv[0]);
+		return EXIT_FAILURE;
+	}
+	grk_initialize(nullptr, num_threads);
+	grk_set_warning_handler(warning_callback, nullptr);
+	grk_set_error_handler(error_callback, nullptr);
+	{
+		// 0: default window
+		const uint32_t windows[] = { 2, 3, 8, 0 };
+		for (uint32_t k = 0; k < 2; ++k) {
+			bool markers = k == 1;
+			std::vector<uint8_t> reference;
+			if (!compress(1, markers, &reference)) {
+				spdlog::error("failed to compress with a window of one tile");
+				goto cleanup;
+			}
+			for (auto window : windows) {
+				std::vector<uint8_t> codestream;
+				if (!compress(window, markers, &codestream)
+						|| codestream != reference) {
+					spdlog::error("code stream with window {}, markers {}"
+							" does not match window of one tile", window,
+							markers);
+					goto cleanup;
+				}
+			}
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+cleanup:
+	grk_deinitialize();
+
+	return rc;
+}
@@ -112,11 +112,13 @@ int main(int argc, char *argv[]) {
 	uint32_t comp_prec;
 	bool irreversible;
 	const char *output_file;
+	uint32_t num_layers = 1;
 
 	grk_initialize(nullptr, 0);
 
-	/* should be test_tile_encoder 3 2000 2000 1000 1000 8 tte1.j2k */
-	if (argc == 9) {
+	/* should be test_tile_encoder 3 2000 2000 1000 1000 8 tte1.j2k,
+	 * optionally followed by number of quality layers */
+	if (argc == 9 || argc == 10) {
 		num_comps = (uint32_t)atoi(argv[1]);
 		image_width = (uint32_t)atoi(argv[2]);
 		image_height = (uint32_t)atoi(argv[3]);
@@ -125,6 +127,8 @@ int main(int argc, char *argv[]) {
 		comp_prec = (uint32_t)atoi(argv[6]);
 		irreversible = atoi(argv[7]) ? true : false;
 		output_file = argv[8];
+		if (argc == 10)
+			num_layers = (uint32_t)atoi(argv[9]);
 	} else {
 		num_comps = 3U;
 		image_width = 2000U;
@@ -135,7 +139,8 @@ int main(int argc, char *argv[]) {
 		irreversible = true;
 		output_file = "test.j2k";
 	}
-	if (num_comps > NUM_COMPS_MAX) {
+	if (num_comps > NUM_COMPS_MAX || !num_layers
+			|| num_layers > sizeof(param.tcp_distoratio) / sizeof(double)) {
 		rc = 1;
 		goto cleanup;
 	}
@@ -154,16 +159,27 @@ int main(int argc, char *argv[]) {
 
 	spdlog::info(
 			"Encoding random values -> keep in mind that this is very hard to compress");
-	for (i = 0; i < data_size; ++i)
-		data[i] = (uint8_t) i;
+	if (num_layers == 1) {
+		for (i = 0; i < data_size; ++i)
+			data[i] = (uint8_t) i;
+	} else {
+		// a ramp is already lossless in the first layer, so that
+		// each layer only adds detail if samples are random
+		uint32_t seed = 1;
+		for (i = 0; i < data_size; ++i) {
+			seed = seed * 1103515245 + 12345;
+			data[i] = (uint8_t) (seed >> 24);
+		}
+	}
 
 	grk_set_default_compress_params(&param);
 	/** you may here add custom encoding parameters */
 	/* rate specifications */
 	/** number of quality layers in the stream */
-	param.tcp_numlayers = 1;
+	param.tcp_numlayers = num_layers;
 	param.cp_fixed_quality = true;
-	param.tcp_distoratio[0] = 20;
+	for (i = 0; i < num_layers; ++i)
+		param.tcp_distoratio[i] = (double)(20 + 10 * i);
 	/* is using others way of calculation */
 	/* param.cp_disto_alloc = 1 or param.cp_fixed_alloc = 1 */
 	/* param.tcp_rates[0] = ... */